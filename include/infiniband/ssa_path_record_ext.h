@@ -0,0 +1,921 @@
+/*
+ * Copyright 2004-2013 Mellanox Technologies LTD. All rights reserved.
+ *
+ * This software is available to you under the terms of the
+ * OpenIB.org BSD license included below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#ifndef SSA_PATH_RECORD_EXT_H
+#define SSA_PATH_RECORD_EXT_H
+
+/*
+ * Extended SSA Access Layer API.
+ * The file complements ssa_path_record.h with interfaces that are
+ * implemented by the access layer only.
+ */
+
+#include <infiniband/ssa_db.h>
+#include <infiniband/ssa_path_record.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Batch callback. It gets an array of path records. The array is valid
+ * only during the call.
+ */
+typedef void (*ssa_pr_path_batch_dump_t)(const ssa_path_parms_t *p_paths,
+		size_t count,
+		void *prm);
+
+/**
+ * ssa_pr_half_world_batch - "half world" computation with a batch callback
+ * @p_ssa_db_smdb: Pointer to smdb database
+ * @context: Path record calculation context
+ * @port_guid: Source port GUID in network order
+ * @batch_clbk: Callback for arrays of computed path records
+ * @clbk_prm: Callback's parameter
+ *
+ * @return value: SSA_PR_SUCCESS - success; otherwise - failure
+ *
+ * The same as ssa_pr_half_world. Path records are passed to the callback
+ * in the same order, in portions of up to 256 records. Records are written
+ * directly to the batch buffer, without a per record callback. If the
+ * computation fails, records computed before the failure are passed to
+ * the callback before the function returns.
+ **/
+extern ssa_pr_status_t ssa_pr_half_world_batch(struct ssa_db *p_ssa_db_smdb,
+		void *context,
+		be64_t port_guid,
+		ssa_pr_path_batch_dump_t batch_clbk,
+		void *clbk_prm);
+
+/**
+ * ssa_pr_whole_world_batch - "whole world" computation with a batch callback
+ * @p_ssa_db_smdb: Pointer to smdb database
+ * @context: Path record calculation context
+ * @batch_clbk: Callback for arrays of computed path records
+ * @clbk_prm: Callback's parameter
+ *
+ * @return value: SSA_PR_SUCCESS - success; otherwise - failure
+ *
+ * The same as ssa_pr_whole_world. Batches and failures are handled as
+ * in ssa_pr_half_world_batch.
+ **/
+extern ssa_pr_status_t ssa_pr_whole_world_batch(struct ssa_db *p_ssa_db_smdb,
+		void *context,
+		ssa_pr_path_batch_dump_t batch_clbk,
+		void *clbk_prm);
+
+/**
+ * ssa_prdb_insert_batch - appends path records to a PRDB
+ * @p_prdb: Pointer to a PRDB created by ssa_prdb_create
+ * @capacity: Number of records the PRDB was created for
+ * @p_paths: Path records
+ * @count: Number of path records
+ *
+ * @return value: number of inserted records. Records that exceed
+ *                the capacity are not inserted.
+ *
+ * The dataset header is updated once per call.
+ **/
+extern uint64_t ssa_prdb_insert_batch(struct ssa_db *p_prdb,
+		uint64_t capacity,
+		const ssa_path_parms_t *p_paths,
+		size_t count);
+
+struct ep_pr_tbl_rec;
+
+/*
+ * Lookup index of a PRDB. Records of the PRDB are not copied, the index
+ * refers to them and is valid while the PRDB is not changed.
+ */
+struct ssa_prdb_index;
+
+/**
+ * ssa_prdb_index_create - builds a lookup index of a PRDB
+ * @p_prdb: Pointer to a PRDB, e.g. created by ssa_pr_compute_half_world
+ *
+ * @return value: pointer to the index or NULL on failure.
+ *
+ * LIDs are sorted for binary search and GUIDs are hashed. The index
+ * takes 6 bytes per record and 8 to 16 bytes per destination port.
+ **/
+extern struct ssa_prdb_index *ssa_prdb_index_create(const struct ssa_db *p_prdb);
+
+/**
+ * ssa_prdb_index_destroy - deallocates a lookup index
+ * @p_index: Pointer to an index
+ **/
+extern void ssa_prdb_index_destroy(struct ssa_prdb_index *p_index);
+
+/**
+ * ssa_prdb_index_memory - returns the size of an index in bytes
+ * @p_index: Pointer to an index
+ **/
+extern size_t ssa_prdb_index_memory(const struct ssa_prdb_index *p_index);
+
+/**
+ * ssa_prdb_lookup_lid - finds path records to a destination LID
+ * @p_index: Pointer to an index
+ * @lid: Destination LID in network order
+ * @pp_recs: Output. Up to count records, in PRDB order.
+ * @count: Size of pp_recs. 0 - only records are counted.
+ *
+ * @return value: number of matching records. A PRDB of a source with
+ *                LMC has a record per source LID.
+ *
+ * Complexity: O(log N).
+ **/
+extern size_t ssa_prdb_lookup_lid(const struct ssa_prdb_index *p_index,
+		be16_t lid,
+		const struct ep_pr_tbl_rec **pp_recs,
+		size_t count);
+
+/**
+ * ssa_prdb_lookup_guid - finds path records to a destination port
+ * @p_index: Pointer to an index
+ * @guid: Destination port GUID in network order
+ * @pp_recs: Output. Up to count records, sorted by LID.
+ * @count: Size of pp_recs. 0 - only records are counted.
+ *
+ * @return value: number of matching records, for all LIDs of the port.
+ *
+ * Complexity: O(1) expected.
+ **/
+extern size_t ssa_prdb_lookup_guid(const struct ssa_prdb_index *p_index,
+		be64_t guid,
+		const struct ep_pr_tbl_rec **pp_recs,
+		size_t count);
+
+/**
+ * ssa_prdb_save_file - saves a PRDB in the binary format
+ * @p_prdb: Pointer to a PRDB
+ * @path: File path
+ *
+ * @return value: 0 - success; otherwise - failure
+ *
+ * The file has a fixed header, dataset descriptors, table and field
+ * definitions and record arrays aligned to 64 bytes. It's written
+ * sequentially under a temporary name and renamed, so an existing file
+ * is replaced atomically.
+ **/
+extern int ssa_prdb_save_file(const struct ssa_db *p_prdb, const char *path);
+
+/**
+ * ssa_prdb_map_file - maps a PRDB saved by ssa_prdb_save_file
+ * @path: File path
+ *
+ * @return value: pointer to a read only PRDB or NULL on failure.
+ *
+ * Definitions and records are used in place in the mapped file, they are
+ * neither copied nor parsed, so the time doesn't depend on the size of
+ * the PRDB. Pages are read on first access. Table and field definitions
+ * are mapped as well, so the PRDB is a complete ssa_db that can be
+ * saved or distributed, but not modified. The PRDB must be released by
+ * ssa_prdb_unmap_file, not by ssa_db_destroy.
+ **/
+extern struct ssa_db *ssa_prdb_map_file(const char *path);
+
+/**
+ * ssa_prdb_unmap_file - releases a PRDB mapped by ssa_prdb_map_file
+ * @p_prdb: Pointer to a mapped PRDB
+ **/
+extern void ssa_prdb_unmap_file(struct ssa_db *p_prdb);
+
+/*
+ * Compact PRDB. Path attributes are stored once in a dictionary and
+ * every record keeps only a destination LID and a dictionary code.
+ * Destination GUIDs are not stored, they are resolved by the
+ * SSA_TABLE_ID_GUID_TO_LID table of the smdb, which is shared by PRDBs
+ * of all sources of a fabric.
+ */
+enum ssa_prdb_compact_table_id {
+	SSA_PR_COMPACT_ATTR_TABLE_ID = 0,
+	SSA_PR_COMPACT_REC_TABLE_ID,
+	SSA_PR_COMPACT_ATTR_TABLE_ID_FIELD_DEF,
+	SSA_PR_COMPACT_REC_TABLE_ID_FIELD_DEF,
+	SSA_PR_COMPACT_TABLE_ID_MAX
+};
+
+enum ssa_prdb_compact_attr_field_id {
+	SSA_PR_COMPACT_FIELD_ID_ATTR_PK = 0,
+	SSA_PR_COMPACT_FIELD_ID_ATTR_MTU,
+	SSA_PR_COMPACT_FIELD_ID_ATTR_RATE,
+	SSA_PR_COMPACT_FIELD_ID_ATTR_SL,
+	SSA_PR_COMPACT_FIELD_ID_ATTR_REVERSIBLE,
+	SSA_PR_COMPACT_ATTR_FIELDS_ID_MAX
+};
+
+enum ssa_prdb_compact_rec_field_id {
+	SSA_PR_COMPACT_FIELD_ID_REC_DLID = 0,
+	SSA_PR_COMPACT_FIELD_ID_REC_ATTR,
+	SSA_PR_COMPACT_REC_FIELDS_ID_MAX
+};
+
+/*
+ * Dictionary record: distinct path attributes
+ */
+struct ep_pr_attr_tbl_rec {
+	be16_t pk;
+	uint8_t mtu;
+	uint8_t rate;
+	uint8_t sl;
+	uint8_t is_reversible;
+	uint8_t pad[2];
+};
+
+/*
+ *@lid - destination LID
+ *@attr - index of path attributes in SSA_PR_COMPACT_ATTR_TABLE_ID table
+ */
+struct ep_pr_compact_tbl_rec {
+	be16_t lid;
+	be16_t attr;
+};
+
+/**
+ * ssa_prdb_compact_create - creates a compact copy of a PRDB
+ * @p_prdb: Pointer to a PRDB
+ *
+ * @return value: pointer to a compact PRDB or NULL on failure.
+ *
+ * Records keep PRDB order. Up to 65536 distinct path attributes are
+ * supported.
+ **/
+extern struct ssa_db *ssa_prdb_compact_create(const struct ssa_db *p_prdb);
+
+/**
+ * ssa_prdb_compact_expand - restores a PRDB from a compact PRDB
+ * @p_compact: Pointer to a compact PRDB
+ * @p_smdb: Pointer to smdb database the PRDB was computed for
+ *
+ * @return value: pointer to a PRDB or NULL on failure, e.g. if
+ *                a destination LID is absent in the smdb.
+ **/
+extern struct ssa_db *ssa_prdb_compact_expand(const struct ssa_db *p_compact,
+		const struct ssa_db *p_smdb);
+
+/*
+ * Range PRDB. A record covers a range of consecutive destination LIDs
+ * of one port with the same path attributes, e.g. all LIDs of an LMC
+ * range.
+ */
+enum ssa_prdb_range_table_id {
+	SSA_PR_RANGE_TABLE_ID = 0,
+	SSA_PR_RANGE_TABLE_ID_FIELD_DEF,
+	SSA_PR_RANGE_TABLE_ID_MAX
+};
+
+enum ssa_prdb_range_field_id {
+	SSA_PR_RANGE_FIELD_ID_DGUID = 0,
+	SSA_PR_RANGE_FIELD_ID_DLID,
+	SSA_PR_RANGE_FIELD_ID_PK,
+	SSA_PR_RANGE_FIELD_ID_MTU,
+	SSA_PR_RANGE_FIELD_ID_RATE,
+	SSA_PR_RANGE_FIELD_ID_SL,
+	SSA_PR_RANGE_FIELD_ID_RANGE,
+	SSA_PR_RANGE_FIELDS_ID_MAX
+};
+
+#define SSA_PR_RANGE_REVERSIBLE		0x80
+#define SSA_PR_RANGE_LID_COUNT_MASK	0x7F
+#define SSA_PR_RANGE_MAX_LIDS		(SSA_PR_RANGE_LID_COUNT_MASK + 1)
+
+/*
+ * The same layout as struct ep_pr_tbl_rec, is_reversible is replaced by
+ * the range byte.
+ *
+ *@lid - the first destination LID of the range
+ *@range - bit 7: SSA_PR_RANGE_REVERSIBLE, bits 0-6: number of LIDs - 1.
+ *         Any LMC range fits in a record.
+ */
+struct ep_pr_range_tbl_rec {
+	be64_t guid;
+	be16_t lid;
+	be16_t pk;
+	uint8_t mtu;
+	uint8_t rate;
+	uint8_t sl;
+	uint8_t range;
+};
+
+/**
+ * ssa_prdb_range_lid_count - returns the number of LIDs of a range record
+ * @p_rec: Range record
+ **/
+static inline unsigned int ssa_prdb_range_lid_count(const struct ep_pr_range_tbl_rec *p_rec)
+{
+	return (p_rec->range & SSA_PR_RANGE_LID_COUNT_MASK) + 1;
+}
+
+/**
+ * ssa_prdb_range_is_reversible - checks reverse paths of a range record
+ * @p_rec: Range record
+ **/
+static inline int ssa_prdb_range_is_reversible(const struct ep_pr_range_tbl_rec *p_rec)
+{
+	return !!(p_rec->range & SSA_PR_RANGE_REVERSIBLE);
+}
+
+/**
+ * ssa_prdb_range_create - creates an empty range PRDB
+ * @num_recs: Number of records
+ **/
+extern struct ssa_db *ssa_prdb_range_create(uint64_t num_recs);
+
+/**
+ * ssa_prdb_range_insert_batch - appends path records to a range PRDB
+ * @p_prdb: Pointer to a range PRDB created by ssa_prdb_range_create
+ * @capacity: Number of records the PRDB was created for
+ * @p_paths: Path records
+ * @count: Number of path records
+ *
+ * @return value: number of inserted path records. Path records that
+ *                exceed the capacity are not inserted.
+ *
+ * A path record extends the last record of the PRDB if it continues
+ * its LID range with the same attributes, also across calls.
+ **/
+extern uint64_t ssa_prdb_range_insert_batch(struct ssa_db *p_prdb,
+		uint64_t capacity,
+		const ssa_path_parms_t *p_paths,
+		size_t count);
+
+/**
+ * ssa_prdb_range_expand - restores a PRDB from a range PRDB
+ * @p_range: Pointer to a range PRDB
+ *
+ * @return value: pointer to a PRDB with a record per LID or NULL
+ *                on failure. Records keep the order of computation.
+ **/
+extern struct ssa_db *ssa_prdb_range_expand(const struct ssa_db *p_range);
+
+/**
+ * ssa_pr_compute_half_world_range - "half world" computation into a range PRDB
+ * @p_ssa_db_smdb: Pointer to smdb database
+ * @context: Path record calculation context
+ * @port_guid: Source port GUID in network order
+ *
+ * @return value: pointer to a range PRDB or NULL on failure.
+ *
+ * The same as ssa_pr_compute_half_world. Paths to all LIDs of
+ * a destination port are stored in one record, so the PRDB is up to
+ * 2^LMC times smaller.
+ **/
+extern struct ssa_db *ssa_pr_compute_half_world_range(struct ssa_db *p_ssa_db_smdb,
+		void *context,
+		be64_t port_guid);
+
+/*
+ * Path record computation engines
+ *
+ *@SSA_PR_ENGINE_WALK - every path is computed by a hop by hop route walk.
+ *                      It's a default engine.
+ *@SSA_PR_ENGINE_DP - "whole world" computation is destination rooted.
+ *                    For every destination, switch to destination suffixes
+ *                    are computed once and reused by all sources.
+ *                    Path records are passed to the callback grouped by
+ *                    destination.
+ *                    Reverse paths are looked up in a reach map that
+ *                    takes GUIDs * switches bits plus 4 bytes per GUID
+ *                    for a "whole world" calculation, e.g. 12 MB for
+ *                    48K GUIDs and 2K switches. It's filled by a pass
+ *                    over switches only. Above 64 MB the map isn't
+ *                    allocated and reverse paths are walked.
+ */
+typedef enum {
+	SSA_PR_ENGINE_WALK = 0,
+	SSA_PR_ENGINE_DP
+} ssa_pr_engine_t;
+
+/**
+ * ssa_pr_set_engine - selects path record computation engine
+ * @context: Path record calculation context
+ * @engine: Engine
+ *
+ * @return value: 0 - success; otherwise - failure
+ **/
+extern int ssa_pr_set_engine(void *context, ssa_pr_engine_t engine);
+
+/*
+ * Flags for ssa_pr_whole_world_mt
+ *
+ *@SSA_PR_MT_ORDERED - path records are passed to the callback in the same
+ *                     order as ssa_pr_whole_world does.
+ *@SSA_PR_MT_CONCURRENT_CLBK - the callback is thread safe. It's called
+ *                     directly from worker threads without serialization.
+ *                     Can't be combined with SSA_PR_MT_ORDERED.
+ */
+enum {
+	SSA_PR_MT_ORDERED = 1 << 0,
+	SSA_PR_MT_CONCURRENT_CLBK = 1 << 1
+};
+
+/**
+ * ssa_pr_whole_world_mt - multi-threaded "whole world" computation
+ * @p_ssa_db_smdb: Pointer to smdb database
+ * @context: Path record calculation context
+ * @threads_num: Number of worker threads. 0 - number of online CPUs.
+ * @flags: SSA_PR_MT_* flags
+ * @dump_clbk: Callback for computed path records
+ * @clbk_prm: Callback's parameter
+ *
+ * @return value: SSA_PR_SUCCESS - success; otherwise - failure
+ *
+ * The function splits source GUIDs (destination GUIDs for
+ * SSA_PR_ENGINE_DP) between worker threads. Every thread
+ * accumulates path records in its own buffer and passes them to the
+ * callback in portions. Unless SSA_PR_MT_CONCURRENT_CLBK is set, the
+ * callback is never called concurrently.
+ **/
+extern ssa_pr_status_t ssa_pr_whole_world_mt(struct ssa_db *p_ssa_db_smdb,
+		void *context,
+		unsigned int threads_num,
+		unsigned int flags,
+		ssa_pr_path_dump_t dump_clbk,
+		void *clbk_prm);
+
+/*
+ * Changes of smdb since the previous calculation.
+ *
+ *@p_lft_block_ids - positions of changed records in SSA_TABLE_ID_LFT_BLOCK.
+ *@lft_block_count - number of changed LFT blocks.
+ *@p_node_lids - LIDs (network order) of nodes with changed port records or
+ *               links. Both ends of a changed link have to be listed.
+ *@node_lid_count - number of nodes.
+ */
+struct ssa_pr_smdb_diff {
+	const uint64_t *p_lft_block_ids;
+	size_t lft_block_count;
+	const be16_t *p_node_lids;
+	size_t node_lid_count;
+};
+
+/*
+ *@SSA_PR_PATH_UPDATED - path record is new or changed.
+ *@SSA_PR_PATH_REMOVED - there is no path anymore. Only GUIDs and LIDs of
+ *                       the record are valid.
+ */
+typedef enum {
+	SSA_PR_PATH_UPDATED = 0,
+	SSA_PR_PATH_REMOVED
+} ssa_pr_path_update_t;
+
+typedef void (*ssa_pr_path_update_clbk_t)(const ssa_path_parms_t *p_path_prm,
+		ssa_pr_path_update_t update,
+		void *prm);
+
+/*
+ * Lookup of a path record of the previous calculation. LIDs are in
+ * network order. Returns 1 and fills p_path_prm if the record exists,
+ * 0 if there was no path.
+ */
+typedef int (*ssa_pr_path_lookup_t)(be16_t from_lid,
+		be16_t to_lid,
+		ssa_path_parms_t *p_path_prm,
+		void *prm);
+
+/**
+ * ssa_pr_whole_world_update - incremental "whole world" computation
+ * @p_ssa_db_smdb: Pointer to smdb database with applied changes
+ * @context: Path record calculation context used for the previous
+ *           "whole world" calculation
+ * @p_diff: Changes since the previous calculation
+ * @lookup_clbk: Lookup of the previous path records
+ * @update_clbk: Callback for changes of path records
+ * @clbk_prm: Parameter of both callbacks
+ *
+ * @return value: SSA_PR_SUCCESS - success; otherwise - failure
+ *
+ * The function finds (source, destination) pairs whose routes may be
+ * affected by the changes and recomputes only them. Records of a pair
+ * are compared with the previous record between the base LIDs of the
+ * pair, all LIDs of a pair share the path:
+ * - SSA_PR_PATH_UPDATED is passed for every LID combination of a pair
+ *   that has a path now and had none or a record with other attributes.
+ * - SSA_PR_PATH_REMOVED is passed for every LID combination of a pair
+ *   that had a path and has none now.
+ * - Nothing is passed for a pair whose record is the same.
+ * The reversible flag of the opposite pair is the status of the
+ * recomputed path, so a changed flag is passed as SSA_PR_PATH_UPDATED of
+ * the previous opposite record. The caller applies the changes to the
+ * results of the previous calculation. Changes of SSA_TABLE_ID_GUID_TO_LID
+ * are not supported: the function fails and a full calculation is needed.
+ **/
+extern ssa_pr_status_t ssa_pr_whole_world_update(struct ssa_db *p_ssa_db_smdb,
+		void *context,
+		const struct ssa_pr_smdb_diff *p_diff,
+		ssa_pr_path_lookup_t lookup_clbk,
+		ssa_pr_path_update_clbk_t update_clbk,
+		void *clbk_prm);
+
+/*
+ * Port identifier for ssa_pr_query_pair
+ *
+ *@SSA_PR_PORT_ID_GUID - port GUID. The path uses the port's base LID.
+ *@SSA_PR_PORT_ID_LID - any LID of the port's LMC range.
+ */
+typedef enum {
+	SSA_PR_PORT_ID_GUID = 0,
+	SSA_PR_PORT_ID_LID
+} ssa_pr_port_id_type_t;
+
+/*
+ *@type - which of the fields identifies the port.
+ *@guid - port GUID in network order.
+ *@lid - LID in network order.
+ */
+struct ssa_pr_port_id {
+	ssa_pr_port_id_type_t type;
+	be64_t guid;
+	be16_t lid;
+};
+
+/**
+ * ssa_pr_query_pair - computes one path record
+ * @p_ssa_db_smdb: Pointer to smdb database
+ * @context: Path record calculation context
+ * @p_source: Source port
+ * @p_dest: Destination port
+ * @p_path_prm: Output. Path record.
+ *
+ * @return value: SSA_PR_SUCCESS - success; SSA_PR_NO_PATH - there is no
+ *                path; SSA_PR_ERROR - failure or unknown port.
+ *
+ * Results of recent pairs and switch to destination suffixes of recent
+ * destinations are cached in the context. The cache is bounded and is
+ * invalidated when smdb tables the index is built from are changed.
+ * The function must not be called concurrently with other calculations
+ * on the same context.
+ **/
+extern ssa_pr_status_t ssa_pr_query_pair(struct ssa_db *p_ssa_db_smdb,
+		void *context,
+		const struct ssa_pr_port_id *p_source,
+		const struct ssa_pr_port_id *p_dest,
+		ssa_path_parms_t *p_path_prm);
+
+/*
+ * Path attribute matrix of a "whole world" calculation. Ports get dense
+ * IDs, the matrix keeps a 1 byte attribute code per (source, destination)
+ * pair. Routing uses base LIDs, so all LIDs of a pair of ports share
+ * the code.
+ */
+struct ssa_pr_matrix;
+
+#define SSA_PR_MATRIX_NO_PATH	0
+#define SSA_PR_MATRIX_NO_ID	0xFFFFFFFF
+
+/**
+ * ssa_pr_matrix_create - "whole world" computation into a matrix
+ * @p_ssa_db_smdb: Pointer to smdb database
+ * @context: Path record calculation context
+ * @threads_num: Number of worker threads. 1 - ssa_pr_whole_world is used,
+ *               otherwise ssa_pr_whole_world_mt. 0 - number of online CPUs.
+ *
+ * @return value: pointer to the matrix or NULL on failure, including more
+ *                than 255 distinct path attributes. Hops aren't a part of
+ *                the attributes.
+ *
+ * The matrix takes N * N bytes for N ports, e.g. 400 MB for 20000 ports.
+ * Pairs without a path, including failed pairs of the degraded fabric
+ * mode, have code SSA_PR_MATRIX_NO_PATH.
+ **/
+extern struct ssa_pr_matrix *ssa_pr_matrix_create(struct ssa_db *p_ssa_db_smdb,
+		void *context,
+		unsigned int threads_num);
+
+/**
+ * ssa_pr_matrix_destroy - deallocates a matrix
+ * @p_matrix: Pointer to a matrix
+ **/
+extern void ssa_pr_matrix_destroy(struct ssa_pr_matrix *p_matrix);
+
+/**
+ * ssa_pr_matrix_size - returns the number of ports N
+ * @p_matrix: Pointer to a matrix
+ **/
+extern uint32_t ssa_pr_matrix_size(const struct ssa_pr_matrix *p_matrix);
+
+/**
+ * ssa_pr_matrix_memory - returns the size of a matrix in bytes
+ * @p_matrix: Pointer to a matrix
+ **/
+extern size_t ssa_pr_matrix_memory(const struct ssa_pr_matrix *p_matrix);
+
+/**
+ * ssa_pr_matrix_id_by_lid - returns the ID of a port
+ * @p_matrix: Pointer to a matrix
+ * @lid: Any LID of the port's LMC range in network order
+ *
+ * @return value: ID or SSA_PR_MATRIX_NO_ID. Complexity: O(1).
+ **/
+extern uint32_t ssa_pr_matrix_id_by_lid(const struct ssa_pr_matrix *p_matrix,
+		be16_t lid);
+
+/**
+ * ssa_pr_matrix_id_by_guid - returns the ID of a port
+ * @p_matrix: Pointer to a matrix
+ * @guid: Port GUID in network order
+ *
+ * @return value: ID or SSA_PR_MATRIX_NO_ID. Complexity: O(1) expected.
+ **/
+extern uint32_t ssa_pr_matrix_id_by_guid(const struct ssa_pr_matrix *p_matrix,
+		be64_t guid);
+
+/**
+ * ssa_pr_matrix_row - returns attribute codes of a source
+ * @p_matrix: Pointer to a matrix
+ * @source_id: Source port ID
+ *
+ * @return value: N codes indexed by destination ID.
+ **/
+extern const uint8_t *ssa_pr_matrix_row(const struct ssa_pr_matrix *p_matrix,
+		uint32_t source_id);
+
+/**
+ * ssa_pr_matrix_path - reads a path record from a matrix
+ * @p_matrix: Pointer to a matrix
+ * @source_id: Source port ID
+ * @dest_id: Destination port ID
+ * @p_path_prm: Output. Path record between base LIDs of the ports.
+ *              Hops aren't kept in the matrix and are 0.
+ *
+ * @return value: SSA_PR_SUCCESS - success; SSA_PR_NO_PATH - there is no
+ *                path; SSA_PR_ERROR - invalid ID. Complexity: O(1).
+ **/
+extern ssa_pr_status_t ssa_pr_matrix_path(const struct ssa_pr_matrix *p_matrix,
+		uint32_t source_id,
+		uint32_t dest_id,
+		ssa_path_parms_t *p_path_prm);
+
+/*
+ * Cumulative statistics of a path record calculation context.
+ *
+ *@paths - computed path records. Every LID combination is a record.
+ *@no_paths - route computations that found no path, one per LID
+ *            combination.
+ *@errors - failed route computations. Forward failures are counted per
+ *          LID combination, reverse ones per pair of ports. The counts
+ *          don't depend on the engine.
+ *@hops - sum of hops of computed path records.
+ *@index_rebuilds - number of smdb index builds and updates.
+ *@index_rebuild_ns - total time of index builds and updates.
+ *@half_world_calls - number of "half world" calculations.
+ *@half_world_ns - total time of "half world" calculations, including
+ *                 index rebuilds and callbacks.
+ *@whole_world_calls - number of "whole world" calculations, single and
+ *                     multi-threaded.
+ *@whole_world_ns - total time of "whole world" calculations.
+ *@index_memory - current size of the smdb index in bytes.
+ *@query_calls - number of ssa_pr_query_pair calls.
+ *@query_hits - ssa_pr_query_pair calls answered from the cache.
+ *
+ * Path counters of incremental updates are included, but updates are
+ * not counted as "whole world" calculations.
+ */
+struct ssa_pr_stats {
+	uint64_t paths;
+	uint64_t no_paths;
+	uint64_t errors;
+	uint64_t hops;
+	uint64_t index_rebuilds;
+	uint64_t index_rebuild_ns;
+	uint64_t half_world_calls;
+	uint64_t half_world_ns;
+	uint64_t whole_world_calls;
+	uint64_t whole_world_ns;
+	uint64_t index_memory;
+	uint64_t query_calls;
+	uint64_t query_hits;
+};
+
+/**
+ * ssa_pr_get_stats - returns statistics of a context
+ * @context: Path record calculation context
+ * @p_stats: Statistics
+ *
+ * @return value: 0 - success; otherwise - failure
+ *
+ * Statistics are updated at the end of every calculation, so the function
+ * must not be called concurrently with calculations on the same context.
+ **/
+extern int ssa_pr_get_stats(void *context, struct ssa_pr_stats *p_stats);
+
+/**
+ * ssa_pr_reset_stats - resets cumulative statistics of a context
+ * @context: Path record calculation context
+ *
+ * Latency histograms are reset as well.
+ **/
+extern void ssa_pr_reset_stats(void *context);
+
+/*
+ * Latency histograms of a context
+ *
+ *@SSA_PR_LATENCY_HALF_WORLD - successful ssa_pr_half_world calls,
+ *                             including batch and PRDB variants.
+ *@SSA_PR_LATENCY_SOURCE_LID - path records of one source LID to all
+ *                             destinations. It's recorded by route walks
+ *                             of "half world" and "whole world"
+ *                             calculations. SSA_PR_ENGINE_DP "whole world"
+ *                             is destination rooted and doesn't record it.
+ */
+typedef enum {
+	SSA_PR_LATENCY_HALF_WORLD = 0,
+	SSA_PR_LATENCY_SOURCE_LID,
+	SSA_PR_LATENCY_NUM
+} ssa_pr_latency_t;
+
+/*
+ * Latency summary. All values are in nanoseconds. Quantiles are upper
+ * bounds of histogram buckets with relative error of about 3%.
+ */
+struct ssa_pr_latency {
+	uint64_t count;
+	uint64_t min_ns;
+	uint64_t max_ns;
+	uint64_t mean_ns;
+	uint64_t p50_ns;
+	uint64_t p99_ns;
+	uint64_t p999_ns;
+};
+
+/**
+ * ssa_pr_get_latency - returns a latency summary
+ * @context: Path record calculation context
+ * @type: Histogram
+ * @p_latency: Summary
+ *
+ * @return value: 0 - success; otherwise - failure
+ **/
+extern int ssa_pr_get_latency(void *context, ssa_pr_latency_t type,
+		struct ssa_pr_latency *p_latency);
+
+/**
+ * ssa_pr_get_latency_quantile - returns a latency quantile
+ * @context: Path record calculation context
+ * @type: Histogram
+ * @quantile: Quantile in range [0, 1]
+ *
+ * @return value: latency in nanoseconds. 0 - there are no measurements.
+ **/
+extern uint64_t ssa_pr_get_latency_quantile(void *context, ssa_pr_latency_t type,
+		double quantile);
+
+/**
+ * ssa_pr_dump_latency - prints latency summaries and histograms
+ * @context: Path record calculation context
+ * @fd: Output file
+ **/
+extern void ssa_pr_dump_latency(void *context, FILE *fd);
+
+/*
+ * Causes of route walk failures in the degraded fabric mode
+ *
+ *@SSA_PR_FAIL_NO_PORT - port record is not found.
+ *@SSA_PR_FAIL_NO_LINK - port has no link record, e.g. the neighbour is down.
+ *@SSA_PR_FAIL_LFT - destination LID is not covered by the switch's LFT.
+ *@SSA_PR_FAIL_NO_ROUTE - LFT of the switch has no port for the destination.
+ *@SSA_PR_FAIL_BAD_ROUTE - route enters a channel adapter that is not the
+ *                         destination.
+ *@SSA_PR_FAIL_LOOP - route is longer than the hop limit.
+ *@SSA_PR_FAIL_OTHER - failure without a known location.
+ */
+typedef enum {
+	SSA_PR_FAIL_NO_PORT = 0,
+	SSA_PR_FAIL_NO_LINK,
+	SSA_PR_FAIL_LFT,
+	SSA_PR_FAIL_NO_ROUTE,
+	SSA_PR_FAIL_BAD_ROUTE,
+	SSA_PR_FAIL_LOOP,
+	SSA_PR_FAIL_OTHER,
+	SSA_PR_FAIL_CAUSE_NUM
+} ssa_pr_fail_cause_t;
+
+/*
+ * Failures of the last calculation in the degraded fabric mode.
+ *
+ *@pairs - path computations that failed or found no path, one per LID
+ *         combination.
+ *@reverse_pairs - reverse path computations that failed, one per pair of
+ *                 ports.
+ *@causes - pairs and reverse_pairs split by ssa_pr_fail_cause_t.
+ *@switches - number of switches where route walks stopped.
+ *@locations - number of distinct (LID, port) locations where route walks
+ *             stopped.
+ */
+struct ssa_pr_fail_stats {
+	uint64_t pairs;
+	uint64_t reverse_pairs;
+	uint64_t causes[SSA_PR_FAIL_CAUSE_NUM];
+	uint64_t switches;
+	uint64_t locations;
+};
+
+/*
+ * A location where route walks stopped.
+ *
+ *@lid - LID in network order.
+ *@port_num - port number. 0xFF - the failure is not related to a port.
+ *@causes - bitmask of ssa_pr_fail_cause_t.
+ *@count - number of failed path computations.
+ */
+struct ssa_pr_fail_location {
+	be16_t lid;
+	uint8_t port_num;
+	uint8_t causes;
+	uint64_t count;
+};
+
+/**
+ * ssa_pr_set_degraded_mode - enables or disables the degraded fabric mode
+ * @context: Path record calculation context
+ * @enable: 0 - disable; otherwise - enable
+ *
+ * @return value: 0 - success; otherwise - failure
+ *
+ * By default a failed path computation is logged and stops the
+ * calculation. In the degraded fabric mode the failed pair is skipped
+ * and aggregated in a failure report, all other pairs are computed.
+ * One summary line is logged per "half world" or "whole world"
+ * calculation.
+ **/
+extern int ssa_pr_set_degraded_mode(void *context, int enable);
+
+/**
+ * ssa_pr_get_fail_stats - returns failures of the last calculation
+ * @context: Path record calculation context
+ * @p_stats: Failure counters
+ *
+ * @return value: 0 - success; otherwise - failure
+ **/
+extern int ssa_pr_get_fail_stats(void *context, struct ssa_pr_fail_stats *p_stats);
+
+/**
+ * ssa_pr_get_fail_locations - returns the most frequent failure locations
+ * of the last calculation
+ * @context: Path record calculation context
+ * @p_locations: Output array
+ * @count: Size of the array
+ *
+ * @return value: number of returned locations, sorted by number of
+ *                failures in descending order.
+ **/
+extern size_t ssa_pr_get_fail_locations(void *context,
+		struct ssa_pr_fail_location *p_locations,
+		size_t count);
+
+/**
+ * ssa_pr_log_async_start - starts asynchronous logging
+ * @entries: Number of messages the log ring holds. It's rounded up to
+ *           a power of two. 0 - default size (4096).
+ *
+ * @return value: 0 - success; otherwise - failure
+ *
+ * Log messages of all contexts are formatted into a lock-free ring and
+ * written to the log file by a background thread. When the ring is full,
+ * messages are dropped instead of blocking the calculation. Messages
+ * longer than 255 characters are truncated. The log file passed to
+ * ssa_pr_create_context must stay open until ssa_pr_log_async_stop.
+ **/
+extern int ssa_pr_log_async_start(size_t entries);
+
+/**
+ * ssa_pr_log_async_stop - writes pending messages and stops asynchronous
+ * logging
+ *
+ * @return value: number of dropped messages
+ *
+ * It must not be called concurrently with path record calculations.
+ **/
+extern uint64_t ssa_pr_log_async_stop();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* end of include guard: SSA_PATH_RECORD_EXT_H */
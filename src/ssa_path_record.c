@@ -39,12 +39,20 @@
 #include <stdarg.h>
 #include <assert.h>
 #include <math.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <infiniband/ssa_db.h>
 #include <infiniband/ssa_smdb.h>
 #include <infiniband/ssa_prdb.h>
 #include <infiniband/ssa_path_record.h>
+#include <infiniband/ssa_path_record_ext.h>
 #include "ssa_path_record_helper.h"
 #include "ssa_path_record_data.h"
+#include "ssa_path_record_dp.h"
+#include "ssa_path_record_hist.h"
+#include "ssa_path_record_fail.h"
+#include "ssa_path_record_query.h"
 
 #ifndef MIN
 #define MIN(X,Y) ((X) < (Y) ?  (X) : (Y))
@@ -53,244 +61,2196 @@
 #define MAX(X,Y) ((X) > (Y) ?  (X) : (Y))
 #endif
 
-#define MAX_HOPS 64
 #define PK_DEFAULT_VAL ntohs(0xffff);
 #define SL_DEFAULT_VAL 0
 
+/*
+ * Number of path records a worker thread accumulates before it passes
+ * them to the callback.
+ */
+#define SSA_PR_MT_BUF_SIZE 4096
+/*
+ * Number of path records passed to a batch callback at once.
+ */
+#define SSA_PR_BATCH_SIZE 256
+/*
+ * In the ordered mode workers may run ahead of the source GUID that is
+ * being passed to the callback by no more than
+ * SSA_PR_MT_WINDOW_FACTOR * threads_num GUIDs.
+ */
+#define SSA_PR_MT_WINDOW_FACTOR 4
+
+/*
+ * Size limit of the reach map. For larger fabrics reverse paths are
+ * computed by route walks.
+ */
+#define SSA_PR_REACH_MAP_MAX_BYTES (64ULL << 20)
+
+/*
+ * "Not computed yet" value of per destination reverse path status
+ */
+#define SSA_PR_REVERSE_UNKNOWN 0xFF
+
+/*
+ * "Whole world" reach map of SSA_PR_ENGINE_DP. It has a row of bits per
+ * destination GUID and a bit per switch. A bit is set if the switch and
+ * hosts attached to it have a valid path to the destination. Reverse
+ * paths of set bits aren't walked.
+ *
+ *@p_bits - rows of bits. Bit index: dense switch number.
+ *@stride - number of 64 bit words in a row.
+ *@p_attach - per GUID: the switch whose bit is valid for reverse paths
+ *            from the GUID. It's the switch itself or the switch a host
+ *            is linked to. SSA_PR_NO_INDEX - reverse paths are walked.
+ *@p_switch_recs - positions of switches in SSA_TABLE_ID_GUID_TO_LID.
+ *@switch_rec_count - number of switches in p_switch_recs.
+ */
+struct ssa_pr_reach_map {
+	uint64_t *p_bits;
+	size_t stride;
+	uint32_t *p_attach;
+	uint32_t *p_switch_recs;
+	size_t switch_rec_count;
+};
+
+/*
+ *@p_index - smdb index
+ *@engine - path record computation engine
+ *@dp - switch suffixes table. It's used by SSA_PR_ENGINE_DP.
+ *@p_reach_map - "whole world" reach map of SSA_PR_ENGINE_DP or NULL.
+ *@stats - cumulative statistics. index_memory is computed on request.
+ *@latency - latency histograms. Index: ssa_pr_latency_t.
+ *@degraded - degraded fabric mode. Failed pairs are skipped.
+ *@fail_report - failures of the last calculation in the degraded mode.
+ *@query_cache - results and suffix tables of ssa_pr_query_pair.
+ */
 struct ssa_pr_context {
 	struct ssa_pr_smdb_index *p_index;
+	ssa_pr_engine_t engine;
+	struct ssa_pr_dp_table dp;
+	const struct ssa_pr_reach_map *p_reach_map;
+	struct ssa_pr_stats stats;
+	struct ssa_pr_hist latency[SSA_PR_LATENCY_NUM];
+	uint8_t degraded;
+	struct ssa_pr_fail_report fail_report;
+	struct ssa_pr_query_cache query_cache;
+};
+
+/*
+ * Path counters of one calculation. Every thread has its own instance.
+ * They are added to the context statistics when the calculation ends,
+ * so the hot path doesn't touch shared data.
+ *
+ *@p_lid_latency - histogram for SSA_PR_LATENCY_SOURCE_LID or NULL. It's
+ *                 owned by the thread as well.
+ *@p_fail_report - failure report of the degraded fabric mode or NULL.
+ *                 NULL - a failed pair stops the calculation.
+ */
+struct ssa_pr_counters {
+	uint64_t paths;
+	uint64_t no_paths;
+	uint64_t errors;
+	uint64_t hops;
+	struct ssa_pr_hist *p_lid_latency;
+	struct ssa_pr_fail_report *p_fail_report;
+};
+
+static ssa_pr_status_t ssa_pr_path_params(const struct ssa_db *p_ssa_db_smdb,
+		const struct ssa_pr_context *p_context,
+		const struct ep_guid_to_lid_tbl_rec *p_source_rec,
+		const struct ep_guid_to_lid_tbl_rec *p_dest_rec,
+		ssa_path_parms_t *p_path_prm,
+		struct ssa_pr_fail *p_fail);
+
+
+
+static void ssa_pr_add_counters(struct ssa_pr_context *p_context,
+		const struct ssa_pr_counters *p_counters)
+{
+	p_context->stats.paths += p_counters->paths;
+	p_context->stats.no_paths += p_counters->no_paths;
+	p_context->stats.errors += p_counters->errors;
+	p_context->stats.hops += p_counters->hops;
+}
+
+/*
+ * ssa_pr_fail_report_prepare - empties the failure report before a
+ * calculation. Returns the report in the degraded fabric mode or NULL.
+ */
+static struct ssa_pr_fail_report *ssa_pr_fail_report_prepare(struct ssa_pr_context *p_context)
+{
+	ssa_pr_fail_report_destroy(&p_context->fail_report);
+	return p_context->degraded ? &p_context->fail_report : NULL;
+}
+
+/*
+ * ssa_pr_context_rebuild_indexes - ssa_pr_rebuild_indexes that accounts
+ * index builds and updates in the context statistics
+ */
+static int ssa_pr_context_rebuild_indexes(struct ssa_pr_context *p_context,
+		const struct ssa_db *p_ssa_db_smdb)
+{
+	struct ssa_pr_smdb_index *p_index = p_context->p_index;
+	uint64_t table_epochs[SSA_PR_INDEX_TABLE_NUM];
+	uint64_t start = 0;
+	int res = 0;
+
+	memcpy(table_epochs,p_index->table_epochs,sizeof(table_epochs));
+	start = ssa_pr_time_ns();
+	res = ssa_pr_rebuild_indexes(p_index,p_ssa_db_smdb);
+	if(res || memcmp(table_epochs,p_index->table_epochs,sizeof(table_epochs))) {
+		p_context->stats.index_rebuilds++;
+		p_context->stats.index_rebuild_ns += ssa_pr_time_ns() - start;
+	}
+	return res;
+}
+
+inline static size_t get_dataset_count(const struct ssa_db *p_ssa_db_smdb,
+		unsigned int table_id)
+{
+	SSA_ASSERT(p_ssa_db_smdb);
+	SSA_ASSERT(table_id < SSA_TABLE_ID_MAX);
+	SSA_ASSERT(&p_ssa_db_smdb->p_db_tables[table_id]);
+
+	return ntohll(p_ssa_db_smdb->p_db_tables[table_id].set_count);
+}
+
+/*
+ * PRDB insertion context.
+ *
+ *@capacity - number of records allocated in the PRDB.
+ *@overflow - number of records that didn't fit.
+ *@range - the PRDB is a range PRDB.
+ */
+struct ssa_pr_prdb_insert {
+	struct ssa_db *p_prdb;
+	uint64_t capacity;
+	uint64_t overflow;
+	int range;
+};
+
+static void insert_pr_batch_to_prdb(const ssa_path_parms_t *p_paths,
+		size_t count,
+		void *prm)
+{
+	struct ssa_pr_prdb_insert *p_insert = (struct ssa_pr_prdb_insert *)prm;
+
+	SSA_ASSERT(p_insert);
+
+	if(p_insert->range)
+		p_insert->overflow += count - ssa_prdb_range_insert_batch(p_insert->p_prdb,
+				p_insert->capacity,p_paths,count);
+	else
+		p_insert->overflow += count - ssa_prdb_insert_batch(p_insert->p_prdb,
+				p_insert->capacity,p_paths,count);
+}
+
+/*
+ * Batch of path records. "Half world" and "whole world" computations
+ * write records directly to the buffer and pass it to a batch callback
+ * in portions of SSA_PR_BATCH_SIZE records.
+ */
+struct ssa_pr_batch {
+	ssa_path_parms_t *p_paths;
+	size_t count;
+	ssa_pr_path_batch_dump_t batch_clbk;
+	void *clbk_prm;
+};
+
+static void batch_flush(struct ssa_pr_batch *p_batch)
+{
+	if(p_batch->count && p_batch->batch_clbk)
+		p_batch->batch_clbk(p_batch->p_paths,p_batch->count,p_batch->clbk_prm);
+	p_batch->count = 0;
+}
+
+/*
+ * batch_slot - place for the next path record: the free slot of the batch
+ * or p_local if there is no batch
+ */
+static inline ssa_path_parms_t *batch_slot(struct ssa_pr_batch *p_batch,
+		ssa_path_parms_t *p_local)
+{
+	return p_batch ? p_batch->p_paths + p_batch->count : p_local;
+}
+
+/*
+ * path_emit - passes a path record that was written to batch_slot
+ */
+static inline void path_emit(struct ssa_pr_batch *p_batch,
+		const ssa_path_parms_t *p_path_prm,
+		ssa_pr_path_dump_t dump_clbk,
+		void *clbk_prm)
+{
+	if(p_batch) {
+		if(SSA_PR_BATCH_SIZE == ++p_batch->count)
+			batch_flush(p_batch);
+	} else if(NULL != dump_clbk) {
+		dump_clbk(p_path_prm,clbk_prm);
+	}
+}
+
+static int batch_init(struct ssa_pr_batch *p_batch,
+		ssa_pr_path_batch_dump_t batch_clbk,
+		void *clbk_prm)
+{
+	p_batch->p_paths = (ssa_path_parms_t *)malloc(SSA_PR_BATCH_SIZE * sizeof(ssa_path_parms_t));
+	if(!p_batch->p_paths) {
+		SSA_PR_LOG_ERROR("Cannot allocate path records batch. Size: %d",SSA_PR_BATCH_SIZE);
+		return -1;
+	}
+	p_batch->count = 0;
+	p_batch->batch_clbk = batch_clbk;
+	p_batch->clbk_prm = clbk_prm;
+	return 0;
+}
+
+/*
+ * ssa_pr_half_world_rec_num - maximal number of "half world" path records:
+ * all LIDs of the source to all LIDs of all ports.
+ */
+static uint64_t ssa_pr_half_world_rec_num(const struct ssa_db *p_ssa_db_smdb,
+		const struct ep_guid_to_lid_tbl_rec *p_source_rec)
+{
+	const struct ep_guid_to_lid_tbl_rec *p_guid_to_lid_tbl =
+		(const struct ep_guid_to_lid_tbl_rec *)p_ssa_db_smdb->pp_tables[SSA_TABLE_ID_GUID_TO_LID];
+	size_t count = get_dataset_count(p_ssa_db_smdb,SSA_TABLE_ID_GUID_TO_LID);
+	uint64_t dest_lids = 0;
+	size_t i = 0;
+
+	SSA_ASSERT(p_guid_to_lid_tbl);
+
+	for(i = 0; i < count; ++i)
+		dest_lids += 1ULL << p_guid_to_lid_tbl[i].lmc;
+
+	return (1ULL << p_source_rec->lmc) * dest_lids;
+}
+
+/*
+ * ssa_pr_fail_classify - describes a failure of the DP engine.
+ *
+ * Suffix tables don't keep the location of a failure. The failed pair is
+ * walked once more hop by hop. It happens only in the degraded fabric mode
+ * and only for failed pairs.
+ */
+static void ssa_pr_fail_classify(const struct ssa_db *p_ssa_db_smdb,
+		const struct ssa_pr_context *p_context,
+		const struct ep_guid_to_lid_tbl_rec *p_source_rec,
+		const struct ep_guid_to_lid_tbl_rec *p_dest_rec,
+		struct ssa_pr_fail *p_fail)
+{
+	ssa_path_parms_t path_prm;
+
+	if(SSA_PR_SUCCESS == ssa_pr_path_params(p_ssa_db_smdb,p_context,
+				p_source_rec,p_dest_rec,&path_prm,p_fail))
+		ssa_pr_set_fail(p_fail,SSA_PR_FAIL_OTHER,0,-1);
+}
+
+/*
+ * ssa_pr_reverse_status - status of a reverse path: destination -> source.
+ * @p_rdp: suffix table rooted at the source or NULL.
+ * @p_fail: failure description of the degraded fabric mode or NULL.
+ *
+ * All reverse paths of a "half world" lead to the same port. With a table
+ * rooted at the source, a reverse path is a first link and one lookup in
+ * the table instead of a second route walk.
+ */
+static ssa_pr_status_t ssa_pr_reverse_status(const struct ssa_db *p_ssa_db_smdb,
+		const struct ssa_pr_context *p_context,
+		struct ssa_pr_dp_table *p_rdp,
+		const struct ep_guid_to_lid_tbl_rec *p_source_rec,
+		const struct ep_guid_to_lid_tbl_rec *p_dest_rec,
+		struct ssa_pr_fail *p_fail)
+{
+	ssa_path_parms_t revers_path_prm;
+	ssa_pr_status_t res = SSA_PR_SUCCESS;
+
+	revers_path_prm.from_guid = p_dest_rec->guid;
+	revers_path_prm.from_lid = p_dest_rec->lid;
+	revers_path_prm.to_guid = p_source_rec->guid;
+	revers_path_prm.to_lid = p_source_rec->lid;
+	revers_path_prm.reversible = 1;
+	revers_path_prm.sl = SL_DEFAULT_VAL;
+	revers_path_prm.pkey = PK_DEFAULT_VAL;
+
+	if(p_rdp) {
+		SSA_ASSERT(p_rdp->p_dest_rec == p_source_rec);
+		res = ssa_pr_dp_path_params(p_rdp,p_ssa_db_smdb,p_context->p_index,
+				p_dest_rec,&revers_path_prm);
+		if(SSA_PR_ERROR == res && p_fail)
+			ssa_pr_fail_classify(p_ssa_db_smdb,p_context,
+					p_dest_rec,p_source_rec,p_fail);
+		return res;
+	}
+
+	return ssa_pr_path_params(p_ssa_db_smdb,p_context,
+			p_dest_rec,p_source_rec,&revers_path_prm,p_fail);
+}
+
+/*
+ * ssa_pr_reach_bit - reverse path hint from the "whole world" reach map.
+ * Returns 1 if paths from the switch to the destination are valid.
+ */
+static inline int ssa_pr_reach_bit(const struct ssa_pr_reach_map *p_map,
+		size_t dest_index,
+		uint32_t switch_id)
+{
+	const uint64_t *p_row = p_map->p_bits + dest_index * p_map->stride;
+
+	return (p_row[switch_id / 64] >> (switch_id % 64)) & 1;
+}
+
+static ssa_pr_status_t ssa_pr_half_world_rec(const struct ssa_db *p_ssa_db_smdb,
+		const struct ssa_pr_context *p_context,
+		struct ssa_pr_dp_table *p_dp,
+		const struct ep_guid_to_lid_tbl_rec *p_source_rec,
+		struct ssa_pr_counters *p_counters,
+		ssa_pr_path_dump_t dump_clbk,
+		void *clbk_prm,
+		struct ssa_pr_batch *p_batch)
+{
+	struct ssa_pr_dp_table *p_rdp = NULL;
+	size_t guid_to_lid_count = 0;
+	const struct ep_guid_to_lid_tbl_rec *p_guid_to_lid_tbl = NULL;
+	size_t i = 0;
+	uint16_t source_base_lid = 0;
+	uint16_t source_last_lid = 0;
+	uint16_t source_lid = 0;
+	uint64_t start = 0, duration = 0;
+	struct ssa_pr_fail fail;
+	struct ssa_pr_fail *p_fail = p_counters->p_fail_report ? &fail : NULL;
+	uint8_t *p_reverse = NULL;
+	ssa_pr_status_t res = SSA_PR_SUCCESS;
+
+	SSA_ASSERT(p_ssa_db_smdb);
+	SSA_ASSERT(p_context);
+	SSA_ASSERT(p_source_rec);
+
+	p_guid_to_lid_tbl = (const struct ep_guid_to_lid_tbl_rec *)p_ssa_db_smdb->pp_tables[SSA_TABLE_ID_GUID_TO_LID];
+	SSA_ASSERT(p_guid_to_lid_tbl);
+
+	guid_to_lid_count = get_dataset_count(p_ssa_db_smdb,SSA_TABLE_ID_GUID_TO_LID);
+
+	/*
+	 * Reverse paths are resolved by the table rooted at the source.
+	 * If the table can't be prepared, they are computed by route walks.
+	 */
+	if(p_dp && !ssa_pr_dp_set_destination(p_dp,p_ssa_db_smdb,
+				p_context->p_index,p_source_rec))
+		p_rdp = p_dp;
+
+	source_base_lid = ntohs(p_source_rec->lid);
+	source_last_lid = source_base_lid + pow(2,p_source_rec->lmc) - 1;
+
+	/*
+	 * Routing uses base LIDs, so the reverse path is the same for all
+	 * LIDs of the source and of the destination. With LMC of the source
+	 * the status is kept per destination GUID across source LIDs.
+	 * Without the array it is resolved once per source LID.
+	 */
+	if(source_last_lid > source_base_lid && guid_to_lid_count) {
+		p_reverse = (uint8_t *)malloc(guid_to_lid_count * sizeof(*p_reverse));
+		if(p_reverse)
+			memset(p_reverse,SSA_PR_REVERSE_UNKNOWN,guid_to_lid_count * sizeof(*p_reverse));
+	}
+
+	for(source_lid = source_base_lid; source_lid <= source_last_lid; ++source_lid) {
+		start = ssa_pr_time_ns();
+		for (i = 0; i < guid_to_lid_count; i++) {
+			uint16_t dest_base_lid = 0;
+			uint16_t dest_last_lid = 0;
+			uint16_t dest_lid = 0;
+			int revers_path_known = 0;
+			ssa_pr_status_t revers_path_res = SSA_PR_SUCCESS;
+
+			const struct ep_guid_to_lid_tbl_rec* p_dest_rec = p_guid_to_lid_tbl + i;
+
+			if(p_reverse && SSA_PR_REVERSE_UNKNOWN != p_reverse[i]) {
+				revers_path_res = (ssa_pr_status_t)p_reverse[i];
+				revers_path_known = 1;
+			}
+			dest_base_lid = ntohs(p_dest_rec->lid);
+			dest_last_lid = dest_base_lid + pow(2,p_dest_rec->lmc) - 1;
+
+			for(dest_lid = dest_base_lid; dest_lid <= dest_last_lid; ++dest_lid) {
+				ssa_path_parms_t path_prm;
+				ssa_path_parms_t *p_path_prm = batch_slot(p_batch,&path_prm);
+				ssa_pr_status_t path_res = SSA_PR_SUCCESS;
+
+				p_path_prm->from_guid = p_source_rec->guid;
+				p_path_prm->from_lid = htons(source_lid); 
+				p_path_prm->to_guid = p_dest_rec->guid;
+				p_path_prm->to_lid = htons(dest_lid);
+				p_path_prm->sl = SL_DEFAULT_VAL;
+				p_path_prm->pkey = PK_DEFAULT_VAL;
+
+				path_res = ssa_pr_path_params(p_ssa_db_smdb,p_context,
+						p_source_rec,p_dest_rec,p_path_prm,p_fail);
+				if(SSA_PR_SUCCESS == path_res) {
+					if(!revers_path_known) {
+						revers_path_res = ssa_pr_reverse_status(p_ssa_db_smdb,p_context,
+								p_rdp,p_source_rec,p_dest_rec,p_fail);
+						revers_path_known = 1;
+						if(p_reverse)
+							p_reverse[i] = revers_path_res;
+						if(SSA_PR_ERROR == revers_path_res) {
+							p_counters->errors++;
+							if(p_fail)
+								ssa_pr_fail_report_add(p_counters->p_fail_report,
+										p_context->p_index,p_fail,1,1);
+							else
+								SSA_PR_LOG_INFO("Reverse path calculation is failed. Source LID 0x%"SCNx16" Destination LID: 0x%"SCNx16,source_lid,dest_lid);
+						}
+					}
+					p_path_prm->reversible = SSA_PR_SUCCESS == revers_path_res;
+					p_counters->paths++;
+					p_counters->hops += p_path_prm->hops;
+
+					path_emit(p_batch,p_path_prm,dump_clbk,clbk_prm);
+
+				} else if(SSA_PR_NO_PATH == path_res) {
+					p_counters->no_paths++;
+					if(p_fail)
+						ssa_pr_fail_report_add(p_counters->p_fail_report,
+								p_context->p_index,p_fail,0,1);
+				} else if(SSA_PR_ERROR == path_res) {
+					p_counters->errors++;
+					if(p_fail) {
+						ssa_pr_fail_report_add(p_counters->p_fail_report,
+								p_context->p_index,p_fail,0,1);
+						continue;
+					}
+					SSA_PR_LOG_ERROR("Path calculation is failed: (0x%"SCNx16") -> (0x%"SCNx16") "
+							"\"Half World\" calculation is stopped." ,source_lid,dest_lid);
+					res = SSA_PR_ERROR;
+					goto Exit;
+				} 
+			}
+		}
+		duration = ssa_pr_time_ns() - start;
+		if(p_counters->p_lid_latency)
+			ssa_pr_hist_record(p_counters->p_lid_latency,duration);
+		SSA_PR_LOG_DEBUG("\"half world\" path records for: 0x%"SCNx16
+				" time: %"PRIu64" ns.",source_lid,duration);
+	}
+Exit:
+	free(p_reverse);
+	return res;
+}
+
+/*
+ * ssa_pr_half_world_run - "half world" with a per record or a batch callback
+ */
+static ssa_pr_status_t ssa_pr_half_world_run(struct ssa_db *p_ssa_db_smdb,
+		void * p_ctnx,
+		be64_t port_guid,
+		ssa_pr_path_dump_t dump_clbk,
+		void *clbk_prm,
+		struct ssa_pr_batch *p_batch)
+{
+	const struct ep_guid_to_lid_tbl_rec *p_source_rec = NULL;
+	struct ssa_pr_context *p_context = (struct ssa_pr_context *)p_ctnx;
+	struct ssa_pr_counters counters;
+	ssa_pr_status_t res = SSA_PR_SUCCESS;
+	const uint64_t start = ssa_pr_time_ns();
+	uint64_t duration = 0;
+
+	SSA_ASSERT(port_guid);
+	SSA_ASSERT(p_ssa_db_smdb);
+	SSA_ASSERT(p_context);
+
+	memset(&counters,'\0',sizeof(counters));
+	counters.p_lid_latency = &p_context->latency[SSA_PR_LATENCY_SOURCE_LID];
+	counters.p_fail_report = ssa_pr_fail_report_prepare(p_context);
+
+	if(ssa_pr_context_rebuild_indexes(p_context,p_ssa_db_smdb)) {
+		SSA_PR_LOG_ERROR("Index rebuild is failed.");
+		res = SSA_PR_ERROR;
+		goto Exit;
+	}
+
+	p_source_rec = find_guid_to_lid_rec_by_guid(p_ssa_db_smdb,p_context->p_index,port_guid);
+
+	if (NULL == p_source_rec) {
+		SSA_PR_LOG_ERROR("GUID to LID record is not found. GUID: 0x%016"PRIx64,ntohll(port_guid));
+		res = SSA_PR_ERROR;
+		goto Exit;
+	}
+
+	ssa_pr_log_muted = NULL != counters.p_fail_report;
+	res = ssa_pr_half_world_rec(p_ssa_db_smdb,p_context,&p_context->dp,
+			p_source_rec,&counters,dump_clbk,clbk_prm,p_batch);
+	ssa_pr_log_muted = 0;
+
+	if(counters.p_fail_report) {
+		char name[64];
+
+		snprintf(name,sizeof(name),"\"half world\" of GUID 0x%016"PRIx64,ntohll(port_guid));
+		ssa_pr_fail_report_log(counters.p_fail_report,name);
+	}
+Exit:
+	duration = ssa_pr_time_ns() - start;
+	ssa_pr_add_counters(p_context,&counters);
+	p_context->stats.half_world_calls++;
+	p_context->stats.half_world_ns += duration;
+	if(SSA_PR_ERROR != res)
+		ssa_pr_hist_record(&p_context->latency[SSA_PR_LATENCY_HALF_WORLD],duration);
+	return res;
+}
+
+ssa_pr_status_t ssa_pr_half_world(struct ssa_db *p_ssa_db_smdb, 
+		void * p_ctnx,
+		be64_t port_guid,
+		ssa_pr_path_dump_t dump_clbk,
+		void *clbk_prm)
+{
+	return ssa_pr_half_world_run(p_ssa_db_smdb,p_ctnx,port_guid,dump_clbk,clbk_prm,NULL);
+}
+										
+/*
+ * ssa_pr_dest_world_rec - path records from all sources to one destination.
+ * It's a destination rooted counterpart of ssa_pr_half_world_rec that
+ * is used by SSA_PR_ENGINE_DP.
+ */
+static ssa_pr_status_t ssa_pr_dest_world_rec(const struct ssa_db *p_ssa_db_smdb,
+		const struct ssa_pr_context *p_context,
+		struct ssa_pr_dp_table *p_dp,
+		size_t dest_index,
+		struct ssa_pr_counters *p_counters,
+		ssa_pr_path_dump_t dump_clbk,
+		void *clbk_prm,
+		struct ssa_pr_batch *p_batch)
+{
+	size_t guid_to_lid_count = 0;
+	const struct ep_guid_to_lid_tbl_rec *p_guid_to_lid_tbl = NULL;
+	const struct ep_guid_to_lid_tbl_rec *p_dest_rec = NULL;
+	const struct ssa_pr_reach_map *p_reach_map = p_context->p_reach_map;
+	size_t i = 0;
+	uint16_t dest_base_lid = 0;
+	uint16_t dest_last_lid = 0;
+	uint32_t reach_switch = SSA_PR_NO_INDEX;
+
+	SSA_ASSERT(p_ssa_db_smdb);
+	SSA_ASSERT(p_context);
+	SSA_ASSERT(p_dp);
+
+	p_guid_to_lid_tbl = (const struct ep_guid_to_lid_tbl_rec *)p_ssa_db_smdb->pp_tables[SSA_TABLE_ID_GUID_TO_LID];
+	SSA_ASSERT(p_guid_to_lid_tbl);
+
+	guid_to_lid_count = get_dataset_count(p_ssa_db_smdb,SSA_TABLE_ID_GUID_TO_LID);
+	SSA_ASSERT(dest_index < guid_to_lid_count);
+	p_dest_rec = p_guid_to_lid_tbl + dest_index;
+
+	/*
+	 * Reverse paths start at the destination, so all of them are
+	 * looked up in the bits of one switch
+	 */
+	if(p_reach_map)
+		reach_switch = p_reach_map->p_attach[dest_index];
+
+	if(ssa_pr_dp_set_destination(p_dp,p_ssa_db_smdb,p_context->p_index,p_dest_rec))
+		return SSA_PR_ERROR;
+
+	dest_base_lid = ntohs(p_dest_rec->lid);
+	dest_last_lid = dest_base_lid + pow(2,p_dest_rec->lmc) - 1;
+
+	for (i = 0; i < guid_to_lid_count; i++) {
+		const struct ep_guid_to_lid_tbl_rec *p_source_rec = p_guid_to_lid_tbl + i;
+		uint16_t source_base_lid = 0;
+		uint16_t source_last_lid = 0;
+		uint16_t source_lid = 0;
+		uint16_t dest_lid = 0;
+		uint64_t lid_pairs = 0;
+		struct ssa_pr_fail fail;
+		ssa_path_parms_t path_prm;
+		ssa_pr_status_t path_res = SSA_PR_SUCCESS;
+		ssa_pr_status_t revers_path_res = SSA_PR_SUCCESS;
+
+		path_prm.from_guid = p_source_rec->guid;
+		path_prm.to_guid = p_dest_rec->guid;
+		path_prm.sl = SL_DEFAULT_VAL;
+		path_prm.pkey = PK_DEFAULT_VAL;
+
+		/*
+		 * The path is computed once for all LID combinations of the
+		 * pair, but counted per combination as by the route walk
+		 */
+		lid_pairs = (1ULL << p_source_rec->lmc) << p_dest_rec->lmc;
+
+		path_res = ssa_pr_dp_path_params(p_dp,p_ssa_db_smdb,p_context->p_index,
+				p_source_rec,&path_prm);
+		if(SSA_PR_ERROR == path_res) {
+			p_counters->errors += lid_pairs;
+			if(p_counters->p_fail_report) {
+				ssa_pr_fail_classify(p_ssa_db_smdb,p_context,
+						p_source_rec,p_dest_rec,&fail);
+				ssa_pr_fail_report_add(p_counters->p_fail_report,
+						p_context->p_index,&fail,0,lid_pairs);
+				continue;
+			}
+			SSA_PR_LOG_ERROR("Path calculation is failed: (0x%"SCNx16") -> (0x%"SCNx16") "
+					"\"Whole World\" calculation is stopped.",
+					ntohs(p_source_rec->lid),dest_base_lid);
+			return SSA_PR_ERROR;
+		} else if(SSA_PR_NO_PATH == path_res) {
+			p_counters->no_paths += lid_pairs;
+			if(p_counters->p_fail_report) {
+				ssa_pr_fail_classify(p_ssa_db_smdb,p_context,
+						p_source_rec,p_dest_rec,&fail);
+				ssa_pr_fail_report_add(p_counters->p_fail_report,
+						p_context->p_index,&fail,0,lid_pairs);
+			}
+			continue;
+		}
+
+		/*
+		 * A clear bit of the reach map may be a failure as well as
+		 * a missing path, so the reverse path is walked. Failures are
+		 * counted and reported as without the map.
+		 */
+		if(SSA_PR_NO_INDEX != reach_switch &&
+				ssa_pr_reach_bit(p_reach_map,i,reach_switch)) {
+			revers_path_res = SSA_PR_SUCCESS;
+		} else {
+			revers_path_res = ssa_pr_reverse_status(p_ssa_db_smdb,p_context,
+					NULL,p_source_rec,p_dest_rec,
+					p_counters->p_fail_report ? &fail : NULL);
+			if(SSA_PR_ERROR == revers_path_res) {
+				p_counters->errors++;
+				if(p_counters->p_fail_report)
+					ssa_pr_fail_report_add(p_counters->p_fail_report,
+							p_context->p_index,&fail,1,1);
+				else
+					SSA_PR_LOG_INFO("Reverse path calculation is failed. Source LID 0x%"SCNx16
+							" Destination LID: 0x%"SCNx16,ntohs(p_source_rec->lid),dest_base_lid);
+			}
+		}
+		path_prm.reversible = SSA_PR_SUCCESS == revers_path_res;
+
+		p_counters->paths += lid_pairs;
+		p_counters->hops += lid_pairs * path_prm.hops;
+
+		if(NULL == dump_clbk && NULL == p_batch)
+			continue;
+
+		/*
+		 * LFT routing uses base LIDs, so all LIDs of a port share the path
+		 */
+		source_base_lid = ntohs(p_source_rec->lid);
+		source_last_lid = source_base_lid + pow(2,p_source_rec->lmc) - 1;
+
+		for(source_lid = source_base_lid; source_lid <= source_last_lid; ++source_lid) {
+			for(dest_lid = dest_base_lid; dest_lid <= dest_last_lid; ++dest_lid) {
+				ssa_path_parms_t *p_path_prm = batch_slot(p_batch,&path_prm);
+
+				if(p_path_prm != &path_prm)
+					*p_path_prm = path_prm;
+				p_path_prm->from_lid = htons(source_lid);
+				p_path_prm->to_lid = htons(dest_lid);
+				path_emit(p_batch,p_path_prm,dump_clbk,clbk_prm);
+			}
+		}
+	}
+
+	return SSA_PR_SUCCESS;
+}
+
+/*
+ * ssa_pr_whole_world_item - one unit of "whole world" computation.
+ * It's "half world" of i-th GUID or, for SSA_PR_ENGINE_DP, all paths to
+ * i-th GUID.
+ */
+static ssa_pr_status_t ssa_pr_whole_world_item(const struct ssa_db *p_ssa_db_smdb,
+		const struct ssa_pr_context *p_context,
+		struct ssa_pr_dp_table *p_dp,
+		size_t i,
+		struct ssa_pr_counters *p_counters,
+		ssa_pr_path_dump_t dump_clbk,
+		void *clbk_prm,
+		struct ssa_pr_batch *p_batch)
+{
+	const struct ep_guid_to_lid_tbl_rec *p_guid_to_lid_tbl =
+		(const struct ep_guid_to_lid_tbl_rec *)p_ssa_db_smdb->pp_tables[SSA_TABLE_ID_GUID_TO_LID];
+	ssa_pr_status_t res = SSA_PR_SUCCESS;
+
+	SSA_ASSERT(p_guid_to_lid_tbl);
+
+	if(SSA_PR_ENGINE_DP == p_context->engine)
+		res = ssa_pr_dest_world_rec(p_ssa_db_smdb,p_context,p_dp,
+				i,p_counters,dump_clbk,clbk_prm,p_batch);
+	else
+		res = ssa_pr_half_world_rec(p_ssa_db_smdb,p_context,p_dp,
+				p_guid_to_lid_tbl + i,p_counters,dump_clbk,clbk_prm,p_batch);
+
+	if (SSA_PR_ERROR == res)
+		SSA_PR_LOG_ERROR("\"%s\" calculation is failed for GUID: 0x%"PRIx64
+				" . \"Whole world\" calculation is stopped.",
+				SSA_PR_ENGINE_DP == p_context->engine ? "Destination" : "Half world",
+				ntohll(p_guid_to_lid_tbl[i].guid));
+	return res;
+}
+
+/*
+ * ssa_pr_reach_row - fills a row of the reach map: all switches that have
+ * a valid path to the i-th GUID with a hop to spare for an attached host.
+ * Bits of missing and failed paths are clear, the main pass walks them
+ * to tell one from the other.
+ */
+static void ssa_pr_reach_row(const struct ssa_db *p_ssa_db_smdb,
+		const struct ssa_pr_context *p_context,
+		struct ssa_pr_dp_table *p_dp,
+		size_t i,
+		const struct ssa_pr_reach_map *p_map)
+{
+	const struct ep_guid_to_lid_tbl_rec *p_guid_to_lid_tbl =
+		(const struct ep_guid_to_lid_tbl_rec *)p_ssa_db_smdb->pp_tables[SSA_TABLE_ID_GUID_TO_LID];
+	const struct ssa_pr_smdb_index *p_index = p_context->p_index;
+	uint64_t *p_row = p_map->p_bits + i * p_map->stride;
+	size_t k = 0;
+
+	SSA_ASSERT(p_guid_to_lid_tbl);
+
+	if(ssa_pr_dp_set_destination(p_dp,p_ssa_db_smdb,p_index,p_guid_to_lid_tbl + i))
+		return;
+
+	for(k = 0; k < p_map->switch_rec_count; ++k) {
+		const struct ep_guid_to_lid_tbl_rec *p_switch_rec =
+			p_guid_to_lid_tbl + p_map->p_switch_recs[k];
+		const uint16_t id = p_index->switch_id_lookup[ntohs(p_switch_rec->lid)];
+		ssa_path_parms_t path_prm;
+
+		if(SSA_PR_SUCCESS == ssa_pr_dp_path_params(p_dp,p_ssa_db_smdb,
+					p_index,p_switch_rec,&path_prm) &&
+				path_prm.hops < MAX_HOPS)
+			p_row[id / 64] |= 1ULL << (id % 64);
+	}
+}
+
+static void ssa_pr_reach_map_destroy(struct ssa_pr_reach_map *p_map)
+{
+	if(!p_map)
+		return;
+	free(p_map->p_bits);
+	free(p_map->p_attach);
+	free(p_map->p_switch_recs);
+	free(p_map);
+}
+
+/*
+ * ssa_pr_reach_map_create - allocates the reach map for SSA_PR_ENGINE_DP
+ * and finds the switch of every GUID. Rows are zeroed. Returns NULL if
+ * the map isn't used, then reverse paths are computed by route walks.
+ */
+static struct ssa_pr_reach_map *ssa_pr_reach_map_create(const struct ssa_db *p_ssa_db_smdb,
+		const struct ssa_pr_context *p_context,
+		size_t count)
+{
+	const struct ep_guid_to_lid_tbl_rec *p_guid_to_lid_tbl =
+		(const struct ep_guid_to_lid_tbl_rec *)p_ssa_db_smdb->pp_tables[SSA_TABLE_ID_GUID_TO_LID];
+	const struct ssa_pr_smdb_index *p_index = p_context->p_index;
+	struct ssa_pr_reach_map *p_map = NULL;
+	size_t i = 0, stride = 0;
+
+	if(SSA_PR_ENGINE_DP != p_context->engine || !count || !p_index->switch_count)
+		return NULL;
+
+	stride = (p_index->switch_count + 63) / 64;
+	if(count * stride * sizeof(uint64_t) > SSA_PR_REACH_MAP_MAX_BYTES) {
+		SSA_PR_LOG_INFO("Reach map is too large. GUIDs: %zu switches: %zu."
+				" Reverse paths are computed by route walks.",
+				count,p_index->switch_count);
+		return NULL;
+	}
+
+	p_map = (struct ssa_pr_reach_map *)calloc(1,sizeof(*p_map));
+	if(!p_map)
+		goto Error;
+	p_map->stride = stride;
+	p_map->p_bits = (uint64_t *)calloc(count * stride,sizeof(*p_map->p_bits));
+	p_map->p_attach = (uint32_t *)malloc(count * sizeof(*p_map->p_attach));
+	p_map->p_switch_recs = (uint32_t *)malloc(p_index->switch_count *
+			sizeof(*p_map->p_switch_recs));
+	if(!p_map->p_bits || !p_map->p_attach || !p_map->p_switch_recs)
+		goto Error;
+
+	for(i = 0; i < count; ++i) {
+		const struct ep_guid_to_lid_tbl_rec *p_rec = p_guid_to_lid_tbl + i;
+		const struct ep_port_tbl_rec *p_port = NULL;
+
+		p_map->p_attach[i] = SSA_PR_NO_INDEX;
+		if(p_rec->is_switch) {
+			if(!ssa_pr_is_switch_lid(p_index,ntohs(p_rec->lid)))
+				continue;
+			if(p_map->switch_rec_count < p_index->switch_count)
+				p_map->p_switch_recs[p_map->switch_rec_count++] = i;
+			p_map->p_attach[i] = p_index->switch_id_lookup[ntohs(p_rec->lid)];
+			continue;
+		}
+
+		/*
+		 * A host's path leaves it by the only link. Hosts linked to
+		 * anything but a switch are walked.
+		 */
+		p_port = find_linked_port(p_ssa_db_smdb,p_index,p_rec->lid,-1);
+		if(p_port && (p_port->rate & SSA_DB_PORT_IS_SWITCH_MASK) &&
+				ssa_pr_is_switch_lid(p_index,ntohs(p_port->port_lid)))
+			p_map->p_attach[i] = p_index->switch_id_lookup[ntohs(p_port->port_lid)];
+	}
+
+	return p_map;
+
+Error:
+	SSA_PR_LOG_INFO("Cannot allocate reach map. GUIDs: %zu switches: %zu."
+			" Reverse paths are computed by route walks.",
+			count,p_index->switch_count);
+	ssa_pr_reach_map_destroy(p_map);
+	return NULL;
+}
+
+/*
+ * ssa_pr_compute_half_world_db - "half world" PRDB with a record per LID
+ * or, if range is set, a range PRDB.
+ */
+static struct ssa_db *ssa_pr_compute_half_world_db(struct ssa_db *p_ssa_db_smdb,
+		void *p_ctnx,
+		be64_t port_guid,
+		int range)
+{
+	struct ssa_pr_context *p_context = (struct ssa_pr_context *)p_ctnx;
+	struct ssa_pr_prdb_insert insert;
+	const struct ep_guid_to_lid_tbl_rec *p_source_rec = NULL;
+	ssa_pr_status_t res = SSA_PR_SUCCESS;
+
+	SSA_ASSERT(p_ssa_db_smdb);
+	SSA_ASSERT(p_context);
+
+	memset(&insert,'\0',sizeof(insert));
+	insert.range = range;
+
+	if(ssa_pr_context_rebuild_indexes(p_context,p_ssa_db_smdb)) {
+		SSA_PR_LOG_ERROR("Index rebuild is failed.");
+		return NULL;
+	}
+
+	p_source_rec = find_guid_to_lid_rec_by_guid(p_ssa_db_smdb,p_context->p_index,port_guid);
+	if(NULL == p_source_rec) {
+		SSA_PR_LOG_ERROR("GUID to LID record is not found. GUID: 0x%016"PRIx64,ntohll(port_guid));
+		return NULL;
+	}
+
+	/*
+	 * PRDB is sized for all LMC combinations of the "half world".
+	 * Routing uses base LIDs, so all LIDs of a destination port have
+	 * the same path and a range PRDB needs a record per port only.
+	 */
+	if(range) {
+		insert.capacity = (1ULL << p_source_rec->lmc) *
+			get_dataset_count(p_ssa_db_smdb,SSA_TABLE_ID_GUID_TO_LID);
+		insert.p_prdb = ssa_prdb_range_create(insert.capacity);
+	} else {
+		insert.capacity = ssa_pr_half_world_rec_num(p_ssa_db_smdb,p_source_rec);
+		insert.p_prdb = ssa_prdb_create(insert.capacity);
+	}
+	if(!insert.p_prdb) {
+		SSA_PR_LOG_ERROR("Path record database creation is failed."
+				" Number of records: %"PRIu64,insert.capacity);
+		return NULL;
+	}
+
+	res = ssa_pr_half_world_batch(p_ssa_db_smdb,p_ctnx,port_guid,insert_pr_batch_to_prdb,&insert);
+	if (SSA_PR_ERROR == res) {
+		SSA_PR_LOG_ERROR("\"Half world\" calculation is failed for GUID: 0x%"PRIx64
+				,ntohll(port_guid));
+		goto Error;
+	}
+
+	if(insert.overflow) {
+		SSA_PR_LOG_ERROR("Path record database overflow. GUID: 0x%"PRIx64
+				" Capacity: %"PRIu64" Lost records: %"PRIu64,
+				ntohll(port_guid),insert.capacity,insert.overflow);
+		goto Error;
+	}
+
+	return insert.p_prdb;
+Error:
+	ssa_db_destroy(insert.p_prdb);
+	return NULL;
+}
+
+struct ssa_db *ssa_pr_compute_half_world(struct ssa_db *p_ssa_db_smdb, 
+		void * p_ctnx,
+		be64_t port_guid)
+{
+	return ssa_pr_compute_half_world_db(p_ssa_db_smdb,p_ctnx,port_guid,0);
+}
+
+struct ssa_db *ssa_pr_compute_half_world_range(struct ssa_db *p_ssa_db_smdb,
+		void *context,
+		be64_t port_guid)
+{
+	return ssa_pr_compute_half_world_db(p_ssa_db_smdb,context,port_guid,1);
+}
+
+/*
+ * ssa_pr_whole_world_run - "whole world" with a per record or a batch callback
+ */
+static ssa_pr_status_t ssa_pr_whole_world_run(struct ssa_db* p_ssa_db_smdb,
+		void * context,
+		ssa_pr_path_dump_t dump_clbk,
+		void* clbk_prm,
+		struct ssa_pr_batch *p_batch)
+{
+	size_t i = 0;
+	size_t count = 0;
+	struct ssa_pr_reach_map *p_reach_map = NULL;
+	ssa_pr_status_t res = SSA_PR_SUCCESS;
+	struct ssa_pr_context *p_context = (struct ssa_pr_context *)context;
+	struct ssa_pr_counters counters;
+	const uint64_t start = ssa_pr_time_ns();
+
+	SSA_ASSERT(p_ssa_db_smdb);
+	SSA_ASSERT(p_context);
+
+	memset(&counters,'\0',sizeof(counters));
+	counters.p_lid_latency = &p_context->latency[SSA_PR_LATENCY_SOURCE_LID];
+	counters.p_fail_report = ssa_pr_fail_report_prepare(p_context);
+
+	if(ssa_pr_context_rebuild_indexes(p_context,p_ssa_db_smdb)) {
+		SSA_PR_LOG_ERROR("Index rebuild is failed.");
+		res = SSA_PR_ERROR;
+		goto Exit;
+	}
+
+	count = get_dataset_count(p_ssa_db_smdb,SSA_TABLE_ID_GUID_TO_LID);
+	ssa_pr_log_muted = NULL != counters.p_fail_report;
+
+	/*
+	 * SSA_PR_ENGINE_DP: the first pass finds valid paths from switches,
+	 * so reverse path validity is a bit lookup in the second one.
+	 */
+	p_reach_map = ssa_pr_reach_map_create(p_ssa_db_smdb,p_context,count);
+	if(p_reach_map) {
+		for (i = 0; i < count; i++)
+			ssa_pr_reach_row(p_ssa_db_smdb,p_context,&p_context->dp,
+					i,p_reach_map);
+		p_context->p_reach_map = p_reach_map;
+	}
+
+	for (i = 0; i < count; i++) {
+		res = ssa_pr_whole_world_item(p_ssa_db_smdb,p_context,&p_context->dp,
+				i,&counters,dump_clbk,clbk_prm,p_batch);
+		if (SSA_PR_ERROR == res)
+			break;
+	}
+
+	p_context->p_reach_map = NULL;
+	ssa_pr_reach_map_destroy(p_reach_map);
+	ssa_pr_log_muted = 0;
+
+	if(counters.p_fail_report)
+		ssa_pr_fail_report_log(counters.p_fail_report,"\"whole world\"");
+Exit:
+	ssa_pr_add_counters(p_context,&counters);
+	p_context->stats.whole_world_calls++;
+	p_context->stats.whole_world_ns += ssa_pr_time_ns() - start;
+
+	return SSA_PR_ERROR == res ? res : SSA_PR_SUCCESS;
+}
+
+ssa_pr_status_t ssa_pr_whole_world(struct ssa_db* p_ssa_db_smdb, 
+		void * context,
+		ssa_pr_path_dump_t dump_clbk,
+		void* clbk_prm)
+{
+	return ssa_pr_whole_world_run(p_ssa_db_smdb,context,dump_clbk,clbk_prm,NULL);
+}
+
+ssa_pr_status_t ssa_pr_half_world_batch(struct ssa_db *p_ssa_db_smdb,
+		void *context,
+		be64_t port_guid,
+		ssa_pr_path_batch_dump_t batch_clbk,
+		void *clbk_prm)
+{
+	struct ssa_pr_batch batch;
+	ssa_pr_status_t res = SSA_PR_SUCCESS;
+
+	if(batch_init(&batch,batch_clbk,clbk_prm))
+		return SSA_PR_ERROR;
+
+	res = ssa_pr_half_world_run(p_ssa_db_smdb,context,port_guid,NULL,NULL,&batch);
+	/*
+	 * Records computed before a failure are passed as well
+	 */
+	batch_flush(&batch);
+
+	free(batch.p_paths);
+	return res;
+}
+
+ssa_pr_status_t ssa_pr_whole_world_batch(struct ssa_db *p_ssa_db_smdb,
+		void *context,
+		ssa_pr_path_batch_dump_t batch_clbk,
+		void *clbk_prm)
+{
+	struct ssa_pr_batch batch;
+	ssa_pr_status_t res = SSA_PR_SUCCESS;
+
+	if(batch_init(&batch,batch_clbk,clbk_prm))
+		return SSA_PR_ERROR;
+
+	res = ssa_pr_whole_world_run(p_ssa_db_smdb,context,NULL,NULL,&batch);
+	batch_flush(&batch);
+
+	free(batch.p_paths);
+	return res;
+}
+
+int ssa_pr_get_stats(void *context, struct ssa_pr_stats *p_stats)
+{
+	struct ssa_pr_context *p_context = (struct ssa_pr_context *)context;
+
+	if(!p_context || !p_stats) {
+		SSA_PR_LOG_ERROR("Invalid parameters of statistics request");
+		return -1;
+	}
+
+	*p_stats = p_context->stats;
+	p_stats->index_memory = ssa_pr_index_memory(p_context->p_index);
+	return 0;
+}
+
+void ssa_pr_reset_stats(void *context)
+{
+	struct ssa_pr_context *p_context = (struct ssa_pr_context *)context;
+	int i = 0;
+
+	SSA_ASSERT(p_context);
+
+	memset(&p_context->stats,'\0',sizeof(p_context->stats));
+	for(i = 0; i < SSA_PR_LATENCY_NUM; ++i)
+		ssa_pr_hist_reset(&p_context->latency[i]);
+}
+
+int ssa_pr_get_latency(void *context, ssa_pr_latency_t type,
+		struct ssa_pr_latency *p_latency)
+{
+	struct ssa_pr_context *p_context = (struct ssa_pr_context *)context;
+	const struct ssa_pr_hist *p_hist = NULL;
+
+	if(!p_context || !p_latency || (unsigned int)type >= SSA_PR_LATENCY_NUM) {
+		SSA_PR_LOG_ERROR("Invalid parameters of latency request");
+		return -1;
+	}
+
+	p_hist = &p_context->latency[type];
+	memset(p_latency,'\0',sizeof(*p_latency));
+	p_latency->count = p_hist->count;
+	if(!p_hist->count)
+		return 0;
+
+	p_latency->min_ns = p_hist->min;
+	p_latency->max_ns = p_hist->max;
+	p_latency->mean_ns = p_hist->sum / p_hist->count;
+	p_latency->p50_ns = ssa_pr_hist_quantile(p_hist,0.5);
+	p_latency->p99_ns = ssa_pr_hist_quantile(p_hist,0.99);
+	p_latency->p999_ns = ssa_pr_hist_quantile(p_hist,0.999);
+	return 0;
+}
+
+uint64_t ssa_pr_get_latency_quantile(void *context, ssa_pr_latency_t type,
+		double quantile)
+{
+	struct ssa_pr_context *p_context = (struct ssa_pr_context *)context;
+
+	if(!p_context || (unsigned int)type >= SSA_PR_LATENCY_NUM) {
+		SSA_PR_LOG_ERROR("Invalid parameters of latency request");
+		return 0;
+	}
+
+	return ssa_pr_hist_quantile(&p_context->latency[type],quantile);
+}
+
+void ssa_pr_dump_latency(void *context, FILE *fd)
+{
+	static const char *names[SSA_PR_LATENCY_NUM] = {"half world","source LID"};
+	struct ssa_pr_context *p_context = (struct ssa_pr_context *)context;
+	struct ssa_pr_latency latency;
+	int i = 0;
+
+	SSA_ASSERT(p_context);
+	SSA_ASSERT(fd);
+
+	for(i = 0; i < SSA_PR_LATENCY_NUM; ++i) {
+		if(ssa_pr_get_latency(context,i,&latency))
+			return;
+		fprintf(fd,"Latency of %s: count %"PRIu64" min %"PRIu64" max %"PRIu64
+				" mean %"PRIu64" p50 %"PRIu64" p99 %"PRIu64" p999 %"PRIu64" ns\n",
+				names[i],latency.count,latency.min_ns,latency.max_ns,
+				latency.mean_ns,latency.p50_ns,latency.p99_ns,latency.p999_ns);
+		if(latency.count) {
+			fprintf(fd,"%12s %12s %10s %9s\n","from ns","to ns","count","total");
+			ssa_pr_hist_dump(&p_context->latency[i],fd);
+		}
+	}
+}
+
+int ssa_pr_set_degraded_mode(void *context, int enable)
+{
+	struct ssa_pr_context *p_context = (struct ssa_pr_context *)context;
+
+	SSA_ASSERT(p_context);
+
+	p_context->degraded = !!enable;
+	return 0;
+}
+
+int ssa_pr_get_fail_stats(void *context, struct ssa_pr_fail_stats *p_stats)
+{
+	struct ssa_pr_context *p_context = (struct ssa_pr_context *)context;
+
+	if(!p_context || !p_stats) {
+		SSA_PR_LOG_ERROR("Invalid parameters of failure statistics request");
+		return -1;
+	}
+
+	*p_stats = p_context->fail_report.stats;
+	return 0;
+}
+
+size_t ssa_pr_get_fail_locations(void *context,
+		struct ssa_pr_fail_location *p_locations,
+		size_t count)
+{
+	struct ssa_pr_context *p_context = (struct ssa_pr_context *)context;
+
+	SSA_ASSERT(p_context);
+	SSA_ASSERT(p_locations || !count);
+
+	return ssa_pr_fail_report_locations(&p_context->fail_report,p_locations,count);
+}
+
+int ssa_pr_set_engine(void *context, ssa_pr_engine_t engine)
+{
+	struct ssa_pr_context *p_context = (struct ssa_pr_context *)context;
+
+	SSA_ASSERT(p_context);
+
+	if(SSA_PR_ENGINE_WALK != engine && SSA_PR_ENGINE_DP != engine) {
+		SSA_PR_LOG_ERROR("Unknown path record engine: %d",engine);
+		return -1;
+	}
+	p_context->engine = engine;
+	return 0;
+}
+
+
+
+/*
+ * Growable array of path records. It's used as a per thread buffer by
+ * the multi-threaded "whole world" computation.
+ */
+struct ssa_pr_path_buf {
+	ssa_path_parms_t *p_paths;
+	size_t count;
+	size_t size;
+};
+
+enum {
+	SSA_PR_MT_SLOT_PENDING = 0,
+	SSA_PR_MT_SLOT_DONE,
+	SSA_PR_MT_SLOT_FAILED
+};
+
+/*
+ * State shared by all workers of ssa_pr_whole_world_mt.
+ *
+ *@next - index of the next source GUID in SSA_TABLE_ID_GUID_TO_LID.
+ *@emitted - ordered mode: number of source GUIDs passed to the callback.
+ *@p_slots - ordered mode: per source GUID results.
+ *@p_done - ordered mode: per source GUID completion state.
+ *@p_reach_map - reach map that is filled by the workers or NULL.
+ */
+struct ssa_pr_mt_job {
+	const struct ssa_db *p_smdb;
+	const struct ssa_pr_context *p_context;
+	size_t count;
+	size_t next;
+	size_t emitted;
+	size_t window;
+	unsigned int flags;
+	ssa_pr_path_dump_t dump_clbk;
+	void *clbk_prm;
+	struct ssa_pr_path_buf *p_slots;
+	uint8_t *p_done;
+	const struct ssa_pr_reach_map *p_reach_map;
+	ssa_pr_status_t res;
+	int stop;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	pthread_mutex_t clbk_lock;
+};
+
+/*
+ * Per thread scratch state.
+ *
+ *@buf_failed - a record of the current source GUID is lost because
+ *              the buffer can't grow.
+ */
+struct ssa_pr_mt_worker {
+	pthread_t thread;
+	struct ssa_pr_mt_job *p_job;
+	struct ssa_pr_path_buf buf;
+	int buf_failed;
+	struct ssa_pr_dp_table dp;
+	struct ssa_pr_counters counters;
+	struct ssa_pr_hist lid_latency;
+	struct ssa_pr_fail_report fail_report;
+};
+
+static void path_buf_destroy(struct ssa_pr_path_buf *p_buf)
+{
+	free(p_buf->p_paths);
+	p_buf->p_paths = NULL;
+	p_buf->count = 0;
+	p_buf->size = 0;
+}
+
+static int path_buf_add(struct ssa_pr_path_buf *p_buf,
+		const ssa_path_parms_t *p_path_prm)
+{
+	if(p_buf->count == p_buf->size) {
+		size_t size = p_buf->size ? 2 * p_buf->size : SSA_PR_MT_BUF_SIZE;
+		ssa_path_parms_t *p_paths = (ssa_path_parms_t *)
+			realloc(p_buf->p_paths,size * sizeof(*p_paths));
+
+		if(!p_paths) {
+			SSA_PR_LOG_ERROR("Cannot allocate path records buffer. Size: %zu",size);
+			return -1;
+		}
+		p_buf->p_paths = p_paths;
+		p_buf->size = size;
+	}
+	p_buf->p_paths[p_buf->count++] = *p_path_prm;
+	return 0;
+}
+
+static void path_buf_flush(struct ssa_pr_mt_job *p_job,
+		struct ssa_pr_path_buf *p_buf)
+{
+	size_t i = 0;
+
+	if(!p_buf->count)
+		return;
+
+	if(p_job->dump_clbk) {
+		if(!(p_job->flags & SSA_PR_MT_CONCURRENT_CLBK))
+			pthread_mutex_lock(&p_job->clbk_lock);
+		for(i = 0; i < p_buf->count; ++i)
+			p_job->dump_clbk(p_buf->p_paths + i,p_job->clbk_prm);
+		if(!(p_job->flags & SSA_PR_MT_CONCURRENT_CLBK))
+			pthread_mutex_unlock(&p_job->clbk_lock);
+	}
+	p_buf->count = 0;
+}
+
+static void mt_path_collect(const ssa_path_parms_t *p_path_prm, void *prm)
+{
+	struct ssa_pr_mt_worker *p_worker = (struct ssa_pr_mt_worker *)prm;
+	struct ssa_pr_mt_job *p_job = p_worker->p_job;
+
+	if(p_worker->buf_failed)
+		return;
+
+	if(path_buf_add(&p_worker->buf,p_path_prm)) {
+		p_worker->buf_failed = 1;
+		pthread_mutex_lock(&p_job->lock);
+		p_job->res = SSA_PR_ERROR;
+		p_job->stop = 1;
+		pthread_cond_broadcast(&p_job->cond);
+		pthread_mutex_unlock(&p_job->lock);
+		return;
+	}
+
+	if(!(p_job->flags & SSA_PR_MT_ORDERED) &&
+			p_worker->buf.count >= SSA_PR_MT_BUF_SIZE)
+		path_buf_flush(p_job,&p_worker->buf);
+}
+
+static void *mt_worker_run(void *prm)
+{
+	struct ssa_pr_mt_worker *p_worker = (struct ssa_pr_mt_worker *)prm;
+	struct ssa_pr_mt_job *p_job = p_worker->p_job;
+	const int ordered = p_job->flags & SSA_PR_MT_ORDERED;
+
+	ssa_pr_log_muted = NULL != p_worker->counters.p_fail_report;
+
+	while(1) {
+		size_t i = 0;
+		ssa_pr_status_t res = SSA_PR_SUCCESS;
+
+		pthread_mutex_lock(&p_job->lock);
+		while(ordered && !p_job->stop && p_job->next < p_job->count &&
+				p_job->next >= p_job->emitted + p_job->window)
+			pthread_cond_wait(&p_job->cond,&p_job->lock);
+		if(p_job->stop || p_job->next >= p_job->count) {
+			pthread_mutex_unlock(&p_job->lock);
+			break;
+		}
+		i = p_job->next++;
+		pthread_mutex_unlock(&p_job->lock);
+
+		if(p_job->p_reach_map) {
+			ssa_pr_reach_row(p_job->p_smdb,p_job->p_context,
+					&p_worker->dp,i,p_job->p_reach_map);
+			continue;
+		}
+
+		res = ssa_pr_whole_world_item(p_job->p_smdb,p_job->p_context,
+				&p_worker->dp,i,&p_worker->counters,mt_path_collect,p_worker,NULL);
+		/*
+		 * Records of the source GUID are incomplete. In ordered mode
+		 * the slot is failed, so the stream stops after it.
+		 */
+		if(p_worker->buf_failed) {
+			res = SSA_PR_ERROR;
+			p_worker->buf_failed = 0;
+		}
+
+		pthread_mutex_lock(&p_job->lock);
+		if(ordered) {
+			p_job->p_slots[i] = p_worker->buf;
+			memset(&p_worker->buf,'\0',sizeof(p_worker->buf));
+			p_job->p_done[i] = SSA_PR_ERROR == res ?
+				SSA_PR_MT_SLOT_FAILED : SSA_PR_MT_SLOT_DONE;
+		}
+		if(SSA_PR_ERROR == res) {
+			p_job->res = SSA_PR_ERROR;
+			p_job->stop = 1;
+		}
+		pthread_cond_broadcast(&p_job->cond);
+		pthread_mutex_unlock(&p_job->lock);
+	}
+
+	if(!ordered)
+		path_buf_flush(p_job,&p_worker->buf);
+	path_buf_destroy(&p_worker->buf);
+	ssa_pr_dp_destroy(&p_worker->dp);
+
+	return NULL;
+}
+
+/*
+ * Ordered mode: the calling thread passes results to the callback
+ * GUID by GUID in the order of SSA_TABLE_ID_GUID_TO_LID table.
+ * As in ssa_pr_whole_world, records computed after a failed "half world"
+ * are not passed to the callback.
+ */
+static void mt_emit_ordered(struct ssa_pr_mt_job *p_job)
+{
+	size_t i = 0;
+
+	for(i = 0; i < p_job->count; ++i) {
+		uint8_t done = 0;
+
+		pthread_mutex_lock(&p_job->lock);
+		while(!p_job->p_done[i] && !(p_job->stop && i >= p_job->next))
+			pthread_cond_wait(&p_job->cond,&p_job->lock);
+		done = p_job->p_done[i];
+		pthread_mutex_unlock(&p_job->lock);
+
+		if(!done)
+			break;
+
+		path_buf_flush(p_job,p_job->p_slots + i);
+		path_buf_destroy(p_job->p_slots + i);
+
+		pthread_mutex_lock(&p_job->lock);
+		p_job->emitted = i + 1;
+		pthread_cond_broadcast(&p_job->cond);
+		pthread_mutex_unlock(&p_job->lock);
+
+		if(SSA_PR_MT_SLOT_FAILED == done)
+			break;
+	}
+}
+
+/*
+ * mt_run_workers - runs one pass of the job and waits for its completion
+ */
+static ssa_pr_status_t mt_run_workers(struct ssa_pr_mt_job *p_job,
+		struct ssa_pr_mt_worker *p_workers,
+		unsigned int threads_num)
+{
+	unsigned int i = 0, started = 0;
+
+	for(i = 0; i < threads_num; ++i) {
+		p_workers[i].p_job = p_job;
+		p_workers[i].counters.p_lid_latency = &p_workers[i].lid_latency;
+		if(p_job->p_context->degraded)
+			p_workers[i].counters.p_fail_report = &p_workers[i].fail_report;
+		ssa_pr_dp_init(&p_workers[i].dp);
+		if(pthread_create(&p_workers[i].thread,NULL,mt_worker_run,p_workers + i)) {
+			SSA_PR_LOG_ERROR("Cannot create worker thread #%u",i);
+			break;
+		}
+		started++;
+	}
+	SSA_PR_LOG_INFO("\"Whole world\" %s is started. Threads: %u GUIDs: %zu",
+			p_job->p_reach_map ? "reach map calculation" : "calculation",
+			started,p_job->count);
+
+	if(!started)
+		return SSA_PR_ERROR;
+
+	if(p_job->flags & SSA_PR_MT_ORDERED)
+		mt_emit_ordered(p_job);
+	for(i = 0; i < started; ++i)
+		pthread_join(p_workers[i].thread,NULL);
+
+	return p_job->res;
+}
+
+ssa_pr_status_t ssa_pr_whole_world_mt(struct ssa_db *p_ssa_db_smdb,
+		void *context,
+		unsigned int threads_num,
+		unsigned int flags,
+		ssa_pr_path_dump_t dump_clbk,
+		void *clbk_prm)
+{
+	struct ssa_pr_context *p_context = (struct ssa_pr_context *)context;
+	struct ssa_pr_mt_job job;
+	struct ssa_pr_mt_worker *p_workers = NULL;
+	struct ssa_pr_reach_map *p_reach_map = NULL;
+	unsigned int i = 0;
+	ssa_pr_status_t res = SSA_PR_SUCCESS;
+	const uint64_t start = ssa_pr_time_ns();
+
+	SSA_ASSERT(p_ssa_db_smdb);
+	SSA_ASSERT(p_context);
+
+	if((flags & SSA_PR_MT_ORDERED) && (flags & SSA_PR_MT_CONCURRENT_CLBK)) {
+		SSA_PR_LOG_ERROR("Ordered mode can't be used with concurrent callback");
+		return SSA_PR_ERROR;
+	}
+
+	if(!threads_num) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		threads_num = cpus > 0 ? cpus : 1;
+	}
+
+	memset(&job,'\0',sizeof(job));
+
+	ssa_pr_fail_report_prepare(p_context);
+
+	/*
+	 * The index is rebuilt once here. Workers use it in read only mode.
+	 */
+	if(ssa_pr_context_rebuild_indexes(p_context,p_ssa_db_smdb)) {
+		SSA_PR_LOG_ERROR("Index rebuild is failed.");
+		res = SSA_PR_ERROR;
+		goto Exit;
+	}
+
+	job.p_smdb = p_ssa_db_smdb;
+	job.p_context = p_context;
+	job.count = get_dataset_count(p_ssa_db_smdb,SSA_TABLE_ID_GUID_TO_LID);
+	job.window = SSA_PR_MT_WINDOW_FACTOR * threads_num;
+	job.flags = flags;
+	job.dump_clbk = dump_clbk;
+	job.clbk_prm = clbk_prm;
+	job.res = SSA_PR_SUCCESS;
+
+	if(!job.count)
+		goto Exit;
+
+	if(flags & SSA_PR_MT_ORDERED) {
+		job.p_slots = (struct ssa_pr_path_buf *)calloc(job.count,sizeof(*job.p_slots));
+		job.p_done = (uint8_t *)calloc(job.count,sizeof(*job.p_done));
+		if(!job.p_slots || !job.p_done) {
+			SSA_PR_LOG_ERROR("Cannot allocate ordered mode buffers. GUIDs: %zu",job.count);
+			res = SSA_PR_ERROR;
+			goto Exit;
+		}
+	}
+
+	p_workers = (struct ssa_pr_mt_worker *)calloc(threads_num,sizeof(*p_workers));
+	if(!p_workers) {
+		SSA_PR_LOG_ERROR("Cannot allocate %u worker threads",threads_num);
+		res = SSA_PR_ERROR;
+		goto Exit;
+	}
+
+	pthread_mutex_init(&job.lock,NULL);
+	pthread_mutex_init(&job.clbk_lock,NULL);
+	pthread_cond_init(&job.cond,NULL);
+
+	/*
+	 * SSA_PR_ENGINE_DP: the reach map is filled by a separate pass.
+	 * It doesn't call the callback, so it's never ordered.
+	 */
+	p_reach_map = ssa_pr_reach_map_create(p_ssa_db_smdb,p_context,job.count);
+	if(p_reach_map) {
+		job.p_reach_map = p_reach_map;
+		job.flags = 0;
+		res = mt_run_workers(&job,p_workers,threads_num);
+		job.p_reach_map = NULL;
+		job.flags = flags;
+		job.next = 0;
+		if(SSA_PR_ERROR == res)
+			goto Destroy;
+		p_context->p_reach_map = p_reach_map;
+	}
+
+	res = mt_run_workers(&job,p_workers,threads_num);
+
+Destroy:
+	p_context->p_reach_map = NULL;
+	pthread_cond_destroy(&job.cond);
+	pthread_mutex_destroy(&job.clbk_lock);
+	pthread_mutex_destroy(&job.lock);
+Exit:
+	ssa_pr_reach_map_destroy(p_reach_map);
+	if(job.p_slots) {
+		size_t j = 0;
+		for(j = 0; j < job.count; ++j)
+			path_buf_destroy(job.p_slots + j);
+		free(job.p_slots);
+	}
+	free(job.p_done);
+
+	/*
+	 * Workers are joined, their counters are stable
+	 */
+	for(i = 0; p_workers && i < threads_num; ++i) {
+		ssa_pr_add_counters(p_context,&p_workers[i].counters);
+		ssa_pr_hist_merge(&p_context->latency[SSA_PR_LATENCY_SOURCE_LID],
+				&p_workers[i].lid_latency);
+		ssa_pr_fail_report_merge(&p_context->fail_report,&p_workers[i].fail_report);
+		ssa_pr_fail_report_destroy(&p_workers[i].fail_report);
+	}
+	free(p_workers);
+
+	if(p_context->degraded)
+		ssa_pr_fail_report_log(&p_context->fail_report,"\"whole world\"");
+
+	p_context->stats.whole_world_calls++;
+	p_context->stats.whole_world_ns += ssa_pr_time_ns() - start;
+
+	return res;
+}
+
+/*
+ * Incremental "whole world" update.
+ *
+ * Routing uses base LIDs and the part of a route before the first changed
+ * element (LFT entry, port or link) is the same in the old and in the new
+ * fabric. Therefore a pair (source, destination) may be changed only if its
+ * route in the new fabric meets a changed element. For every candidate
+ * destination the routes of all switches are classified once with memo,
+ * the same way as the destination rooted engine does.
+ */
+enum {
+	SSA_PR_UPD_UNKNOWN = 0,
+	SSA_PR_UPD_IN_PROGRESS,
+	SSA_PR_UPD_CLEAN,
+	SSA_PR_UPD_TOUCHED
 };
 
-static ssa_pr_status_t ssa_pr_path_params(const struct ssa_db *p_ssa_db_smdb,
-		const struct ssa_pr_context *p_context,
-		const struct ep_guid_to_lid_tbl_rec *p_source_rec,
-		const struct ep_guid_to_lid_tbl_rec *p_dest_rec,
-		ssa_path_parms_t *p_path_prm);
+/*
+ * LFT blocks per switch in the changed blocks bitmap. Blocks cover all
+ * LIDs up to MAX_LOOKUP_LID.
+ */
+#define SSA_PR_UPD_LFT_BLOCKS (MAX_LOOKUP_LID / 64 + 1)
 
+/*
+ *@p_changed_lids - bitmap. Index: base LID of a node with changed ports
+ *                  or links.
+ *@p_changed_blocks - bitmap. Index: dense switch number * SSA_PR_UPD_LFT_BLOCKS
+ *                    + LFT block num.
+ *@p_changed_block_nums - bitmap. Index: LFT block num changed on any switch.
+ *@p_states - per switch classification of routes to the current destination.
+ *@p_pairs - affected pairs. Value: source index << 32 | destination index.
+ */
+struct ssa_pr_update_job {
+	const struct ssa_db *p_smdb;
+	const struct ssa_pr_smdb_index *p_index;
+	uint8_t *p_changed_lids;
+	uint8_t *p_changed_blocks;
+	uint8_t *p_changed_block_nums;
+	int nodes_changed;
+	uint8_t *p_states;
+	be16_t dest_lid;
+	uint64_t *p_pairs;
+	size_t pair_count;
+	size_t pair_size;
+};
 
+#define UPD_BIT(p_map,i) ((p_map)[(i) / 8] & (1 << ((i) % 8)))
+#define UPD_SET_BIT(p_map,i) ((p_map)[(i) / 8] |= 1 << ((i) % 8))
 
-inline static size_t get_dataset_count(const struct ssa_db *p_ssa_db_smdb,
-		unsigned int table_id)
+static inline int upd_node_changed(const struct ssa_pr_update_job *p_job,
+		const be16_t lid)
 {
-	SSA_ASSERT(p_ssa_db_smdb);
-	SSA_ASSERT(table_id < SSA_TABLE_ID_MAX);
-	SSA_ASSERT(&p_ssa_db_smdb->p_db_tables[table_id]);
-
-	return ntohll(p_ssa_db_smdb->p_db_tables[table_id].set_count);
+	return ntohs(lid) <= MAX_LOOKUP_LID && UPD_BIT(p_job->p_changed_lids,ntohs(lid));
 }
 
-static void insert_pr_to_prdb(const ssa_path_parms_t *p_path_prm, void *prm)
+/*
+ * upd_switch_touched - does the route from a switch to the current
+ * destination meet a changed element. Failures and loops are treated as
+ * changes.
+ */
+static int upd_switch_touched(struct ssa_pr_update_job *p_job,
+		const be16_t switch_lid,
+		unsigned int depth)
 {
-	struct ssa_db *p_prdb = NULL;
-	struct db_dataset *p_dataset = NULL;
-	uint64_t set_size = 0, set_count = 0;
-	struct ep_pr_tbl_rec *p_rec = NULL;
+	const struct ep_port_tbl_rec *p_port = NULL;
+	int out_port_num = -1;
+	int touched = 0;
+	size_t id = 0;
 
-	p_prdb = (struct ssa_db*)prm;
-	SSA_ASSERT(p_prdb);
+	/*
+	 * Paths via an unknown switch fail, they are always recomputed
+	 */
+	if(!ssa_pr_is_switch_lid(p_job->p_index,ntohs(switch_lid)))
+		return 1;
+	id = p_job->p_index->switch_id_lookup[ntohs(switch_lid)];
+
+	if(SSA_PR_UPD_UNKNOWN != p_job->p_states[id])
+		return SSA_PR_UPD_CLEAN != p_job->p_states[id];
+
+	if(upd_node_changed(p_job,switch_lid) ||
+			UPD_BIT(p_job->p_changed_blocks,id * SSA_PR_UPD_LFT_BLOCKS + (ntohs(p_job->dest_lid) >> 6))) {
+		p_job->p_states[id] = SSA_PR_UPD_TOUCHED;
+		return 1;
+	}
 
-	p_dataset = p_prdb->p_db_tables + SSA_PR_TABLE_ID;
-	SSA_ASSERT(p_dataset);
+	if(switch_lid == p_job->dest_lid) {
+		p_job->p_states[id] = SSA_PR_UPD_CLEAN;
+		return 0;
+	}
 
-	set_size = ntohll(p_dataset->set_size);
-	set_count = ntohll(p_dataset->set_count);
+	p_job->p_states[id] = SSA_PR_UPD_IN_PROGRESS;
+
+	out_port_num = find_destination_port(p_job->p_smdb,p_job->p_index,
+			switch_lid,p_job->dest_lid);
+	if(out_port_num < 0) {
+		touched = 1;
+	} else if(LFT_NO_PATH != out_port_num) {
+		p_port = find_linked_port(p_job->p_smdb,p_job->p_index,switch_lid,out_port_num);
+		if(NULL == p_port || upd_node_changed(p_job,p_port->port_lid))
+			touched = 1;
+		else if((p_port->rate & SSA_DB_PORT_IS_SWITCH_MASK) &&
+				p_port->port_lid != p_job->dest_lid)
+			touched = depth >= MAX_HOPS ? 1 :
+				upd_switch_touched(p_job,p_port->port_lid,depth + 1);
+	}
 
-	p_rec = ((struct ep_pr_tbl_rec *)p_prdb->pp_tables[SSA_PR_TABLE_ID]) + set_count;
-	SSA_ASSERT(p_rec);
+	p_job->p_states[id] = touched ? SSA_PR_UPD_TOUCHED : SSA_PR_UPD_CLEAN;
+	return touched;
+}
 
-	p_rec->guid = p_path_prm->to_guid;
-	p_rec->lid = p_path_prm->to_lid;
-	p_rec->pk = p_path_prm->pkey;
-	p_rec->mtu = p_path_prm->mtu;
-	p_rec->rate = p_path_prm->rate;
-	p_rec->sl = p_path_prm->sl;
-	p_rec->is_reversible = p_path_prm->reversible;
+static int upd_source_touched(struct ssa_pr_update_job *p_job,
+		const struct ep_guid_to_lid_tbl_rec *p_source_rec)
+{
+	const struct ep_port_tbl_rec *p_port = NULL;
+
+	if(upd_node_changed(p_job,p_source_rec->lid))
+		return 1;
+	if(p_source_rec->is_switch)
+		return upd_switch_touched(p_job,p_source_rec->lid,0);
+	if(p_source_rec->lid == p_job->dest_lid)
+		return 0;
+
+	p_port = find_linked_port(p_job->p_smdb,p_job->p_index,p_source_rec->lid,-1);
+	if(NULL == p_port || upd_node_changed(p_job,p_port->port_lid))
+		return 1;
+	if((p_port->rate & SSA_DB_PORT_IS_SWITCH_MASK) && p_port->port_lid != p_job->dest_lid)
+		return upd_switch_touched(p_job,p_port->port_lid,0);
+	return 0;
+}
 
-	set_size += sizeof(struct ep_pr_tbl_rec);
-	set_count++;
+static int upd_add_pair(struct ssa_pr_update_job *p_job,
+		size_t source_index,
+		size_t dest_index)
+{
+	if(p_job->pair_count == p_job->pair_size) {
+		size_t size = p_job->pair_size ? 2 * p_job->pair_size : 1024;
+		uint64_t *p_pairs = (uint64_t *)realloc(p_job->p_pairs,size * sizeof(*p_pairs));
 
-	p_dataset->set_count = htonll(set_count);
-	p_dataset->set_size = htonll(set_size);
+		if(!p_pairs) {
+			SSA_PR_LOG_ERROR("Cannot allocate affected pairs. Number of pairs: %zu",size);
+			return -1;
+		}
+		p_job->p_pairs = p_pairs;
+		p_job->pair_size = size;
+	}
+	p_job->p_pairs[p_job->pair_count++] = (uint64_t)source_index << 32 | dest_index;
+	return 0;
 }
 
-ssa_pr_status_t ssa_pr_half_world(struct ssa_db *p_ssa_db_smdb, 
-		void * p_ctnx,
-		be64_t port_guid,
-		ssa_pr_path_dump_t dump_clbk,
-		void *clbk_prm)
+static int upd_pair_cmp(const void *p1, const void *p2)
 {
-	const struct ep_guid_to_lid_tbl_rec *p_source_rec = NULL;
-	size_t guid_to_lid_count = 0;
-	const struct ep_guid_to_lid_tbl_rec *p_guid_to_lid_tbl = NULL;
-	size_t i = 0;
-	size_t source_lids_count = 0;
-	uint16_t source_base_lid = 0;
-	uint16_t source_last_lid = 0;
-	uint16_t source_lid = 0;
-	struct ssa_pr_context *p_context = (struct ssa_pr_context *)p_ctnx;
-	clock_t start, end;
-	double cpu_time_used;
+	const uint64_t v1 = *(const uint64_t *)p1;
+	const uint64_t v2 = *(const uint64_t *)p2;
 
-	SSA_ASSERT(port_guid);
-	SSA_ASSERT(p_ssa_db_smdb);
-	SSA_ASSERT(p_context);
+	return v1 < v2 ? -1 : v1 > v2;
+}
 
+/*
+ * upd_prepare - fills changed elements bitmaps from a diff
+ */
+static int upd_prepare(struct ssa_pr_update_job *p_job,
+		const struct ssa_pr_smdb_diff *p_diff)
+{
+	const struct ep_lft_block_tbl_rec *p_lft_block_tbl =
+		(const struct ep_lft_block_tbl_rec *)p_job->p_smdb->pp_tables[SSA_TABLE_ID_LFT_BLOCK];
+	const size_t block_count = get_dataset_count(p_job->p_smdb,SSA_TABLE_ID_LFT_BLOCK);
+	const struct ssa_pr_smdb_index *p_index = p_job->p_index;
+	size_t i = 0;
 
-	if(ssa_pr_rebuild_indexes(p_context->p_index,p_ssa_db_smdb)) {
-		SSA_PR_LOG_ERROR("Index rebuild is failed.");
-		return SSA_PR_ERROR;
+	p_job->p_changed_lids = (uint8_t *)calloc((MAX_LOOKUP_LID + 1 + 7) / 8,1);
+	p_job->p_changed_block_nums = (uint8_t *)calloc((SSA_PR_UPD_LFT_BLOCKS + 7) / 8,1);
+	p_job->p_changed_blocks = (uint8_t *)
+		calloc((p_index->switch_count * SSA_PR_UPD_LFT_BLOCKS + 7) / 8,1);
+	p_job->p_states = (uint8_t *)calloc(p_index->switch_count + 1,1);
+	if(!p_job->p_changed_lids || !p_job->p_changed_block_nums ||
+			!p_job->p_changed_blocks || !p_job->p_states) {
+		SSA_PR_LOG_ERROR("Cannot allocate incremental update state. Switches: %zu",
+				p_index->switch_count);
+		return -1;
 	}
 
-	p_guid_to_lid_tbl = (const struct ep_guid_to_lid_tbl_rec *)p_ssa_db_smdb->pp_tables[SSA_TABLE_ID_GUID_TO_LID];
-	SSA_ASSERT(p_guid_to_lid_tbl);
+	for(i = 0; i < p_diff->lft_block_count; ++i) {
+		const struct ep_lft_block_tbl_rec *p_block = NULL;
+		uint16_t block_num = 0;
 
-	guid_to_lid_count = get_dataset_count(p_ssa_db_smdb,SSA_TABLE_ID_GUID_TO_LID);
+		if(p_diff->p_lft_block_ids[i] >= block_count) {
+			SSA_PR_LOG_ERROR("Invalid LFT block record index: %"PRIu64,
+					p_diff->p_lft_block_ids[i]);
+			return -1;
+		}
+		p_block = p_lft_block_tbl + p_diff->p_lft_block_ids[i];
+		block_num = ntohs(p_block->block_num);
+		/*
+		 * Blocks above the last one cover only multicast LIDs
+		 */
+		if(!ssa_pr_is_switch_lid(p_index,ntohs(p_block->lid)) || block_num >= SSA_PR_UPD_LFT_BLOCKS)
+			continue;
+		UPD_SET_BIT(p_job->p_changed_blocks,
+				p_index->switch_id_lookup[ntohs(p_block->lid)] * SSA_PR_UPD_LFT_BLOCKS + block_num);
+		UPD_SET_BIT(p_job->p_changed_block_nums,block_num);
+	}
 
-	p_source_rec = find_guid_to_lid_rec_by_guid(p_ssa_db_smdb,port_guid);
+	for(i = 0; i < p_diff->node_lid_count; ++i) {
+		const struct ep_guid_to_lid_tbl_rec *p_rec =
+			find_guid_to_lid_rec_by_lid(p_job->p_smdb,p_index,p_diff->p_node_lids[i]);
 
-	if (NULL == p_source_rec) {
-		SSA_PR_LOG_ERROR("GUID to LID record is not found. GUID: 0x%016"PRIx64,ntohll(port_guid));
-		return SSA_PR_ERROR;
+		if(NULL == p_rec)
+			return -1;
+		UPD_SET_BIT(p_job->p_changed_lids,ntohs(p_rec->lid));
+		p_job->nodes_changed = 1;
 	}
 
-	source_base_lid = ntohs(p_source_rec->lid);
-	source_last_lid = source_base_lid + pow(2,p_source_rec->lmc) - 1;
-
-	for(source_lid = source_base_lid; source_lid <= source_last_lid; ++source_lid) {
-		start = clock();
-		for (i = 0; i < guid_to_lid_count; i++) {
-			uint16_t dest_base_lid = 0;
-			uint16_t dest_last_lid = 0;
-			uint16_t dest_lid = 0;
+	return 0;
+}
 
-			const struct ep_guid_to_lid_tbl_rec* p_dest_rec = p_guid_to_lid_tbl + i;
-			dest_base_lid = ntohs(p_dest_rec->lid);
-			dest_last_lid = dest_base_lid + pow(2,p_dest_rec->lmc) - 1;
+/*
+ * upd_pair_found - is a pair in the sorted array of affected pairs
+ */
+static int upd_pair_found(const struct ssa_pr_update_job *p_job,
+		const uint64_t pair)
+{
+	return NULL != bsearch(&pair,p_job->p_pairs,p_job->pair_count,
+			sizeof(p_job->p_pairs[0]),upd_pair_cmp);
+}
 
-			for(dest_lid = dest_base_lid; dest_lid <= dest_last_lid; ++dest_lid) {
-				ssa_path_parms_t path_prm;
-				ssa_pr_status_t path_res = SSA_PR_SUCCESS;
+static inline int upd_path_differs(const ssa_path_parms_t *p_prm1,
+		const ssa_path_parms_t *p_prm2)
+{
+	return p_prm1->mtu != p_prm2->mtu || p_prm1->rate != p_prm2->rate ||
+		p_prm1->pkt_life != p_prm2->pkt_life || p_prm1->hops != p_prm2->hops ||
+		!p_prm1->reversible != !p_prm2->reversible ||
+		p_prm1->sl != p_prm2->sl || p_prm1->pkey != p_prm2->pkey;
+}
 
-				path_prm.from_guid = port_guid; 
-				path_prm.from_lid = htons(source_lid); 
-				path_prm.to_guid = p_dest_rec->guid;
-				path_prm.to_lid = htons(dest_lid);
-				path_prm.sl = SL_DEFAULT_VAL;
-				path_prm.pkey = PK_DEFAULT_VAL;
+/*
+ * upd_emit_lids - passes all LID combinations of a pair to the callback
+ */
+static void upd_emit_lids(const struct ep_guid_to_lid_tbl_rec *p_source_rec,
+		const struct ep_guid_to_lid_tbl_rec *p_dest_rec,
+		ssa_path_parms_t *p_path_prm,
+		ssa_pr_path_update_t update,
+		ssa_pr_path_update_clbk_t update_clbk,
+		void *clbk_prm)
+{
+	uint16_t source_lid = 0, dest_lid = 0;
+	const uint16_t source_base_lid = ntohs(p_source_rec->lid);
+	const uint16_t source_last_lid = source_base_lid + pow(2,p_source_rec->lmc) - 1;
+	const uint16_t dest_base_lid = ntohs(p_dest_rec->lid);
+	const uint16_t dest_last_lid = dest_base_lid + pow(2,p_dest_rec->lmc) - 1;
 
-				path_res = ssa_pr_path_params(p_ssa_db_smdb,p_context,
-						p_source_rec,p_dest_rec,&path_prm);
-				if(SSA_PR_SUCCESS == path_res) {
-					ssa_path_parms_t revers_path_prm;
-					ssa_pr_status_t revers_path_res = SSA_PR_SUCCESS;
-
-					revers_path_prm.from_guid = path_prm.to_guid;
-					revers_path_prm.from_lid = path_prm.to_lid; 
-					revers_path_prm.to_guid = path_prm.from_guid;
-					revers_path_prm.to_lid = path_prm.from_lid;
-					revers_path_prm.reversible = 1;
-					revers_path_prm.sl = SL_DEFAULT_VAL;
-					revers_path_prm.pkey= PK_DEFAULT_VAL;
-
-					revers_path_res = ssa_pr_path_params(p_ssa_db_smdb,p_context,
-							p_dest_rec,p_source_rec,&revers_path_prm);
-
-					if(SSA_PR_ERROR == revers_path_res) {
-						SSA_PR_LOG_INFO("Reverse path calculation is failed. Source LID 0x%"SCNx16" Destination LID: 0x%"SCNx16,source_lid,dest_lid);
-					}
-					else
-						path_prm.reversible = SSA_PR_SUCCESS == revers_path_res;
+	for(source_lid = source_base_lid; source_lid <= source_last_lid; ++source_lid) {
+		for(dest_lid = dest_base_lid; dest_lid <= dest_last_lid; ++dest_lid) {
+			p_path_prm->from_lid = htons(source_lid);
+			p_path_prm->to_lid = htons(dest_lid);
+			update_clbk(p_path_prm,update,clbk_prm);
+		}
+	}
+}
 
-					if(NULL != dump_clbk)
-						dump_clbk(&path_prm,clbk_prm);
+/*
+ * upd_emit_pair - recomputes an affected pair and passes its records to
+ * the callback if they differ from the previous ones. *p_path_res is the
+ * status of the new path.
+ */
+static ssa_pr_status_t upd_emit_pair(const struct ssa_db *p_ssa_db_smdb,
+		const struct ssa_pr_context *p_context,
+		const struct ep_guid_to_lid_tbl_rec *p_source_rec,
+		const struct ep_guid_to_lid_tbl_rec *p_dest_rec,
+		struct ssa_pr_counters *p_counters,
+		ssa_pr_status_t *p_path_res,
+		ssa_pr_path_lookup_t lookup_clbk,
+		ssa_pr_path_update_clbk_t update_clbk,
+		void *clbk_prm)
+{
+	ssa_path_parms_t path_prm;
+	ssa_path_parms_t prev_path_prm;
+	ssa_pr_status_t path_res = SSA_PR_SUCCESS;
+	int prev_found = 0;
+
+	memset(&path_prm,'\0',sizeof(path_prm));
+	path_prm.from_guid = p_source_rec->guid;
+	path_prm.to_guid = p_dest_rec->guid;
+	path_prm.sl = SL_DEFAULT_VAL;
+	path_prm.pkey = PK_DEFAULT_VAL;
+
+	path_res = ssa_pr_path_params(p_ssa_db_smdb,p_context,p_source_rec,p_dest_rec,&path_prm,NULL);
+	*p_path_res = path_res;
+	if(SSA_PR_ERROR == path_res) {
+		p_counters->errors++;
+		SSA_PR_LOG_ERROR("Path calculation is failed: (0x%"SCNx16") -> (0x%"SCNx16") "
+				"Incremental update is stopped.",ntohs(p_source_rec->lid),
+				ntohs(p_dest_rec->lid));
+		return SSA_PR_ERROR;
+	}
 
-				} else if(SSA_PR_ERROR == path_res) {
-					SSA_PR_LOG_ERROR("Path calculation is failed: (0x%"SCNx16") -> (0x%"SCNx16") "
-							"\"Half World\" calculation is stopped." ,source_lid,dest_lid);
-					return SSA_PR_ERROR;
-				} 
-			}
-		}
-		end = clock();
-		cpu_time_used = ((double) (end - start)) / CLOCKS_PER_SEC;
-		SSA_PR_LOG_DEBUG("\"half world\" path records for: 0x%"SCNx16
-				" time: %f sec.",source_lid,cpu_time_used );
+	/*
+	 * All LIDs of a pair share the path, so the base LIDs record
+	 * represents the pair
+	 */
+	prev_found = lookup_clbk(p_source_rec->lid,p_dest_rec->lid,&prev_path_prm,clbk_prm);
+
+	if(SSA_PR_NO_PATH == path_res) {
+		p_counters->no_paths++;
+		if(prev_found)
+			upd_emit_lids(p_source_rec,p_dest_rec,&path_prm,
+					SSA_PR_PATH_REMOVED,update_clbk,clbk_prm);
+	} else {
+		const uint64_t lid_pairs = (1ULL << p_source_rec->lmc) << p_dest_rec->lmc;
+		ssa_pr_status_t revers_path_res = ssa_pr_reverse_status(p_ssa_db_smdb,
+				p_context,NULL,p_source_rec,p_dest_rec,NULL);
+
+		if(SSA_PR_ERROR == revers_path_res)
+			p_counters->errors++;
+		path_prm.reversible = SSA_PR_SUCCESS == revers_path_res;
+		p_counters->paths += lid_pairs;
+		p_counters->hops += lid_pairs * path_prm.hops;
+
+		if(!prev_found || upd_path_differs(&path_prm,&prev_path_prm))
+			upd_emit_lids(p_source_rec,p_dest_rec,&path_prm,
+					SSA_PR_PATH_UPDATED,update_clbk,clbk_prm);
 	}
+
 	return SSA_PR_SUCCESS;
 }
-										
-struct ssa_db *ssa_pr_compute_half_world(struct ssa_db *p_ssa_db_smdb, 
-		void * p_ctnx,
-		be64_t port_guid)
+
+/*
+ * upd_emit_opposite - the route of an opposite pair isn't affected, but
+ * its reversible flag is the status of a recomputed path. The previous
+ * record is passed with the new flag if the flag changed.
+ */
+static void upd_emit_opposite(const struct ep_guid_to_lid_tbl_rec *p_source_rec,
+		const struct ep_guid_to_lid_tbl_rec *p_dest_rec,
+		const ssa_pr_status_t revers_path_res,
+		ssa_pr_path_lookup_t lookup_clbk,
+		ssa_pr_path_update_clbk_t update_clbk,
+		void *clbk_prm)
 {
-	struct ssa_db *p_prdb = NULL;
-	uint64_t record_num = 0;
-	size_t guid_to_lid_count = 0;
+	ssa_path_parms_t path_prm;
+	const uint8_t reversible = SSA_PR_SUCCESS == revers_path_res;
+
+	if(!lookup_clbk(p_source_rec->lid,p_dest_rec->lid,&path_prm,clbk_prm) ||
+			!path_prm.reversible == !reversible)
+		return;
+
+	path_prm.from_guid = p_source_rec->guid;
+	path_prm.to_guid = p_dest_rec->guid;
+	path_prm.reversible = reversible;
+	upd_emit_lids(p_source_rec,p_dest_rec,&path_prm,
+			SSA_PR_PATH_UPDATED,update_clbk,clbk_prm);
+}
+
+ssa_pr_status_t ssa_pr_whole_world_update(struct ssa_db *p_ssa_db_smdb,
+		void *context,
+		const struct ssa_pr_smdb_diff *p_diff,
+		ssa_pr_path_lookup_t lookup_clbk,
+		ssa_pr_path_update_clbk_t update_clbk,
+		void *clbk_prm)
+{
+	struct ssa_pr_context *p_context = (struct ssa_pr_context *)context;
+	struct ssa_pr_smdb_index *p_index = NULL;
 	const struct ep_guid_to_lid_tbl_rec *p_guid_to_lid_tbl = NULL;
-	const struct ep_guid_to_lid_tbl_rec *p_curr_rec = NULL;
-	size_t i = 0;
+	struct ssa_pr_update_job job;
+	struct ssa_pr_counters counters;
+	size_t count = 0, i = 0, j = 0, pairs = 0;
 	ssa_pr_status_t res = SSA_PR_SUCCESS;
-	uint16_t source_base_lid = 0;
-	uint16_t source_last_lid = 0;
 
 	SSA_ASSERT(p_ssa_db_smdb);
+	SSA_ASSERT(p_context);
+	SSA_ASSERT(p_diff);
+	SSA_ASSERT(lookup_clbk);
+	SSA_ASSERT(update_clbk);
+
+	p_index = p_context->p_index;
+
+	/*
+	 * The index keeps the state of the previous calculation. New or
+	 * removed nodes change dense switch numbers and need a full one.
+	 */
+	if((uint64_t)-1 == p_index->epoch || p_index->table_epochs[SSA_PR_INDEX_GUID_TO_LID] !=
+			ntohll(p_ssa_db_smdb->p_db_tables[SSA_TABLE_ID_GUID_TO_LID].epoch)) {
+		SSA_PR_LOG_ERROR("Incremental update is not possible. Full \"whole world\" "
+				"calculation is required.");
+		return SSA_PR_ERROR;
+	}
+
+	if(p_diff->node_lid_count || ssa_pr_update_lft_blocks(p_index,p_ssa_db_smdb,
+				p_diff->p_lft_block_ids,p_diff->lft_block_count)) {
+		if(ssa_pr_context_rebuild_indexes(p_context,p_ssa_db_smdb)) {
+			SSA_PR_LOG_ERROR("Index rebuild is failed.");
+			return SSA_PR_ERROR;
+		}
+	}
+
+	memset(&counters,'\0',sizeof(counters));
+	memset(&job,'\0',sizeof(job));
+	job.p_smdb = p_ssa_db_smdb;
+	job.p_index = p_index;
+
+	if(upd_prepare(&job,p_diff)) {
+		res = SSA_PR_ERROR;
+		goto Exit;
+	}
 
 	p_guid_to_lid_tbl = (const struct ep_guid_to_lid_tbl_rec *)p_ssa_db_smdb->pp_tables[SSA_TABLE_ID_GUID_TO_LID];
 	SSA_ASSERT(p_guid_to_lid_tbl);
+	count = get_dataset_count(p_ssa_db_smdb,SSA_TABLE_ID_GUID_TO_LID);
 
-	guid_to_lid_count = get_dataset_count(p_ssa_db_smdb,SSA_TABLE_ID_GUID_TO_LID);
-	record_num = guid_to_lid_count * guid_to_lid_count * 2;  
-
-	p_prdb = ssa_prdb_create(record_num);
-	if(!p_prdb) {
-		SSA_PR_LOG_ERROR("Path record database creation is failed."
-				" Number of records: %ll",record_num);
-		return NULL;
+	for(j = 0; j < count; ++j) {
+		const struct ep_guid_to_lid_tbl_rec *p_dest_rec = p_guid_to_lid_tbl + j;
+		const int dest_changed = upd_node_changed(&job,p_dest_rec->lid);
+
+		/*
+		 * Without port or link changes only destinations covered by
+		 * changed LFT blocks are affected
+		 */
+		if(!job.nodes_changed && !UPD_BIT(job.p_changed_block_nums,ntohs(p_dest_rec->lid) >> 6))
+			continue;
+
+		job.dest_lid = p_dest_rec->lid;
+		memset(job.p_states,SSA_PR_UPD_UNKNOWN,p_index->switch_count);
+
+		for(i = 0; i < count; ++i) {
+			if(!dest_changed && !upd_source_touched(&job,p_guid_to_lid_tbl + i))
+				continue;
+			if(upd_add_pair(&job,i,j)) {
+				res = SSA_PR_ERROR;
+				goto Exit;
+			}
+		}
 	}
 
-	res = ssa_pr_half_world(p_ssa_db_smdb,p_ctnx,port_guid,insert_pr_to_prdb,p_prdb);
-	if (SSA_PR_ERROR == res) {
-		SSA_PR_LOG_ERROR("\"Half world\" calculation is failed for GUID: 0x%"PRIx64
-				,ntohll(port_guid));
-		goto Error;
+	qsort(job.p_pairs,job.pair_count,sizeof(job.p_pairs[0]),upd_pair_cmp);
+
+	for(i = 0; i < job.pair_count; ++i) {
+		const size_t source_index = job.p_pairs[i] >> 32;
+		const size_t dest_index = job.p_pairs[i] & 0xFFFFFFFF;
+		ssa_pr_status_t path_res = SSA_PR_SUCCESS;
+
+		res = upd_emit_pair(p_ssa_db_smdb,p_context,
+				p_guid_to_lid_tbl + source_index,p_guid_to_lid_tbl + dest_index,
+				&counters,&path_res,lookup_clbk,update_clbk,clbk_prm);
+		if(SSA_PR_ERROR == res)
+			goto Exit;
+		pairs++;
+
+		/*
+		 * Reversibility of the opposite record depends on this pair
+		 */
+		if(source_index != dest_index &&
+				!upd_pair_found(&job,(uint64_t)dest_index << 32 | source_index))
+			upd_emit_opposite(p_guid_to_lid_tbl + dest_index,
+					p_guid_to_lid_tbl + source_index,path_res,
+					lookup_clbk,update_clbk,clbk_prm);
 	}
-	return p_prdb;
-Error:
-	if(p_prdb) {
-		ssa_db_destroy(p_prdb);
-		return NULL;
+
+	SSA_PR_LOG_INFO("Incremental update: changed LFT blocks: %zu changed nodes: %zu "
+			"recomputed GUID pairs: %zu",p_diff->lft_block_count,
+			p_diff->node_lid_count,pairs);
+Exit:
+	ssa_pr_add_counters(p_context,&counters);
+	free(job.p_pairs);
+	free(job.p_states);
+	free(job.p_changed_blocks);
+	free(job.p_changed_block_nums);
+	free(job.p_changed_lids);
+	return res;
+}
+
+/*
+ * ssa_pr_query_port - finds the record of a queried port
+ * @p_lid: Output. LID of the path in network order.
+ */
+static const struct ep_guid_to_lid_tbl_rec *ssa_pr_query_port(const struct ssa_db *p_ssa_db_smdb,
+		const struct ssa_pr_smdb_index *p_index,
+		const struct ssa_pr_port_id *p_port,
+		be16_t *p_lid)
+{
+	const struct ep_guid_to_lid_tbl_rec *p_rec = NULL;
+
+	if(SSA_PR_PORT_ID_GUID == p_port->type && p_port->guid) {
+		p_rec = find_guid_to_lid_rec_by_guid(p_ssa_db_smdb,p_index,p_port->guid);
+		if(p_rec)
+			*p_lid = p_rec->lid;
+	} else if(SSA_PR_PORT_ID_LID == p_port->type) {
+		p_rec = find_guid_to_lid_rec_by_lid(p_ssa_db_smdb,p_index,p_port->lid);
+		*p_lid = p_port->lid;
+	} else {
+		SSA_PR_LOG_ERROR("Invalid port identifier. Type: %d",p_port->type);
 	}
+
+	return p_rec;
 }
 
-ssa_pr_status_t ssa_pr_whole_world(struct ssa_db* p_ssa_db_smdb, 
-		void * context,
-		ssa_pr_path_dump_t dump_clbk,
-		void* clbk_prm)
+/*
+ * ssa_pr_query_compute - computes a pair missed by the query cache
+ *
+ * Forward and reverse paths are resolved by suffix tables rooted at the
+ * destination and the source. If a table can't be prepared, the path is
+ * computed by a route walk.
+ */
+static ssa_pr_status_t ssa_pr_query_compute(const struct ssa_db *p_ssa_db_smdb,
+		struct ssa_pr_context *p_context,
+		const struct ep_guid_to_lid_tbl_rec *p_source_rec,
+		const struct ep_guid_to_lid_tbl_rec *p_dest_rec,
+		struct ssa_pr_query_entry *p_entry)
 {
-	size_t i = 0;
-	const struct ep_guid_to_lid_tbl_rec *p_guid_to_lid_tbl = NULL;
-	size_t count = 0;
+	struct ssa_pr_query_cache *p_cache = &p_context->query_cache;
+	struct ssa_pr_dp_table *p_dp = NULL;
+	ssa_path_parms_t path_prm;
 	ssa_pr_status_t res = SSA_PR_SUCCESS;
 
+	memset(&path_prm,'\0',sizeof(path_prm));
+	p_dp = ssa_pr_query_cache_dp(p_cache,p_ssa_db_smdb,p_context->p_index,p_dest_rec);
+	if(p_dp)
+		res = ssa_pr_dp_path_params(p_dp,p_ssa_db_smdb,p_context->p_index,
+				p_source_rec,&path_prm);
+	else
+		res = ssa_pr_path_params(p_ssa_db_smdb,p_context,p_source_rec,
+				p_dest_rec,&path_prm,NULL);
+
+	if(SSA_PR_SUCCESS == res) {
+		p_dp = ssa_pr_query_cache_dp(p_cache,p_ssa_db_smdb,p_context->p_index,p_source_rec);
+		p_entry->reversible = SSA_PR_SUCCESS == ssa_pr_reverse_status(p_ssa_db_smdb,
+				p_context,p_dp,p_source_rec,p_dest_rec,NULL);
+		p_entry->mtu = path_prm.mtu;
+		p_entry->rate = path_prm.rate;
+		p_entry->pkt_life = path_prm.pkt_life;
+		p_entry->hops = path_prm.hops;
+	}
+	p_entry->status = res;
+
+	return res;
+}
+
+ssa_pr_status_t ssa_pr_query_pair(struct ssa_db *p_ssa_db_smdb,
+		void *context,
+		const struct ssa_pr_port_id *p_source,
+		const struct ssa_pr_port_id *p_dest,
+		ssa_path_parms_t *p_path_prm)
+{
+	struct ssa_pr_context *p_context = (struct ssa_pr_context *)context;
+	const struct ep_guid_to_lid_tbl_rec *p_source_rec = NULL;
+	const struct ep_guid_to_lid_tbl_rec *p_dest_rec = NULL;
+	const struct ssa_pr_query_entry *p_entry = NULL;
+	struct ssa_pr_query_entry entry;
+	be16_t source_lid = 0, dest_lid = 0;
+
 	SSA_ASSERT(p_ssa_db_smdb);
+	SSA_ASSERT(p_context);
+	SSA_ASSERT(p_source);
+	SSA_ASSERT(p_dest);
+	SSA_ASSERT(p_path_prm);
 
-	p_guid_to_lid_tbl = (struct ep_guid_to_lid_tbl_rec *)p_ssa_db_smdb->pp_tables[SSA_TABLE_ID_GUID_TO_LID];
-	SSA_ASSERT(p_guid_to_lid_tbl);
+	p_context->stats.query_calls++;
 
-	count = get_dataset_count(p_ssa_db_smdb,SSA_TABLE_ID_GUID_TO_LID);
+	if(ssa_pr_context_rebuild_indexes(p_context,p_ssa_db_smdb)) {
+		SSA_PR_LOG_ERROR("Index rebuild is failed.");
+		return SSA_PR_ERROR;
+	}
 
-	for (i = 0; i < count; i++) {
-		res = ssa_pr_half_world(p_ssa_db_smdb,context,p_guid_to_lid_tbl[i].guid,dump_clbk,clbk_prm);
-		if (SSA_PR_ERROR == res) {
-			SSA_PR_LOG_ERROR("\"Half world\" calculation is failed for GUID: 0x%"PRIx64
-					" . \"Whole world\" calculation is stopped.",ntohll(p_guid_to_lid_tbl[i].guid));
-			return res;
+	if(ssa_pr_query_cache_validate(&p_context->query_cache,p_ssa_db_smdb,
+				p_context->p_index))
+		return SSA_PR_ERROR;
+
+	p_source_rec = ssa_pr_query_port(p_ssa_db_smdb,p_context->p_index,p_source,&source_lid);
+	p_dest_rec = ssa_pr_query_port(p_ssa_db_smdb,p_context->p_index,p_dest,&dest_lid);
+	if(!p_source_rec || !p_dest_rec)
+		return SSA_PR_ERROR;
+
+	p_entry = ssa_pr_query_cache_lookup(&p_context->query_cache,
+			ssa_pr_query_cache_key(p_source_rec,p_dest_rec));
+	if(p_entry) {
+		p_context->stats.query_hits++;
+	} else {
+		memset(&entry,'\0',sizeof(entry));
+		entry.key = ssa_pr_query_cache_key(p_source_rec,p_dest_rec);
+		if(SSA_PR_ERROR == ssa_pr_query_compute(p_ssa_db_smdb,p_context,
+					p_source_rec,p_dest_rec,&entry)) {
+			p_context->stats.errors++;
+			SSA_PR_LOG_ERROR("Path calculation is failed: (0x%"SCNx16") -> (0x%"SCNx16")",
+					ntohs(source_lid),ntohs(dest_lid));
+			return SSA_PR_ERROR;
+		}
+		ssa_pr_query_cache_insert(&p_context->query_cache,&entry);
+		p_entry = &entry;
+
+		if(SSA_PR_SUCCESS == entry.status) {
+			p_context->stats.paths++;
+			p_context->stats.hops += entry.hops;
+		} else {
+			p_context->stats.no_paths++;
 		}
 	}
-	return SSA_PR_SUCCESS;
-}
 
+	if(SSA_PR_SUCCESS != p_entry->status)
+		return p_entry->status;
+
+	memset(p_path_prm,'\0',sizeof(*p_path_prm));
+	p_path_prm->from_guid = p_source_rec->guid;
+	p_path_prm->from_lid = source_lid;
+	p_path_prm->to_guid = p_dest_rec->guid;
+	p_path_prm->to_lid = dest_lid;
+	p_path_prm->sl = SL_DEFAULT_VAL;
+	p_path_prm->pkey = PK_DEFAULT_VAL;
+	p_path_prm->mtu = p_entry->mtu;
+	p_path_prm->rate = p_entry->rate;
+	p_path_prm->pkt_life = p_entry->pkt_life;
+	p_path_prm->hops = p_entry->hops;
+	p_path_prm->reversible = p_entry->reversible;
 
+	return SSA_PR_SUCCESS;
+}
 
 static inline const struct ep_port_tbl_rec *get_switch_port(const struct ssa_db *p_ssa_db_smdb,
 		const struct ssa_pr_smdb_index * p_index,
@@ -312,17 +2272,28 @@ static inline const struct ep_port_tbl_rec *get_host_port(const struct ssa_db *p
 }
 
 
+/*
+ * The route walk uses the routing graph of the SMDB index: a hop is a few
+ * loads of host order values. Ranks of rates give the same result as
+ * ib_path_compare_rates: a rate is replaced only by a strictly lower one.
+ */
 static ssa_pr_status_t ssa_pr_path_params(const struct ssa_db *p_ssa_db_smdb,
 		const struct ssa_pr_context *p_context,
 		const struct ep_guid_to_lid_tbl_rec *p_source_rec,
 		const struct ep_guid_to_lid_tbl_rec *p_dest_rec,
-		ssa_path_parms_t *p_path_prm)
+		ssa_path_parms_t *p_path_prm,
+		struct ssa_pr_fail *p_fail)
 {
-	int source_port_num = -1; 
+	be16_t lid = 0;
+	uint8_t port_num = 0;
 	const struct ep_port_tbl_rec *source_port = NULL;
 	const struct ep_port_tbl_rec *dest_port = NULL;
 	const struct ep_port_tbl_rec *port = NULL;
+	const struct ep_port_tbl_rec *p_port_tbl = NULL;
 	const struct ep_subnet_opts_tbl_rec *opt_rec = NULL;
+	const struct ssa_pr_smdb_index *p_index = NULL;
+	uint32_t port_index = 0, dest_index = 0;
+	uint8_t rate_rank = 0;
 
 	SSA_ASSERT(p_ssa_db_smdb);
 	SSA_ASSERT(p_context);
@@ -335,11 +2306,20 @@ static ssa_pr_status_t ssa_pr_path_params(const struct ssa_db *p_ssa_db_smdb,
 		(const struct ep_subnet_opts_tbl_rec *)p_ssa_db_smdb->pp_tables[SSA_TABLE_ID_SUBNET_OPTS];
 	SSA_ASSERT(opt_rec);
 
+	p_index = p_context->p_index;
+	p_port_tbl = (const struct ep_port_tbl_rec *)p_ssa_db_smdb->pp_tables[SSA_TABLE_ID_PORT];
+	SSA_ASSERT(p_port_tbl);
+	SSA_ASSERT(p_index->p_graph);
+
 	if(p_source_rec->is_switch) 
 		source_port = get_switch_port(p_ssa_db_smdb,p_context->p_index,p_source_rec->lid,0);
 	else
 		source_port = get_host_port(p_ssa_db_smdb,p_context->p_index,p_source_rec->lid);
 	if(NULL == source_port) {
+		if(p_fail) {
+			ssa_pr_set_fail(p_fail,SSA_PR_FAIL_NO_PORT,p_source_rec->lid,-1);
+			return SSA_PR_ERROR;
+		}
 		SSA_PR_LOG_ERROR("Source port is not found. Path record calculation is stopped."
 			   " LID: 0x%"SCNx16,htons(p_source_rec->lid));
 		return SSA_PR_ERROR;
@@ -350,6 +2330,10 @@ static ssa_pr_status_t ssa_pr_path_params(const struct ssa_db *p_ssa_db_smdb,
 	else
 		dest_port = get_host_port(p_ssa_db_smdb,p_context->p_index,p_dest_rec->lid);
 	if(NULL == dest_port) {
+		if(p_fail) {
+			ssa_pr_set_fail(p_fail,SSA_PR_FAIL_NO_PORT,p_dest_rec->lid,-1);
+			return SSA_PR_ERROR;
+		}
 		SSA_PR_LOG_ERROR("Destination port is not found. Path record calculation is stopped."
 			   " LID: 0x%"SCNx16,htons(p_dest_rec->lid));
 		return SSA_PR_ERROR;
@@ -360,17 +2344,25 @@ static ssa_pr_status_t ssa_pr_path_params(const struct ssa_db *p_ssa_db_smdb,
 	p_path_prm->rate = source_port->rate & SSA_DB_PORT_RATE_MASK;
 	p_path_prm->pkt_life = 0;
 	p_path_prm->hops = 0;
+	rate_rank = p_index->port_rate_rank[source_port - p_port_tbl];
+	dest_index = dest_port - p_port_tbl;
 
 	if(p_source_rec->is_switch) {
 		const int out_port_num = find_destination_port(p_ssa_db_smdb,p_context->p_index,
 				p_source_rec->lid,p_dest_rec->lid);
 		if(out_port_num  < 0) {
+			if(p_fail) {
+				ssa_pr_set_fail(p_fail,SSA_PR_FAIL_LFT,p_source_rec->lid,-1);
+				return SSA_PR_ERROR;
+			}
 			SSA_PR_LOG_ERROR("Failed to faind outgoing port for LID: 0x%"SCNx16
 					" on switch LID: 0x%"SCNx16". "
 					"Path record calculation is sttoped."
 					,htons(p_dest_rec->lid),htons(p_source_rec->lid));
 			return SSA_PR_ERROR;
 		} else if(LFT_NO_PATH == out_port_num) {
+			if(p_fail)
+				ssa_pr_set_fail(p_fail,SSA_PR_FAIL_NO_ROUTE,p_source_rec->lid,-1);
 			SSA_PR_LOG_DEBUG("There is no path from LID: 0x%"SCNx16" to LID: 0x%"SCNx16" .",
 					htons(p_source_rec->lid),htons(p_dest_rec->lid));
 			return SSA_PR_NO_PATH;
@@ -378,27 +2370,47 @@ static ssa_pr_status_t ssa_pr_path_params(const struct ssa_db *p_ssa_db_smdb,
 
 		port = find_port(p_ssa_db_smdb,p_context->p_index,p_source_rec->lid,out_port_num);	
 		if(NULL == port) {
+			if(p_fail) {
+				ssa_pr_set_fail(p_fail,SSA_PR_FAIL_NO_PORT,p_source_rec->lid,out_port_num);
+				return SSA_PR_ERROR;
+			}
 			SSA_PR_LOG_ERROR("Port is not found. Path record calculation is stopped."
 					" LID: 0x%"SCNx16" num: %u",htons(p_source_rec->lid),out_port_num);
 			return SSA_PR_ERROR;
 		}
+		port_index = port - p_port_tbl;
 	} else {
-		port = source_port;
+		port_index = source_port - p_port_tbl;
 	}
 
-	while(port != dest_port) {
+	while(port_index != dest_index) {
 		int out_port_num = -1;
-
-		port = find_linked_port(p_ssa_db_smdb,p_context->p_index,port->port_lid,port->port_num);
-		if(NULL == port) {
+		const uint32_t from_index = port_index;
+		uint32_t switch_index = 0;
+
+		port_index = p_index->port_link[from_index];
+		if(SSA_PR_NO_INDEX == port_index) {
+			lid = p_port_tbl[from_index].port_lid;
+			port_num = p_port_tbl[from_index].port_num;
+			/* The lookup by LID reports the missing link */
+			find_linked_port(p_ssa_db_smdb,p_index,lid,port_num);
+			if(p_fail) {
+				ssa_pr_set_fail(p_fail,SSA_PR_FAIL_NO_LINK,lid,port_num);
+				return SSA_PR_ERROR;
+			}
 			SSA_PR_LOG_ERROR("Port is not found. Path record calculation is stopped.");
 			return SSA_PR_ERROR;
 		}
 
-		if(port == dest_port)
+		if(port_index == dest_index)
 			break;
 
-		if(!(port->rate & SSA_DB_PORT_IS_SWITCH_MASK)) {
+		if(!p_index->port_is_switch[port_index]) {
+			port = p_port_tbl + port_index;
+			if(p_fail) {
+				ssa_pr_set_fail(p_fail,SSA_PR_FAIL_BAD_ROUTE,port->port_lid,port->port_num);
+				return SSA_PR_ERROR;
+			}
 			SSA_PR_LOG_ERROR("Error: Internal error, bad path while routing "
 				"(GUID: 0x%016"PRIx64") port %d to "
 				"(GUID: 0x%016"PRIx64") port %d; "
@@ -410,31 +2422,49 @@ static ssa_pr_status_t ssa_pr_path_params(const struct ssa_db *p_ssa_db_smdb,
 			return SSA_PR_ERROR;
 		}	
 
-		p_path_prm->mtu = MIN(p_path_prm->mtu,port->neighbor_mtu);
-		if(ib_path_compare_rates_fast(p_path_prm->rate,port->rate & SSA_DB_PORT_RATE_MASK) > 0)
-			p_path_prm->rate = port->rate & SSA_DB_PORT_RATE_MASK;
+		p_path_prm->mtu = MIN(p_path_prm->mtu,p_index->port_mtu[port_index]);
+		if(p_index->port_rate_rank[port_index] < rate_rank) {
+			rate_rank = p_index->port_rate_rank[port_index];
+			p_path_prm->rate = p_index->port_rate[port_index];
+		}
 
-		out_port_num  = find_destination_port(p_ssa_db_smdb,p_context->p_index,port->port_lid,p_dest_rec->lid);
+		switch_index = port_index;
+		out_port_num = route_out_port(p_index,switch_index,p_dest_rec->lid);
 		if(LFT_NO_PATH == out_port_num){
+			lid = p_port_tbl[switch_index].port_lid;
+			if(p_fail)
+				ssa_pr_set_fail(p_fail,SSA_PR_FAIL_NO_ROUTE,lid,-1);
 			SSA_PR_LOG_DEBUG("There is no path from LID: 0x%"SCNx16" to LID: 0x%"SCNx16" .",
 					htons(p_source_rec->lid),htons(p_dest_rec->lid));
 			return SSA_PR_NO_PATH;
 		}
 
-		port = find_port(p_ssa_db_smdb,p_context->p_index,port->port_lid,out_port_num);
-		if(NULL == port) {
+		port_index = route_switch_port(p_ssa_db_smdb,p_index,switch_index,out_port_num);
+		if(SSA_PR_NO_INDEX == port_index) {
+			lid = p_port_tbl[switch_index].port_lid;
+			if(p_fail) {
+				ssa_pr_set_fail(p_fail,SSA_PR_FAIL_NO_PORT,lid,out_port_num);
+				return SSA_PR_ERROR;
+			}
 			SSA_PR_LOG_ERROR("Port is not found. Path record calculation is stopped."
 					" LID: 0x%"SCNx16" num: %u",
-					htons(port->port_lid),out_port_num);
+					htons(lid),out_port_num);
 			return SSA_PR_ERROR;
 		}
 
-		p_path_prm->mtu = MIN(p_path_prm->mtu,port->neighbor_mtu);
-		if(ib_path_compare_rates_fast(p_path_prm->rate,port->rate & SSA_DB_PORT_RATE_MASK) > 0)
-			p_path_prm->rate = port->rate & SSA_DB_PORT_RATE_MASK;
+		p_path_prm->mtu = MIN(p_path_prm->mtu,p_index->port_mtu[port_index]);
+		if(p_index->port_rate_rank[port_index] < rate_rank) {
+			rate_rank = p_index->port_rate_rank[port_index];
+			p_path_prm->rate = p_index->port_rate[port_index];
+		}
 		p_path_prm->hops++;
 
 		if (p_path_prm->hops > MAX_HOPS) {
+			lid = p_port_tbl[switch_index].port_lid;
+			if(p_fail) {
+				ssa_pr_set_fail(p_fail,SSA_PR_FAIL_LOOP,lid,out_port_num);
+				return SSA_PR_ERROR;
+			}
 			SSA_PR_LOG_ERROR(
 				"Path from GUID 0x%016" PRIx64 " (port %d) "
 				"to lid %u GUID 0x%016" PRIx64 " (port %d) "
@@ -448,14 +2478,20 @@ static ssa_pr_status_t ssa_pr_path_params(const struct ssa_db *p_ssa_db_smdb,
 		}
 	}
 
-	p_path_prm->mtu = MIN(p_path_prm->mtu,port->neighbor_mtu);
-	if(ib_path_compare_rates_fast(p_path_prm->rate,port->rate & SSA_DB_PORT_RATE_MASK) > 0)
-		p_path_prm->rate = port->rate & SSA_DB_PORT_RATE_MASK;
+	p_path_prm->mtu = MIN(p_path_prm->mtu,p_index->port_mtu[port_index]);
+	if(p_index->port_rate_rank[port_index] < rate_rank)
+		p_path_prm->rate = p_index->port_rate[port_index];
 
 	return SSA_PR_SUCCESS;
 }
 
 
+/*
+ * The notice about a log level above SSA_PR_LOG_COMPILE_LEVEL is printed
+ * once per process
+ */
+static int ssa_pr_log_level_noticed;
+
 void *ssa_pr_create_context(FILE* log_fd, int log_level)
 {
 	struct ssa_pr_context *p_context = NULL;
@@ -463,6 +2499,18 @@ void *ssa_pr_create_context(FILE* log_fd, int log_level)
 	ssa_pr_log_level = log_level;
 	ssa_pr_log_fd = log_fd;
 
+	/*
+	 * Messages above the compiled in level are dropped without a trace,
+	 * so a shorter log than requested is explained
+	 */
+	if(log_level > SSA_PR_LOG_COMPILE_LEVEL && !ssa_pr_log_level_noticed) {
+		ssa_pr_log_level_noticed = 1;
+		SSA_PR_LOG_PRINT_FUNCTION(SSA_PR_LOG_FORMAT " Log level %d is requested, but only"
+				" levels up to %d are compiled in. Configure with --enable-debug"
+				" or build with -DSSA_PR_LOG_COMPILE_LEVEL=<level> for more.\n",
+				SSA_PR_LOG_PREFIX_ARGS(INFO_TAG),log_level,SSA_PR_LOG_COMPILE_LEVEL);
+	}
+
 	p_context = (struct ssa_pr_context *)malloc(sizeof(struct ssa_pr_context )); 
 	if(!p_context) {
 		SSA_PR_LOG_ERROR("Cannot allocate path record calculation context");
@@ -480,6 +2528,10 @@ void *ssa_pr_create_context(FILE* log_fd, int log_level)
 	memset(p_context->p_index,'\0',sizeof(struct ssa_pr_smdb_index));
 	p_context->p_index->epoch = -1;
 
+	p_context->engine = SSA_PR_ENGINE_WALK;
+	ssa_pr_dp_init(&p_context->dp);
+	ssa_pr_query_cache_init(&p_context->query_cache);
+
 	return p_context;
 Error:
 	if(p_context && p_context->p_index) {
@@ -508,6 +2560,9 @@ void ssa_pr_destroy_context(void * ctx)
 			free(p_context->p_index);
 			p_context->p_index = NULL;
 		}
+		ssa_pr_dp_destroy(&p_context->dp);
+		ssa_pr_fail_report_destroy(&p_context->fail_report);
+		ssa_pr_query_cache_destroy(&p_context->query_cache);
 		free(p_context);
 		p_context = NULL;
 	}
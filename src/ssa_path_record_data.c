@@ -33,6 +33,7 @@
 #endif              /* HAVE_CONFIG_H */
 
 #include <errno.h>
+#include <stdlib.h>
 #include <math.h>
 #include <string.h>
 #include <inttypes.h>
@@ -58,6 +59,68 @@ inline static size_t get_dataset_count(const struct ssa_db *p_smdb,
 	return ntohll(p_smdb->p_db_tables[table_id].set_count);
 }
 
+/*
+ * build_lid_lookups - allocates per LID lookup tables. They cover LIDs up
+ * to the highest one of SSA_TABLE_ID_GUID_TO_LID, including LMC ranges.
+ * All entries are "not found".
+ */
+static int build_lid_lookups(struct ssa_pr_smdb_index *p_index,
+		const struct ssa_db *p_smdb)
+{
+	size_t i = 0, count = 0, lid_count = 1;
+	const struct ep_guid_to_lid_tbl_rec *p_guid_to_lid_tbl = NULL;
+	uint8_t *p_lookup = NULL;
+
+	SSA_ASSERT(p_smdb);
+	SSA_ASSERT(p_index);
+	SSA_ASSERT(!p_index->p_lid_lookup);
+
+	p_guid_to_lid_tbl =
+		(struct ep_guid_to_lid_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_GUID_TO_LID];
+	SSA_ASSERT(p_guid_to_lid_tbl);
+
+	count = get_dataset_count(p_smdb,SSA_TABLE_ID_GUID_TO_LID);
+
+	for (i = 0; i < count; i++) {
+		size_t last_lid = ntohs(p_guid_to_lid_tbl[i].lid) +
+			(1U << p_guid_to_lid_tbl[i].lmc) - 1;
+
+		if(last_lid > MAX_LOOKUP_LID)
+			last_lid = MAX_LOOKUP_LID;
+		if(lid_count < last_lid + 1)
+			lid_count = last_lid + 1;
+	}
+
+	/*
+	 * Tables are ordered by the size of entries, so all are aligned
+	 */
+	p_index->lid_lookup_size = lid_count * (3 * sizeof(uint32_t) +
+			2 * sizeof(uint16_t) + sizeof(uint8_t));
+	p_lookup = (uint8_t *)malloc(p_index->lid_lookup_size);
+	if(!p_lookup) {
+		SSA_PR_LOG_ERROR("Cannot allocate LID lookup tables. LIDs: %zu",lid_count);
+		p_index->lid_lookup_size = 0;
+		return -1;
+	}
+
+	p_index->p_lid_lookup = p_lookup;
+	p_index->lid_lookup_count = lid_count;
+	p_index->guid_to_lid_lookup = (uint32_t *)p_lookup;
+	p_index->ca_port_lookup = p_index->guid_to_lid_lookup + lid_count;
+	p_index->ca_link_lookup = p_index->ca_port_lookup + lid_count;
+	p_index->switch_id_lookup = (uint16_t *)(p_index->ca_link_lookup + lid_count);
+	p_index->lft_top_lookup = p_index->switch_id_lookup + lid_count;
+	p_index->is_switch_lookup = (uint8_t *)(p_index->lft_top_lookup + lid_count);
+
+	memset(p_index->guid_to_lid_lookup,0xFF,3 * lid_count * sizeof(uint32_t));
+	memset(p_index->switch_id_lookup,'\0',2 * lid_count * sizeof(uint16_t) +
+			lid_count * sizeof(uint8_t));
+
+	SSA_PR_LOG_INFO("LID lookup tables size: %zu bytes. LIDs: %zu",
+			p_index->lid_lookup_size,lid_count);
+	return 0;
+}
+
 static int build_is_switch_lookup(struct ssa_pr_smdb_index *p_index,
 		const struct ssa_db *p_smdb)
 {
@@ -71,19 +134,87 @@ static int build_is_switch_lookup(struct ssa_pr_smdb_index *p_index,
 		(struct ep_guid_to_lid_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_GUID_TO_LID];
 	SSA_ASSERT(p_guid_to_lid_tbl);
 
-	memset(p_index->is_switch_lookup,'\0',(MAX_LOOKUP_LID + 1) * sizeof(p_index->is_switch_lookup[0]));
+	memset(p_index->is_switch_lookup,'\0',p_index->lid_lookup_count * sizeof(p_index->is_switch_lookup[0]));
+	memset(p_index->switch_id_lookup,'\0',p_index->lid_lookup_count * sizeof(p_index->switch_id_lookup[0]));
+	p_index->switch_count = 0;
 
 	count = get_dataset_count(p_smdb,SSA_TABLE_ID_GUID_TO_LID);
 
 	for (i = 0; i < count; i++) {
 		uint16_t lid = ntohs(p_guid_to_lid_tbl[i].lid);
+
+		if(lid >= p_index->lid_lookup_count)
+			continue;
 		p_index->is_switch_lookup[lid] =
 		   	p_guid_to_lid_tbl[i].is_switch;
+		if(p_guid_to_lid_tbl[i].is_switch)
+			p_index->switch_id_lookup[lid] = p_index->switch_count++;
 	}
 
 	return 0;
 }
 
+static inline size_t guid_hash(const be64_t guid, unsigned int bits)
+{
+	/*
+	 * Fibonacci hashing. GUIDs of a fabric often differ only in a few
+	 * bits, the multiplication spreads them over the high bits.
+	 */
+	return (size_t)((guid * 0x9E3779B97F4A7C15ULL) >> (64 - bits));
+}
+
+static int build_guid_to_lid_index(struct ssa_pr_smdb_index *p_index,
+		const struct ssa_db *p_smdb)
+{
+	size_t i = 0, count = 0, size = 0;
+	const struct ep_guid_to_lid_tbl_rec *p_guid_to_lid_tbl = NULL;
+
+	SSA_ASSERT(p_smdb);
+	SSA_ASSERT(p_index);
+
+	p_guid_to_lid_tbl = 
+		(struct ep_guid_to_lid_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_GUID_TO_LID];
+	SSA_ASSERT(p_guid_to_lid_tbl);
+
+	memset(p_index->guid_to_lid_lookup,0xFF,p_index->lid_lookup_count * sizeof(p_index->guid_to_lid_lookup[0]));
+
+	count = get_dataset_count(p_smdb,SSA_TABLE_ID_GUID_TO_LID);
+
+	/*
+	 * Load factor of the hash table is at most 1/2
+	 */
+	p_index->guid_hash_bits = 1;
+	while(((size_t)1 << p_index->guid_hash_bits) < 2 * count)
+		p_index->guid_hash_bits++;
+	size = (size_t)1 << p_index->guid_hash_bits;
+
+	p_index->guid_hash = (uint32_t *)malloc(size * sizeof(uint32_t));
+	if(!p_index->guid_hash) {
+		SSA_PR_LOG_ERROR("Cannot allocate GUID hash table. Size: %zu",size);
+		return -1;
+	}
+	memset(p_index->guid_hash,0xFF,size * sizeof(uint32_t));
+
+	for (i = 0; i < count; i++) {
+		size_t slot = guid_hash(p_guid_to_lid_tbl[i].guid,p_index->guid_hash_bits);
+		uint16_t base_lid = ntohs(p_guid_to_lid_tbl[i].lid);
+		size_t lid = 0;
+
+		while(SSA_PR_NO_INDEX != p_index->guid_hash[slot]) {
+			if(p_guid_to_lid_tbl[p_index->guid_hash[slot]].guid == p_guid_to_lid_tbl[i].guid)
+				break;
+			slot = (slot + 1) & (size - 1);
+		}
+		if(SSA_PR_NO_INDEX == p_index->guid_hash[slot])
+			p_index->guid_hash[slot] = i;
+
+		for(lid = base_lid; lid < base_lid + (1U << p_guid_to_lid_tbl[i].lmc) &&
+				lid < p_index->lid_lookup_count; ++lid)
+			p_index->guid_to_lid_lookup[lid] = i;
+	}
+
+	return 0;
+}
 
 static int build_lft_top_lookup(struct ssa_pr_smdb_index *p_index,
 		const struct ssa_db *p_smdb)
@@ -98,162 +229,437 @@ static int build_lft_top_lookup(struct ssa_pr_smdb_index *p_index,
 		(struct ep_lft_top_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_LFT_TOP];
 	SSA_ASSERT(p_lft_top_tbl );
 
-	memset(p_index->lft_top_lookup,'\0',(MAX_LOOKUP_LID + 1) * sizeof(p_index->lft_top_lookup[0]));
+	memset(p_index->lft_top_lookup,'\0',p_index->lid_lookup_count * sizeof(p_index->lft_top_lookup[0]));
 
 	count = get_dataset_count(p_smdb,SSA_TABLE_ID_LFT_TOP);
 
+	/*
+	 * Only switches of GUID_TO_LID have forwarding tables
+	 */
 	for (i = 0; i < count; i++)
-		p_index->lft_top_lookup[ntohs(p_lft_top_tbl[i].lid)] = ntohs(p_lft_top_tbl[i].lft_top);
+		if(ntohs(p_lft_top_tbl[i].lid) < p_index->lid_lookup_count)
+			p_index->lft_top_lookup[ntohs(p_lft_top_tbl[i].lid)] = ntohs(p_lft_top_tbl[i].lft_top);
+
+	return 0;
+}
+
+/*
+ * build_port_layout - sizes and allocates per switch port and link lookups
+ * A switch gets (highest port number + 1) slots. All slots are "not found".
+ */
+static int build_port_layout(struct ssa_pr_smdb_index *p_index,
+		const struct ssa_db *p_smdb)
+{
+	size_t i = 0, count = 0;
+	size_t port_slots = 0;
+	uint32_t *p_port_counts = NULL;
+	const struct ep_port_tbl_rec *p_port_tbl = NULL;
+	const struct ep_link_tbl_rec *p_link_tbl = NULL;
+	uint32_t *p_csr = NULL;
+	int res = 0;
+
+	SSA_ASSERT(p_smdb);
+	SSA_ASSERT(p_index);
+	SSA_ASSERT(!p_index->p_port_csr);
+
+	p_port_tbl = (const struct ep_port_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_PORT];
+	p_link_tbl = (const struct ep_link_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_LINK];
+	SSA_ASSERT(p_port_tbl);
+	SSA_ASSERT(p_link_tbl);
+
+	p_port_counts = (uint32_t *)calloc(p_index->switch_count + 1,sizeof(uint32_t));
+	if(!p_port_counts) {
+		SSA_PR_LOG_ERROR("Cannot allocate CSR layout. Switches: %zu",p_index->switch_count);
+		return -1;
+	}
+
+	count = get_dataset_count(p_smdb,SSA_TABLE_ID_PORT);
+	for (i = 0; i < count; i++) {
+		uint16_t lid = ntohs(p_port_tbl[i].port_lid);
+		uint8_t port_num = p_port_tbl[i].port_num;
+
+		if(!(p_port_tbl[i].rate & SSA_DB_PORT_IS_SWITCH_MASK) ||
+				!ssa_pr_is_switch_lid(p_index,lid))
+			continue;
+		if(port_num > MAX_LOOKUP_PORT) {
+			SSA_PR_LOG_ERROR("Invalid port number. LID: 0x%"SCNx16" Port num: %u",
+					lid,port_num);
+			res = -1;
+			goto Exit;
+		}
+		if(p_port_counts[p_index->switch_id_lookup[lid]] < port_num + 1U)
+			p_port_counts[p_index->switch_id_lookup[lid]] = port_num + 1U;
+	}
+
+	count = get_dataset_count(p_smdb,SSA_TABLE_ID_LINK);
+	for (i = 0; i < count; i++) {
+		uint16_t lid = ntohs(p_link_tbl[i].from_lid);
+		uint8_t port_num = p_link_tbl[i].from_port_num;
+
+		if(!ssa_pr_is_switch_lid(p_index,lid))
+			continue;
+		if(port_num > MAX_LOOKUP_PORT) {
+			SSA_PR_LOG_ERROR("Invalid port number. LID: 0x%"SCNx16" Port num: %u",
+					lid,port_num);
+			res = -1;
+			goto Exit;
+		}
+		if(p_port_counts[p_index->switch_id_lookup[lid]] < port_num + 1U)
+			p_port_counts[p_index->switch_id_lookup[lid]] = port_num + 1U;
+	}
+
+	for (i = 0; i < p_index->switch_count; i++)
+		port_slots += p_port_counts[i];
+
+	p_index->port_csr_size = (p_index->switch_count + 1 + 2 * port_slots) * sizeof(uint32_t);
+	p_csr = (uint32_t *)malloc(p_index->port_csr_size);
+	if(!p_csr) {
+		SSA_PR_LOG_ERROR("Cannot allocate SMDB index. Size: %zu bytes",p_index->port_csr_size);
+		p_index->port_csr_size = 0;
+		res = -1;
+		goto Exit;
+	}
+
+	p_index->p_port_csr = p_csr;
+	p_index->switch_port_offset = p_csr;
+	p_index->switch_port_lookup = p_index->switch_port_offset + p_index->switch_count + 1;
+	p_index->switch_link_lookup = p_index->switch_port_lookup + port_slots;
+
+	p_index->switch_port_offset[0] = 0;
+	for (i = 0; i < p_index->switch_count; i++)
+		p_index->switch_port_offset[i + 1] = p_index->switch_port_offset[i] + p_port_counts[i];
+
+	memset(p_index->switch_port_lookup,0xFF,2 * port_slots * sizeof(uint32_t));
+
+	SSA_PR_LOG_INFO("Switch port lookup tables size: %zu bytes. Port slots: %zu",
+			p_index->port_csr_size,port_slots);
+Exit:
+	free(p_port_counts);
+	return res;
+}
+
+/*
+ * build_lft_layout - sizes and allocates per switch forwarding tables
+ * A switch gets (LFT top + 1) entries. All entries are LFT_NO_PATH.
+ */
+static int build_lft_layout(struct ssa_pr_smdb_index *p_index)
+{
+	size_t i = 0, lft_slots = 0;
+	uint32_t *p_csr = NULL;
+
+	SSA_ASSERT(p_index);
+	SSA_ASSERT(!p_index->p_lft_csr);
+
+	/*
+	 * Forwarding table of a switch covers LIDs [0, LFT top] and is
+	 * followed by the sentinel entry. One more sentinel entry is
+	 * read by lookups of non switch LIDs if there are no switches.
+	 */
+	for (i = 0; i < p_index->lid_lookup_count; i++)
+		if(p_index->is_switch_lookup[i])
+			lft_slots += p_index->lft_top_lookup[i] + 2U;
+	lft_slots++;
+
+	p_index->lft_csr_size = (p_index->switch_count + 2) * sizeof(uint32_t) +
+		lft_slots * sizeof(uint8_t);
+	p_csr = (uint32_t *)malloc(p_index->lft_csr_size);
+	if(!p_csr) {
+		SSA_PR_LOG_ERROR("Cannot allocate SMDB index. Size: %zu bytes",p_index->lft_csr_size);
+		p_index->lft_csr_size = 0;
+		return -1;
+	}
+
+	p_index->p_lft_csr = p_csr;
+	p_index->lft_offset = p_csr;
+	p_index->lft_ports = (uint8_t *)(p_index->lft_offset + p_index->switch_count + 2);
 
+	/*
+	 * Offsets are ordered by dense switch number
+	 */
+	for (i = 0; i < p_index->lid_lookup_count; i++)
+		if(p_index->is_switch_lookup[i])
+			p_index->lft_offset[p_index->switch_id_lookup[i] + 1] =
+				p_index->lft_top_lookup[i] + 2U;
+	p_index->lft_offset[0] = 0;
+	for (i = 0; i < p_index->switch_count; i++)
+		p_index->lft_offset[i + 1] += p_index->lft_offset[i];
+	p_index->lft_offset[p_index->switch_count + 1] = p_index->lft_offset[p_index->switch_count];
+
+	memset(p_index->lft_ports,LFT_NO_PATH,lft_slots * sizeof(uint8_t));
+
+	SSA_PR_LOG_INFO("Forwarding tables size: %zu bytes. LFT entries: %zu",
+			p_index->lft_csr_size,lft_slots);
 	return 0;
 }
 
 static int build_port_index(struct ssa_pr_smdb_index *p_index,
 		const struct ssa_db *p_smdb)
 {
-	size_t i = 0, count = 0, switch_count = 0;
+	size_t i = 0, count = 0;
 	const struct ep_port_tbl_rec  *p_port_tbl = NULL;
-	uint64_t default_val = 0; 
 
 	SSA_ASSERT(p_smdb);
 	SSA_ASSERT(p_index);
+	SSA_ASSERT(p_index->switch_port_lookup);
 
 	p_port_tbl = 
 		(struct ep_port_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_PORT];
 	SSA_ASSERT(p_port_tbl);
 
-	memset(p_index->ca_port_lookup,'\0',(MAX_LOOKUP_LID + 1) * sizeof(p_index->ca_port_lookup[0]));
-	memset(p_index->switch_port_lookup,'\0',(MAX_LOOKUP_LID + 1) * sizeof(p_index->switch_port_lookup[0]));
+	memset(p_index->ca_port_lookup,0xFF,p_index->lid_lookup_count * sizeof(p_index->ca_port_lookup[0]));
 
 	count = get_dataset_count(p_smdb,SSA_TABLE_ID_PORT);
-	default_val = count + 1; 
 
 	for (i = 0; i < count; i++) {
+		uint16_t lid = ntohs(p_port_tbl[i].port_lid);
+
 		if(p_port_tbl[i].rate & SSA_DB_PORT_IS_SWITCH_MASK) {
-			uint64_t *port_lookup = p_index->switch_port_lookup[ntohs(p_port_tbl[i].port_lid)];
-			if(!port_lookup) {
-				size_t j = 0;
-
-				port_lookup = (uint64_t*)malloc((MAX_LOOKUP_PORT + 1) * sizeof(uint64_t));
-				for(j = 0;j <= MAX_LOOKUP_PORT;++j)
-					port_lookup[j] = default_val;
-
-				p_index->switch_port_lookup[ntohs(p_port_tbl[i].port_lid)] = port_lookup;
-				switch_count++;
-			}
-			port_lookup[p_port_tbl[i].port_num] = i;
-		} else {
-			p_index->ca_port_lookup[ntohs(p_port_tbl[i].port_lid)] = i;
+			/*
+			 * Only ports of known switches are reachable by lookups
+			 */
+			if(ssa_pr_is_switch_lid(p_index,lid))
+				p_index->switch_port_lookup[p_index->switch_port_offset[p_index->switch_id_lookup[lid]] +
+					p_port_tbl[i].port_num] = i;
+		} else if(lid < p_index->lid_lookup_count) {
+			p_index->ca_port_lookup[lid] = i;
 		}
 	}
 
-	SSA_PR_LOG_INFO("Switch ports lookup table size: %u bytes",switch_count * 
-			sizeof(uint64_t) * MAX_LOOKUP_PORT);
-
 	return 0;
 }
 
-static int build_lft_block_lookup(struct ssa_pr_smdb_index *p_index,
+/*
+ * copy_lft_block - copies an LFT block to the switch's forwarding table.
+ * The part of the block above LFT top is ignored.
+ */
+static void copy_lft_block(struct ssa_pr_smdb_index *p_index,
+		const struct ep_lft_block_tbl_rec *p_block)
+{
+	uint16_t lid = ntohs(p_block->lid);
+	size_t first_lid = ntohs(p_block->block_num) * IB_SMP_DATA_SIZE;
+	size_t lft_size = 0;
+
+	if(!ssa_pr_is_switch_lid(p_index,lid))
+		return;
+
+	lft_size = p_index->lft_offset[p_index->switch_id_lookup[lid] + 1] -
+		p_index->lft_offset[p_index->switch_id_lookup[lid]] - 1;
+	if(first_lid >= lft_size)
+		return;
+
+	memcpy(p_index->lft_ports + p_index->lft_offset[p_index->switch_id_lookup[lid]] + first_lid,
+			p_block->block,
+			lft_size - first_lid < IB_SMP_DATA_SIZE ? lft_size - first_lid : IB_SMP_DATA_SIZE);
+}
+
+/*
+ * build_lft - copies LFT blocks to per switch forwarding tables.
+ * LIDs that are not covered by any block stay LFT_NO_PATH.
+ */
+static int build_lft(struct ssa_pr_smdb_index *p_index,
 		const struct ssa_db *p_smdb)
 {
 	size_t i = 0, count = 0;
 	const struct ep_lft_block_tbl_rec *p_lft_block_tbl = NULL;
-	size_t lookup_size = 0;
-	uint64_t default_val = 0;
 
 	SSA_ASSERT(p_smdb);
 	SSA_ASSERT(p_index);
+	SSA_ASSERT(p_index->lft_ports);
 
 	p_lft_block_tbl =(struct ep_lft_block_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_LFT_BLOCK];
 	SSA_ASSERT(p_lft_block_tbl);
 
-	memset(p_index->lft_block_lookup,'\0',(MAX_LOOKUP_LID + 1) * sizeof(p_index->lft_block_lookup[0]));
-
 	count = get_dataset_count(p_smdb,SSA_TABLE_ID_LFT_BLOCK);
-	default_val = count + 1;
-
-	for (i = 0; i < count; i++) {
-		size_t j = 0;
-		uint64_t *block_lookup = 
-			p_index->lft_block_lookup[ntohs(p_lft_block_tbl[i].lid)];
-
-		if(!block_lookup) {
-			block_lookup = (uint64_t*)malloc(MAX_LFT_BLOCK_MUM * sizeof(uint64_t));
-			lookup_size += MAX_LFT_BLOCK_MUM * sizeof(uint64_t);
 
-			p_index->lft_block_lookup[ntohs(p_lft_block_tbl[i].lid)] =
-				block_lookup;
-
-			for(j = 0; j < MAX_LFT_BLOCK_MUM; ++j)
-				block_lookup[j] = default_val;
-		}
-		block_lookup[ntohs(p_lft_block_tbl[i].block_num)] = i;
-	}
+	for (i = 0; i < count; i++)
+		copy_lft_block(p_index,p_lft_block_tbl + i);
 
-	SSA_PR_LOG_INFO("LFT lookup size: %u bytes",lookup_size);
 	return 0;
 }
+
 static int build_link_index(struct ssa_pr_smdb_index *p_index,
 		const struct ssa_db *p_smdb)
 {
 	size_t i = 0, link_count = 0, port_count = 0;
 	const struct ep_link_tbl_rec  *p_link_tbl =  NULL;
-	uint64_t default_val = 0;
 
 	SSA_ASSERT(p_smdb);
 	SSA_ASSERT(p_index);
-	SSA_ASSERT(p_index->is_switch_lookup);
+	SSA_ASSERT(p_index->switch_link_lookup);
 
-	memset(p_index->ca_link_lookup,'\0',(MAX_LOOKUP_LID + 1) * sizeof(p_index->ca_link_lookup[0]));
-	memset(p_index->switch_link_lookup,'\0',(MAX_LOOKUP_PORT + 1) * sizeof(p_index->switch_link_lookup[0]));
+	memset(p_index->ca_link_lookup,0xFF,p_index->lid_lookup_count * sizeof(p_index->ca_link_lookup[0]));
 
 	p_link_tbl = (const struct ep_link_tbl_rec*)p_smdb->pp_tables[SSA_TABLE_ID_LINK];
 	SSA_ASSERT(p_link_tbl);
 
 	link_count = get_dataset_count(p_smdb,SSA_TABLE_ID_LINK);
 	port_count = get_dataset_count(p_smdb,SSA_TABLE_ID_PORT);
-	default_val = port_count  + 1;
 
 	for (i = 0; i < link_count; i++) {
+		uint16_t from_lid = ntohs(p_link_tbl[i].from_lid);
 		size_t to_port_index = find_port_index(p_smdb,p_index,
 				p_link_tbl[i].to_lid,p_link_tbl[i].to_port_num);
 
 		if(to_port_index >= port_count) {
-			SSA_PR_LOG_ERROR("Can't find port for LID: 0x"SCNx16 ". Link index build is failed",
+			SSA_PR_LOG_ERROR("Can't find port for LID: 0x%"SCNx16 ". Link index build is failed",
 				ntohs(p_link_tbl[i].to_lid));
 			return -1;
 		}
 
-		if(p_index->is_switch_lookup[ntohs(p_link_tbl[i].from_lid)]) {
-			uint64_t *port_lookup = p_index->switch_link_lookup[ntohs(p_link_tbl[i].from_lid)];
-			if(!port_lookup) {
-				size_t j = 0;
-				port_lookup = (uint64_t*)malloc((MAX_LOOKUP_PORT + 1) * sizeof(uint64_t));
-				p_index->switch_link_lookup[ntohs(p_link_tbl[i].from_lid)] = port_lookup;
-				for(j = 0;j <= MAX_LOOKUP_PORT;++j)
-					port_lookup[j] = default_val;
-			}
-			port_lookup[p_link_tbl[i].from_port_num] = to_port_index ;
-		}
-		else {
-			p_index->ca_link_lookup[ntohs(p_link_tbl[i].from_lid)] = to_port_index;
-		}
+		if(ssa_pr_is_switch_lid(p_index,from_lid))
+			p_index->switch_link_lookup[p_index->switch_port_offset[p_index->switch_id_lookup[from_lid]] +
+				p_link_tbl[i].from_port_num] = to_port_index;
+		else if(from_lid < p_index->lid_lookup_count)
+			p_index->ca_link_lookup[from_lid] = to_port_index;
 	}
 
 	return 0;
 }
 
-int ssa_pr_build_indexes(struct ssa_pr_smdb_index *p_index,
+/*
+ * build_routing_graph - host order copy of port records and links
+ * that is used by the route walk. Must be called after the link index.
+ */
+static int build_routing_graph(struct ssa_pr_smdb_index *p_index,
 		const struct ssa_db *p_smdb)
 {
-	int res = 0;
+	const size_t rate_num = sizeof(rates_cmp_table) / sizeof(rates_cmp_table[0]);
+	uint8_t rate_ranks[sizeof(rates_cmp_table) / sizeof(rates_cmp_table[0])];
+	const struct ep_port_tbl_rec *p_port_tbl = NULL;
+	size_t i = 0, j = 0, count = 0;
+	uint8_t *p_graph = NULL;
 
 	SSA_ASSERT(p_smdb);
 	SSA_ASSERT(p_index);
+	SSA_ASSERT(!p_index->p_graph);
+	SSA_ASSERT(p_index->switch_link_lookup);
 
-	res = build_is_switch_lookup(p_index,p_smdb);
+	p_port_tbl = (const struct ep_port_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_PORT];
+	SSA_ASSERT(p_port_tbl);
+
+	/*
+	 * Rank of a rate is the number of slower rates
+	 */
+	for (i = 0; i < rate_num; i++) {
+		rate_ranks[i] = 0;
+		for (j = 0; j < rate_num; j++)
+			if(ib_path_compare_rates_fast(i,j) > 0)
+				rate_ranks[i]++;
+	}
+
+	count = get_dataset_count(p_smdb,SSA_TABLE_ID_PORT);
+
+	p_index->graph_size = count * (sizeof(uint32_t) + sizeof(uint16_t) + 4 * sizeof(uint8_t));
+	p_graph = (uint8_t *)malloc(p_index->graph_size ? p_index->graph_size : 1);
+	if(!p_graph) {
+		SSA_PR_LOG_ERROR("Cannot allocate routing graph. Size: %zu bytes",p_index->graph_size);
+		p_index->graph_size = 0;
+		return -1;
+	}
+
+	p_index->p_graph = p_graph;
+	p_index->port_link = (uint32_t *)p_graph;
+	p_index->port_node = (uint16_t *)(p_index->port_link + count);
+	p_index->port_mtu = (uint8_t *)(p_index->port_node + count);
+	p_index->port_rate = p_index->port_mtu + count;
+	p_index->port_rate_rank = p_index->port_rate + count;
+	p_index->port_is_switch = p_index->port_rate_rank + count;
+
+	for (i = 0; i < count; i++) {
+		uint16_t lid = ntohs(p_port_tbl[i].port_lid);
+		uint8_t rate = p_port_tbl[i].rate & SSA_DB_PORT_RATE_MASK;
+		uint32_t link = SSA_PR_NO_INDEX;
+
+		if(lid >= p_index->lid_lookup_count) {
+			p_index->port_node[i] = SSA_PR_NO_NODE;
+		} else if(p_index->is_switch_lookup[lid]) {
+			uint16_t switch_id = p_index->switch_id_lookup[lid];
+			uint32_t slot = p_index->switch_port_offset[switch_id] + p_port_tbl[i].port_num;
+
+			p_index->port_node[i] = switch_id;
+			if(slot < p_index->switch_port_offset[switch_id + 1])
+				link = p_index->switch_link_lookup[slot];
+		} else {
+			p_index->port_node[i] = SSA_PR_NO_NODE;
+			link = p_index->ca_link_lookup[lid];
+		}
+
+		p_index->port_link[i] = link < count ? link : SSA_PR_NO_INDEX;
+		p_index->port_mtu[i] = p_port_tbl[i].neighbor_mtu;
+		p_index->port_rate[i] = rate;
+		p_index->port_rate_rank[i] = rate < rate_num ? rate_ranks[rate] : 0xFF;
+		p_index->port_is_switch[i] = !!(p_port_tbl[i].rate & SSA_DB_PORT_IS_SWITCH_MASK);
+	}
+
+	SSA_PR_LOG_INFO("Routing graph size: %zu bytes. Ports: %zu",
+			p_index->graph_size,count);
+	return 0;
+}
+
+/*
+ * Sub-indices and their source tables.
+ * GUID_TO_LID defines switches and dense switch numbers, so its change
+ * invalidates all sub-indices.
+ */
+static const int epoch_table_ids[SSA_PR_INDEX_TABLE_NUM] = {
+	[SSA_PR_INDEX_GUID_TO_LID] = SSA_TABLE_ID_GUID_TO_LID,
+	[SSA_PR_INDEX_LINK] = SSA_TABLE_ID_LINK,
+	[SSA_PR_INDEX_PORT] = SSA_TABLE_ID_PORT,
+	[SSA_PR_INDEX_LFT_TOP] = SSA_TABLE_ID_LFT_TOP,
+	[SSA_PR_INDEX_LFT_BLOCK] = SSA_TABLE_ID_LFT_BLOCK
+};
+
+#define INDEX_CHANGED(mask,table) ((mask) & (1 << (table)))
+
+static void destroy_port_index(struct ssa_pr_smdb_index *p_index)
+{
+	if(p_index->p_lid_lookup) {
+		memset(p_index->ca_port_lookup,0xFF,p_index->lid_lookup_count * sizeof(p_index->ca_port_lookup[0]));
+		memset(p_index->ca_link_lookup,0xFF,p_index->lid_lookup_count * sizeof(p_index->ca_link_lookup[0]));
+	}
+
+	free(p_index->p_port_csr);
+	p_index->p_port_csr = NULL;
+	p_index->port_csr_size = 0;
+	p_index->switch_port_offset = NULL;
+	p_index->switch_port_lookup = NULL;
+	p_index->switch_link_lookup = NULL;
+
+	free(p_index->p_graph);
+	p_index->p_graph = NULL;
+	p_index->graph_size = 0;
+	p_index->port_link = NULL;
+	p_index->port_node = NULL;
+	p_index->port_mtu = NULL;
+	p_index->port_rate = NULL;
+	p_index->port_rate_rank = NULL;
+	p_index->port_is_switch = NULL;
+}
+
+static void destroy_lft_index(struct ssa_pr_smdb_index *p_index)
+{
+	free(p_index->p_lft_csr);
+	p_index->p_lft_csr = NULL;
+	p_index->lft_csr_size = 0;
+	p_index->lft_offset = NULL;
+	p_index->lft_ports = NULL;
+}
+
+/*
+ * rebuild_port_index - port and link lookups and the routing graph.
+ * Links refer to port positions, so all are rebuilt if PORT or LINK
+ * table is changed.
+ */
+static int rebuild_port_index(struct ssa_pr_smdb_index *p_index,
+		const struct ssa_db *p_smdb)
+{
+	int res = 0;
+
+	destroy_port_index(p_index);
+
+	res = build_port_layout(p_index,p_smdb);
 	if(res) {
-		SSA_PR_LOG_ERROR("Build for is_switch_lookup is failed");
+		SSA_PR_LOG_ERROR("Build for switch port lookup tables layout is failed");
 		return res;
 	}
 	res = build_port_index(p_index,p_smdb);
@@ -261,25 +667,79 @@ int ssa_pr_build_indexes(struct ssa_pr_smdb_index *p_index,
 		SSA_PR_LOG_ERROR("Build for port index is failed");
 		return res;
 	}
+	res = build_link_index(p_index,p_smdb);
+	if(res) {
+		SSA_PR_LOG_ERROR("Build for link index is failed");
+		return res;
+	}
+	res = build_routing_graph(p_index,p_smdb);
+	if(res) {
+		SSA_PR_LOG_ERROR("Build for routing graph is failed");
+		return res;
+	}
+
+	return 0;
+}
+
+static int rebuild_lft_index(struct ssa_pr_smdb_index *p_index,
+		const struct ssa_db *p_smdb)
+{
+	int res = 0;
+
+	destroy_lft_index(p_index);
+
 	res = build_lft_top_lookup(p_index,p_smdb);
 	if(res) {
 		SSA_PR_LOG_ERROR("Build for lft_top is failed");
 		return res;
 	}
-	res = build_lft_block_lookup(p_index,p_smdb);
+	res = build_lft_layout(p_index);
 	if(res) {
-		SSA_PR_LOG_ERROR("Build for lft block lookup is failed");
+		SSA_PR_LOG_ERROR("Build for forwarding tables layout is failed");
 		return res;
 	}
-	res = build_link_index(p_index,p_smdb);
+	res = build_lft(p_index,p_smdb);
 	if(res) {
-		SSA_PR_LOG_ERROR("Build for link index is failed");
+		SSA_PR_LOG_ERROR("Build for forwarding tables is failed");
 		return res;
 	}
 
 	return 0;
 }
 
+int ssa_pr_build_indexes(struct ssa_pr_smdb_index *p_index,
+		const struct ssa_db *p_smdb)
+{
+	int res = 0;
+
+	SSA_ASSERT(p_smdb);
+	SSA_ASSERT(p_index);
+
+	res = build_lid_lookups(p_index,p_smdb);
+	if(res) {
+		SSA_PR_LOG_ERROR("Build for LID lookup tables is failed");
+		return res;
+	}
+	res = build_is_switch_lookup(p_index,p_smdb);
+	if(res) {
+		SSA_PR_LOG_ERROR("Build for is_switch_lookup is failed");
+		return res;
+	}
+	res = build_guid_to_lid_index(p_index,p_smdb);
+	if(res) {
+		SSA_PR_LOG_ERROR("Build for GUID to LID index is failed");
+		return res;
+	}
+	res = rebuild_port_index(p_index,p_smdb);
+	if(res)
+		return res;
+	res = rebuild_lft_index(p_index,p_smdb);
+	if(res)
+		return res;
+
+	return 0;
+}
+
 
 void ssa_pr_destroy_indexes(struct ssa_pr_smdb_index *p_index)
 {
@@ -287,86 +747,187 @@ void ssa_pr_destroy_indexes(struct ssa_pr_smdb_index *p_index)
 
 	SSA_ASSERT(p_index);
 
-	memset(p_index->is_switch_lookup,'\0',(MAX_LOOKUP_LID + 1) * sizeof(p_index->is_switch_lookup[0]));
-	memset(p_index->lft_top_lookup ,'\0',(MAX_LOOKUP_LID + 1) * sizeof(p_index->lft_top_lookup[0]));
-	memset(p_index->ca_port_lookup,'\0',(MAX_LOOKUP_LID +1) * sizeof(p_index->ca_port_lookup[0]));
+	p_index->switch_count = 0;
 
-	for(i = 0; i <= MAX_LOOKUP_LID; ++i) {
-		free(p_index->switch_port_lookup[i]);
-		p_index->switch_port_lookup[i] = NULL;
-	}
+	free(p_index->guid_hash);
+	p_index->guid_hash = NULL;
+	p_index->guid_hash_bits = 0;
 
-	memset(p_index->ca_link_lookup,'\0',(MAX_LOOKUP_LID +1) * sizeof(p_index->ca_link_lookup[0]));
+	destroy_port_index(p_index);
+	destroy_lft_index(p_index);
 
-	for(i = 0; i <= MAX_LOOKUP_LID; ++i) {
-		free(p_index->switch_link_lookup[i]);
-		p_index->switch_link_lookup[i] = NULL;
-	}
-
-	for(i = 0; i <= MAX_LOOKUP_LID; ++i) {
-		if(p_index->lft_block_lookup[i]) {
-			free(p_index->lft_block_lookup[i]);
-			p_index->lft_block_lookup[i] = NULL;
-		}
-	}
+	free(p_index->p_lid_lookup);
+	p_index->p_lid_lookup = NULL;
+	p_index->lid_lookup_size = 0;
+	p_index->lid_lookup_count = 0;
+	p_index->is_switch_lookup = NULL;
+	p_index->switch_id_lookup = NULL;
+	p_index->guid_to_lid_lookup = NULL;
+	p_index->lft_top_lookup = NULL;
+	p_index->ca_port_lookup = NULL;
+	p_index->ca_link_lookup = NULL;
 
+	for(i = 0; i < SSA_PR_INDEX_TABLE_NUM; ++i)
+		p_index->table_epochs[i] = -1;
 	p_index->epoch = -1;
 }
 
-static int epoch_table_ids[] = {
-	SSA_TABLE_ID_GUID_TO_LID,
-	SSA_TABLE_ID_LINK,
-	SSA_TABLE_ID_PORT,
-	SSA_TABLE_ID_LFT_TOP,
-	SSA_TABLE_ID_LFT_BLOCK
-};
-
 int ssa_pr_rebuild_indexes(struct ssa_pr_smdb_index *p_index,
 		const struct ssa_db *p_smdb)
 {
 	int i = 0;
 	uint64_t smdb_epoch = 0;
+	uint64_t table_epochs[SSA_PR_INDEX_TABLE_NUM];
+	unsigned int changed = 0;
 	int res = 0;
 
 	SSA_ASSERT(p_smdb);
 	SSA_ASSERT(p_index);
 
-	for(i = 0; i < sizeof(epoch_table_ids) / sizeof(epoch_table_ids[0]); ++i) {
+	for(i = 0; i < SSA_PR_INDEX_TABLE_NUM; ++i) {
 		const struct db_dataset *p_dataset = &p_smdb->p_db_tables[epoch_table_ids[i]];
-		smdb_epoch = smdb_epoch > ntohll(p_dataset->epoch) ? smdb_epoch : ntohll(p_dataset->epoch);
+
+		table_epochs[i] = ntohll(p_dataset->epoch);
+		smdb_epoch = smdb_epoch > table_epochs[i] ? smdb_epoch : table_epochs[i];
+		if(p_index->table_epochs[i] != table_epochs[i])
+			changed |= 1 << i;
 	}
 
-	if(p_index->epoch != smdb_epoch) {
+	/*
+	 * A new index or a change of GUID_TO_LID: full rebuild
+	 */
+	if((uint64_t)-1 == p_index->epoch || INDEX_CHANGED(changed,SSA_PR_INDEX_GUID_TO_LID)) {
 		ssa_pr_destroy_indexes(p_index);
 		res = ssa_pr_build_indexes(p_index,p_smdb);
 		if(res) {
 			SSA_PR_LOG_ERROR("SMDB index creation is failed. epoch : %"PRIu64,smdb_epoch);
-			return res;
+			goto Error;
+		}
+		SSA_PR_LOG_INFO("SMDB index was created. epoch : %"PRIu64,smdb_epoch);
+	} else if(changed) {
+		if(INDEX_CHANGED(changed,SSA_PR_INDEX_PORT) ||
+				INDEX_CHANGED(changed,SSA_PR_INDEX_LINK)) {
+			res = rebuild_port_index(p_index,p_smdb);
+			if(res)
+				goto Update_error;
+		}
+
+		if(INDEX_CHANGED(changed,SSA_PR_INDEX_LFT_TOP)) {
+			res = rebuild_lft_index(p_index,p_smdb);
+			if(res)
+				goto Update_error;
+		} else if(INDEX_CHANGED(changed,SSA_PR_INDEX_LFT_BLOCK)) {
+			/*
+			 * Layout depends on LFT top only. Forwarding tables
+			 * are refilled in place.
+			 */
+			memset(p_index->lft_ports,LFT_NO_PATH,
+					(p_index->lft_offset[p_index->switch_count] + 1) * sizeof(uint8_t));
+			res = build_lft(p_index,p_smdb);
+			if(res)
+				goto Update_error;
+		}
+		SSA_PR_LOG_INFO("SMDB index was updated. epoch : %"PRIu64" changed tables mask: 0x%x",
+				smdb_epoch,changed);
+	}
+
+	for(i = 0; i < SSA_PR_INDEX_TABLE_NUM; ++i)
+		p_index->table_epochs[i] = table_epochs[i];
+	p_index->epoch = smdb_epoch;
+	return 0;
+
+Update_error:
+	SSA_PR_LOG_ERROR("SMDB index update is failed. epoch : %"PRIu64,smdb_epoch);
+Error:
+	ssa_pr_destroy_indexes(p_index);
+	return res;
+}
+
+int ssa_pr_update_lft_blocks(struct ssa_pr_smdb_index *p_index,
+		const struct ssa_db *p_smdb,
+		const uint64_t *p_block_ids,
+		size_t count)
+{
+	const struct ep_lft_block_tbl_rec *p_lft_block_tbl = NULL;
+	size_t i = 0, block_count = 0;
+
+	SSA_ASSERT(p_smdb);
+	SSA_ASSERT(p_index);
+	SSA_ASSERT(p_block_ids || !count);
+
+	/*
+	 * Patching is possible only if forwarding tables are up to date
+	 * with all tables except LFT_BLOCK
+	 */
+	for(i = 0; i < SSA_PR_INDEX_TABLE_NUM; ++i) {
+		if(SSA_PR_INDEX_LFT_BLOCK != i && p_index->table_epochs[i] !=
+				ntohll(p_smdb->p_db_tables[epoch_table_ids[i]].epoch))
+			return -1;
+	}
+	if(!p_index->lft_ports)
+		return -1;
+
+	p_lft_block_tbl =(struct ep_lft_block_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_LFT_BLOCK];
+	SSA_ASSERT(p_lft_block_tbl);
+
+	block_count = get_dataset_count(p_smdb,SSA_TABLE_ID_LFT_BLOCK);
+
+	for(i = 0; i < count; ++i) {
+		if(p_block_ids[i] >= block_count) {
+			SSA_PR_LOG_ERROR("Invalid LFT block record index: %"PRIu64,p_block_ids[i]);
+			return -1;
 		}
-		p_index->epoch = smdb_epoch;
-		SSA_PR_LOG_INFO("SMDB index was created. epoch : %"PRIu64,p_index->epoch);
+		copy_lft_block(p_index,p_lft_block_tbl + p_block_ids[i]);
 	}
+
+	p_index->table_epochs[SSA_PR_INDEX_LFT_BLOCK] =
+		ntohll(p_smdb->p_db_tables[SSA_TABLE_ID_LFT_BLOCK].epoch);
+	if(p_index->epoch < p_index->table_epochs[SSA_PR_INDEX_LFT_BLOCK])
+		p_index->epoch = p_index->table_epochs[SSA_PR_INDEX_LFT_BLOCK];
 	return 0;
 }
 
+size_t ssa_pr_index_memory(const struct ssa_pr_smdb_index *p_index)
+{
+	size_t size = sizeof(*p_index);
+
+	SSA_ASSERT(p_index);
+
+	if(p_index->p_lid_lookup)
+		size += p_index->lid_lookup_size;
+	if(p_index->guid_hash)
+		size += ((size_t)1 << p_index->guid_hash_bits) * sizeof(p_index->guid_hash[0]);
+	if(p_index->p_port_csr)
+		size += p_index->port_csr_size;
+	if(p_index->p_lft_csr)
+		size += p_index->lft_csr_size;
+	if(p_index->p_graph)
+		size += p_index->graph_size;
+	return size;
+}
+
 const struct ep_guid_to_lid_tbl_rec *find_guid_to_lid_rec_by_guid(const struct ssa_db *p_smdb,
+		const struct ssa_pr_smdb_index *p_index,
 		const be64_t port_guid)
 {
-	size_t i = 0;
 	const struct ep_guid_to_lid_tbl_rec *p_guid_to_lid_tbl = NULL;
-	size_t count = 0;
+	size_t slot = 0, mask = 0;
 
 	SSA_ASSERT(p_smdb);
+	SSA_ASSERT(p_index);
 	SSA_ASSERT(port_guid);
 
 	p_guid_to_lid_tbl = (struct ep_guid_to_lid_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_GUID_TO_LID];
 	SSA_ASSERT(p_guid_to_lid_tbl);
 
-	count = get_dataset_count(p_smdb,SSA_TABLE_ID_GUID_TO_LID);
-
-	for (i = 0; i < count; i++) {
-		if (port_guid == p_guid_to_lid_tbl[i].guid) 
-			return p_guid_to_lid_tbl + i;
+	if(p_index->guid_hash) {
+		mask = ((size_t)1 << p_index->guid_hash_bits) - 1;
+		for(slot = guid_hash(port_guid,p_index->guid_hash_bits);
+				SSA_PR_NO_INDEX != p_index->guid_hash[slot];
+				slot = (slot + 1) & mask) {
+			if (port_guid == p_guid_to_lid_tbl[p_index->guid_hash[slot]].guid)
+				return p_guid_to_lid_tbl + p_index->guid_hash[slot];
+		}
 	}
 
 	SSA_PR_LOG_ERROR("GUID to LID record is not found. GUID: 0x%016"PRIx64,ntohll(port_guid));
@@ -374,58 +935,42 @@ const struct ep_guid_to_lid_tbl_rec *find_guid_to_lid_rec_by_guid(const struct s
 	return NULL;
 }
 
-int find_destination_port(const struct ssa_db *p_smdb,
+const struct ep_guid_to_lid_tbl_rec *find_guid_to_lid_rec_by_lid(const struct ssa_db *p_smdb,
 		const struct ssa_pr_smdb_index *p_index,
-		const be16_t source_lid,
-		const be16_t dest_lid)
+		const be16_t lid)
 {
-	size_t i = 0;
+	const struct ep_guid_to_lid_tbl_rec *p_guid_to_lid_tbl = NULL;
+
+	SSA_ASSERT(p_smdb);
+	SSA_ASSERT(p_index);
 
-	struct ep_lft_block_tbl_rec *p_lft_block_tbl = NULL;
-	size_t lft_block_count = 0;
+	p_guid_to_lid_tbl = (struct ep_guid_to_lid_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_GUID_TO_LID];
+	SSA_ASSERT(p_guid_to_lid_tbl);
 
-	size_t lft_block_num = 0;
-	size_t lft_port_shift = 0;
-	size_t lft_block_index = 0;
+	if(ntohs(lid) >= p_index->lid_lookup_count ||
+			SSA_PR_NO_INDEX == p_index->guid_to_lid_lookup[ntohs(lid)]) {
+		SSA_PR_LOG_ERROR("GUID to LID record is not found. LID: 0x%"SCNx16,ntohs(lid));
+		return NULL;
+	}
 
-	uint16_t lft_top = 0;
+	return p_guid_to_lid_tbl + p_index->guid_to_lid_lookup[ntohs(lid)];
+}
+
+int find_destination_port(const struct ssa_db *p_smdb,
+		const struct ssa_pr_smdb_index *p_index,
+		const be16_t source_lid,
+		const be16_t dest_lid)
+{
+	const uint16_t lid = ntohs(source_lid);
 
 	SSA_ASSERT(p_smdb);
 	SSA_ASSERT(p_index);
 	SSA_ASSERT(source_lid);
 	SSA_ASSERT(dest_lid);
 
-	p_lft_block_tbl =(struct ep_lft_block_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_LFT_BLOCK];
-	SSA_ASSERT(p_lft_block_tbl);
-
-	lft_block_count  = get_dataset_count(p_smdb,SSA_TABLE_ID_LFT_BLOCK);
-
-	/*
-	 * Optimisation. If IB_SMP_DATA_SIZE is power of 2 we can use shift istead of division
-	 *
-	 *  lft_block_num = floorl(ntohs(dest_lid) / IB_SMP_DATA_SIZE);
-	 */
-	lft_block_num = ntohs(dest_lid) >> 6;
-	lft_port_shift = ntohs(dest_lid) % IB_SMP_DATA_SIZE;
-	lft_top = p_index->lft_top_lookup[ntohs(source_lid)];
-
-	if(ntohs(dest_lid) > lft_top) {
-		SSA_PR_LOG_ERROR("LFT routing is failed. Destination LID exceeds LFT top . "
-				"Source LID (0x%"SCNx16") Destination LID: (0x%"SCNx16") LFT top: %u",
-			ntohs(source_lid),ntohs(dest_lid),lft_top);
-		return -1;
-	}
-
-	if (!p_index->lft_block_lookup[ntohs(source_lid)] || 
-			p_index->lft_block_lookup[ntohs(source_lid)][lft_block_num] > lft_block_count) {
-		SSA_PR_LOG_ERROR("LFT routing is failed. Destination LID exceeds LFT top . "
-				"Source LID (0x%"SCNx16") Destination LID: (0x%"SCNx16") LFT top: %u",
-			ntohs(source_lid),ntohs(dest_lid),lft_top);
-		return -1;
-	}
-
-	lft_block_index = p_index->lft_block_lookup[ntohs(source_lid)][lft_block_num];
-	return p_lft_block_tbl[lft_block_index].block[lft_port_shift];
+	if(!ssa_pr_is_switch_lid(p_index,lid))
+		return ssa_pr_lft_entry(p_index,0,0,ntohs(dest_lid));
+	return ssa_pr_lft_entry(p_index,p_index->switch_id_lookup[lid],1,ntohs(dest_lid));
 }
 
 static size_t find_port_index(const struct ssa_db *p_smdb,
@@ -433,7 +978,6 @@ static size_t find_port_index(const struct ssa_db *p_smdb,
 		const be16_t lid,
 		const int port_num)
 {
-	size_t i = 0;
 	size_t port_index = -1;
 
 	SSA_ASSERT(p_smdb);
@@ -441,20 +985,21 @@ static size_t find_port_index(const struct ssa_db *p_smdb,
 	SSA_ASSERT(p_index->is_switch_lookup);
 	SSA_ASSERT(lid);
 
-	if(p_index->is_switch_lookup[ntohs(lid)]) {
-		uint64_t *switch_port_lookup = p_index->switch_port_lookup[ntohs(lid)]; 
+	if(ssa_pr_is_switch_lid(p_index,ntohs(lid))) {
+		uint16_t switch_id = p_index->switch_id_lookup[ntohs(lid)];
+		uint32_t slot = p_index->switch_port_offset[switch_id];
 
-		if(!switch_port_lookup) {
+		if(port_num < 0 || slot + port_num >= p_index->switch_port_offset[switch_id + 1]) {
 			SSA_PR_LOG_ERROR("Port is not found. LID: 0x%"SCNx16" Port num: %d",
 					ntohs(lid),port_num);
 			return -1;
 		}
-		port_index = switch_port_lookup[port_num];
-	} else {
+		port_index = p_index->switch_port_lookup[slot + port_num];
+	} else if(ntohs(lid) < p_index->lid_lookup_count) {
 		port_index = p_index->ca_port_lookup[ntohs(lid)];
 	}
 
-	return port_index;
+	return SSA_PR_NO_INDEX == port_index ? (size_t)-1 : port_index;
 }
 
 const struct ep_port_tbl_rec *find_port(const struct ssa_db *p_smdb,
@@ -486,10 +1031,9 @@ const struct ep_port_tbl_rec *find_linked_port(const struct ssa_db *p_smdb,
 		const be16_t lid,
 		const int port_num)
 {
-	size_t i = 0;
 	const struct ep_port_tbl_rec *p_port_tbl = NULL;
 	size_t port_count = 0;
-	size_t record_index = 0;
+	size_t record_index = SSA_PR_NO_INDEX;
 
 	SSA_ASSERT(p_smdb);
 	SSA_ASSERT(p_index);
@@ -499,16 +1043,18 @@ const struct ep_port_tbl_rec *find_linked_port(const struct ssa_db *p_smdb,
 	p_port_tbl = (const struct ep_port_tbl_rec*)p_smdb->pp_tables[SSA_TABLE_ID_PORT];
 	SSA_ASSERT(p_port_tbl );
 
-	if(p_index->is_switch_lookup[ntohs(lid)]) {
-		uint64_t *port_lookup = p_index->switch_link_lookup[ntohs(lid)];
-		if(!port_lookup) {
-			SSA_PR_LOG_ERROR("Link is not found. LID: 0x%"SCNx16" Port num: %u",
+	if(ssa_pr_is_switch_lid(p_index,ntohs(lid))) {
+		uint16_t switch_id = p_index->switch_id_lookup[ntohs(lid)];
+		uint32_t slot = p_index->switch_port_offset[switch_id];
+
+		if(port_num < 0 || slot + port_num >= p_index->switch_port_offset[switch_id + 1]) {
+			SSA_PR_LOG_ERROR("Link is not found. LID: 0x%"SCNx16" Port num: %d",
 					ntohs(lid),port_num);
 			return NULL;
 		}
-		record_index = port_lookup[port_num];
+		record_index = p_index->switch_link_lookup[slot + port_num];
 	}
-	else {
+	else if(ntohs(lid) < p_index->lid_lookup_count) {
 		record_index = p_index->ca_link_lookup[ntohs(lid)];
 	}
 
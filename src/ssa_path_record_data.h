@@ -39,49 +39,141 @@
 #define MAX_LOOKUP_PORT 254
 #define MAX_LFT_BLOCK_MUM (MAX_LOOKUP_LID/64)
 #define NO_REAL_PORT_NUM -1
+#define MAX_HOPS 64
+
+/*
+ * "Not found" value of 32 bit lookup tables
+ */
+#define SSA_PR_NO_INDEX 0xFFFFFFFF
+
+/*
+ * "Not a known switch" value of port_node
+ */
+#define SSA_PR_NO_NODE 0xFFFF
+
+/*
+ * Source tables of SMDB index. Values are positions in table_epochs.
+ */
+enum {
+	SSA_PR_INDEX_GUID_TO_LID = 0,
+	SSA_PR_INDEX_LINK,
+	SSA_PR_INDEX_PORT,
+	SSA_PR_INDEX_LFT_TOP,
+	SSA_PR_INDEX_LFT_BLOCK,
+	SSA_PR_INDEX_TABLE_NUM
+};
 
 /*
  * SMDB index improves the speed of data retrieval operations on a smdb tables.
  * For this propose we use lookup tables that replaces runtime iteration by 
  * indexing operation.
  *
+ * Per switch lookup tables use CSR (compressed sparse row) layout: a switch
+ * owns a range of slots that is sized to its real number of ports or LFT
+ * entries. Port and link lookups share one allocation, forwarding tables
+ * use another one. Allocations follow sub-indices, so a sub-index of
+ * a changed table is rebuilt without copying the others. Per LID lookups
+ * share one more allocation that covers LIDs [0, lid_lookup_count), i.e.
+ * up to the highest LID of SSA_TABLE_ID_GUID_TO_LID, so it's sized when
+ * GUID_TO_LID is changed. Higher LIDs are unknown to all of them. Table
+ * positions are stored as 32 bit values.
+ *
  *@epoch  Corresponds to smdb epoch. If they will be different, the index will
  *        be rebuild automatically. 
+ *@table_epochs - epochs of source tables. Only sub-indices of changed
+ *                tables are rebuilt.
  *
  *@is_switch_lookups - lookup table. Index: LID , value: boolean flag is switch.
+ *@switch_id_lookup - lookup table. Index: switch LID, value: dense switch
+ *                    number in range [0, switch_count).
+ *@switch_count - number of switches in smdb.
+ *@guid_to_lid_lookup - lookup table. Index: LID, including all LIDs of
+ *                      port's LMC range. Value: index in
+ *                      SSA_TABLE_ID_GUID_TO_LID table.
+ *@guid_hash - open addressing hash table with linear probing.
+ *             Key: GUID, value: index in SSA_TABLE_ID_GUID_TO_LID table.
+ *@guid_hash_bits - size of guid_hash is 2^guid_hash_bits.
  *@lft_top_lookup - lookup table. Index: LID. Value: LFT top LID.
- *@lft_block_lookup - lookup table for LFT blocks. 
- *                    The table allow lookup by pair (LID,block num).
- *                    Index is a LID.
- *                    If a LID is CA, the corresponded value in lft_block_lookup  is NULL.
- *                    If not, the value is pointer to dinamycally allocated lookup 
- *                    table for switch's LFT blocks. The table's length is MAX_LFT_BLOCK_MUM .
  *@ca_port_lookup - lookup table for CA ports. 
  *                  Index: LID , value: index in SSA_TABLE_ID_PORT table.
- *@switch_port_lookup - lookup table for switch ports. The table allow lookup by pair (LID,port num).
- *						Index is a LID.
- *                      If a LID is CA, the corresponded value in switch_port_lookup is NULL.
- *                      If not, the value is pointer to dinamycally allocated lookup 
- *                      table for switch's ports. The table's length is MAX_LOOKUP_PORT.
- *                      
  *@ca_link_lookup - lookup table for links from CA. 
- *                  Index: LID , value: index in SSA_TABLE_ID_LINK table.
- *@switch_link_lookup - lookup table for links from switch ports. 
- *                      The table allow lookup by pair (LID,port num).
- *						Index is a LID.
- *                      If a LID is CA, the corresponded value in switch_link_lookup is NULL.
- *                      If not, the value is pointer to dinamycally allocated lookup 
- *                      table for switch's links. The table's length is MAX_LOOKUP_PORT.
+ *                  Index: LID , value: index of linked port in SSA_TABLE_ID_PORT table.
+ *@lid_lookup_count - number of entries of every per LID lookup table.
+ *                    0 - the tables are not allocated.
+ *@p_lid_lookup - the allocation that holds per LID lookup tables.
+ *@lid_lookup_size - size of the allocation in bytes.
+ *@switch_port_offset - CSR offsets of switch ports. Index: dense switch number.
+ *                      Ports of a switch occupy slots
+ *                      [switch_port_offset[id], switch_port_offset[id + 1]).
+ *                      Slot number is offset + port num.
+ *@switch_port_lookup - lookup table for switch ports. Index: slot,
+ *                      value: index in SSA_TABLE_ID_PORT table.
+ *@switch_link_lookup - lookup table for links from switch ports. It shares
+ *                      slots with switch_port_lookup. Value: index of linked
+ *                      port in SSA_TABLE_ID_PORT table.
+ *@lft_offset - CSR offsets of forwarding tables. Index: dense switch number.
+ *              Forwarding table of a switch has LFT top + 1 entries and
+ *              the sentinel entry. The last offset is repeated, so
+ *              lft_offset[0] and lft_offset[1] exist without switches.
+ *@lft_ports - forwarding tables. Index: lft_offset[id] + destination LID
+ *             in host order, value: outgoing port. LIDs that are not
+ *             covered by SSA_TABLE_ID_LFT_BLOCK are LFT_NO_PATH.
+ *             Destination LIDs above LFT top read the sentinel entry.
+ *@p_port_csr - the allocation that holds switch_port_offset,
+ *              switch_port_lookup and switch_link_lookup.
+ *@port_csr_size - size of the allocation in bytes.
+ *@p_lft_csr - the allocation that holds lft_offset and lft_ports.
+ *@lft_csr_size - size of the allocation in bytes.
+ *
+ * Routing graph is a structure of arrays in host order that is used by
+ * the route walk instead of big endian port records. All arrays are indexed
+ * by position in SSA_TABLE_ID_PORT table.
+ *@port_link - position of the linked port, the same as find_linked_port
+ *             returns for the port.
+ *@port_node - dense switch number of the port's LID or SSA_PR_NO_NODE.
+ *@port_mtu - neighbor MTU.
+ *@port_rate - rate without the switch flag.
+ *@port_rate_rank - order of port_rate by ib_path_compare_rates: rates
+ *                  with a higher rank are faster, equal rates have equal
+ *                  ranks. Invalid rates have the highest rank.
+ *@port_is_switch - switch flag of the port record.
+ *@p_graph - the allocation that holds the routing graph.
+ *@graph_size - size of the allocation in bytes.
+ *
+ * Missing values of 32 bit tables are SSA_PR_NO_INDEX.
  */
 struct ssa_pr_smdb_index {
 	uint64_t epoch;
-	uint8_t is_switch_lookup[MAX_LOOKUP_LID + 1];
-	uint16_t lft_top_lookup[MAX_LOOKUP_LID + 1];
-	uint64_t* lft_block_lookup[MAX_LOOKUP_LID + 1];
-	uint64_t ca_port_lookup[MAX_LOOKUP_LID + 1];
-	uint64_t* switch_port_lookup[MAX_LOOKUP_LID +1 ];
-	uint64_t ca_link_lookup[MAX_LOOKUP_LID +1];
-	uint64_t* switch_link_lookup[MAX_LOOKUP_LID + 1];
+	uint64_t table_epochs[SSA_PR_INDEX_TABLE_NUM];
+	uint8_t *is_switch_lookup;
+	uint16_t *switch_id_lookup;
+	size_t switch_count;
+	uint32_t *guid_to_lid_lookup;
+	uint32_t *guid_hash;
+	unsigned int guid_hash_bits;
+	uint16_t *lft_top_lookup;
+	uint32_t *ca_port_lookup;
+	uint32_t *ca_link_lookup;
+	size_t lid_lookup_count;
+	void *p_lid_lookup;
+	size_t lid_lookup_size;
+	uint32_t *switch_port_offset;
+	uint32_t *switch_port_lookup;
+	uint32_t *switch_link_lookup;
+	uint32_t *lft_offset;
+	uint8_t *lft_ports;
+	void *p_port_csr;
+	size_t port_csr_size;
+	void *p_lft_csr;
+	size_t lft_csr_size;
+	uint32_t *port_link;
+	uint16_t *port_node;
+	uint8_t *port_mtu;
+	uint8_t *port_rate;
+	uint8_t *port_rate_rank;
+	uint8_t *port_is_switch;
+	void *p_graph;
+	size_t graph_size;
 };
 
 /**
@@ -112,25 +204,68 @@ extern void ssa_pr_destroy_indexes(struct ssa_pr_smdb_index *p_index);
  * @return value: 0 - success; otherwise - failure
  *
  * The function rebuilds a smdb index if needed. The desicion rebuild or not
- * is based on epoch of index and database.
+ * is based on epoch of index and database. Epochs are compared per table
+ * and only sub-indices of changed tables are rebuilt. If only LFT blocks
+ * are changed, forwarding tables are refilled in place.
  **/
 extern int ssa_pr_rebuild_indexes(struct ssa_pr_smdb_index *p_index,
 		const struct ssa_db *p_smdb);
 
+/**
+ * ssa_pr_update_lft_blocks - patches forwarding tables with changed LFT blocks
+ * @p_index: pointer to an index
+ * @p_smdb: pointer to smdb database
+ * @p_block_ids: positions of changed records in SSA_TABLE_ID_LFT_BLOCK table
+ * @count: number of positions
+ *
+ * @return value: 0 - success; otherwise - failure
+ *
+ * The function is a cheaper alternative to ssa_pr_rebuild_indexes when
+ * changed LFT blocks are known. All other tables must be unchanged since
+ * the last rebuild, otherwise the function fails and doesn't touch the index.
+ * LFT block records must not be removed.
+ **/
+extern int ssa_pr_update_lft_blocks(struct ssa_pr_smdb_index *p_index,
+		const struct ssa_db *p_smdb,
+		const uint64_t *p_block_ids,
+		size_t count);
+
+/**
+ * ssa_pr_index_memory - memory used by a smdb index
+ * @p_index: pointer to an index
+ *
+ * @return value: size in bytes of the index and all its allocations
+ **/
+extern size_t ssa_pr_index_memory(const struct ssa_pr_smdb_index *p_index);
+
 /**
  * find_guid_to_lid_rec_by_guid - search in SSA_TABLE_ID_GUID_TO_LID table
  * @p_smdb: Pointer to a smdb databse.
+ * @p_index: Pointer to a smdb index. It's used for boot retrieval operations 
  * @port_guid: GUID in network order.
  *
  * @return value: pointer to found record. NULL - failure.
  *
- * The function iterates SSA_TABLE_ID_GUID_TO_LID table and searches for a
- * record with given GUID 
+ * The function searches for a record with given GUID in the GUID hash table
  **/
 extern const struct ep_guid_to_lid_tbl_rec 
 *find_guid_to_lid_rec_by_guid(const struct ssa_db *p_smdb,
+		const struct ssa_pr_smdb_index *p_index,
 		const be64_t port_guid);
 
+/**
+ * find_guid_to_lid_rec_by_lid - search in SSA_TABLE_ID_GUID_TO_LID table
+ * @p_smdb: Pointer to a smdb databse.
+ * @p_index: Pointer to a smdb index. It's used for boot retrieval operations 
+ * @lid: LID in network order. Any LID of port's LMC range.
+ *
+ * @return value: pointer to found record. NULL - failure.
+ **/
+extern const struct ep_guid_to_lid_tbl_rec 
+*find_guid_to_lid_rec_by_lid(const struct ssa_db *p_smdb,
+		const struct ssa_pr_smdb_index *p_index,
+		const be16_t lid);
+
 /**
  * find_port - search in SSA_TABLE_ID_PORT table
  * @p_smdb: Pointer to a smdb databse.
@@ -148,15 +283,58 @@ extern const struct ep_port_tbl_rec *find_port(const struct ssa_db *p_smdb,
 		const int port_num);
 
 /**
- * find_destination_port - search in SSA_TABLE_ID_LFT_BLOCK table
+ * ssa_pr_is_switch_lid - checks if a LID belongs to a known switch
+ * @p_index: Pointer to a smdb index
+ * @lid: LID in host order
+ *
+ * @return value: 1 - the LID is a switch of SSA_TABLE_ID_GUID_TO_LID and
+ * switch_id_lookup is valid for it; 0 - otherwise.
+ **/
+static inline int ssa_pr_is_switch_lid(const struct ssa_pr_smdb_index *p_index,
+		const uint16_t lid)
+{
+	return lid < p_index->lid_lookup_count && p_index->is_switch_lookup[lid];
+}
+
+/**
+ * ssa_pr_lft_entry - reads a forwarding table without branches
+ * @p_index: Pointer to a smdb index
+ * @switch_id: dense switch number
+ * @is_switch: 1 - switch_id is valid; 0 - the result is -1
+ * @dlid: destination LID in host order
+ *
+ * @return value: outgoing port number. LFT_NO_PATH - no path. -1 - not
+ * a switch or destination LID above LFT top.
+ **/
+static inline int ssa_pr_lft_entry(const struct ssa_pr_smdb_index *p_index,
+		const uint16_t switch_id,
+		const uint32_t is_switch,
+		const uint32_t dlid)
+{
+	const uint32_t *p_lft_offset = p_index->lft_offset + switch_id;
+	const uint32_t size = (p_lft_offset[1] - p_lft_offset[0] - 1) * is_switch;
+	const uint32_t out_of_range = dlid >= size;
+
+	/*
+	 * Out of range LIDs read the sentinel entry, the mask turns it into -1
+	 */
+	return p_index->lft_ports[p_lft_offset[0] + dlid + (size - dlid) * out_of_range] |
+		-(int)out_of_range;
+}
+
+/**
+ * find_destination_port - search in switch's forwarding table
  * @p_smdb: Pointer to a smdb databse.
  * @p_index: Pointer to a smdb index. It's used for boot retrieval operations 
  * @source_lid: switch's LID in network order
  * @dest_lid: destination LID in network order
  *
- * @return value: pointer to found record. NULL - failure.
+ * @return value: outgoing port number. LFT_NO_PATH - no path. -1 - failure.
  *
- * The function searches for link record in LFT table
+ * The function reads outgoing port from the forwarding table built from
+ * SSA_TABLE_ID_LFT_BLOCK. Destination LID above LFT top or a source LID
+ * that is not a switch is a failure. The failure is not logged, callers
+ * report it.
  **/
 extern int find_destination_port(const struct ssa_db *p_smdb,
 		const struct ssa_pr_smdb_index *p_index,
@@ -179,4 +357,58 @@ extern const struct ep_port_tbl_rec *find_linked_port(const struct ssa_db *p_smd
 		const struct ssa_pr_smdb_index *p_index,
 		const be16_t from_lid,
 		const int from_port_num);
+
+/**
+ * route_out_port - outgoing port of a switch on the route
+ * @p_index: Pointer to a smdb index
+ * @port_index: position of a switch port in SSA_TABLE_ID_PORT table
+ * @dest_lid: destination LID in network order
+ *
+ * @return value: outgoing port number of the switch that owns the port.
+ * LFT_NO_PATH - no path. -1 - the port's LID is not a known switch or
+ * the destination is above LFT top.
+ **/
+static inline int route_out_port(const struct ssa_pr_smdb_index *p_index,
+		const uint32_t port_index,
+		const be16_t dest_lid)
+{
+	const uint16_t node = p_index->port_node[port_index];
+
+	if(SSA_PR_NO_NODE == node)
+		return -1;
+	return ssa_pr_lft_entry(p_index,node,1,ntohs(dest_lid));
+}
+
+/**
+ * route_switch_port - search for a port of a switch on the route
+ * @p_smdb: Pointer to a smdb database
+ * @p_index: Pointer to a smdb index
+ * @port_index: position of a switch port in SSA_TABLE_ID_PORT table
+ * @out_port_num: port number of the same switch
+ *
+ * @return value: position of the port out_port_num of the switch that
+ * owns the port at port_index. SSA_PR_NO_INDEX - the port is not found.
+ **/
+static inline uint32_t route_switch_port(const struct ssa_db *p_smdb,
+		const struct ssa_pr_smdb_index *p_index,
+		const uint32_t port_index,
+		const int out_port_num)
+{
+	const uint16_t node = p_index->port_node[port_index];
+	const struct ep_port_tbl_rec *p_port_tbl = NULL;
+	const struct ep_port_tbl_rec *port = NULL;
+
+	if(SSA_PR_NO_NODE != node && out_port_num >= 0) {
+		const uint32_t slot = p_index->switch_port_offset[node] + out_port_num;
+
+		if(slot < p_index->switch_port_offset[node + 1] &&
+				SSA_PR_NO_INDEX != p_index->switch_port_lookup[slot])
+			return p_index->switch_port_lookup[slot];
+	}
+
+	p_port_tbl = (const struct ep_port_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_PORT];
+	port = find_port(p_smdb,p_index,p_port_tbl[port_index].port_lid,out_port_num);
+	return port ? (uint32_t)(port - p_port_tbl) : SSA_PR_NO_INDEX;
+}
+
 #endif /* end of include guard: SSA_PATH_RECORD_DATA_H */
@@ -0,0 +1,340 @@
+/*
+ * Copyright 2004-2013 Mellanox Technologies LTD. All rights reserved.
+ *
+ * This software is available to you under the terms of the
+ * OpenIB.org BSD license included below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif              /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <infiniband/ssa_db.h>
+#include <infiniband/ssa_smdb.h>
+#include <infiniband/ssa_path_record.h>
+#include "ssa_path_record_helper.h"
+#include "ssa_path_record_data.h"
+#include "ssa_path_record_dp.h"
+
+#ifndef MIN
+#define MIN(X,Y) ((X) < (Y) ?  (X) : (Y))
+#endif
+
+enum {
+	SSA_PR_DP_IN_PROGRESS = 1,
+	SSA_PR_DP_DONE
+};
+
+/*
+ * Result of a route walk from some port to the destination
+ */
+struct dp_walk_res {
+	ssa_pr_status_t status;
+	uint8_t mtu;
+	uint8_t rate;
+	unsigned int hops;
+};
+
+/*
+ * The same rule as in the hop by hop route walk: a rate is replaced only
+ * by a strictly lower one.
+ */
+static inline uint8_t dp_min_rate(const uint8_t rate1,const uint8_t rate2)
+{
+	return ib_path_compare_rates_fast(rate1,rate2) > 0 ? rate2 : rate1;
+}
+
+static inline uint8_t port_rate(const struct ep_port_tbl_rec *p_port)
+{
+	return p_port->rate & SSA_DB_PORT_RATE_MASK;
+}
+
+static struct dp_walk_res dp_walk_from_port(struct ssa_pr_dp_table *p_table,
+		const struct ssa_db *p_smdb,
+		const struct ssa_pr_smdb_index *p_index,
+		const struct ep_port_tbl_rec *p_port,
+		unsigned int depth);
+
+void ssa_pr_dp_init(struct ssa_pr_dp_table *p_table)
+{
+	SSA_ASSERT(p_table);
+	memset(p_table,'\0',sizeof(*p_table));
+}
+
+void ssa_pr_dp_destroy(struct ssa_pr_dp_table *p_table)
+{
+	SSA_ASSERT(p_table);
+
+	free(p_table->p_entries);
+	memset(p_table,'\0',sizeof(*p_table));
+}
+
+int ssa_pr_dp_set_destination(struct ssa_pr_dp_table *p_table,
+		const struct ssa_db *p_smdb,
+		const struct ssa_pr_smdb_index *p_index,
+		const struct ep_guid_to_lid_tbl_rec *p_dest_rec)
+{
+	SSA_ASSERT(p_table);
+	SSA_ASSERT(p_smdb);
+	SSA_ASSERT(p_index);
+	SSA_ASSERT(p_dest_rec);
+
+	if(p_table->size < p_index->switch_count) {
+		struct ssa_pr_dp_entry *p_entries = (struct ssa_pr_dp_entry *)
+			realloc(p_table->p_entries,p_index->switch_count * sizeof(*p_entries));
+
+		if(!p_entries) {
+			SSA_PR_LOG_ERROR("Cannot allocate switch suffix table. Switches: %zu",
+					p_index->switch_count);
+			return -1;
+		}
+		memset(p_entries,'\0',p_index->switch_count * sizeof(*p_entries));
+		p_table->p_entries = p_entries;
+		p_table->size = p_index->switch_count;
+		p_table->stamp = 0;
+	}
+
+	if(0 == ++p_table->stamp) {
+		memset(p_table->p_entries,'\0',p_table->size * sizeof(p_table->p_entries[0]));
+		p_table->stamp = 1;
+	}
+
+	p_table->p_dest_rec = p_dest_rec;
+	p_table->p_dest_port = find_port(p_smdb,p_index,p_dest_rec->lid,
+			p_dest_rec->is_switch ? 0 : -1);
+	if(NULL == p_table->p_dest_port) {
+		SSA_PR_LOG_ERROR("Destination port is not found. LID: 0x%"SCNx16,
+				ntohs(p_dest_rec->lid));
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * dp_switch_entry - returns suffix of a switch for the table's destination.
+ * The suffix is computed if it's not in the table yet.
+ */
+static const struct ssa_pr_dp_entry *dp_switch_entry(struct ssa_pr_dp_table *p_table,
+		const struct ssa_db *p_smdb,
+		const struct ssa_pr_smdb_index *p_index,
+		const be16_t switch_lid,
+		unsigned int depth)
+{
+	struct ssa_pr_dp_entry *p_entry = NULL;
+	const struct ep_port_tbl_rec *p_out_port = NULL;
+	struct dp_walk_res res;
+	int out_port_num = -1;
+
+	p_entry = p_table->p_entries + p_index->switch_id_lookup[ntohs(switch_lid)];
+
+	if(p_entry->stamp == p_table->stamp) {
+		if(SSA_PR_DP_IN_PROGRESS == p_entry->state) {
+			SSA_PR_LOG_ERROR("Routing loop to LID: 0x%"SCNx16" via switch LID: 0x%"SCNx16,
+					ntohs(p_table->p_dest_rec->lid),ntohs(switch_lid));
+			p_entry->state = SSA_PR_DP_DONE;
+			p_entry->lft_status = SSA_PR_ERROR;
+		}
+		return p_entry;
+	}
+
+	p_entry->stamp = p_table->stamp;
+	p_entry->state = SSA_PR_DP_IN_PROGRESS;
+
+	out_port_num = find_destination_port(p_smdb,p_index,switch_lid,
+			p_table->p_dest_rec->lid);
+	if(out_port_num < 0) {
+		SSA_PR_LOG_ERROR("Failed to find outgoing port for LID: 0x%"SCNx16
+				" on switch LID: 0x%"SCNx16".",
+				ntohs(p_table->p_dest_rec->lid),ntohs(switch_lid));
+		p_entry->lft_status = SSA_PR_ERROR;
+		goto Exit;
+	} else if(LFT_NO_PATH == out_port_num) {
+		p_entry->lft_status = SSA_PR_NO_PATH;
+		goto Exit;
+	}
+
+	p_out_port = find_port(p_smdb,p_index,switch_lid,out_port_num);
+	if(NULL == p_out_port) {
+		SSA_PR_LOG_ERROR("Port is not found. LID: 0x%"SCNx16" num: %u",
+				ntohs(switch_lid),out_port_num);
+		p_entry->lft_status = SSA_PR_ERROR;
+		goto Exit;
+	}
+
+	p_entry->lft_status = SSA_PR_SUCCESS;
+	p_entry->out_mtu = p_out_port->neighbor_mtu;
+	p_entry->out_rate = port_rate(p_out_port);
+
+	res = dp_walk_from_port(p_table,p_smdb,p_index,p_out_port,depth);
+	/*
+	 * The entry may be marked as a part of a routing loop during the walk
+	 */
+	if(SSA_PR_SUCCESS != p_entry->lft_status)
+		goto Exit;
+
+	p_entry->status = res.status;
+	p_entry->mtu = res.mtu;
+	p_entry->rate = res.rate;
+	p_entry->hops = MIN(res.hops,MAX_HOPS + 1);
+Exit:
+	p_entry->state = SSA_PR_DP_DONE;
+	return p_entry;
+}
+
+/*
+ * dp_walk_from_port - route from an outgoing port to the destination.
+ * MTU and rate of the given port itself are taken into account only
+ * if it's the destination port.
+ */
+static struct dp_walk_res dp_walk_from_port(struct ssa_pr_dp_table *p_table,
+		const struct ssa_db *p_smdb,
+		const struct ssa_pr_smdb_index *p_index,
+		const struct ep_port_tbl_rec *p_port,
+		unsigned int depth)
+{
+	struct dp_walk_res res;
+	const struct ssa_pr_dp_entry *p_entry = NULL;
+	const struct ep_port_tbl_rec *p_dest_port = p_table->p_dest_port;
+
+	memset(&res,'\0',sizeof(res));
+	res.status = SSA_PR_ERROR;
+
+	if(p_port == p_dest_port) {
+		res.status = SSA_PR_SUCCESS;
+		res.mtu = p_port->neighbor_mtu;
+		res.rate = port_rate(p_port);
+		return res;
+	}
+
+	p_port = find_linked_port(p_smdb,p_index,p_port->port_lid,p_port->port_num);
+	if(NULL == p_port) {
+		SSA_PR_LOG_ERROR("Port is not found. Path record calculation is stopped.");
+		return res;
+	}
+
+	if(p_port == p_dest_port) {
+		res.status = SSA_PR_SUCCESS;
+		res.mtu = p_port->neighbor_mtu;
+		res.rate = port_rate(p_port);
+		return res;
+	}
+
+	if(!(p_port->rate & SSA_DB_PORT_IS_SWITCH_MASK) ||
+			!ssa_pr_is_switch_lid(p_index,ntohs(p_port->port_lid))) {
+		SSA_PR_LOG_ERROR("Error: Internal error, bad path while routing "
+				"to (GUID: 0x%016"PRIx64") port %d; "
+				"ended at (LID: 0x%04"SCNx16") port %d",
+				ntohll(p_table->p_dest_rec->guid),p_dest_port->port_num,
+				ntohs(p_port->port_lid),p_port->port_num);
+		return res;
+	}
+
+	if(depth > MAX_HOPS) {
+		res.hops = depth;
+		return res;
+	}
+
+	p_entry = dp_switch_entry(p_table,p_smdb,p_index,p_port->port_lid,depth + 1);
+	if(SSA_PR_SUCCESS != p_entry->lft_status) {
+		res.status = p_entry->lft_status;
+		return res;
+	}
+
+	res.status = p_entry->status;
+	res.mtu = MIN(p_port->neighbor_mtu,p_entry->out_mtu);
+	res.mtu = MIN(res.mtu,p_entry->mtu);
+	res.rate = dp_min_rate(port_rate(p_port),p_entry->out_rate);
+	res.rate = dp_min_rate(res.rate,p_entry->rate);
+	res.hops = p_entry->hops + 1;
+
+	return res;
+}
+
+ssa_pr_status_t ssa_pr_dp_path_params(struct ssa_pr_dp_table *p_table,
+		const struct ssa_db *p_smdb,
+		const struct ssa_pr_smdb_index *p_index,
+		const struct ep_guid_to_lid_tbl_rec *p_source_rec,
+		ssa_path_parms_t *p_path_prm)
+{
+	const struct ep_port_tbl_rec *p_source_port = NULL;
+	struct dp_walk_res res;
+
+	SSA_ASSERT(p_table);
+	SSA_ASSERT(p_table->p_dest_rec);
+	SSA_ASSERT(p_smdb);
+	SSA_ASSERT(p_index);
+	SSA_ASSERT(p_source_rec);
+	SSA_ASSERT(p_path_prm);
+
+	p_source_port = find_port(p_smdb,p_index,p_source_rec->lid,
+			p_source_rec->is_switch ? 0 : -1);
+	if(NULL == p_source_port) {
+		SSA_PR_LOG_ERROR("Source port is not found. Path record calculation is stopped."
+				" LID: 0x%"SCNx16,ntohs(p_source_rec->lid));
+		return SSA_PR_ERROR;
+	}
+
+	p_path_prm->pkt_life = 0;
+	p_path_prm->mtu = p_source_port->neighbor_mtu;
+	p_path_prm->rate = port_rate(p_source_port);
+	p_path_prm->hops = 0;
+
+	if(p_source_rec->is_switch) {
+		const struct ssa_pr_dp_entry *p_entry =
+			dp_switch_entry(p_table,p_smdb,p_index,p_source_rec->lid,0);
+
+		if(SSA_PR_SUCCESS != p_entry->lft_status)
+			return p_entry->lft_status;
+
+		res.status = p_entry->status;
+		res.mtu = p_entry->mtu;
+		res.rate = p_entry->rate;
+		res.hops = p_entry->hops;
+	} else {
+		res = dp_walk_from_port(p_table,p_smdb,p_index,p_source_port,0);
+	}
+
+	if(SSA_PR_SUCCESS == res.status && res.hops > MAX_HOPS) {
+		SSA_PR_LOG_ERROR("Path from GUID 0x%016" PRIx64 " to lid %u "
+				"needs more than %d hops, max %d hops allowed.",
+				ntohll(p_source_rec->guid),ntohs(p_table->p_dest_rec->lid),
+				res.hops,MAX_HOPS);
+		return SSA_PR_ERROR;
+	}
+
+	if(SSA_PR_SUCCESS != res.status)
+		return res.status;
+
+	p_path_prm->mtu = MIN(p_path_prm->mtu,res.mtu);
+	p_path_prm->rate = dp_min_rate(p_path_prm->rate,res.rate);
+	p_path_prm->hops = res.hops;
+
+	return SSA_PR_SUCCESS;
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2004-2013 Mellanox Technologies LTD. All rights reserved.
+ *
+ * This software is available to you under the terms of the
+ * OpenIB.org BSD license included below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#ifndef SSA_PATH_RECORD_DP_H
+#define SSA_PATH_RECORD_DP_H
+
+/*
+ * Internal API for destination rooted path record engine.
+ *
+ * LFT defines exactly one outgoing port per pair (switch, destination LID).
+ * Therefore the part of a route from a switch to a destination doesn't
+ * depend on the source. For a given destination the engine computes this
+ * suffix (min MTU, min rate, number of hops) once per switch and reuses it
+ * for all sources. A path record is a first link combined with one
+ * table lookup.
+ */
+
+#include "ssa_path_record_data.h"
+
+/*
+ * Result for one switch and the current destination.
+ *
+ *@stamp - the entry is valid only if equals to the table's stamp.
+ *@state - SSA_PR_DP_IN_PROGRESS while the suffix is computed.
+ *@lft_status - status of the LFT lookup on the switch.
+ *@out_mtu, out_rate - parameters of outgoing port chosen by LFT.
+ *@status, mtu, rate, hops - parameters of the route behind the
+ *                           outgoing port.
+ */
+struct ssa_pr_dp_entry {
+	uint32_t stamp;
+	uint8_t state;
+	uint8_t lft_status;
+	uint8_t out_mtu;
+	uint8_t out_rate;
+	uint8_t status;
+	uint8_t mtu;
+	uint8_t rate;
+	uint8_t hops;
+};
+
+/*
+ * Per destination table of switch suffixes.
+ *
+ *@p_entries - index: dense switch number (see switch_id_lookup).
+ *@size - number of allocated entries.
+ *@stamp - generation of the table. It's changed for every destination
+ *         so the table is not cleaned between destinations.
+ *@p_dest_rec - current destination.
+ *@p_dest_port - port of the current destination.
+ */
+struct ssa_pr_dp_table {
+	struct ssa_pr_dp_entry *p_entries;
+	size_t size;
+	uint32_t stamp;
+	const struct ep_guid_to_lid_tbl_rec *p_dest_rec;
+	const struct ep_port_tbl_rec *p_dest_port;
+};
+
+/**
+ * ssa_pr_dp_init - initializes a suffix table
+ * @p_table: Pointer to a table
+ **/
+extern void ssa_pr_dp_init(struct ssa_pr_dp_table *p_table);
+
+/**
+ * ssa_pr_dp_destroy - deallocates all resources of a suffix table
+ * @p_table: Pointer to a table
+ **/
+extern void ssa_pr_dp_destroy(struct ssa_pr_dp_table *p_table);
+
+/**
+ * ssa_pr_dp_set_destination - prepares a table for a destination
+ * @p_table: Pointer to a table
+ * @p_smdb: Pointer to smdb database
+ * @p_index: Pointer to a smdb index
+ * @p_dest_rec: Destination's record in SSA_TABLE_ID_GUID_TO_LID
+ *
+ * @return value: 0 - success; otherwise - failure
+ *
+ * All previously computed suffixes are invalidated.
+ **/
+extern int ssa_pr_dp_set_destination(struct ssa_pr_dp_table *p_table,
+		const struct ssa_db *p_smdb,
+		const struct ssa_pr_smdb_index *p_index,
+		const struct ep_guid_to_lid_tbl_rec *p_dest_rec);
+
+/**
+ * ssa_pr_dp_path_params - computes a path to the table's destination
+ * @p_table: Pointer to a table prepared by ssa_pr_dp_set_destination
+ * @p_smdb: Pointer to smdb database
+ * @p_index: Pointer to a smdb index
+ * @p_source_rec: Source's record in SSA_TABLE_ID_GUID_TO_LID
+ * @p_path_prm: Output. Only mtu, rate, hops and pkt_life are set.
+ *
+ * @return value: the same as for a hop by hop route walk.
+ **/
+extern ssa_pr_status_t ssa_pr_dp_path_params(struct ssa_pr_dp_table *p_table,
+		const struct ssa_db *p_smdb,
+		const struct ssa_pr_smdb_index *p_index,
+		const struct ep_guid_to_lid_tbl_rec *p_source_rec,
+		ssa_path_parms_t *p_path_prm);
+
+#endif /* end of include guard: SSA_PATH_RECORD_DP_H */
@@ -0,0 +1,273 @@
+/*
+ * Copyright 2004-2013 Mellanox Technologies LTD. All rights reserved.
+ *
+ * This software is available to you under the terms of the
+ * OpenIB.org BSD license included below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif              /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <infiniband/ssa_db.h>
+#include <infiniband/ssa_smdb.h>
+#include <infiniband/ssa_path_record.h>
+#include "ssa_path_record_helper.h"
+#include "ssa_path_record_fail.h"
+
+#define FAIL_REPORT_MIN_BITS 6
+/*
+ * Number of locations in the summary log line
+ */
+#define FAIL_REPORT_LOG_LOCATIONS 4
+
+static const char *fail_cause_names[SSA_PR_FAIL_CAUSE_NUM] = {
+	"no port",
+	"no link",
+	"LFT lookup",
+	"no route",
+	"bad route",
+	"loop",
+	"other"
+};
+
+static inline size_t fail_hash(uint32_t key, unsigned int bits)
+{
+	/* Knuth's multiplicative hash */
+	return (key * 2654435761U) >> (32 - bits);
+}
+
+static struct ssa_pr_fail_entry *fail_find_slot(struct ssa_pr_fail_entry *p_entries,
+		unsigned int bits, uint16_t lid, uint8_t port_num)
+{
+	const size_t mask = ((size_t)1 << bits) - 1;
+	size_t slot = fail_hash(((uint32_t)lid << 8) | port_num,bits);
+
+	while(p_entries[slot].count &&
+			(p_entries[slot].lid != lid || p_entries[slot].port_num != port_num))
+		slot = (slot + 1) & mask;
+	return p_entries + slot;
+}
+
+/*
+ * fail_grow - doubles the location table. Load factor is at most 1/2.
+ */
+static int fail_grow(struct ssa_pr_fail_report *p_report)
+{
+	const unsigned int bits = p_report->entry_bits ?
+		p_report->entry_bits + 1 : FAIL_REPORT_MIN_BITS;
+	const size_t old_size = p_report->entry_bits ? (size_t)1 << p_report->entry_bits : 0;
+	struct ssa_pr_fail_entry *p_entries = NULL;
+	size_t i = 0;
+
+	p_entries = (struct ssa_pr_fail_entry *)calloc((size_t)1 << bits,sizeof(*p_entries));
+	if(!p_entries)
+		return -1;
+
+	for(i = 0; i < old_size; ++i) {
+		const struct ssa_pr_fail_entry *p_old = p_report->p_entries + i;
+
+		if(p_old->count)
+			*fail_find_slot(p_entries,bits,p_old->lid,p_old->port_num) = *p_old;
+	}
+
+	free(p_report->p_entries);
+	p_report->p_entries = p_entries;
+	p_report->entry_bits = bits;
+	return 0;
+}
+
+static int fail_add_location(struct ssa_pr_fail_report *p_report,
+		uint16_t lid, uint8_t port_num, uint8_t causes, uint64_t count)
+{
+	struct ssa_pr_fail_entry *p_entry = NULL;
+
+	if(!p_report->entry_bits || 2 * (p_report->stats.locations + 1) >
+			((size_t)1 << p_report->entry_bits)) {
+		if(fail_grow(p_report))
+			return -1;
+	}
+
+	p_entry = fail_find_slot(p_report->p_entries,p_report->entry_bits,lid,port_num);
+	if(!p_entry->count) {
+		p_entry->lid = lid;
+		p_entry->port_num = port_num;
+		p_report->stats.locations++;
+	}
+	p_entry->causes |= causes;
+	p_entry->count += count;
+	return 0;
+}
+
+static int fail_add_switch(struct ssa_pr_fail_report *p_report, size_t id,
+		size_t switch_count)
+{
+	if(!p_report->p_switch_map) {
+		p_report->switch_map_words = (switch_count + 63) / 64;
+		p_report->p_switch_map = (uint64_t *)calloc(p_report->switch_map_words,
+				sizeof(uint64_t));
+		if(!p_report->p_switch_map)
+			return -1;
+	}
+	if(id / 64 >= p_report->switch_map_words)
+		return -1;
+
+	if(!(p_report->p_switch_map[id / 64] & (1ULL << (id % 64)))) {
+		p_report->p_switch_map[id / 64] |= 1ULL << (id % 64);
+		p_report->stats.switches++;
+	}
+	return 0;
+}
+
+int ssa_pr_fail_report_add(struct ssa_pr_fail_report *p_report,
+		const struct ssa_pr_smdb_index *p_index,
+		const struct ssa_pr_fail *p_fail,
+		int reverse,
+		uint64_t count)
+{
+	const uint16_t lid = ntohs(p_fail->lid);
+	int res = 0;
+
+	SSA_ASSERT(p_report);
+	SSA_ASSERT(p_index);
+	SSA_ASSERT(p_fail);
+	SSA_ASSERT(p_fail->cause < SSA_PR_FAIL_CAUSE_NUM);
+
+	if(reverse)
+		p_report->stats.reverse_pairs += count;
+	else
+		p_report->stats.pairs += count;
+	p_report->stats.causes[p_fail->cause] += count;
+
+	if(!lid || lid > MAX_LOOKUP_LID)
+		return 0;
+
+	if(ssa_pr_is_switch_lid(p_index,lid))
+		res = fail_add_switch(p_report,p_index->switch_id_lookup[lid],
+				p_index->switch_count);
+	if(fail_add_location(p_report,lid,p_fail->port_num,1 << p_fail->cause,count))
+		res = -1;
+	return res;
+}
+
+void ssa_pr_fail_report_merge(struct ssa_pr_fail_report *p_report,
+		const struct ssa_pr_fail_report *p_src)
+{
+	size_t i = 0;
+	int j = 0;
+
+	p_report->stats.pairs += p_src->stats.pairs;
+	p_report->stats.reverse_pairs += p_src->stats.reverse_pairs;
+	for(j = 0; j < SSA_PR_FAIL_CAUSE_NUM; ++j)
+		p_report->stats.causes[j] += p_src->stats.causes[j];
+
+	for(i = 0; i < p_src->switch_map_words; ++i) {
+		uint64_t bits = p_src->p_switch_map[i];
+
+		while(bits) {
+			fail_add_switch(p_report,i * 64 + __builtin_ctzll(bits),
+					p_src->switch_map_words * 64);
+			bits &= bits - 1;
+		}
+	}
+
+	for(i = 0; p_src->entry_bits && i < ((size_t)1 << p_src->entry_bits); ++i) {
+		const struct ssa_pr_fail_entry *p_entry = p_src->p_entries + i;
+
+		if(p_entry->count)
+			fail_add_location(p_report,p_entry->lid,p_entry->port_num,
+					p_entry->causes,p_entry->count);
+	}
+}
+
+size_t ssa_pr_fail_report_locations(const struct ssa_pr_fail_report *p_report,
+		struct ssa_pr_fail_location *p_locations,
+		size_t count)
+{
+	size_t i = 0, j = 0, found = 0;
+
+	for(i = 0; p_report->entry_bits && i < ((size_t)1 << p_report->entry_bits); ++i) {
+		const struct ssa_pr_fail_entry *p_entry = p_report->p_entries + i;
+
+		if(!p_entry->count)
+			continue;
+		if(found == count && (!count || p_entry->count <= p_locations[count - 1].count))
+			continue;
+
+		/* Insertion into the sorted output. The last one is dropped if full. */
+		j = found < count ? found++ : count - 1;
+		for(; j > 0 && p_locations[j - 1].count < p_entry->count; --j)
+			p_locations[j] = p_locations[j - 1];
+		p_locations[j].lid = htons(p_entry->lid);
+		p_locations[j].port_num = p_entry->port_num;
+		p_locations[j].causes = p_entry->causes;
+		p_locations[j].count = p_entry->count;
+	}
+	return found;
+}
+
+void ssa_pr_fail_report_log(const struct ssa_pr_fail_report *p_report,
+		const char *name)
+{
+	struct ssa_pr_fail_location locations[FAIL_REPORT_LOG_LOCATIONS];
+	char causes[256] = {}, top[256] = {};
+	size_t len = 0, count = 0, i = 0;
+	int j = 0;
+
+	if(!p_report->stats.pairs && !p_report->stats.reverse_pairs)
+		return;
+
+	for(j = 0; j < SSA_PR_FAIL_CAUSE_NUM && len < sizeof(causes); ++j)
+		if(p_report->stats.causes[j])
+			len += snprintf(causes + len,sizeof(causes) - len,"%s%s: %"PRIu64,
+					len ? ", " : "",fail_cause_names[j],p_report->stats.causes[j]);
+
+	count = ssa_pr_fail_report_locations(p_report,locations,FAIL_REPORT_LOG_LOCATIONS);
+	for(i = 0, len = 0; i < count && len < sizeof(top); ++i) {
+		if(SSA_PR_FAIL_NO_PORT_NUM == locations[i].port_num)
+			len += snprintf(top + len,sizeof(top) - len,"%sLID 0x%"SCNx16" (%"PRIu64")",
+					len ? ", " : "",ntohs(locations[i].lid),locations[i].count);
+		else
+			len += snprintf(top + len,sizeof(top) - len,"%sLID 0x%"SCNx16" port %u (%"PRIu64")",
+					len ? ", " : "",ntohs(locations[i].lid),locations[i].port_num,
+					locations[i].count);
+	}
+
+	SSA_PR_LOG_ERROR("Degraded fabric: %s: failed paths: %"PRIu64" failed reverse paths: %"PRIu64
+			" causes: %s. Failing switches: %"PRIu64" locations: %"PRIu64". Top: %s",
+			name,p_report->stats.pairs,p_report->stats.reverse_pairs,causes,
+			p_report->stats.switches,p_report->stats.locations,top);
+}
+
+void ssa_pr_fail_report_destroy(struct ssa_pr_fail_report *p_report)
+{
+	free(p_report->p_switch_map);
+	free(p_report->p_entries);
+	memset(p_report,'\0',sizeof(*p_report));
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2004-2013 Mellanox Technologies LTD. All rights reserved.
+ *
+ * This software is available to you under the terms of the
+ * OpenIB.org BSD license included below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#ifndef SSA_PATH_RECORD_FAIL_H
+#define SSA_PATH_RECORD_FAIL_H
+
+/*
+ * Internal API for failure reports of the degraded fabric mode.
+ *
+ * Instead of a log line per failed (source, destination) pair, route
+ * walks describe where they stopped and why. Failures are aggregated in
+ * per cause counters, a bitmap of failing switches and a hash table of
+ * failing (LID, port) locations.
+ */
+
+#include <infiniband/ssa_path_record_ext.h>
+#include "ssa_path_record_data.h"
+
+/*
+ * Port number of failures that are not related to a port
+ */
+#define SSA_PR_FAIL_NO_PORT_NUM 0xFF
+
+/*
+ * Failure of one route walk.
+ *
+ *@lid - LID in network order of a port or a switch where the walk stopped.
+ *@port_num - port number or SSA_PR_FAIL_NO_PORT_NUM.
+ */
+struct ssa_pr_fail {
+	ssa_pr_fail_cause_t cause;
+	be16_t lid;
+	uint8_t port_num;
+};
+
+/*
+ * Failure counter of a location. Key: LID in host order and port number.
+ *
+ *@causes - bitmask of ssa_pr_fail_cause_t.
+ */
+struct ssa_pr_fail_entry {
+	uint16_t lid;
+	uint8_t port_num;
+	uint8_t causes;
+	uint64_t count;
+};
+
+/*
+ * Aggregated failures. A zeroed structure is an empty report, tables are
+ * allocated on the first failure.
+ *
+ *@stats - counters that are returned by ssa_pr_get_fail_stats.
+ *@p_switch_map - bitmap of failing switches. Index: dense switch number.
+ *@switch_map_words - number of 64 bit words in the bitmap.
+ *@p_entries - open addressing hash table of failing locations with
+ *             linear probing. Empty entries have zero count.
+ *@entry_bits - size of the table is 2^entry_bits.
+ */
+struct ssa_pr_fail_report {
+	struct ssa_pr_fail_stats stats;
+	uint64_t *p_switch_map;
+	size_t switch_map_words;
+	struct ssa_pr_fail_entry *p_entries;
+	unsigned int entry_bits;
+};
+
+/**
+ * ssa_pr_set_fail - describes a failure of a route walk
+ * @p_fail: Pointer to a failure
+ * @cause: Cause
+ * @lid: LID in network order
+ * @port_num: Port number. Negative - the failure is not related to a port.
+ **/
+static inline void ssa_pr_set_fail(struct ssa_pr_fail *p_fail,
+		ssa_pr_fail_cause_t cause, be16_t lid, int port_num)
+{
+	p_fail->cause = cause;
+	p_fail->lid = lid;
+	p_fail->port_num = port_num < 0 ? SSA_PR_FAIL_NO_PORT_NUM : port_num;
+}
+
+/**
+ * ssa_pr_fail_report_add - adds a failure to a report
+ * @p_report: Pointer to a report
+ * @p_index: Pointer to a smdb index
+ * @p_fail: Failure
+ * @reverse: The failure is of a reverse path
+ * @count: Number of failed path computations
+ *
+ * @return value: 0 - success; otherwise - only counters are updated,
+ *                the location can't be stored.
+ **/
+extern int ssa_pr_fail_report_add(struct ssa_pr_fail_report *p_report,
+		const struct ssa_pr_smdb_index *p_index,
+		const struct ssa_pr_fail *p_fail,
+		int reverse,
+		uint64_t count);
+
+/**
+ * ssa_pr_fail_report_merge - adds failures of one report to another one
+ * @p_report: Pointer to a destination report
+ * @p_src: Pointer to a source report
+ **/
+extern void ssa_pr_fail_report_merge(struct ssa_pr_fail_report *p_report,
+		const struct ssa_pr_fail_report *p_src);
+
+/**
+ * ssa_pr_fail_report_locations - returns the most frequent failing locations
+ * @p_report: Pointer to a report
+ * @p_locations: Output array
+ * @count: Size of the array
+ *
+ * @return value: number of returned locations. They are sorted by number
+ *                of failures in descending order.
+ **/
+extern size_t ssa_pr_fail_report_locations(const struct ssa_pr_fail_report *p_report,
+		struct ssa_pr_fail_location *p_locations,
+		size_t count);
+
+/**
+ * ssa_pr_fail_report_log - logs one summary line of a report
+ * @p_report: Pointer to a report
+ * @name: Name of the calculation, e.g. "half world" of a GUID
+ **/
+extern void ssa_pr_fail_report_log(const struct ssa_pr_fail_report *p_report,
+		const char *name);
+
+/**
+ * ssa_pr_fail_report_destroy - deallocates a report and makes it empty
+ * @p_report: Pointer to a report
+ **/
+extern void ssa_pr_fail_report_destroy(struct ssa_pr_fail_report *p_report);
+
+#endif /* end of include guard: SSA_PATH_RECORD_FAIL_H */
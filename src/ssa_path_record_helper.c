@@ -36,9 +36,25 @@
 #endif              /* HAVE_CONFIG_H */
 
 #include <time.h>
+#include <stdarg.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 #include <iba/ib_types.h>
+#include <infiniband/ssa_path_record_ext.h>
 #include "ssa_path_record_helper.h"
 
+/*
+ * Size of a message in the log ring. Longer messages are truncated.
+ */
+#define SSA_PR_LOG_MSG_SIZE 256
+#define SSA_PR_LOG_RING_DEFAULT_SIZE 4096
+/*
+ * Sleep time of the log thread when the ring is empty
+ */
+#define SSA_PR_LOG_IDLE_NS 1000000
+
 /*
  * ib_path_compare_rates and ordered_are copied from SA source.
  */
@@ -152,17 +168,211 @@ int rates_cmp_table[19][19] = {
 
 int ssa_pr_log_level = SSA_PR_EEROR_LEVEL;
 FILE *ssa_pr_log_fd = NULL;
+__thread int ssa_pr_log_muted = 0;
 
+/*
+ * Log messages have a resolution of one second. The formatted time is
+ * cached per thread and refreshed only when the second changes. The coarse
+ * clock is read without a system call.
+ */
 const char* get_time()
 {
-	static char buffer[64] = {};
-	time_t rawtime;
-	struct tm *timeinfo;
+	static __thread char buffer[64] = {};
+	static __thread time_t cached_sec = -1;
+	struct timespec ts;
+	struct tm timeinfo;
 
-	time(&rawtime);
-	timeinfo = localtime(&rawtime);
-
-	strftime(buffer, 64, "%Y-%m-%d %H:%M:%S", timeinfo);
+	clock_gettime(CLOCK_REALTIME_COARSE,&ts);
+	if(ts.tv_sec != cached_sec) {
+		localtime_r(&ts.tv_sec,&timeinfo);
+		strftime(buffer, 64, "%Y-%m-%d %H:%M:%S", &timeinfo);
+		cached_sec = ts.tv_sec;
+	}
 
 	return buffer;
 }
+
+/*
+ * Asynchronous log sink: bounded multi-producer ring with a sequence
+ * number per slot. Producers claim a slot with CAS on head and publish
+ * it by the slot's sequence. The log thread is the only consumer.
+ * When the ring is full, the message is dropped and counted, so logging
+ * never blocks path record computation.
+ *
+ *@seq - slot is free for a producer at position seq, and holds a message
+ *       of position seq - 1 for the consumer.
+ *@fd - log file at the moment of logging.
+ */
+struct ssa_pr_log_slot {
+	uint64_t seq;
+	FILE *fd;
+	char msg[SSA_PR_LOG_MSG_SIZE];
+};
+
+/*
+ *@head - next position for producers.
+ *@tail - next position of the consumer.
+ *@dropped - number of messages that didn't fit.
+ */
+struct ssa_pr_log_ring {
+	struct ssa_pr_log_slot *p_slots;
+	uint64_t mask;
+	uint64_t head;
+	uint64_t tail;
+	uint64_t dropped;
+	int stop;
+	pthread_t thread;
+};
+
+static struct ssa_pr_log_ring *p_log_ring = NULL;
+
+static int log_ring_push(struct ssa_pr_log_ring *p_ring,
+		const char *format, va_list args)
+{
+	struct ssa_pr_log_slot *p_slot = NULL;
+	uint64_t pos = __atomic_load_n(&p_ring->head,__ATOMIC_RELAXED);
+
+	while(1) {
+		int64_t diff = 0;
+
+		p_slot = p_ring->p_slots + (pos & p_ring->mask);
+		diff = (int64_t)(__atomic_load_n(&p_slot->seq,__ATOMIC_ACQUIRE) - pos);
+		if(!diff) {
+			if(__atomic_compare_exchange_n(&p_ring->head,&pos,pos + 1,1,
+						__ATOMIC_RELAXED,__ATOMIC_RELAXED))
+				break;
+		} else if(diff < 0) {
+			__atomic_fetch_add(&p_ring->dropped,1,__ATOMIC_RELAXED);
+			return -1;
+		} else {
+			pos = __atomic_load_n(&p_ring->head,__ATOMIC_RELAXED);
+		}
+	}
+
+	p_slot->fd = ssa_pr_log_fd;
+	vsnprintf(p_slot->msg,SSA_PR_LOG_MSG_SIZE,format,args);
+	__atomic_store_n(&p_slot->seq,pos + 1,__ATOMIC_RELEASE);
+	return 0;
+}
+
+/*
+ * log_ring_drain - writes all published messages
+ *
+ * @return value: number of written messages
+ */
+static size_t log_ring_drain(struct ssa_pr_log_ring *p_ring)
+{
+	FILE *last_fd = NULL;
+	size_t count = 0;
+
+	while(1) {
+		struct ssa_pr_log_slot *p_slot = p_ring->p_slots + (p_ring->tail & p_ring->mask);
+
+		if(__atomic_load_n(&p_slot->seq,__ATOMIC_ACQUIRE) != p_ring->tail + 1)
+			break;
+
+		if(p_slot->fd) {
+			if(last_fd && last_fd != p_slot->fd)
+				fflush(last_fd);
+			fputs(p_slot->msg,p_slot->fd);
+			last_fd = p_slot->fd;
+		}
+		__atomic_store_n(&p_slot->seq,p_ring->tail + p_ring->mask + 1,__ATOMIC_RELEASE);
+		p_ring->tail++;
+		count++;
+	}
+
+	if(last_fd)
+		fflush(last_fd);
+	return count;
+}
+
+static void *log_ring_run(void *prm)
+{
+	struct ssa_pr_log_ring *p_ring = (struct ssa_pr_log_ring *)prm;
+	const struct timespec idle = {0,SSA_PR_LOG_IDLE_NS};
+
+	while(!__atomic_load_n(&p_ring->stop,__ATOMIC_ACQUIRE)) {
+		if(!log_ring_drain(p_ring))
+			nanosleep(&idle,NULL);
+	}
+	log_ring_drain(p_ring);
+
+	return NULL;
+}
+
+void ssa_pr_log_print(const char *format, ...)
+{
+	struct ssa_pr_log_ring *p_ring = __atomic_load_n(&p_log_ring,__ATOMIC_ACQUIRE);
+	va_list args;
+
+	va_start(args,format);
+	if(p_ring)
+		log_ring_push(p_ring,format,args);
+	else if(ssa_pr_log_fd)
+		vfprintf(ssa_pr_log_fd,format,args);
+	va_end(args);
+}
+
+int ssa_pr_log_async_start(size_t entries)
+{
+	struct ssa_pr_log_ring *p_ring = NULL;
+	uint64_t size = 1, i = 0;
+
+	if(p_log_ring) {
+		SSA_PR_LOG_ERROR("Asynchronous logging is already started");
+		return -1;
+	}
+
+	if(!entries)
+		entries = SSA_PR_LOG_RING_DEFAULT_SIZE;
+	while(size < entries)
+		size <<= 1;
+
+	p_ring = (struct ssa_pr_log_ring *)calloc(1,sizeof(*p_ring));
+	if(!p_ring) {
+		SSA_PR_LOG_ERROR("Cannot allocate log ring");
+		return -1;
+	}
+	p_ring->p_slots = (struct ssa_pr_log_slot *)malloc(size * sizeof(*p_ring->p_slots));
+	if(!p_ring->p_slots) {
+		SSA_PR_LOG_ERROR("Cannot allocate log ring. Size: %"PRIu64,size);
+		goto Error;
+	}
+	for(i = 0; i < size; ++i)
+		p_ring->p_slots[i].seq = i;
+	p_ring->mask = size - 1;
+
+	if(pthread_create(&p_ring->thread,NULL,log_ring_run,p_ring)) {
+		SSA_PR_LOG_ERROR("Cannot create log thread");
+		goto Error;
+	}
+
+	__atomic_store_n(&p_log_ring,p_ring,__ATOMIC_RELEASE);
+	return 0;
+Error:
+	free(p_ring->p_slots);
+	free(p_ring);
+	return -1;
+}
+
+uint64_t ssa_pr_log_async_stop()
+{
+	struct ssa_pr_log_ring *p_ring = p_log_ring;
+	uint64_t dropped = 0;
+
+	if(!p_ring)
+		return 0;
+
+	__atomic_store_n(&p_log_ring,NULL,__ATOMIC_RELEASE);
+	__atomic_store_n(&p_ring->stop,1,__ATOMIC_RELEASE);
+	pthread_join(p_ring->thread,NULL);
+
+	dropped = p_ring->dropped;
+	free(p_ring->p_slots);
+	free(p_ring);
+
+	if(dropped)
+		SSA_PR_LOG_INFO("Asynchronous logging dropped %"PRIu64" messages",dropped);
+	return dropped;
+}
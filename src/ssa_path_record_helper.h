@@ -36,6 +36,8 @@
  */
 
 #include<stdio.h>
+#include<stdint.h>
+#include<time.h>
 
 #if defined (_DEBUG_)
 #define SSA_ASSERT	assert
@@ -56,10 +58,40 @@ enum {
 	SSA_PR_DEBUG_LEVEL = 3
 };
 
+/*
+ * The most verbose log level that is compiled in. Calls of more verbose
+ * levels are removed by the compiler, so release builds don't pay even
+ * for the runtime level check of debug messages. It can be overridden
+ * with -DSSA_PR_LOG_COMPILE_LEVEL=<level>.
+ */
+#ifndef SSA_PR_LOG_COMPILE_LEVEL
+#if defined (DEBUG) || defined (_DEBUG_)
+#define SSA_PR_LOG_COMPILE_LEVEL SSA_PR_DEBUG_LEVEL
+#else
+#define SSA_PR_LOG_COMPILE_LEVEL SSA_PR_INFO_LEVEL
+#endif
+#endif
+
 extern int ssa_pr_log_level;
 extern FILE *ssa_pr_log_fd;
 extern const char* get_time();
 
+/*
+ * Error messages of a thread are dropped while ssa_pr_log_muted is set.
+ * The degraded fabric mode reports failed paths with one summary instead.
+ */
+extern __thread int ssa_pr_log_muted;
+
+/**
+ * ssa_pr_log_print - writes a log message to ssa_pr_log_fd
+ * @format: printf format
+ *
+ * If asynchronous logging is started, the message is formatted into
+ * the log ring and written later by the log thread.
+ **/
+extern void ssa_pr_log_print(const char *format, ...)
+	__attribute__((format(printf,1,2)));
+
 extern  int rates_cmp_table[19][19];
 /*
  * According to profiling results,ib_path_compare_rates takes about
@@ -73,14 +105,26 @@ static inline int ib_path_compare_rates_fast(const int rate1,const int rate2)
 	return rates_cmp_table[rate1][rate2];
 }
 
+/*
+ * Monotonic time in nanoseconds. It's used for statistics.
+ */
+static inline uint64_t ssa_pr_time_ns()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
 #define _FILE strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__
 #define SSA_PR_LOG_FORMAT "%s | %-7s | %-15s:%d | %s |"
 #define SSA_PR_LOG_PREFIX_ARGS(tag) get_time(), tag ,_FILE,__LINE__,__func__ 
-#define SSA_PR_LOG_PRINT_FUNCTION(format,...) fprintf(ssa_pr_log_fd,format,__VA_ARGS__)
+#define SSA_PR_LOG_PRINT_FUNCTION(format,...) ssa_pr_log_print(format,__VA_ARGS__)
+#define SSA_PR_LOG_ENABLED(level) (SSA_PR_LOG_COMPILE_LEVEL >= (level) && ssa_pr_log_level >= (level))
 
 
-#define SSA_PR_LOG_ERROR(message,args...) {if(ssa_pr_log_level>=SSA_PR_EEROR_LEVEL) SSA_PR_LOG_PRINT_FUNCTION(SSA_PR_LOG_FORMAT message "\n",SSA_PR_LOG_PREFIX_ARGS(ERROR_TAG), ##args);}
-#define SSA_PR_LOG_INFO(message,args...) {if(ssa_pr_log_level>=SSA_PR_INFO_LEVEL) SSA_PR_LOG_PRINT_FUNCTION(SSA_PR_LOG_FORMAT message "\n",SSA_PR_LOG_PREFIX_ARGS(INFO_TAG), ##args);}
-#define SSA_PR_LOG_DEBUG(message,args...) {if(ssa_pr_log_level>=SSA_PR_DEBUG_LEVEL) SSA_PR_LOG_PRINT_FUNCTION(SSA_PR_LOG_FORMAT message "\n",SSA_PR_LOG_PREFIX_ARGS(DEBUG_TAG), ##args);}
+#define SSA_PR_LOG_ERROR(message,args...) {if(SSA_PR_LOG_ENABLED(SSA_PR_EEROR_LEVEL) && !ssa_pr_log_muted) SSA_PR_LOG_PRINT_FUNCTION(SSA_PR_LOG_FORMAT message "\n",SSA_PR_LOG_PREFIX_ARGS(ERROR_TAG), ##args);}
+#define SSA_PR_LOG_INFO(message,args...) {if(SSA_PR_LOG_ENABLED(SSA_PR_INFO_LEVEL)) SSA_PR_LOG_PRINT_FUNCTION(SSA_PR_LOG_FORMAT message "\n",SSA_PR_LOG_PREFIX_ARGS(INFO_TAG), ##args);}
+#define SSA_PR_LOG_DEBUG(message,args...) {if(SSA_PR_LOG_ENABLED(SSA_PR_DEBUG_LEVEL)) SSA_PR_LOG_PRINT_FUNCTION(SSA_PR_LOG_FORMAT message "\n",SSA_PR_LOG_PREFIX_ARGS(DEBUG_TAG), ##args);}
 
 #endif /* __SSA_PATH_RECORD_HELPER_H__ */
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2004-2013 Mellanox Technologies LTD. All rights reserved.
+ *
+ * This software is available to you under the terms of the
+ * OpenIB.org BSD license included below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif              /* HAVE_CONFIG_H */
+
+#include <string.h>
+#include <inttypes.h>
+#include "ssa_path_record_hist.h"
+
+/*
+ * Lower bound of a bucket
+ */
+static uint64_t hist_bucket_low(unsigned int bucket)
+{
+	unsigned int shift = 0;
+
+	if(bucket < SSA_PR_HIST_SUB_COUNT)
+		return bucket;
+
+	shift = bucket / SSA_PR_HIST_SUB_COUNT - 1;
+	return (uint64_t)(SSA_PR_HIST_SUB_COUNT + bucket % SSA_PR_HIST_SUB_COUNT) << shift;
+}
+
+/*
+ * Upper bound of a bucket, inclusive
+ */
+static uint64_t hist_bucket_high(unsigned int bucket)
+{
+	if(bucket < SSA_PR_HIST_SUB_COUNT)
+		return bucket;
+
+	return hist_bucket_low(bucket) + (1ULL << (bucket / SSA_PR_HIST_SUB_COUNT - 1)) - 1;
+}
+
+void ssa_pr_hist_reset(struct ssa_pr_hist *p_hist)
+{
+	memset(p_hist,'\0',sizeof(*p_hist));
+}
+
+void ssa_pr_hist_merge(struct ssa_pr_hist *p_hist,
+		const struct ssa_pr_hist *p_src)
+{
+	unsigned int i = 0;
+
+	if(!p_src->count)
+		return;
+
+	if(!p_hist->count || p_src->min < p_hist->min)
+		p_hist->min = p_src->min;
+	if(p_src->max > p_hist->max)
+		p_hist->max = p_src->max;
+	p_hist->count += p_src->count;
+	p_hist->sum += p_src->sum;
+
+	for(i = 0; i < SSA_PR_HIST_BUCKETS; ++i)
+		p_hist->buckets[i] += p_src->buckets[i];
+}
+
+uint64_t ssa_pr_hist_quantile(const struct ssa_pr_hist *p_hist,
+		double quantile)
+{
+	uint64_t rank = 0, seen = 0;
+	unsigned int i = 0;
+
+	if(!p_hist->count)
+		return 0;
+
+	if(quantile <= 0)
+		return p_hist->min;
+	if(quantile >= 1)
+		return p_hist->max;
+
+	/*
+	 * Rank of the quantile is in range [1, count]
+	 */
+	rank = (uint64_t)(quantile * p_hist->count);
+	if(rank < quantile * p_hist->count)
+		rank++;
+	if(!rank)
+		rank = 1;
+
+	for(i = 0; i < SSA_PR_HIST_BUCKETS; ++i) {
+		seen += p_hist->buckets[i];
+		if(seen >= rank) {
+			const uint64_t high = hist_bucket_high(i);
+			return high < p_hist->max ? high : p_hist->max;
+		}
+	}
+
+	return p_hist->max;
+}
+
+void ssa_pr_hist_dump(const struct ssa_pr_hist *p_hist, FILE *fd)
+{
+	uint64_t seen = 0;
+	unsigned int i = 0;
+
+	for(i = 0; i < SSA_PR_HIST_BUCKETS; ++i) {
+		if(!p_hist->buckets[i])
+			continue;
+		seen += p_hist->buckets[i];
+		fprintf(fd,"%12"PRIu64" %12"PRIu64" %10"PRIu64" %8.4f%%\n",
+				hist_bucket_low(i),hist_bucket_high(i),p_hist->buckets[i],
+				100.0 * seen / p_hist->count);
+	}
+}
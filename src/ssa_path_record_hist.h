@@ -0,0 +1,131 @@
+/*
+ * Copyright 2004-2013 Mellanox Technologies LTD. All rights reserved.
+ *
+ * This software is available to you under the terms of the
+ * OpenIB.org BSD license included below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#ifndef SSA_PATH_RECORD_HIST_H
+#define SSA_PATH_RECORD_HIST_H
+
+/*
+ * Internal API for latency histograms.
+ *
+ * Buckets are log-linear: every power of two range of values is split
+ * into SSA_PR_HIST_SUB_COUNT linear sub-buckets. Values below
+ * SSA_PR_HIST_SUB_COUNT have a bucket each. Relative error of a
+ * quantile is at most 1 / SSA_PR_HIST_SUB_COUNT.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define SSA_PR_HIST_SUB_BITS 5
+#define SSA_PR_HIST_SUB_COUNT (1 << SSA_PR_HIST_SUB_BITS)
+#define SSA_PR_HIST_BUCKETS ((64 - SSA_PR_HIST_SUB_BITS + 1) * SSA_PR_HIST_SUB_COUNT)
+
+/*
+ *@count - number of recorded values.
+ *@min, max - the smallest and the largest recorded value.
+ *@sum - sum of recorded values.
+ *@buckets - number of values per bucket.
+ */
+struct ssa_pr_hist {
+	uint64_t count;
+	uint64_t min;
+	uint64_t max;
+	uint64_t sum;
+	uint64_t buckets[SSA_PR_HIST_BUCKETS];
+};
+
+/**
+ * ssa_pr_hist_bucket - bucket of a value
+ * @value: Value
+ **/
+static inline unsigned int ssa_pr_hist_bucket(uint64_t value)
+{
+	unsigned int shift = 0;
+
+	if(value < SSA_PR_HIST_SUB_COUNT)
+		return value;
+
+	shift = 63 - __builtin_clzll(value) - SSA_PR_HIST_SUB_BITS;
+	return (shift + 1) * SSA_PR_HIST_SUB_COUNT +
+		(value >> shift) - SSA_PR_HIST_SUB_COUNT;
+}
+
+/**
+ * ssa_pr_hist_record - records a value
+ * @p_hist: Pointer to a histogram
+ * @value: Value
+ **/
+static inline void ssa_pr_hist_record(struct ssa_pr_hist *p_hist, uint64_t value)
+{
+	if(!p_hist->count || value < p_hist->min)
+		p_hist->min = value;
+	if(value > p_hist->max)
+		p_hist->max = value;
+	p_hist->count++;
+	p_hist->sum += value;
+	p_hist->buckets[ssa_pr_hist_bucket(value)]++;
+}
+
+/**
+ * ssa_pr_hist_reset - removes all values
+ * @p_hist: Pointer to a histogram
+ **/
+extern void ssa_pr_hist_reset(struct ssa_pr_hist *p_hist);
+
+/**
+ * ssa_pr_hist_merge - adds values of one histogram to another one
+ * @p_hist: Pointer to a destination histogram
+ * @p_src: Pointer to a source histogram
+ **/
+extern void ssa_pr_hist_merge(struct ssa_pr_hist *p_hist,
+		const struct ssa_pr_hist *p_src);
+
+/**
+ * ssa_pr_hist_quantile - value at a quantile
+ * @p_hist: Pointer to a histogram
+ * @quantile: Quantile in range [0, 1]
+ *
+ * @return value: upper bound of the bucket that holds the quantile,
+ *                but not more than the largest recorded value.
+ *                0 - the histogram is empty.
+ **/
+extern uint64_t ssa_pr_hist_quantile(const struct ssa_pr_hist *p_hist,
+		double quantile);
+
+/**
+ * ssa_pr_hist_dump - prints non empty buckets
+ * @p_hist: Pointer to a histogram
+ * @fd: Output file
+ *
+ * Every line is: bucket lower bound, upper bound, count and cumulative
+ * percentage.
+ **/
+extern void ssa_pr_hist_dump(const struct ssa_pr_hist *p_hist, FILE *fd);
+
+#endif /* end of include guard: SSA_PATH_RECORD_HIST_H */
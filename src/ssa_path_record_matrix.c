@@ -0,0 +1,387 @@
+/*
+ * Copyright 2004-2013 Mellanox Technologies LTD. All rights reserved.
+ *
+ * This software is available to you under the terms of the
+ * OpenIB.org BSD license included below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif              /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <infiniband/ssa_db.h>
+#include <infiniband/ssa_smdb.h>
+#include <infiniband/ssa_path_record.h>
+#include <infiniband/ssa_path_record_ext.h>
+#include "ssa_path_record_helper.h"
+
+#define SSA_PR_MATRIX_MAX_CODES 256
+#define SSA_PR_MATRIX_DICT_BITS 9
+
+/*
+ * Attributes of a code. Packed into a dictionary key by matrix_attr_key.
+ * Hops aren't kept: almost every pair of distances and other attributes
+ * would need its own code, as PRDB records the matrix has no hops.
+ */
+struct ssa_pr_matrix_attr {
+	uint8_t mtu;
+	uint8_t rate;
+	uint8_t pkt_life;
+	uint8_t reversible;
+	uint8_t sl;
+	uint16_t pkey;
+};
+
+/*
+ *@count - number of ports N. Port ID is its position in
+ *         SSA_TABLE_ID_GUID_TO_LID table.
+ *@p_guids - ID to GUID.
+ *@p_lids - ID to base LID, network order.
+ *@p_row_offsets - offsets of source rows in p_codes.
+ *@p_codes - attribute codes. Index: p_row_offsets[source ID] + destination ID.
+ *@p_lid_ids - LID to ID. Index: LID in host order, up to max_lid.
+ *@p_guid_hash - open addressing hash table with linear probing. Values are
+ *               IDs, SSA_PR_MATRIX_NO_ID - empty slot.
+ *@attrs - code to attributes. Code SSA_PR_MATRIX_NO_PATH is not used.
+ *@attr_keys - dictionary keys of codes.
+ *@dict - dictionary hash table, values are codes. SSA_PR_MATRIX_NO_PATH -
+ *        empty slot.
+ *@overflow - more than SSA_PR_MATRIX_MAX_CODES - 1 distinct attributes.
+ */
+struct ssa_pr_matrix {
+	uint32_t count;
+	be64_t *p_guids;
+	be16_t *p_lids;
+	uint64_t *p_row_offsets;
+	uint8_t *p_codes;
+	uint32_t *p_lid_ids;
+	uint16_t max_lid;
+	uint32_t *p_guid_hash;
+	unsigned int guid_hash_bits;
+	struct ssa_pr_matrix_attr attrs[SSA_PR_MATRIX_MAX_CODES];
+	unsigned int attr_count;
+	uint64_t attr_keys[SSA_PR_MATRIX_MAX_CODES];
+	uint8_t dict[1 << SSA_PR_MATRIX_DICT_BITS];
+	int overflow;
+};
+
+static inline size_t matrix_hash(const uint64_t key, unsigned int bits)
+{
+	return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> (64 - bits));
+}
+
+static inline uint64_t matrix_attr_key(const ssa_path_parms_t *p_path_prm)
+{
+	return (uint64_t)p_path_prm->mtu | (uint64_t)p_path_prm->rate << 8 |
+		(uint64_t)p_path_prm->pkt_life << 16 |
+		(uint64_t)(p_path_prm->reversible ? 1 : 0) << 32 |
+		(uint64_t)p_path_prm->sl << 40 | (uint64_t)p_path_prm->pkey << 48;
+}
+
+/*
+ * matrix_attr_code - returns the code of path attributes, a new code is
+ * assigned on first appearance. SSA_PR_MATRIX_NO_PATH - too many codes.
+ */
+static uint8_t matrix_attr_code(struct ssa_pr_matrix *p_matrix,
+		const ssa_path_parms_t *p_path_prm)
+{
+	const uint64_t key = matrix_attr_key(p_path_prm);
+	const size_t mask = (1 << SSA_PR_MATRIX_DICT_BITS) - 1;
+	struct ssa_pr_matrix_attr *p_attr = NULL;
+	size_t slot = 0;
+
+	for(slot = matrix_hash(key,SSA_PR_MATRIX_DICT_BITS);
+			SSA_PR_MATRIX_NO_PATH != p_matrix->dict[slot];
+			slot = (slot + 1) & mask) {
+		if(key == p_matrix->attr_keys[p_matrix->dict[slot]])
+			return p_matrix->dict[slot];
+	}
+
+	if(SSA_PR_MATRIX_MAX_CODES == p_matrix->attr_count) {
+		p_matrix->overflow = 1;
+		return SSA_PR_MATRIX_NO_PATH;
+	}
+
+	p_attr = p_matrix->attrs + p_matrix->attr_count;
+	p_attr->mtu = p_path_prm->mtu;
+	p_attr->rate = p_path_prm->rate;
+	p_attr->pkt_life = p_path_prm->pkt_life;
+	p_attr->reversible = p_path_prm->reversible ? 1 : 0;
+	p_attr->sl = p_path_prm->sl;
+	p_attr->pkey = p_path_prm->pkey;
+	p_matrix->attr_keys[p_matrix->attr_count] = key;
+	p_matrix->dict[slot] = p_matrix->attr_count;
+
+	return p_matrix->attr_count++;
+}
+
+static void matrix_path_collect(const ssa_path_parms_t *p_path_prm, void *prm)
+{
+	struct ssa_pr_matrix *p_matrix = (struct ssa_pr_matrix *)prm;
+	const uint16_t from_lid = ntohs(p_path_prm->from_lid);
+	const uint16_t to_lid = ntohs(p_path_prm->to_lid);
+	uint32_t source_id = SSA_PR_MATRIX_NO_ID, dest_id = SSA_PR_MATRIX_NO_ID;
+
+	if(from_lid <= p_matrix->max_lid)
+		source_id = p_matrix->p_lid_ids[from_lid];
+	if(to_lid <= p_matrix->max_lid)
+		dest_id = p_matrix->p_lid_ids[to_lid];
+	if(SSA_PR_MATRIX_NO_ID == source_id || SSA_PR_MATRIX_NO_ID == dest_id)
+		return;
+
+	p_matrix->p_codes[p_matrix->p_row_offsets[source_id] + dest_id] =
+		matrix_attr_code(p_matrix,p_path_prm);
+}
+
+/*
+ * matrix_ports_init - assigns IDs to ports and builds LID and GUID lookups
+ */
+static int matrix_ports_init(struct ssa_pr_matrix *p_matrix,
+		const struct ssa_db *p_ssa_db_smdb)
+{
+	const struct ep_guid_to_lid_tbl_rec *p_guid_to_lid_tbl =
+		(const struct ep_guid_to_lid_tbl_rec *)p_ssa_db_smdb->pp_tables[SSA_TABLE_ID_GUID_TO_LID];
+	size_t size = 0, mask = 0, slot = 0;
+	uint32_t i = 0, last_lid = 0, lid = 0;
+
+	for(i = 0; i < p_matrix->count; ++i) {
+		last_lid = ntohs(p_guid_to_lid_tbl[i].lid) + (1 << p_guid_to_lid_tbl[i].lmc) - 1;
+		if(last_lid > 0xFFFF) {
+			SSA_PR_LOG_ERROR("Invalid LID range. GUID: 0x%016"PRIx64,
+					ntohll(p_guid_to_lid_tbl[i].guid));
+			return -1;
+		}
+		if(last_lid > p_matrix->max_lid)
+			p_matrix->max_lid = last_lid;
+	}
+
+	p_matrix->guid_hash_bits = 1;
+	while(((size_t)1 << p_matrix->guid_hash_bits) < 2 * (size_t)p_matrix->count)
+		p_matrix->guid_hash_bits++;
+	size = (size_t)1 << p_matrix->guid_hash_bits;
+	mask = size - 1;
+
+	/* One spare entry, so an empty smdb doesn't need malloc(0) */
+	p_matrix->p_guids = (be64_t *)malloc((p_matrix->count + 1) * sizeof(*p_matrix->p_guids));
+	p_matrix->p_lids = (be16_t *)malloc((p_matrix->count + 1) * sizeof(*p_matrix->p_lids));
+	p_matrix->p_lid_ids = (uint32_t *)malloc((p_matrix->max_lid + 1) * sizeof(*p_matrix->p_lid_ids));
+	p_matrix->p_guid_hash = (uint32_t *)malloc(size * sizeof(*p_matrix->p_guid_hash));
+	if(!p_matrix->p_guids || !p_matrix->p_lids || !p_matrix->p_lid_ids ||
+			!p_matrix->p_guid_hash) {
+		SSA_PR_LOG_ERROR("Cannot allocate path matrix ports. Ports: %"PRIu32,p_matrix->count);
+		return -1;
+	}
+	memset(p_matrix->p_lid_ids,0xFF,(p_matrix->max_lid + 1) * sizeof(*p_matrix->p_lid_ids));
+	memset(p_matrix->p_guid_hash,0xFF,size * sizeof(*p_matrix->p_guid_hash));
+
+	for(i = 0; i < p_matrix->count; ++i) {
+		const struct ep_guid_to_lid_tbl_rec *p_rec = p_guid_to_lid_tbl + i;
+
+		p_matrix->p_guids[i] = p_rec->guid;
+		p_matrix->p_lids[i] = p_rec->lid;
+
+		last_lid = ntohs(p_rec->lid) + (1 << p_rec->lmc) - 1;
+		for(lid = ntohs(p_rec->lid); lid <= last_lid; ++lid)
+			p_matrix->p_lid_ids[lid] = i;
+
+		for(slot = matrix_hash(p_rec->guid,p_matrix->guid_hash_bits);
+				SSA_PR_MATRIX_NO_ID != p_matrix->p_guid_hash[slot];
+				slot = (slot + 1) & mask)
+			;
+		p_matrix->p_guid_hash[slot] = i;
+	}
+
+	return 0;
+}
+
+struct ssa_pr_matrix *ssa_pr_matrix_create(struct ssa_db *p_ssa_db_smdb,
+		void *context,
+		unsigned int threads_num)
+{
+	struct ssa_pr_matrix *p_matrix = NULL;
+	ssa_pr_status_t res = SSA_PR_SUCCESS;
+	uint64_t count = 0;
+	uint32_t i = 0;
+
+	SSA_ASSERT(p_ssa_db_smdb);
+	SSA_ASSERT(context);
+
+	count = ntohll(p_ssa_db_smdb->p_db_tables[SSA_TABLE_ID_GUID_TO_LID].set_count);
+	if(count >= SSA_PR_MATRIX_NO_ID) {
+		SSA_PR_LOG_ERROR("Too many ports for path matrix. Ports: %"PRIu64,count);
+		return NULL;
+	}
+
+	p_matrix = (struct ssa_pr_matrix *)calloc(1,sizeof(*p_matrix));
+	if(!p_matrix) {
+		SSA_PR_LOG_ERROR("Cannot allocate path matrix");
+		return NULL;
+	}
+	p_matrix->count = count;
+
+	if(matrix_ports_init(p_matrix,p_ssa_db_smdb))
+		goto Error;
+
+	p_matrix->p_row_offsets = (uint64_t *)malloc((count + 1) * sizeof(*p_matrix->p_row_offsets));
+	p_matrix->p_codes = (uint8_t *)calloc(count * count + 1,sizeof(*p_matrix->p_codes));
+	if(!p_matrix->p_row_offsets || !p_matrix->p_codes) {
+		SSA_PR_LOG_ERROR("Cannot allocate path matrix. Ports: %"PRIu64,count);
+		goto Error;
+	}
+	for(i = 0; i <= count; ++i)
+		p_matrix->p_row_offsets[i] = (uint64_t)i * count;
+
+	/* Code 0 is reserved for pairs without a path */
+	p_matrix->attr_count = 1;
+
+	if(1 == threads_num)
+		res = ssa_pr_whole_world(p_ssa_db_smdb,context,matrix_path_collect,p_matrix);
+	else
+		res = ssa_pr_whole_world_mt(p_ssa_db_smdb,context,threads_num,0,
+				matrix_path_collect,p_matrix);
+	if(SSA_PR_ERROR == res) {
+		SSA_PR_LOG_ERROR("\"Whole world\" calculation for path matrix is failed");
+		goto Error;
+	}
+	if(p_matrix->overflow) {
+		SSA_PR_LOG_ERROR("Too many distinct path attributes for path matrix. Maximum: %d",
+				SSA_PR_MATRIX_MAX_CODES - 1);
+		goto Error;
+	}
+
+	return p_matrix;
+Error:
+	ssa_pr_matrix_destroy(p_matrix);
+	return NULL;
+}
+
+void ssa_pr_matrix_destroy(struct ssa_pr_matrix *p_matrix)
+{
+	if(!p_matrix)
+		return;
+
+	free(p_matrix->p_guids);
+	free(p_matrix->p_lids);
+	free(p_matrix->p_row_offsets);
+	free(p_matrix->p_codes);
+	free(p_matrix->p_lid_ids);
+	free(p_matrix->p_guid_hash);
+	free(p_matrix);
+}
+
+uint32_t ssa_pr_matrix_size(const struct ssa_pr_matrix *p_matrix)
+{
+	SSA_ASSERT(p_matrix);
+
+	return p_matrix->count;
+}
+
+size_t ssa_pr_matrix_memory(const struct ssa_pr_matrix *p_matrix)
+{
+	SSA_ASSERT(p_matrix);
+
+	return sizeof(*p_matrix) +
+		(size_t)p_matrix->count * p_matrix->count * sizeof(*p_matrix->p_codes) +
+		p_matrix->count * (sizeof(*p_matrix->p_guids) + sizeof(*p_matrix->p_lids) +
+				sizeof(*p_matrix->p_row_offsets)) +
+		(p_matrix->max_lid + 1) * sizeof(*p_matrix->p_lid_ids) +
+		((size_t)1 << p_matrix->guid_hash_bits) * sizeof(*p_matrix->p_guid_hash);
+}
+
+uint32_t ssa_pr_matrix_id_by_lid(const struct ssa_pr_matrix *p_matrix,
+		be16_t lid)
+{
+	const uint16_t host_lid = ntohs(lid);
+
+	SSA_ASSERT(p_matrix);
+
+	return host_lid <= p_matrix->max_lid ? p_matrix->p_lid_ids[host_lid] :
+		SSA_PR_MATRIX_NO_ID;
+}
+
+uint32_t ssa_pr_matrix_id_by_guid(const struct ssa_pr_matrix *p_matrix,
+		be64_t guid)
+{
+	const size_t mask = ((size_t)1 << p_matrix->guid_hash_bits) - 1;
+	size_t slot = 0;
+
+	SSA_ASSERT(p_matrix);
+
+	for(slot = matrix_hash(guid,p_matrix->guid_hash_bits);
+			SSA_PR_MATRIX_NO_ID != p_matrix->p_guid_hash[slot];
+			slot = (slot + 1) & mask) {
+		if(guid == p_matrix->p_guids[p_matrix->p_guid_hash[slot]])
+			return p_matrix->p_guid_hash[slot];
+	}
+
+	return SSA_PR_MATRIX_NO_ID;
+}
+
+const uint8_t *ssa_pr_matrix_row(const struct ssa_pr_matrix *p_matrix,
+		uint32_t source_id)
+{
+	SSA_ASSERT(p_matrix);
+	SSA_ASSERT(source_id < p_matrix->count);
+
+	return p_matrix->p_codes + p_matrix->p_row_offsets[source_id];
+}
+
+ssa_pr_status_t ssa_pr_matrix_path(const struct ssa_pr_matrix *p_matrix,
+		uint32_t source_id,
+		uint32_t dest_id,
+		ssa_path_parms_t *p_path_prm)
+{
+	const struct ssa_pr_matrix_attr *p_attr = NULL;
+	uint8_t code = SSA_PR_MATRIX_NO_PATH;
+
+	SSA_ASSERT(p_matrix);
+	SSA_ASSERT(p_path_prm);
+
+	if(source_id >= p_matrix->count || dest_id >= p_matrix->count)
+		return SSA_PR_ERROR;
+
+	code = p_matrix->p_codes[p_matrix->p_row_offsets[source_id] + dest_id];
+	if(SSA_PR_MATRIX_NO_PATH == code)
+		return SSA_PR_NO_PATH;
+
+	p_attr = p_matrix->attrs + code;
+	memset(p_path_prm,'\0',sizeof(*p_path_prm));
+	p_path_prm->from_guid = p_matrix->p_guids[source_id];
+	p_path_prm->from_lid = p_matrix->p_lids[source_id];
+	p_path_prm->to_guid = p_matrix->p_guids[dest_id];
+	p_path_prm->to_lid = p_matrix->p_lids[dest_id];
+	p_path_prm->mtu = p_attr->mtu;
+	p_path_prm->rate = p_attr->rate;
+	p_path_prm->pkt_life = p_attr->pkt_life;
+	p_path_prm->reversible = p_attr->reversible;
+	p_path_prm->sl = p_attr->sl;
+	p_path_prm->pkey = p_attr->pkey;
+
+	return SSA_PR_SUCCESS;
+}
@@ -0,0 +1,195 @@
+/*
+ * Copyright 2004-2013 Mellanox Technologies LTD. All rights reserved.
+ *
+ * This software is available to you under the terms of the
+ * OpenIB.org BSD license included below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif              /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <infiniband/ssa_db.h>
+#include <infiniband/ssa_smdb.h>
+#include <infiniband/ssa_path_record.h>
+#include "ssa_path_record_helper.h"
+#include "ssa_path_record_query.h"
+
+static inline struct ssa_pr_query_entry *query_cache_set(const struct ssa_pr_query_cache *p_cache,
+		uint32_t key)
+{
+	/* Multiplicative hash: sources and destinations are dense LIDs */
+	const uint32_t set = (key * 2654435761U) >> (32 - SSA_PR_QUERY_CACHE_SET_BITS);
+
+	return p_cache->p_entries + set * SSA_PR_QUERY_CACHE_WAYS;
+}
+
+void ssa_pr_query_cache_init(struct ssa_pr_query_cache *p_cache)
+{
+	int i = 0;
+
+	SSA_ASSERT(p_cache);
+
+	memset(p_cache,'\0',sizeof(*p_cache));
+	for(i = 0; i < SSA_PR_QUERY_DP_TABLES; ++i)
+		ssa_pr_dp_init(&p_cache->dp[i].dp);
+}
+
+void ssa_pr_query_cache_destroy(struct ssa_pr_query_cache *p_cache)
+{
+	int i = 0;
+
+	if(!p_cache)
+		return;
+
+	for(i = 0; i < SSA_PR_QUERY_DP_TABLES; ++i)
+		ssa_pr_dp_destroy(&p_cache->dp[i].dp);
+	free(p_cache->p_entries);
+	ssa_pr_query_cache_init(p_cache);
+}
+
+int ssa_pr_query_cache_validate(struct ssa_pr_query_cache *p_cache,
+		const struct ssa_db *p_smdb,
+		const struct ssa_pr_smdb_index *p_index)
+{
+	int i = 0;
+
+	SSA_ASSERT(p_cache);
+	SSA_ASSERT(p_smdb);
+	SSA_ASSERT(p_index);
+
+	if(!p_cache->p_entries) {
+		p_cache->p_entries = (struct ssa_pr_query_entry *)
+			calloc(SSA_PR_QUERY_CACHE_SIZE,sizeof(*p_cache->p_entries));
+		if(!p_cache->p_entries) {
+			SSA_PR_LOG_ERROR("Cannot allocate path query cache. Entries: %d",
+					SSA_PR_QUERY_CACHE_SIZE);
+			return -1;
+		}
+		p_cache->epoch = 0;
+	}
+
+	if(p_cache->epoch && p_cache->p_smdb == p_smdb &&
+			!memcmp(p_cache->table_epochs,p_index->table_epochs,
+				sizeof(p_cache->table_epochs)))
+		return 0;
+
+	p_cache->p_smdb = p_smdb;
+	memcpy(p_cache->table_epochs,p_index->table_epochs,sizeof(p_cache->table_epochs));
+
+	/*
+	 * Entries of all previous epochs become invalid. After a wrap around
+	 * they could match again, so they are cleaned explicitly.
+	 */
+	if(!++p_cache->epoch) {
+		memset(p_cache->p_entries,'\0',
+				SSA_PR_QUERY_CACHE_SIZE * sizeof(*p_cache->p_entries));
+		for(i = 0; i < SSA_PR_QUERY_DP_TABLES; ++i)
+			p_cache->dp[i].epoch = 0;
+		p_cache->epoch = 1;
+	}
+
+	SSA_PR_LOG_DEBUG("Path query cache is invalidated. epoch: %"PRIu32,p_cache->epoch);
+	return 0;
+}
+
+const struct ssa_pr_query_entry *ssa_pr_query_cache_lookup(struct ssa_pr_query_cache *p_cache,
+		uint32_t key)
+{
+	struct ssa_pr_query_entry *p_set = NULL;
+	struct ssa_pr_query_entry entry;
+	int i = 0;
+
+	SSA_ASSERT(p_cache);
+	SSA_ASSERT(p_cache->p_entries);
+
+	p_set = query_cache_set(p_cache,key);
+	for(i = 0; i < SSA_PR_QUERY_CACHE_WAYS; ++i) {
+		if(p_set[i].epoch != p_cache->epoch)
+			break;
+		if(p_set[i].key != key)
+			continue;
+
+		if(i) {
+			entry = p_set[i];
+			memmove(p_set + 1,p_set,i * sizeof(*p_set));
+			p_set[0] = entry;
+		}
+		return p_set;
+	}
+
+	return NULL;
+}
+
+void ssa_pr_query_cache_insert(struct ssa_pr_query_cache *p_cache,
+		const struct ssa_pr_query_entry *p_entry)
+{
+	struct ssa_pr_query_entry *p_set = NULL;
+
+	SSA_ASSERT(p_cache);
+	SSA_ASSERT(p_cache->p_entries);
+	SSA_ASSERT(p_entry);
+
+	p_set = query_cache_set(p_cache,p_entry->key);
+	memmove(p_set + 1,p_set,(SSA_PR_QUERY_CACHE_WAYS - 1) * sizeof(*p_set));
+	p_set[0] = *p_entry;
+	p_set[0].epoch = p_cache->epoch;
+}
+
+struct ssa_pr_dp_table *ssa_pr_query_cache_dp(struct ssa_pr_query_cache *p_cache,
+		const struct ssa_db *p_smdb,
+		const struct ssa_pr_smdb_index *p_index,
+		const struct ep_guid_to_lid_tbl_rec *p_dest_rec)
+{
+	struct ssa_pr_query_dp *p_lru = NULL;
+	int i = 0;
+
+	SSA_ASSERT(p_cache);
+	SSA_ASSERT(p_dest_rec);
+
+	for(i = 0; i < SSA_PR_QUERY_DP_TABLES; ++i) {
+		struct ssa_pr_query_dp *p_dp = p_cache->dp + i;
+
+		if(p_dp->epoch == p_cache->epoch && p_dp->dp.p_dest_rec == p_dest_rec) {
+			p_dp->last_use = ++p_cache->clock;
+			return &p_dp->dp;
+		}
+		if(!p_lru || p_dp->epoch != p_cache->epoch ||
+				(p_lru->epoch == p_cache->epoch && p_dp->last_use < p_lru->last_use))
+			p_lru = p_dp;
+	}
+
+	if(ssa_pr_dp_set_destination(&p_lru->dp,p_smdb,p_index,p_dest_rec)) {
+		p_lru->epoch = 0;
+		return NULL;
+	}
+	p_lru->epoch = p_cache->epoch;
+	p_lru->last_use = ++p_cache->clock;
+	return &p_lru->dp;
+}
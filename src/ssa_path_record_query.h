@@ -0,0 +1,177 @@
+/*
+ * Copyright 2004-2013 Mellanox Technologies LTD. All rights reserved.
+ *
+ * This software is available to you under the terms of the
+ * OpenIB.org BSD license included below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#ifndef SSA_PATH_RECORD_QUERY_H
+#define SSA_PATH_RECORD_QUERY_H
+
+/*
+ * Internal API for the single pair query cache.
+ *
+ * Path parameters depend only on the pair of ports: routing uses base
+ * LIDs. The cache keeps recent pairs in a set associative table keyed by
+ * (source base LID, destination base LID) and recent switch suffix tables
+ * of the destination rooted engine. Every entry is tagged with the cache
+ * epoch. The epoch is changed when the smdb index is changed, so the whole
+ * cache is invalidated in O(1).
+ */
+
+#include "ssa_path_record_dp.h"
+
+#define SSA_PR_QUERY_CACHE_SET_BITS 10
+#define SSA_PR_QUERY_CACHE_WAYS 4
+#define SSA_PR_QUERY_CACHE_SIZE \
+	((1 << SSA_PR_QUERY_CACHE_SET_BITS) * SSA_PR_QUERY_CACHE_WAYS)
+/*
+ * Number of cached suffix tables. Every table is rooted at a destination.
+ */
+#define SSA_PR_QUERY_DP_TABLES 8
+
+/*
+ *@key - source base LID << 16 | destination base LID, host order.
+ *@epoch - the entry is valid only if equals to the cache's epoch.
+ *@status - status of the forward path.
+ *@reversible - the reverse path exists.
+ *@mtu, rate, pkt_life, hops - path parameters.
+ */
+struct ssa_pr_query_entry {
+	uint32_t key;
+	uint32_t epoch;
+	uint8_t status;
+	uint8_t reversible;
+	uint8_t mtu;
+	uint8_t rate;
+	uint8_t pkt_life;
+	uint8_t hops;
+};
+
+/*
+ *@epoch - the table is valid only if equals to the cache's epoch.
+ *@last_use - value of the cache's clock at the last use.
+ */
+struct ssa_pr_query_dp {
+	struct ssa_pr_dp_table dp;
+	uint32_t epoch;
+	uint64_t last_use;
+};
+
+/*
+ *@p_entries - SSA_PR_QUERY_CACHE_SIZE entries. Ways of a set are ordered
+ *             from the most to the least recently used. It's allocated by
+ *             the first query.
+ *@epoch - current epoch. 0 - nothing is cached.
+ *@p_smdb, table_epochs - smdb and index state the cache was filled for.
+ *@dp - suffix tables, least recently used one is replaced.
+ *@clock - number of suffix table uses.
+ */
+struct ssa_pr_query_cache {
+	struct ssa_pr_query_entry *p_entries;
+	uint32_t epoch;
+	const struct ssa_db *p_smdb;
+	uint64_t table_epochs[SSA_PR_INDEX_TABLE_NUM];
+	struct ssa_pr_query_dp dp[SSA_PR_QUERY_DP_TABLES];
+	uint64_t clock;
+};
+
+/**
+ * ssa_pr_query_cache_init - initializes an empty cache
+ * @p_cache: Pointer to a cache
+ **/
+extern void ssa_pr_query_cache_init(struct ssa_pr_query_cache *p_cache);
+
+/**
+ * ssa_pr_query_cache_destroy - deallocates all resources of a cache
+ * @p_cache: Pointer to a cache
+ **/
+extern void ssa_pr_query_cache_destroy(struct ssa_pr_query_cache *p_cache);
+
+/**
+ * ssa_pr_query_cache_validate - checks that a cache matches an index
+ * @p_cache: Pointer to a cache
+ * @p_smdb: Pointer to smdb database
+ * @p_index: Pointer to an up to date smdb index of the database
+ *
+ * @return value: 0 - success; otherwise - the cache can't be allocated
+ *
+ * All entries and suffix tables are invalidated if the database or
+ * epochs of index tables are changed since the last call.
+ **/
+extern int ssa_pr_query_cache_validate(struct ssa_pr_query_cache *p_cache,
+		const struct ssa_db *p_smdb,
+		const struct ssa_pr_smdb_index *p_index);
+
+/**
+ * ssa_pr_query_cache_key - cache key of a pair
+ * @p_source_rec: Source's record in SSA_TABLE_ID_GUID_TO_LID
+ * @p_dest_rec: Destination's record in SSA_TABLE_ID_GUID_TO_LID
+ **/
+static inline uint32_t ssa_pr_query_cache_key(const struct ep_guid_to_lid_tbl_rec *p_source_rec,
+		const struct ep_guid_to_lid_tbl_rec *p_dest_rec)
+{
+	return (uint32_t)ntohs(p_source_rec->lid) << 16 | ntohs(p_dest_rec->lid);
+}
+
+/**
+ * ssa_pr_query_cache_lookup - finds a pair
+ * @p_cache: Pointer to a validated cache
+ * @key: Key of the pair
+ *
+ * @return value: pointer to the entry or NULL. The entry becomes the most
+ *                recently used one of its set.
+ **/
+extern const struct ssa_pr_query_entry *ssa_pr_query_cache_lookup(struct ssa_pr_query_cache *p_cache,
+		uint32_t key);
+
+/**
+ * ssa_pr_query_cache_insert - inserts a pair
+ * @p_cache: Pointer to a validated cache
+ * @p_entry: Entry. The epoch is set by the function.
+ *
+ * The least recently used entry of the set is replaced.
+ **/
+extern void ssa_pr_query_cache_insert(struct ssa_pr_query_cache *p_cache,
+		const struct ssa_pr_query_entry *p_entry);
+
+/**
+ * ssa_pr_query_cache_dp - returns a suffix table rooted at a destination
+ * @p_cache: Pointer to a validated cache
+ * @p_smdb: Pointer to smdb database
+ * @p_index: Pointer to a smdb index
+ * @p_dest_rec: Destination's record in SSA_TABLE_ID_GUID_TO_LID
+ *
+ * @return value: pointer to the table or NULL if it can't be prepared.
+ *
+ * Suffixes computed by previous queries to the same destination are
+ * reused.
+ **/
+extern struct ssa_pr_dp_table *ssa_pr_query_cache_dp(struct ssa_pr_query_cache *p_cache,
+		const struct ssa_db *p_smdb,
+		const struct ssa_pr_smdb_index *p_index,
+		const struct ep_guid_to_lid_tbl_rec *p_dest_rec);
+
+#endif /* end of include guard: SSA_PATH_RECORD_QUERY_H */
@@ -32,9 +32,15 @@
  */
 
 
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
 #include <ssa_db.h>
 #include <ssa_prdb.h>
+#include <ssa_smdb.h>
 #include <asm/byteorder.h>
+#include <infiniband/ssa_path_record_ext.h>
+#include "ssa_path_record_helper.h"
 
 static const struct db_table_def def_tbl[] = {
 	{ DBT_DEF_VERSION, sizeof(struct db_table_def), DBT_TYPE_DATA, 0, { 0,SSA_PR_TABLE_ID, 0 },
@@ -65,6 +71,76 @@ static const struct db_field_def field_tbl[] = {
 	{ DB_VERSION_INVALID }
 };
 
+static const struct db_table_def compact_def_tbl[] = {
+	{ DBT_DEF_VERSION, sizeof(struct db_table_def), DBT_TYPE_DATA, 0, { 0, SSA_PR_COMPACT_ATTR_TABLE_ID, 0 },
+		"PR attributes", __constant_htonl(sizeof(struct ep_pr_attr_tbl_rec)), 0 },
+	{ DBT_DEF_VERSION, sizeof(struct db_table_def), DBT_TYPE_DATA, 0, { 0, SSA_PR_COMPACT_REC_TABLE_ID, 0 },
+		"PR compact", __constant_htonl(sizeof(struct ep_pr_compact_tbl_rec)), 0 },
+	{ DBT_DEF_VERSION, sizeof(struct db_table_def), DBT_TYPE_DEF, 0, { 0, SSA_PR_COMPACT_ATTR_TABLE_ID_FIELD_DEF, 0 },
+		"PR attributes fields", __constant_htonl(sizeof(struct db_field_def)), __constant_htonl(SSA_PR_COMPACT_ATTR_TABLE_ID) },
+	{ DBT_DEF_VERSION, sizeof(struct db_table_def), DBT_TYPE_DEF, 0, { 0, SSA_PR_COMPACT_REC_TABLE_ID_FIELD_DEF, 0 },
+		"PR compact fields", __constant_htonl(sizeof(struct db_field_def)), __constant_htonl(SSA_PR_COMPACT_REC_TABLE_ID) },
+	{ DB_VERSION_INVALID }
+};
+
+static const struct db_dataset compact_dataset_tbl[] = {
+	{ DB_DS_VERSION, sizeof(struct db_dataset), 0, 0, { 0, SSA_PR_COMPACT_ATTR_TABLE_ID, 0 }, 0, 0, 0, 0 },
+	{ DB_DS_VERSION, sizeof(struct db_dataset), 0, 0, { 0, SSA_PR_COMPACT_REC_TABLE_ID, 0 }, 0, 0, 0, 0 },
+	{ DB_VERSION_INVALID }
+};
+
+static const struct db_dataset compact_field_dataset_tbl[] = {
+	{ DB_DS_VERSION, sizeof(struct db_dataset), 0, 0, { 0, SSA_PR_COMPACT_ATTR_TABLE_ID_FIELD_DEF, 0 }, 0, 0, 0, 0 },
+	{ DB_DS_VERSION, sizeof(struct db_dataset), 0, 0, { 0, SSA_PR_COMPACT_REC_TABLE_ID_FIELD_DEF, 0 }, 0, 0, 0, 0 },
+	{ DB_VERSION_INVALID }
+};
+
+static const struct db_field_def compact_field_tbl[] = {
+	{ DBF_DEF_VERSION, 0, DBF_TYPE_NET16, 0, { 0, SSA_PR_COMPACT_ATTR_TABLE_ID_FIELD_DEF, SSA_PR_COMPACT_FIELD_ID_ATTR_PK }, "pk", __constant_htonl(16), 0 },
+	{ DBF_DEF_VERSION, 0, DBF_TYPE_U8, 0, { 0, SSA_PR_COMPACT_ATTR_TABLE_ID_FIELD_DEF, SSA_PR_COMPACT_FIELD_ID_ATTR_MTU }, "mtu", __constant_htonl(8), __constant_htonl(16) },
+	{ DBF_DEF_VERSION, 0, DBF_TYPE_U8, 0, { 0, SSA_PR_COMPACT_ATTR_TABLE_ID_FIELD_DEF, SSA_PR_COMPACT_FIELD_ID_ATTR_RATE }, "rate", __constant_htonl(8), __constant_htonl(24) },
+	{ DBF_DEF_VERSION, 0, DBF_TYPE_U8, 0, { 0, SSA_PR_COMPACT_ATTR_TABLE_ID_FIELD_DEF, SSA_PR_COMPACT_FIELD_ID_ATTR_SL }, "sl", __constant_htonl(8), __constant_htonl(32) },
+	{ DBF_DEF_VERSION, 0, DBF_TYPE_U8, 0, { 0, SSA_PR_COMPACT_ATTR_TABLE_ID_FIELD_DEF, SSA_PR_COMPACT_FIELD_ID_ATTR_REVERSIBLE }, "is_reversible", __constant_htonl(8), __constant_htonl(40) },
+	{ DBF_DEF_VERSION, 0, DBF_TYPE_NET16, 0, { 0, SSA_PR_COMPACT_REC_TABLE_ID_FIELD_DEF, SSA_PR_COMPACT_FIELD_ID_REC_DLID }, "lid", __constant_htonl(16), 0 },
+	{ DBF_DEF_VERSION, 0, DBF_TYPE_NET16, 0, { 0, SSA_PR_COMPACT_REC_TABLE_ID_FIELD_DEF, SSA_PR_COMPACT_FIELD_ID_REC_ATTR }, "attr", __constant_htonl(16), __constant_htonl(16) },
+	{ DB_VERSION_INVALID }
+};
+
+static const struct db_table_def range_def_tbl[] = {
+	{ DBT_DEF_VERSION, sizeof(struct db_table_def), DBT_TYPE_DATA, 0, { 0, SSA_PR_RANGE_TABLE_ID, 0 },
+		"PR range", __constant_htonl(sizeof(struct ep_pr_range_tbl_rec)), 0 },
+	{ DBT_DEF_VERSION, sizeof(struct db_table_def), DBT_TYPE_DEF, 0, { 0, SSA_PR_RANGE_TABLE_ID_FIELD_DEF, 0 },
+		"PR range fields", __constant_htonl(sizeof(struct db_field_def)), __constant_htonl(SSA_PR_RANGE_TABLE_ID) },
+	{ DB_VERSION_INVALID }
+};
+
+static const struct db_dataset range_dataset_tbl[] = {
+	{ DB_DS_VERSION, sizeof(struct db_dataset), 0, 0, { 0, SSA_PR_RANGE_TABLE_ID, 0 }, 0, 0, 0, 0 },
+	{ DB_VERSION_INVALID }
+};
+
+static const struct db_dataset range_field_dataset_tbl[] = {
+	{ DB_DS_VERSION, sizeof(struct db_dataset), 0, 0, { 0, SSA_PR_RANGE_TABLE_ID_FIELD_DEF, 0 }, 0, 0, 0, 0 },
+	{ DB_VERSION_INVALID }
+};
+
+static const struct db_field_def range_field_tbl[] = {
+	{ DBF_DEF_VERSION, 0, DBF_TYPE_NET64, 0, { 0, SSA_PR_RANGE_TABLE_ID_FIELD_DEF, SSA_PR_RANGE_FIELD_ID_DGUID }, "guid", __constant_htonl(64), 0 },
+	{ DBF_DEF_VERSION, 0, DBF_TYPE_NET16, 0, { 0, SSA_PR_RANGE_TABLE_ID_FIELD_DEF, SSA_PR_RANGE_FIELD_ID_DLID }, "lid", __constant_htonl(16), __constant_htonl(64) },
+	{ DBF_DEF_VERSION, 0, DBF_TYPE_NET16, 0, { 0, SSA_PR_RANGE_TABLE_ID_FIELD_DEF, SSA_PR_RANGE_FIELD_ID_PK }, "pk", __constant_htonl(16), __constant_htonl(80) },
+	{ DBF_DEF_VERSION, 0, DBF_TYPE_U8, 0, { 0, SSA_PR_RANGE_TABLE_ID_FIELD_DEF, SSA_PR_RANGE_FIELD_ID_MTU }, "mtu", __constant_htonl(8), __constant_htonl(96) },
+	{ DBF_DEF_VERSION, 0, DBF_TYPE_U8, 0, { 0, SSA_PR_RANGE_TABLE_ID_FIELD_DEF, SSA_PR_RANGE_FIELD_ID_RATE }, "rate", __constant_htonl(8), __constant_htonl(104) },
+	{ DBF_DEF_VERSION, 0, DBF_TYPE_U8, 0, { 0, SSA_PR_RANGE_TABLE_ID_FIELD_DEF, SSA_PR_RANGE_FIELD_ID_SL }, "sl", __constant_htonl(8), __constant_htonl(112) },
+	{ DBF_DEF_VERSION, 0, DBF_TYPE_U8, 0, { 0, SSA_PR_RANGE_TABLE_ID_FIELD_DEF, SSA_PR_RANGE_FIELD_ID_RANGE }, "range", __constant_htonl(8), __constant_htonl(120) },
+	{ DB_VERSION_INVALID }
+};
+
+/*
+ * Dictionary codes are 16 bit
+ */
+#define SSA_PR_COMPACT_MAX_ATTRS 0x10000
+#define SSA_PR_COMPACT_NO_ATTR 0xFFFFFFFF
+
 
 /** =========================================================================
  */
@@ -88,3 +164,408 @@ struct ssa_db  *ssa_prdb_create(uint64_t num_recs)
 	return p_ssa_db;
 }
 
+/** =========================================================================
+ */
+uint64_t ssa_prdb_insert_batch(struct ssa_db *p_prdb, uint64_t capacity,
+			       const ssa_path_parms_t *p_paths, size_t count)
+{
+	struct db_dataset *p_dataset = p_prdb->p_db_tables + SSA_PR_TABLE_ID;
+	struct ep_pr_tbl_rec *p_rec = NULL;
+	uint64_t set_count = ntohll(p_dataset->set_count);
+	uint64_t i;
+
+	if (set_count >= capacity)
+		return 0;
+	if (count > capacity - set_count)
+		count = capacity - set_count;
+
+	p_rec = (struct ep_pr_tbl_rec *)p_prdb->pp_tables[SSA_PR_TABLE_ID] + set_count;
+	for (i = 0; i < count; i++, p_rec++) {
+		p_rec->guid = p_paths[i].to_guid;
+		p_rec->lid = p_paths[i].to_lid;
+		p_rec->pk = p_paths[i].pkey;
+		p_rec->mtu = p_paths[i].mtu;
+		p_rec->rate = p_paths[i].rate;
+		p_rec->sl = p_paths[i].sl;
+		p_rec->is_reversible = p_paths[i].reversible;
+	}
+
+	set_count += count;
+	p_dataset->set_count = htonll(set_count);
+	p_dataset->set_size = htonll(set_count * sizeof(struct ep_pr_tbl_rec));
+
+	return count;
+}
+
+/** =========================================================================
+ */
+static inline uint64_t compact_attr_key(const struct ep_pr_tbl_rec *p_rec)
+{
+	return ((uint64_t)p_rec->pk << 32) | ((uint64_t)p_rec->mtu << 24) |
+		((uint64_t)p_rec->rate << 16) | ((uint64_t)p_rec->sl << 8) |
+		p_rec->is_reversible;
+}
+
+static inline size_t compact_attr_hash(const uint64_t key, unsigned int bits)
+{
+	return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> (64 - bits));
+}
+
+/*
+ * Assigns a dictionary code to every record. Codes are given in order of
+ * first appearance. Returns the number of distinct attributes or 0 if
+ * there are too many of them.
+ */
+static uint32_t compact_build_dict(const struct ep_pr_tbl_rec *p_recs,
+				   uint64_t count, uint64_t *p_keys,
+				   uint16_t *p_codes)
+{
+	uint32_t *p_hash = NULL;
+	unsigned int bits = 8;
+	uint32_t attr_count = 0;
+	uint64_t i, key;
+	size_t slot, mask;
+
+	while (bits < 17 && ((uint64_t)1 << bits) < 2 * count)
+		bits++;
+	mask = ((size_t)1 << bits) - 1;
+
+	p_hash = (uint32_t *)malloc((mask + 1) * sizeof(*p_hash));
+	if (!p_hash) {
+		SSA_PR_LOG_ERROR("Cannot allocate compact PRDB dictionary");
+		return 0;
+	}
+	memset(p_hash, 0xFF, (mask + 1) * sizeof(*p_hash));
+
+	for (i = 0; i < count; i++) {
+		key = compact_attr_key(p_recs + i);
+		slot = compact_attr_hash(key, bits);
+		while (p_hash[slot] != SSA_PR_COMPACT_NO_ATTR &&
+		       p_keys[p_hash[slot]] != key)
+			slot = (slot + 1) & mask;
+
+		if (p_hash[slot] == SSA_PR_COMPACT_NO_ATTR) {
+			if (attr_count == SSA_PR_COMPACT_MAX_ATTRS) {
+				SSA_PR_LOG_ERROR("Too many distinct path attributes for compact PRDB");
+				attr_count = 0;
+				break;
+			}
+			p_keys[attr_count] = key;
+			p_hash[slot] = attr_count++;
+		}
+		p_codes[i] = p_hash[slot];
+	}
+
+	free(p_hash);
+	return attr_count;
+}
+
+struct ssa_db *ssa_prdb_compact_create(const struct ssa_db *p_prdb)
+{
+	struct ssa_db *p_compact = NULL;
+	const struct ep_pr_tbl_rec *p_recs = NULL;
+	struct ep_pr_attr_tbl_rec *p_attr = NULL;
+	struct ep_pr_compact_tbl_rec *p_rec = NULL;
+	uint64_t num_recs_arr[SSA_PR_COMPACT_TABLE_ID_MAX] = {};
+	uint64_t num_field_recs_arr[SSA_PR_COMPACT_TABLE_ID_MAX] = {};
+	size_t recs_size_arr[SSA_PR_COMPACT_TABLE_ID_MAX] = {};
+	uint64_t *p_keys = NULL;
+	uint16_t *p_codes = NULL;
+	uint64_t count, i;
+	uint32_t attr_count;
+
+	SSA_ASSERT(p_prdb);
+
+	p_recs = (const struct ep_pr_tbl_rec *)p_prdb->pp_tables[SSA_PR_TABLE_ID];
+	count = ntohll(p_prdb->p_db_tables[SSA_PR_TABLE_ID].set_count);
+
+	/* One spare entry, so an empty PRDB doesn't need malloc(0) */
+	p_keys = (uint64_t *)malloc((count < SSA_PR_COMPACT_MAX_ATTRS ?
+				     count + 1 : SSA_PR_COMPACT_MAX_ATTRS) * sizeof(*p_keys));
+	p_codes = (uint16_t *)malloc((count + 1) * sizeof(*p_codes));
+	if (!p_keys || !p_codes) {
+		SSA_PR_LOG_ERROR("Cannot allocate compact PRDB. Records: %"PRIu64, count);
+		goto Exit;
+	}
+
+	attr_count = compact_build_dict(p_recs, count, p_keys, p_codes);
+	if (count && !attr_count)
+		goto Exit;
+
+	num_recs_arr[SSA_PR_COMPACT_ATTR_TABLE_ID] = attr_count;
+	recs_size_arr[SSA_PR_COMPACT_ATTR_TABLE_ID] = sizeof(struct ep_pr_attr_tbl_rec);
+	num_field_recs_arr[SSA_PR_COMPACT_ATTR_TABLE_ID] = SSA_PR_COMPACT_ATTR_FIELDS_ID_MAX;
+	num_recs_arr[SSA_PR_COMPACT_REC_TABLE_ID] = count;
+	recs_size_arr[SSA_PR_COMPACT_REC_TABLE_ID] = sizeof(struct ep_pr_compact_tbl_rec);
+	num_field_recs_arr[SSA_PR_COMPACT_REC_TABLE_ID] = SSA_PR_COMPACT_REC_FIELDS_ID_MAX;
+
+	p_compact = ssa_db_create(num_recs_arr, recs_size_arr, num_field_recs_arr,
+				  SSA_PR_COMPACT_TABLE_ID_MAX);
+	if (!p_compact) {
+		SSA_PR_LOG_ERROR("Cannot allocate compact PRDB. Records: %"PRIu64, count);
+		goto Exit;
+	}
+
+	ssa_db_init(p_compact, "PRDB compact", 11 /*just some db_id */, compact_def_tbl,
+		    compact_dataset_tbl, compact_field_dataset_tbl, compact_field_tbl);
+
+	p_attr = (struct ep_pr_attr_tbl_rec *)p_compact->pp_tables[SSA_PR_COMPACT_ATTR_TABLE_ID];
+	for (i = 0; i < attr_count; i++, p_attr++) {
+		memset(p_attr, 0, sizeof(*p_attr));
+		p_attr->pk = (be16_t)(p_keys[i] >> 32);
+		p_attr->mtu = (uint8_t)(p_keys[i] >> 24);
+		p_attr->rate = (uint8_t)(p_keys[i] >> 16);
+		p_attr->sl = (uint8_t)(p_keys[i] >> 8);
+		p_attr->is_reversible = (uint8_t)p_keys[i];
+	}
+
+	p_rec = (struct ep_pr_compact_tbl_rec *)p_compact->pp_tables[SSA_PR_COMPACT_REC_TABLE_ID];
+	for (i = 0; i < count; i++, p_rec++) {
+		p_rec->lid = p_recs[i].lid;
+		p_rec->attr = htons(p_codes[i]);
+	}
+
+	p_compact->p_db_tables[SSA_PR_COMPACT_ATTR_TABLE_ID].set_count = htonll(attr_count);
+	p_compact->p_db_tables[SSA_PR_COMPACT_ATTR_TABLE_ID].set_size =
+		htonll(attr_count * sizeof(struct ep_pr_attr_tbl_rec));
+	p_compact->p_db_tables[SSA_PR_COMPACT_REC_TABLE_ID].set_count = htonll(count);
+	p_compact->p_db_tables[SSA_PR_COMPACT_REC_TABLE_ID].set_size =
+		htonll(count * sizeof(struct ep_pr_compact_tbl_rec));
+
+Exit:
+	free(p_keys);
+	free(p_codes);
+	return p_compact;
+}
+
+/** =========================================================================
+ */
+static int compact_lid_cmp(const void *p1, const void *p2)
+{
+	const uint64_t key1 = *(const uint64_t *)p1;
+	const uint64_t key2 = *(const uint64_t *)p2;
+
+	return key1 < key2 ? -1 : key1 > key2;
+}
+
+/*
+ * Finds a GUID to LID record by any LID of the port's LMC range.
+ * p_lids are sorted keys: base LID in the upper 32 bits, index of
+ * the GUID to LID record in the lower.
+ */
+static const struct ep_guid_to_lid_tbl_rec *
+compact_find_port(const struct ep_guid_to_lid_tbl_rec *p_ports,
+		  const uint64_t *p_lids, uint64_t count, uint16_t lid)
+{
+	const struct ep_guid_to_lid_tbl_rec *p_port = NULL;
+	uint64_t low = 0, high = count, mid;
+	uint16_t base;
+
+	/* The first key with base LID above lid */
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if ((p_lids[mid] >> 32) <= lid)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	if (!low)
+		return NULL;
+
+	p_port = p_ports + (uint32_t)p_lids[low - 1];
+	base = (uint16_t)(p_lids[low - 1] >> 32);
+	return lid - base < (1 << p_port->lmc) ? p_port : NULL;
+}
+
+struct ssa_db *ssa_prdb_compact_expand(const struct ssa_db *p_compact,
+				       const struct ssa_db *p_smdb)
+{
+	struct ssa_db *p_prdb = NULL;
+	const struct ep_pr_attr_tbl_rec *p_attrs = NULL;
+	const struct ep_pr_compact_tbl_rec *p_recs = NULL;
+	const struct ep_guid_to_lid_tbl_rec *p_ports = NULL;
+	const struct ep_guid_to_lid_tbl_rec *p_port = NULL;
+	struct ep_pr_tbl_rec *p_rec = NULL;
+	uint64_t *p_lids = NULL;
+	uint64_t count, attr_count, port_count, i;
+	uint16_t lid, attr;
+
+	SSA_ASSERT(p_compact);
+	SSA_ASSERT(p_smdb);
+
+	p_attrs = (const struct ep_pr_attr_tbl_rec *)p_compact->pp_tables[SSA_PR_COMPACT_ATTR_TABLE_ID];
+	p_recs = (const struct ep_pr_compact_tbl_rec *)p_compact->pp_tables[SSA_PR_COMPACT_REC_TABLE_ID];
+	attr_count = ntohll(p_compact->p_db_tables[SSA_PR_COMPACT_ATTR_TABLE_ID].set_count);
+	count = ntohll(p_compact->p_db_tables[SSA_PR_COMPACT_REC_TABLE_ID].set_count);
+	p_ports = (const struct ep_guid_to_lid_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_GUID_TO_LID];
+	port_count = ntohll(p_smdb->p_db_tables[SSA_TABLE_ID_GUID_TO_LID].set_count);
+
+	p_lids = (uint64_t *)malloc((port_count + 1) * sizeof(*p_lids));
+	if (!p_lids) {
+		SSA_PR_LOG_ERROR("Cannot allocate LID table. Ports: %"PRIu64, port_count);
+		return NULL;
+	}
+	for (i = 0; i < port_count; i++)
+		p_lids[i] = ((uint64_t)ntohs(p_ports[i].lid) << 32) | i;
+	qsort(p_lids, port_count, sizeof(*p_lids), compact_lid_cmp);
+
+	p_prdb = ssa_prdb_create(count);
+	if (!p_prdb) {
+		SSA_PR_LOG_ERROR("Cannot allocate PRDB. Records: %"PRIu64, count);
+		goto Exit;
+	}
+
+	p_rec = (struct ep_pr_tbl_rec *)p_prdb->pp_tables[SSA_PR_TABLE_ID];
+	for (i = 0; i < count; i++, p_rec++) {
+		lid = ntohs(p_recs[i].lid);
+		attr = ntohs(p_recs[i].attr);
+
+		/* Records of a port are usually adjacent */
+		if (!p_port || (uint16_t)(lid - ntohs(p_port->lid)) >= (1 << p_port->lmc))
+			p_port = compact_find_port(p_ports, p_lids, port_count, lid);
+		if (!p_port || attr >= attr_count) {
+			SSA_PR_LOG_ERROR("Invalid compact PRDB record. LID: 0x%"SCNx16" attributes: %u",
+					 lid, attr);
+			ssa_db_destroy(p_prdb);
+			p_prdb = NULL;
+			goto Exit;
+		}
+
+		p_rec->guid = p_port->guid;
+		p_rec->lid = p_recs[i].lid;
+		p_rec->pk = p_attrs[attr].pk;
+		p_rec->mtu = p_attrs[attr].mtu;
+		p_rec->rate = p_attrs[attr].rate;
+		p_rec->sl = p_attrs[attr].sl;
+		p_rec->is_reversible = p_attrs[attr].is_reversible;
+	}
+
+	p_prdb->p_db_tables[SSA_PR_TABLE_ID].set_count = htonll(count);
+	p_prdb->p_db_tables[SSA_PR_TABLE_ID].set_size =
+		htonll(count * sizeof(struct ep_pr_tbl_rec));
+
+Exit:
+	free(p_lids);
+	return p_prdb;
+}
+
+/** =========================================================================
+ */
+struct ssa_db *ssa_prdb_range_create(uint64_t num_recs)
+{
+	struct ssa_db *p_ssa_db = NULL;
+	uint64_t num_recs_arr[SSA_PR_RANGE_TABLE_ID_MAX] = {};
+	uint64_t num_field_recs_arr[SSA_PR_RANGE_TABLE_ID_MAX] = {};
+	size_t recs_size_arr[SSA_PR_RANGE_TABLE_ID_MAX] = {};
+
+	num_recs_arr[SSA_PR_RANGE_TABLE_ID] = num_recs;
+	recs_size_arr[SSA_PR_RANGE_TABLE_ID] = sizeof(struct ep_pr_range_tbl_rec);
+	num_field_recs_arr[SSA_PR_RANGE_TABLE_ID] = SSA_PR_RANGE_FIELDS_ID_MAX;
+
+	p_ssa_db = ssa_db_create(num_recs_arr, recs_size_arr, num_field_recs_arr,
+				 SSA_PR_RANGE_TABLE_ID_MAX);
+	if (!p_ssa_db)
+		return NULL;
+
+	ssa_db_init(p_ssa_db, "PRDB range", 12 /*just some db_id */, range_def_tbl,
+		    range_dataset_tbl, range_field_dataset_tbl, range_field_tbl);
+
+	return p_ssa_db;
+}
+
+/** =========================================================================
+ */
+static inline int range_extends(const struct ep_pr_range_tbl_rec *p_rec,
+				const ssa_path_parms_t *p_path)
+{
+	const uint8_t reversible = p_path->reversible ? SSA_PR_RANGE_REVERSIBLE : 0;
+	const unsigned int lid_count = ssa_prdb_range_lid_count(p_rec);
+
+	return lid_count < SSA_PR_RANGE_MAX_LIDS &&
+		p_rec->guid == p_path->to_guid &&
+		(uint16_t)(ntohs(p_rec->lid) + lid_count) == ntohs(p_path->to_lid) &&
+		p_rec->pk == p_path->pkey && p_rec->mtu == p_path->mtu &&
+		p_rec->rate == p_path->rate && p_rec->sl == p_path->sl &&
+		(p_rec->range & SSA_PR_RANGE_REVERSIBLE) == reversible;
+}
+
+uint64_t ssa_prdb_range_insert_batch(struct ssa_db *p_prdb, uint64_t capacity,
+				     const ssa_path_parms_t *p_paths, size_t count)
+{
+	struct db_dataset *p_dataset = p_prdb->p_db_tables + SSA_PR_RANGE_TABLE_ID;
+	struct ep_pr_range_tbl_rec *p_recs = NULL;
+	struct ep_pr_range_tbl_rec *p_rec = NULL;
+	uint64_t set_count = ntohll(p_dataset->set_count);
+	uint64_t i;
+
+	p_recs = (struct ep_pr_range_tbl_rec *)p_prdb->pp_tables[SSA_PR_RANGE_TABLE_ID];
+	p_rec = set_count ? p_recs + set_count - 1 : NULL;
+
+	for (i = 0; i < count; i++) {
+		if (p_rec && range_extends(p_rec, p_paths + i)) {
+			p_rec->range++;
+			continue;
+		}
+		if (set_count >= capacity)
+			break;
+
+		p_rec = p_recs + set_count++;
+		p_rec->guid = p_paths[i].to_guid;
+		p_rec->lid = p_paths[i].to_lid;
+		p_rec->pk = p_paths[i].pkey;
+		p_rec->mtu = p_paths[i].mtu;
+		p_rec->rate = p_paths[i].rate;
+		p_rec->sl = p_paths[i].sl;
+		p_rec->range = p_paths[i].reversible ? SSA_PR_RANGE_REVERSIBLE : 0;
+	}
+
+	p_dataset->set_count = htonll(set_count);
+	p_dataset->set_size = htonll(set_count * sizeof(struct ep_pr_range_tbl_rec));
+
+	return i;
+}
+
+/** =========================================================================
+ */
+struct ssa_db *ssa_prdb_range_expand(const struct ssa_db *p_range)
+{
+	struct ssa_db *p_prdb = NULL;
+	const struct ep_pr_range_tbl_rec *p_recs = NULL;
+	struct ep_pr_tbl_rec *p_rec = NULL;
+	uint64_t range_count, count = 0, i;
+	unsigned int lid_count, j;
+
+	SSA_ASSERT(p_range);
+
+	p_recs = (const struct ep_pr_range_tbl_rec *)p_range->pp_tables[SSA_PR_RANGE_TABLE_ID];
+	range_count = ntohll(p_range->p_db_tables[SSA_PR_RANGE_TABLE_ID].set_count);
+
+	for (i = 0; i < range_count; i++)
+		count += ssa_prdb_range_lid_count(p_recs + i);
+
+	p_prdb = ssa_prdb_create(count);
+	if (!p_prdb) {
+		SSA_PR_LOG_ERROR("Cannot allocate PRDB. Records: %"PRIu64, count);
+		return NULL;
+	}
+
+	p_rec = (struct ep_pr_tbl_rec *)p_prdb->pp_tables[SSA_PR_TABLE_ID];
+	for (i = 0; i < range_count; i++) {
+		lid_count = ssa_prdb_range_lid_count(p_recs + i);
+		for (j = 0; j < lid_count; j++, p_rec++) {
+			p_rec->guid = p_recs[i].guid;
+			p_rec->lid = htons(ntohs(p_recs[i].lid) + j);
+			p_rec->pk = p_recs[i].pk;
+			p_rec->mtu = p_recs[i].mtu;
+			p_rec->rate = p_recs[i].rate;
+			p_rec->sl = p_recs[i].sl;
+			p_rec->is_reversible = ssa_prdb_range_is_reversible(p_recs + i);
+		}
+	}
+
+	p_prdb->p_db_tables[SSA_PR_TABLE_ID].set_count = htonll(count);
+	p_prdb->p_db_tables[SSA_PR_TABLE_ID].set_size =
+		htonll(count * sizeof(struct ep_pr_tbl_rec));
+
+	return p_prdb;
+}
@@ -0,0 +1,396 @@
+/*
+ * Copyright 2004-2013 Mellanox Technologies LTD. All rights reserved.
+ *
+ * This software is available to you under the terms of the
+ * OpenIB.org BSD license included below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif              /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <linux/limits.h>
+#include <infiniband/ssa_db.h>
+#include <infiniband/ssa_prdb.h>
+#include <infiniband/ssa_path_record.h>
+#include <infiniband/ssa_path_record_ext.h>
+#include "ssa_path_record_helper.h"
+
+/*
+ * Binary PRDB file:
+ *
+ *   struct prdb_file_header            table_def - descriptor of table definitions
+ *   struct db_dataset[dataset_count]   field definitions of every table
+ *   struct db_dataset[dataset_count]   records of every table
+ *   table definitions, aligned to PRDB_FILE_ALIGN
+ *   field definitions of table 0, aligned to PRDB_FILE_ALIGN
+ *   ...
+ *   records of table 0, aligned to PRDB_FILE_ALIGN
+ *   ...
+ *
+ * set_offset of every dataset descriptor is a file offset of its data.
+ * Integers of the header and of dataset descriptors are in network order,
+ * definitions and records are stored as they are in memory. A mapped file
+ * is used in place: nothing is copied or parsed.
+ */
+#define PRDB_FILE_MAGIC "SSAPRDB"
+#define PRDB_FILE_VERSION 2
+#define PRDB_FILE_ALIGN 64
+
+struct prdb_file_header {
+	char magic[8];
+	be32_t version;
+	be32_t header_size;
+	be64_t file_size;
+	be32_t dataset_count;
+	be32_t record_size;
+	struct db_def db_def;
+	struct db_dataset table_def;
+};
+
+/*
+ * A mapped PRDB. The ssa_db is a view of the mapping.
+ *
+ *@db - returned to the user. It must be the first member.
+ *@p_addr, size - the mapping.
+ */
+struct prdb_file_map {
+	struct ssa_db db;
+	void *p_addr;
+	size_t size;
+};
+
+static inline uint64_t prdb_file_align(uint64_t offset)
+{
+	return (offset + PRDB_FILE_ALIGN - 1) & ~(uint64_t)(PRDB_FILE_ALIGN - 1);
+}
+
+static int prdb_file_pad(FILE *fd, uint64_t *p_offset)
+{
+	static const char zeros[PRDB_FILE_ALIGN];
+	const uint64_t aligned = prdb_file_align(*p_offset);
+
+	if(aligned != *p_offset && 1 != fwrite(zeros,aligned - *p_offset,1,fd))
+		return -1;
+	*p_offset = aligned;
+	return 0;
+}
+
+/*
+ * prdb_file_put_dataset - writes a dataset descriptor
+ *
+ * The descriptor points to *p_data_offset, which is moved past its data.
+ */
+static int prdb_file_put_dataset(FILE *fd, const struct db_dataset *p_dataset,
+		uint64_t *p_data_offset)
+{
+	struct db_dataset dataset = *p_dataset;
+
+	dataset.set_offset = htonll(*p_data_offset);
+	*p_data_offset = prdb_file_align(*p_data_offset + ntohll(dataset.set_size));
+	return 1 == fwrite(&dataset,sizeof(dataset),1,fd) ? 0 : -1;
+}
+
+/*
+ * prdb_file_put_data - writes data of a dataset at the next aligned offset
+ */
+static int prdb_file_put_data(FILE *fd, const struct db_dataset *p_dataset,
+		const void *p_data, uint64_t *p_offset)
+{
+	const uint64_t size = ntohll(p_dataset->set_size);
+
+	if(prdb_file_pad(fd,p_offset))
+		return -1;
+	if(size && 1 != fwrite(p_data,size,1,fd))
+		return -1;
+	*p_offset += size;
+	return 0;
+}
+
+int ssa_prdb_save_file(const struct ssa_db *p_prdb, const char *path)
+{
+	struct prdb_file_header header;
+	char tmp_path[PATH_MAX];
+	FILE *fd = NULL;
+	uint64_t offset = 0, data_offset = 0, i = 0;
+
+	SSA_ASSERT(p_prdb);
+	SSA_ASSERT(path);
+
+	if(p_prdb->data_tbl_cnt <= SSA_PR_TABLE_ID || !p_prdb->p_def_tbl ||
+			!p_prdb->p_db_field_tables || !p_prdb->pp_field_tables) {
+		SSA_PR_LOG_ERROR("Invalid PRDB. Tables: %"PRIu64,p_prdb->data_tbl_cnt);
+		return -1;
+	}
+
+	/*
+	 * The file is written under a temporary name and renamed, so readers
+	 * never map a partially written file.
+	 */
+	if(snprintf(tmp_path,sizeof(tmp_path),"%s.tmp",path) >= (int)sizeof(tmp_path)) {
+		SSA_PR_LOG_ERROR("PRDB file path is too long: %s",path);
+		return -1;
+	}
+
+	fd = fopen(tmp_path,"w");
+	if(!fd) {
+		SSA_PR_LOG_ERROR("Can't open PRDB file for writing: %s (%s)",tmp_path,strerror(errno));
+		return -1;
+	}
+
+	/* Layout: data offsets and the file size are known in advance */
+	data_offset = prdb_file_align(sizeof(header) +
+			2 * p_prdb->data_tbl_cnt * sizeof(struct db_dataset));
+	offset = prdb_file_align(data_offset + ntohll(p_prdb->db_table_def.set_size));
+	for(i = 0; i < p_prdb->data_tbl_cnt; ++i)
+		offset = prdb_file_align(offset + ntohll(p_prdb->p_db_field_tables[i].set_size));
+	for(i = 0; i < p_prdb->data_tbl_cnt; ++i)
+		offset = prdb_file_align(offset + ntohll(p_prdb->p_db_tables[i].set_size));
+
+	memset(&header,'\0',sizeof(header));
+	memcpy(header.magic,PRDB_FILE_MAGIC,sizeof(PRDB_FILE_MAGIC));
+	header.version = htonl(PRDB_FILE_VERSION);
+	header.header_size = htonl(sizeof(header));
+	header.file_size = htonll(offset);
+	header.dataset_count = htonl(p_prdb->data_tbl_cnt);
+	header.record_size = htonl(sizeof(struct ep_pr_tbl_rec));
+	header.db_def = p_prdb->db_def;
+	header.table_def = p_prdb->db_table_def;
+	header.table_def.set_offset = htonll(data_offset);
+
+	if(1 != fwrite(&header,sizeof(header),1,fd))
+		goto Error;
+
+	/* Descriptors are in the same order as data */
+	offset = prdb_file_align(data_offset + ntohll(p_prdb->db_table_def.set_size));
+	for(i = 0; i < p_prdb->data_tbl_cnt; ++i)
+		if(prdb_file_put_dataset(fd,p_prdb->p_db_field_tables + i,&offset))
+			goto Error;
+	for(i = 0; i < p_prdb->data_tbl_cnt; ++i)
+		if(prdb_file_put_dataset(fd,p_prdb->p_db_tables + i,&offset))
+			goto Error;
+
+	offset = sizeof(header) + 2 * p_prdb->data_tbl_cnt * sizeof(struct db_dataset);
+	if(prdb_file_put_data(fd,&p_prdb->db_table_def,p_prdb->p_def_tbl,&offset))
+		goto Error;
+	for(i = 0; i < p_prdb->data_tbl_cnt; ++i)
+		if(prdb_file_put_data(fd,p_prdb->p_db_field_tables + i,
+					p_prdb->pp_field_tables[i],&offset))
+			goto Error;
+	for(i = 0; i < p_prdb->data_tbl_cnt; ++i)
+		if(prdb_file_put_data(fd,p_prdb->p_db_tables + i,p_prdb->pp_tables[i],&offset))
+			goto Error;
+	if(prdb_file_pad(fd,&offset))
+		goto Error;
+
+	if(fclose(fd)) {
+		fd = NULL;
+		goto Error;
+	}
+	fd = NULL;
+
+	if(rename(tmp_path,path)) {
+		SSA_PR_LOG_ERROR("Can't rename PRDB file %s to %s (%s)",tmp_path,path,strerror(errno));
+		unlink(tmp_path);
+		return -1;
+	}
+
+	return 0;
+Error:
+	SSA_PR_LOG_ERROR("Can't write PRDB file: %s (%s)",tmp_path,strerror(errno));
+	if(fd)
+		fclose(fd);
+	unlink(tmp_path);
+	return -1;
+}
+
+/*
+ * prdb_file_check_dataset - validates a dataset descriptor of a mapped file
+ *
+ * record_size is 0 if the size of records isn't fixed.
+ */
+static int prdb_file_check_dataset(const struct db_dataset *p_dataset,
+		size_t size, size_t record_size)
+{
+	const uint64_t offset = ntohll(p_dataset->set_offset);
+	const uint64_t set_size = ntohll(p_dataset->set_size);
+
+	if(offset % PRDB_FILE_ALIGN || offset > size || set_size > size - offset)
+		return -1;
+	if(record_size && set_size != ntohll(p_dataset->set_count) * record_size)
+		return -1;
+	return 0;
+}
+
+/*
+ * prdb_file_check - validates a mapped file before it's used
+ */
+static int prdb_file_check(const void *p_addr, size_t size, const char *path)
+{
+	const struct prdb_file_header *p_header = (const struct prdb_file_header *)p_addr;
+	const struct db_dataset *p_field_datasets = NULL;
+	const struct db_dataset *p_datasets = NULL;
+	uint64_t count = 0, i = 0;
+
+	if(size < sizeof(*p_header) || memcmp(p_header->magic,PRDB_FILE_MAGIC,sizeof(PRDB_FILE_MAGIC))) {
+		SSA_PR_LOG_ERROR("Not a PRDB file: %s",path);
+		return -1;
+	}
+
+	if(PRDB_FILE_VERSION != ntohl(p_header->version) ||
+			sizeof(*p_header) != ntohl(p_header->header_size) ||
+			sizeof(struct ep_pr_tbl_rec) != ntohl(p_header->record_size)) {
+		SSA_PR_LOG_ERROR("Unsupported PRDB file: %s version: %u record size: %u",
+				path,ntohl(p_header->version),ntohl(p_header->record_size));
+		return -1;
+	}
+
+	count = ntohl(p_header->dataset_count);
+	if(ntohll(p_header->file_size) != size || count <= SSA_PR_TABLE_ID ||
+			count > (size - sizeof(*p_header)) / (2 * sizeof(struct db_dataset))) {
+		SSA_PR_LOG_ERROR("Truncated or corrupted PRDB file: %s",path);
+		return -1;
+	}
+
+	if(prdb_file_check_dataset(&p_header->table_def,size,sizeof(struct db_table_def))) {
+		SSA_PR_LOG_ERROR("Corrupted table definitions of PRDB file: %s",path);
+		return -1;
+	}
+
+	p_field_datasets = (const struct db_dataset *)(p_header + 1);
+	p_datasets = p_field_datasets + count;
+	for(i = 0; i < count; ++i) {
+		if(prdb_file_check_dataset(p_field_datasets + i,size,sizeof(struct db_field_def)) ||
+				prdb_file_check_dataset(p_datasets + i,size,0)) {
+			SSA_PR_LOG_ERROR("Corrupted dataset %"PRIu64" of PRDB file: %s",i,path);
+			return -1;
+		}
+	}
+
+	if(prdb_file_check_dataset(p_datasets + SSA_PR_TABLE_ID,size,sizeof(struct ep_pr_tbl_rec))) {
+		SSA_PR_LOG_ERROR("Corrupted PR table of PRDB file: %s",path);
+		return -1;
+	}
+
+	return 0;
+}
+
+struct ssa_db *ssa_prdb_map_file(const char *path)
+{
+	struct prdb_file_map *p_map = NULL;
+	const struct prdb_file_header *p_header = NULL;
+	struct stat st;
+	void *p_addr = MAP_FAILED;
+	uint64_t i = 0;
+	int fd = -1;
+
+	SSA_ASSERT(path);
+
+	fd = open(path,O_RDONLY);
+	if(fd < 0) {
+		SSA_PR_LOG_ERROR("Can't open PRDB file: %s (%s)",path,strerror(errno));
+		return NULL;
+	}
+
+	if(fstat(fd,&st) || !st.st_size) {
+		SSA_PR_LOG_ERROR("Can't get size of PRDB file: %s",path);
+		goto Error;
+	}
+
+	p_addr = mmap(NULL,st.st_size,PROT_READ,MAP_SHARED,fd,0);
+	if(MAP_FAILED == p_addr) {
+		SSA_PR_LOG_ERROR("Can't map PRDB file: %s (%s)",path,strerror(errno));
+		goto Error;
+	}
+	/* The mapping stays valid after the descriptor is closed */
+	close(fd);
+	fd = -1;
+
+	if(prdb_file_check(p_addr,st.st_size,path))
+		goto Error;
+	p_header = (const struct prdb_file_header *)p_addr;
+
+	p_map = (struct prdb_file_map *)calloc(1,sizeof(*p_map));
+	if(p_map) {
+		p_map->db.pp_tables = (void **)calloc(ntohl(p_header->dataset_count),sizeof(void *));
+		p_map->db.pp_field_tables = (struct db_field_def **)
+			calloc(ntohl(p_header->dataset_count),sizeof(struct db_field_def *));
+	}
+	if(!p_map || !p_map->db.pp_tables || !p_map->db.pp_field_tables) {
+		SSA_PR_LOG_ERROR("Cannot allocate mapped PRDB");
+		goto Error;
+	}
+
+	p_map->p_addr = p_addr;
+	p_map->size = st.st_size;
+	p_map->db.db_def = p_header->db_def;
+	p_map->db.db_table_def = p_header->table_def;
+	p_map->db.p_def_tbl = (struct db_table_def *)
+		((char *)p_addr + ntohll(p_header->table_def.set_offset));
+	p_map->db.data_tbl_cnt = ntohl(p_header->dataset_count);
+	p_map->db.p_db_field_tables = (struct db_dataset *)(p_header + 1);
+	p_map->db.p_db_tables = p_map->db.p_db_field_tables + p_map->db.data_tbl_cnt;
+	for(i = 0; i < p_map->db.data_tbl_cnt; ++i) {
+		p_map->db.pp_field_tables[i] = (struct db_field_def *)
+			((char *)p_addr + ntohll(p_map->db.p_db_field_tables[i].set_offset));
+		p_map->db.pp_tables[i] = (char *)p_addr + ntohll(p_map->db.p_db_tables[i].set_offset);
+	}
+
+	return &p_map->db;
+Error:
+	if(p_map) {
+		free(p_map->db.pp_field_tables);
+		free(p_map->db.pp_tables);
+		free(p_map);
+	}
+	if(MAP_FAILED != p_addr)
+		munmap(p_addr,st.st_size);
+	if(fd >= 0)
+		close(fd);
+	return NULL;
+}
+
+void ssa_prdb_unmap_file(struct ssa_db *p_prdb)
+{
+	struct prdb_file_map *p_map = (struct prdb_file_map *)p_prdb;
+
+	if(!p_map)
+		return;
+
+	munmap(p_map->p_addr,p_map->size);
+	free(p_map->db.pp_field_tables);
+	free(p_map->db.pp_tables);
+	free(p_map);
+}
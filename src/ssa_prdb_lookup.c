@@ -0,0 +1,275 @@
+/*
+ * Copyright 2004-2013 Mellanox Technologies LTD. All rights reserved.
+ *
+ * This software is available to you under the terms of the
+ * OpenIB.org BSD license included below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif              /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <infiniband/ssa_db.h>
+#include <infiniband/ssa_prdb.h>
+#include <infiniband/ssa_path_record.h>
+#include <infiniband/ssa_path_record_ext.h>
+#include "ssa_path_record_helper.h"
+
+/*
+ *@p_recs - records of the PRDB.
+ *@count - number of records.
+ *@p_lids - LIDs of records in host order, sorted. Binary search runs
+ *          over this dense array, records are touched only by matches.
+ *@p_order - p_order[i] is the record of p_lids[i]. Records of the same
+ *           LID keep PRDB order.
+ *@p_guid_hash - open addressing hash table with linear probing. Values
+ *               are positions in p_lids of the first record of a port.
+ *               SSA_PR_PRDB_NO_POS - empty slot.
+ *@guid_hash_bits - size of p_guid_hash is 2^guid_hash_bits.
+ */
+struct ssa_prdb_index {
+	const struct ep_pr_tbl_rec *p_recs;
+	uint32_t count;
+	uint16_t *p_lids;
+	uint32_t *p_order;
+	uint32_t *p_guid_hash;
+	unsigned int guid_hash_bits;
+};
+
+#define SSA_PR_PRDB_NO_POS 0xFFFFFFFF
+
+static inline size_t prdb_guid_hash(const be64_t guid, unsigned int bits)
+{
+	return (size_t)((guid * 0x9E3779B97F4A7C15ULL) >> (64 - bits));
+}
+
+static int prdb_key_cmp(const void *p1, const void *p2)
+{
+	const uint64_t key1 = *(const uint64_t *)p1;
+	const uint64_t key2 = *(const uint64_t *)p2;
+
+	return key1 < key2 ? -1 : key1 > key2;
+}
+
+/*
+ * prdb_index_sort - sorts records by (LID, position in PRDB)
+ */
+static int prdb_index_sort(struct ssa_prdb_index *p_index)
+{
+	uint64_t *p_keys = NULL;
+	uint32_t i = 0;
+
+	p_keys = (uint64_t *)malloc(p_index->count * sizeof(*p_keys));
+	if(!p_keys) {
+		SSA_PR_LOG_ERROR("Cannot allocate PRDB sort keys. Records: %"PRIu32,p_index->count);
+		return -1;
+	}
+
+	for(i = 0; i < p_index->count; ++i)
+		p_keys[i] = (uint64_t)ntohs(p_index->p_recs[i].lid) << 32 | i;
+	qsort(p_keys,p_index->count,sizeof(*p_keys),prdb_key_cmp);
+
+	for(i = 0; i < p_index->count; ++i) {
+		p_index->p_lids[i] = p_keys[i] >> 32;
+		p_index->p_order[i] = p_keys[i] & 0xFFFFFFFF;
+	}
+
+	free(p_keys);
+	return 0;
+}
+
+/*
+ * prdb_index_hash - hashes the first record of every port
+ *
+ * LIDs of a port form an LMC range, so its records are adjacent in
+ * LID order.
+ */
+static int prdb_index_hash(struct ssa_prdb_index *p_index)
+{
+	size_t ports = 0, size = 0, mask = 0, slot = 0;
+	uint32_t i = 0;
+
+	for(i = 0; i < p_index->count; ++i)
+		if(!i || p_index->p_recs[p_index->p_order[i]].guid !=
+				p_index->p_recs[p_index->p_order[i - 1]].guid)
+			ports++;
+
+	p_index->guid_hash_bits = 1;
+	while(((size_t)1 << p_index->guid_hash_bits) < 2 * ports)
+		p_index->guid_hash_bits++;
+	size = (size_t)1 << p_index->guid_hash_bits;
+	mask = size - 1;
+
+	p_index->p_guid_hash = (uint32_t *)malloc(size * sizeof(*p_index->p_guid_hash));
+	if(!p_index->p_guid_hash) {
+		SSA_PR_LOG_ERROR("Cannot allocate PRDB GUID hash table. Size: %zu",size);
+		return -1;
+	}
+	memset(p_index->p_guid_hash,0xFF,size * sizeof(*p_index->p_guid_hash));
+
+	for(i = 0; i < p_index->count; ++i) {
+		const be64_t guid = p_index->p_recs[p_index->p_order[i]].guid;
+
+		if(i && guid == p_index->p_recs[p_index->p_order[i - 1]].guid)
+			continue;
+
+		for(slot = prdb_guid_hash(guid,p_index->guid_hash_bits);
+				SSA_PR_PRDB_NO_POS != p_index->p_guid_hash[slot];
+				slot = (slot + 1) & mask) {
+			if(guid == p_index->p_recs[p_index->p_order[p_index->p_guid_hash[slot]]].guid)
+				break;
+		}
+		if(SSA_PR_PRDB_NO_POS == p_index->p_guid_hash[slot])
+			p_index->p_guid_hash[slot] = i;
+	}
+
+	return 0;
+}
+
+struct ssa_prdb_index *ssa_prdb_index_create(const struct ssa_db *p_prdb)
+{
+	struct ssa_prdb_index *p_index = NULL;
+	uint64_t count = 0;
+
+	SSA_ASSERT(p_prdb);
+
+	count = ntohll(p_prdb->p_db_tables[SSA_PR_TABLE_ID].set_count);
+	if(count >= SSA_PR_PRDB_NO_POS) {
+		SSA_PR_LOG_ERROR("PRDB is too large for lookup index. Records: %"PRIu64,count);
+		return NULL;
+	}
+
+	p_index = (struct ssa_prdb_index *)calloc(1,sizeof(*p_index));
+	if(!p_index) {
+		SSA_PR_LOG_ERROR("Cannot allocate PRDB lookup index");
+		return NULL;
+	}
+
+	p_index->p_recs = (const struct ep_pr_tbl_rec *)p_prdb->pp_tables[SSA_PR_TABLE_ID];
+	p_index->count = count;
+	/* One spare entry, so an empty PRDB doesn't need malloc(0) */
+	p_index->p_lids = (uint16_t *)malloc((count + 1) * sizeof(*p_index->p_lids));
+	p_index->p_order = (uint32_t *)malloc((count + 1) * sizeof(*p_index->p_order));
+	if(!p_index->p_lids || !p_index->p_order) {
+		SSA_PR_LOG_ERROR("Cannot allocate PRDB lookup index. Records: %"PRIu64,count);
+		goto Error;
+	}
+
+	if(prdb_index_sort(p_index) || prdb_index_hash(p_index))
+		goto Error;
+
+	return p_index;
+Error:
+	ssa_prdb_index_destroy(p_index);
+	return NULL;
+}
+
+void ssa_prdb_index_destroy(struct ssa_prdb_index *p_index)
+{
+	if(!p_index)
+		return;
+
+	free(p_index->p_lids);
+	free(p_index->p_order);
+	free(p_index->p_guid_hash);
+	free(p_index);
+}
+
+size_t ssa_prdb_index_memory(const struct ssa_prdb_index *p_index)
+{
+	SSA_ASSERT(p_index);
+
+	return sizeof(*p_index) +
+		p_index->count * (sizeof(*p_index->p_lids) + sizeof(*p_index->p_order)) +
+		((size_t)1 << p_index->guid_hash_bits) * sizeof(*p_index->p_guid_hash);
+}
+
+size_t ssa_prdb_lookup_lid(const struct ssa_prdb_index *p_index,
+		be16_t lid,
+		const struct ep_pr_tbl_rec **pp_recs,
+		size_t count)
+{
+	const uint16_t host_lid = ntohs(lid);
+	uint32_t low = 0, size = 0, i = 0;
+
+	SSA_ASSERT(p_index);
+	SSA_ASSERT(pp_recs || !count);
+
+	/*
+	 * Lower bound of host_lid. The loop has no data dependent branches,
+	 * the compiler turns the comparison into a conditional move.
+	 */
+	size = p_index->count;
+	while(size > 1) {
+		const uint32_t half = size / 2;
+
+		low = p_index->p_lids[low + half - 1] < host_lid ? low + half : low;
+		size -= half;
+	}
+	if(size && p_index->p_lids[low] < host_lid)
+		low++;
+
+	for(i = low; i < p_index->count && p_index->p_lids[i] == host_lid; ++i)
+		if(i - low < count)
+			pp_recs[i - low] = p_index->p_recs + p_index->p_order[i];
+
+	return i - low;
+}
+
+size_t ssa_prdb_lookup_guid(const struct ssa_prdb_index *p_index,
+		be64_t guid,
+		const struct ep_pr_tbl_rec **pp_recs,
+		size_t count)
+{
+	size_t slot = 0, mask = 0;
+	uint32_t first = SSA_PR_PRDB_NO_POS, i = 0;
+
+	SSA_ASSERT(p_index);
+	SSA_ASSERT(pp_recs || !count);
+
+	mask = ((size_t)1 << p_index->guid_hash_bits) - 1;
+
+	for(slot = prdb_guid_hash(guid,p_index->guid_hash_bits);
+			SSA_PR_PRDB_NO_POS != p_index->p_guid_hash[slot];
+			slot = (slot + 1) & mask) {
+		if(guid == p_index->p_recs[p_index->p_order[p_index->p_guid_hash[slot]]].guid) {
+			first = p_index->p_guid_hash[slot];
+			break;
+		}
+	}
+	if(SSA_PR_PRDB_NO_POS == first)
+		return 0;
+
+	for(i = first; i < p_index->count &&
+			p_index->p_recs[p_index->p_order[i]].guid == guid; ++i)
+		if(i - first < count)
+			pp_recs[i - first] = p_index->p_recs + p_index->p_order[i];
+
+	return i - first;
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright 2004-2013 Mellanox Technologies LTD. All rights reserved.
+ *
+ * This software is available to you under the terms of the
+ * OpenIB.org BSD license included below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "perf_counters.h"
+
+struct perf_counter_def {
+	const char *name;
+	uint32_t type;
+	uint64_t config;
+};
+
+#define PERF_CACHE_CONFIG(cache,op,result) \
+	((cache) | ((op) << 8) | ((result) << 16))
+
+static const struct perf_counter_def counter_defs[PERF_CNT_NUM] = {
+	{ "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ "l1d_misses", PERF_TYPE_HW_CACHE,
+		PERF_CACHE_CONFIG(PERF_COUNT_HW_CACHE_L1D,PERF_COUNT_HW_CACHE_OP_READ,
+				PERF_COUNT_HW_CACHE_RESULT_MISS) },
+	{ "llc_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+	{ "dtlb_misses", PERF_TYPE_HW_CACHE,
+		PERF_CACHE_CONFIG(PERF_COUNT_HW_CACHE_DTLB,PERF_COUNT_HW_CACHE_OP_READ,
+				PERF_COUNT_HW_CACHE_RESULT_MISS) },
+	{ "branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+};
+
+/*
+ * Value, time enabled and time running (PERF_FORMAT_TOTAL_TIME_*)
+ */
+struct perf_read_format {
+	uint64_t value;
+	uint64_t time_enabled;
+	uint64_t time_running;
+};
+
+static int open_counter(const struct perf_counter_def *p_def)
+{
+	struct perf_event_attr attr;
+
+	memset(&attr,'\0',sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = p_def->type;
+	attr.config = p_def->config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.inherit = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	/* pid 0, cpu -1: the calling thread on any CPU */
+	return syscall(__NR_perf_event_open,&attr,0,-1,-1,0);
+}
+
+int perf_counters_open(struct perf_counters *p_counters)
+{
+	int i = 0, count = 0;
+
+	memset(p_counters,'\0',sizeof(*p_counters));
+	for(i = 0; i < PERF_CNT_NUM; ++i) {
+		p_counters->fds[i] = open_counter(counter_defs + i);
+		if(p_counters->fds[i] >= 0)
+			count++;
+	}
+	return count;
+}
+
+void perf_counters_close(struct perf_counters *p_counters)
+{
+	int i = 0;
+
+	for(i = 0; i < PERF_CNT_NUM; ++i) {
+		if(p_counters->fds[i] >= 0)
+			close(p_counters->fds[i]);
+		p_counters->fds[i] = -1;
+	}
+}
+
+void perf_counters_start(struct perf_counters *p_counters)
+{
+	int i = 0;
+
+	for(i = 0; i < PERF_CNT_NUM; ++i) {
+		if(p_counters->fds[i] < 0)
+			continue;
+		ioctl(p_counters->fds[i],PERF_EVENT_IOC_RESET,0);
+		ioctl(p_counters->fds[i],PERF_EVENT_IOC_ENABLE,0);
+	}
+}
+
+void perf_counters_pause(struct perf_counters *p_counters)
+{
+	int i = 0;
+
+	for(i = 0; i < PERF_CNT_NUM; ++i)
+		if(p_counters->fds[i] >= 0)
+			ioctl(p_counters->fds[i],PERF_EVENT_IOC_DISABLE,0);
+}
+
+void perf_counters_resume(struct perf_counters *p_counters)
+{
+	int i = 0;
+
+	for(i = 0; i < PERF_CNT_NUM; ++i)
+		if(p_counters->fds[i] >= 0)
+			ioctl(p_counters->fds[i],PERF_EVENT_IOC_ENABLE,0);
+}
+
+void perf_counters_stop(struct perf_counters *p_counters)
+{
+	struct perf_read_format data;
+	int i = 0;
+
+	for(i = 0; i < PERF_CNT_NUM; ++i) {
+		p_counters->values[i] = 0;
+		if(p_counters->fds[i] < 0)
+			continue;
+		ioctl(p_counters->fds[i],PERF_EVENT_IOC_DISABLE,0);
+		if(sizeof(data) != read(p_counters->fds[i],&data,sizeof(data)))
+			continue;
+		if(data.time_running && data.time_running < data.time_enabled)
+			data.value = (double)data.value * data.time_enabled / data.time_running;
+		p_counters->values[i] = data.value;
+	}
+}
+
+const char *perf_counters_name(const int id)
+{
+	return id >= 0 && id < PERF_CNT_NUM ? counter_defs[id].name : "unknown";
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2004-2013 Mellanox Technologies LTD. All rights reserved.
+ *
+ * This software is available to you under the terms of the
+ * OpenIB.org BSD license included below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+/*
+ * Hardware counters of the calling thread based on perf_event_open.
+ * Counters that are not supported by the CPU or not permitted
+ * (see /proc/sys/kernel/perf_event_paranoid) are reported as unavailable,
+ * the rest of counters still work.
+ * Threads created while counters are enabled are counted as well, their
+ * counts are added when they exit.
+ */
+
+#include <stdint.h>
+
+enum {
+	PERF_CNT_CYCLES = 0,
+	PERF_CNT_INSTRUCTIONS,
+	PERF_CNT_L1D_MISSES,
+	PERF_CNT_LLC_MISSES,
+	PERF_CNT_DTLB_MISSES,
+	PERF_CNT_BRANCH_MISSES,
+	PERF_CNT_NUM
+};
+
+/*
+ *@fds - file descriptors of counters. -1 - the counter is unavailable.
+ *@values - counter values of the last measurement, scaled if the kernel
+ *          multiplexed counters.
+ */
+struct perf_counters {
+	int fds[PERF_CNT_NUM];
+	uint64_t values[PERF_CNT_NUM];
+};
+
+/**
+ * perf_counters_open - opens counters of the calling thread
+ * @p_counters: Counters
+ *
+ * @return value: number of available counters.
+ **/
+extern int perf_counters_open(struct perf_counters *p_counters);
+
+/**
+ * perf_counters_close - closes counters
+ * @p_counters: Counters
+ **/
+extern void perf_counters_close(struct perf_counters *p_counters);
+
+/**
+ * perf_counters_start - resets and starts counters
+ * @p_counters: Counters
+ **/
+extern void perf_counters_start(struct perf_counters *p_counters);
+
+/**
+ * perf_counters_pause - stops counters without reading
+ * @p_counters: Counters
+ **/
+extern void perf_counters_pause(struct perf_counters *p_counters);
+
+/**
+ * perf_counters_resume - continues counting after perf_counters_pause
+ * @p_counters: Counters
+ **/
+extern void perf_counters_resume(struct perf_counters *p_counters);
+
+/**
+ * perf_counters_stop - stops counters and reads their values
+ * @p_counters: Counters
+ **/
+extern void perf_counters_stop(struct perf_counters *p_counters);
+
+/**
+ * perf_counters_is_available - checks a counter
+ * @p_counters: Counters
+ * @id: PERF_CNT_* counter
+ **/
+static inline int perf_counters_is_available(const struct perf_counters *p_counters,
+		const int id)
+{
+	return p_counters->fds[id] >= 0;
+}
+
+/**
+ * perf_counters_name - returns a short name of a counter
+ * @id: PERF_CNT_* counter
+ **/
+extern const char *perf_counters_name(const int id);
+
+#endif /* end of include guard: PERF_COUNTERS_H */
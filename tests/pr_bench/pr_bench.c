@@ -0,0 +1,857 @@
+/*
+ * Copyright 2004-2013 Mellanox Technologies LTD. All rights reserved.
+ *
+ * This software is available to you under the terms of the
+ * OpenIB.org BSD license included below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/*
+ * Path record benchmark. For every fabric of the matrix it measures
+ * SMDB index build, "half world" computation for sampled sources, PRDB
+ * creation for the same sources, PRDB inserts and lookups alone and "whole world"
+ * computation with every given number of threads. Results are printed
+ * as CSV or JSON. Optionally hardware counters are collected for every
+ * phase and normalized per path record.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ctype.h>
+#include <inttypes.h>
+#include <time.h>
+#include <linux/limits.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <ssa_db.h>
+#include <ssa_smdb.h>
+#include <ssa_prdb.h>
+#include <infiniband/ssa_path_record.h>
+#include <infiniband/ssa_path_record_ext.h>
+
+#include "ssa_path_record_data.h"
+#include "topo_gen.h"
+#include "perf_counters.h"
+
+#define BENCH_MAX_ITEMS 32
+
+enum {
+	BENCH_FORMAT_CSV = 0,
+	BENCH_FORMAT_JSON
+};
+
+struct bench_prm {
+	enum topo_gen_type type;
+	unsigned int sizes[BENCH_MAX_ITEMS];
+	unsigned int size_count;
+	unsigned int threads[BENCH_MAX_ITEMS];
+	unsigned int thread_count;
+	unsigned int levels;
+	unsigned int hosts;
+	uint8_t lmc;
+	uint8_t use_dp_engine;
+	unsigned int sources;
+	unsigned int repeats;
+	uint8_t use_counters;
+	int format;
+};
+
+/*
+ * One line of the report
+ */
+struct bench_result {
+	const char *name;
+	unsigned int size;
+	unsigned int threads;
+	uint64_t paths;
+	double seconds;
+	double index_ms;
+	uint64_t counters[PERF_CNT_NUM];
+};
+
+struct bench_fabric {
+	struct ssa_db *p_smdb;
+	struct topo_gen_stats stats;
+	double index_ms;
+};
+
+static size_t result_count;
+static struct perf_counters bench_counters;
+static uint8_t use_counters;
+
+static void print_usage(FILE *file,const char *name)
+{
+	fprintf(file,"Usage: %s [-h] [-t type] [-s sizes] [-T threads] [-n levels] [-p hosts] [-m lmc] [-S sources] [-r repeats] [-D] [-P] [-j] [-o output file]\n", name);
+	fprintf(file,"\t-h\t\t-Print this help\n");
+	fprintf(file,"\t-t\t\t-Topology: fat-tree, torus-2d, torus-3d or dragonfly. Default: fat-tree\n");
+	fprintf(file,"\t-s\t\t-Comma separated fabric sizes: fat tree radix, torus side or\n");
+	fprintf(file,"\t\t\t dragonfly switches per group. Default: 8,16,24\n");
+	fprintf(file,"\t-T\t\t-Comma separated numbers of \"whole world\" threads. 1 - single\n");
+	fprintf(file,"\t\t\t threaded ssa_pr_whole_world. Default: 1\n");
+	fprintf(file,"\t-n\t\t-Fat tree: number of levels. Default: 3\n");
+	fprintf(file,"\t-p\t\t-Channel adapters per leaf switch. Default: topology specific\n");
+	fprintf(file,"\t-m\t\t-LMC of channel adapters. Default: 0\n");
+	fprintf(file,"\t-S\t\t-Number of sources for \"half world\" benchmarks. Default: 64\n");
+	fprintf(file,"\t-r\t\t-Number of repeats. The best time is reported. Default: 1\n");
+	fprintf(file,"\t-D\t\t-Use destination rooted engine\n");
+	fprintf(file,"\t-P\t\t-Collect hardware counters per phase. Values are per path\n");
+	fprintf(file,"\t\t\t record, for index_build - totals\n");
+	fprintf(file,"\t-j\t\t-JSON output. CSV is a default\n");
+	fprintf(file,"\t-o\t\t-Output file location. If ommited, stdout is used\n");
+}
+
+static unsigned int parse_list(const char *str, unsigned int *p_arr)
+{
+	unsigned int count = 0;
+	const char *p = str;
+	char *p_end = NULL;
+
+	while(*p && count < BENCH_MAX_ITEMS) {
+		unsigned long val = strtoul(p,&p_end,10);
+
+		if(p_end == p)
+			return 0;
+		p_arr[count++] = val;
+		p = p_end;
+		if(',' == *p)
+			p++;
+		else if(*p)
+			return 0;
+	}
+	return count;
+}
+
+static double get_time_sec()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long get_peak_rss_kb()
+{
+	struct rusage usage;
+
+	if(getrusage(RUSAGE_SELF,&usage))
+		return -1;
+	return usage.ru_maxrss;
+}
+
+static void set_fabric_prm(const struct bench_prm *p_prm,
+		const unsigned int size,
+		struct topo_gen_prm *p_topo_prm)
+{
+	memset(p_topo_prm,'\0',sizeof(*p_topo_prm));
+	p_topo_prm->type = p_prm->type;
+	p_topo_prm->hosts = p_prm->hosts;
+	p_topo_prm->lmc = p_prm->lmc;
+
+	switch(p_prm->type) {
+		case TOPO_GEN_FAT_TREE:
+			p_topo_prm->radix = size;
+			p_topo_prm->levels = p_prm->levels;
+			break;
+		case TOPO_GEN_TORUS_2D:
+		case TOPO_GEN_TORUS_3D:
+			p_topo_prm->dims[0] = p_topo_prm->dims[1] = p_topo_prm->dims[2] = size;
+			break;
+		case TOPO_GEN_DRAGONFLY:
+			/* Balanced dragonfly: a = 2p = 2h */
+			p_topo_prm->routers = size;
+			p_topo_prm->global_links = size / 2 ? size / 2 : 1;
+			if(!p_topo_prm->hosts)
+				p_topo_prm->hosts = size / 2 ? size / 2 : 1;
+			break;
+		default:
+			break;
+	}
+}
+
+static void print_header(FILE *fd, const struct bench_prm *p_prm)
+{
+	if(BENCH_FORMAT_JSON == p_prm->format)
+		fprintf(fd,"[\n");
+	else {
+		int i = 0;
+
+		fprintf(fd,"topology,size,switches,hosts,lmc,engine,benchmark,threads,"
+				"paths,seconds,paths_per_sec,ns_per_path,index_ms,peak_rss_kb");
+		for(i = 0; i < PERF_CNT_NUM; ++i)
+			fprintf(fd,",%s_per_path",perf_counters_name(i));
+		fprintf(fd,"\n");
+	}
+}
+
+static void print_footer(FILE *fd, const struct bench_prm *p_prm)
+{
+	if(BENCH_FORMAT_JSON == p_prm->format)
+		fprintf(fd,"\n]\n");
+}
+
+/*
+ * Counters are normalized per path record. Phases without path records
+ * (index build) report totals.
+ */
+static void print_counters(FILE *fd, const struct bench_prm *p_prm,
+		const struct bench_result *p_res)
+{
+	const uint64_t paths = p_res->paths ? p_res->paths : 1;
+	const int json = BENCH_FORMAT_JSON == p_prm->format;
+	int i = 0;
+
+	for(i = 0; i < PERF_CNT_NUM; ++i) {
+		if(json)
+			fprintf(fd,", \"%s_per_path\": ",perf_counters_name(i));
+		else
+			fprintf(fd,",");
+		if(!use_counters || !perf_counters_is_available(&bench_counters,i))
+			fputs(json ? "null" : "",fd);
+		else
+			fprintf(fd,"%.3f",(double)p_res->counters[i] / paths);
+	}
+}
+
+static void print_result(FILE *fd, const struct bench_prm *p_prm,
+		const struct bench_fabric *p_fabric,
+		const struct bench_result *p_res)
+{
+	const double paths_per_sec = p_res->seconds > 0 ? p_res->paths / p_res->seconds : 0;
+	const double ns_per_path = p_res->paths ? p_res->seconds * 1e9 / p_res->paths : 0;
+	const char *engine = p_prm->use_dp_engine ? "dp" : "walk";
+
+	if(BENCH_FORMAT_JSON == p_prm->format) {
+		fprintf(fd,"%s  {\"topology\": \"%s\", \"size\": %u, \"switches\": %zu, "
+				"\"hosts\": %zu, \"lmc\": %u, \"engine\": \"%s\", "
+				"\"benchmark\": \"%s\", \"threads\": %u, \"paths\": %"PRIu64", "
+				"\"seconds\": %.6f, \"paths_per_sec\": %.1f, \"ns_per_path\": %.2f, "
+				"\"index_ms\": %.3f, \"peak_rss_kb\": %ld",
+				result_count ? ",\n" : "",
+				topo_gen_type_name(p_prm->type),p_res->size,
+				p_fabric->stats.switches,p_fabric->stats.hosts,p_prm->lmc,engine,
+				p_res->name,p_res->threads,p_res->paths,p_res->seconds,
+				paths_per_sec,ns_per_path,p_res->index_ms,get_peak_rss_kb());
+		print_counters(fd,p_prm,p_res);
+		fprintf(fd,"}");
+	} else {
+		fprintf(fd,"%s,%u,%zu,%zu,%u,%s,%s,%u,%"PRIu64",%.6f,%.1f,%.2f,%.3f,%ld",
+				topo_gen_type_name(p_prm->type),p_res->size,
+				p_fabric->stats.switches,p_fabric->stats.hosts,p_prm->lmc,engine,
+				p_res->name,p_res->threads,p_res->paths,p_res->seconds,
+				paths_per_sec,ns_per_path,p_res->index_ms,get_peak_rss_kb());
+		print_counters(fd,p_prm,p_res);
+		fprintf(fd,"\n");
+	}
+	fflush(fd);
+	result_count++;
+}
+
+static void count_path(const ssa_path_parms_t *p_path_prm, void *prm)
+{
+	(*(uint64_t *)prm)++;
+}
+
+/*
+ * Index build on a separate index, so the context's index is not affected.
+ */
+static int bench_index_build(const struct bench_fabric *p_fabric,
+		void *p_context, const unsigned int arg,
+		struct bench_result *p_res)
+{
+	struct ssa_pr_smdb_index *p_index = NULL;
+	double start = 0;
+	int res = 0;
+
+	if(use_counters)
+		perf_counters_pause(&bench_counters);
+
+	p_index = (struct ssa_pr_smdb_index *)malloc(sizeof(*p_index));
+	if(!p_index) {
+		fprintf(stderr,"Can't allocate smdb index\n");
+		return -1;
+	}
+	memset(p_index,'\0',sizeof(*p_index));
+	p_index->epoch = -1;
+
+	if(use_counters)
+		perf_counters_resume(&bench_counters);
+	start = get_time_sec();
+	res = ssa_pr_rebuild_indexes(p_index,p_fabric->p_smdb);
+	p_res->seconds = get_time_sec() - start;
+	if(use_counters)
+		perf_counters_pause(&bench_counters);
+	if(res)
+		fprintf(stderr,"smdb index build is failed\n");
+
+	ssa_pr_destroy_indexes(p_index);
+	free(p_index);
+	return res;
+}
+
+/*
+ * Sources are spread evenly over SSA_TABLE_ID_GUID_TO_LID.
+ */
+static be64_t get_source_guid(const struct ssa_db *p_smdb,
+		const unsigned int i, const unsigned int count)
+{
+	const struct ep_guid_to_lid_tbl_rec *p_tbl =
+		(const struct ep_guid_to_lid_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_GUID_TO_LID];
+	const uint64_t rec_count = ntohll(p_smdb->p_db_tables[SSA_TABLE_ID_GUID_TO_LID].set_count);
+
+	return p_tbl[(uint64_t)i * rec_count / count].guid;
+}
+
+static int bench_half_world(const struct bench_fabric *p_fabric,
+		void *p_context, const unsigned int sources,
+		struct bench_result *p_res)
+{
+	unsigned int i = 0;
+	double start = get_time_sec();
+
+	for(i = 0; i < sources; ++i)
+		if(SSA_PR_SUCCESS != ssa_pr_half_world(p_fabric->p_smdb,p_context,
+					get_source_guid(p_fabric->p_smdb,i,sources),
+					count_path,&p_res->paths))
+			return -1;
+
+	p_res->seconds = get_time_sec() - start;
+	return 0;
+}
+
+static int bench_compute_half_world(const struct bench_fabric *p_fabric,
+		void *p_context, const unsigned int sources,
+		struct bench_result *p_res)
+{
+	struct ssa_db *p_prdb = NULL;
+	unsigned int i = 0;
+	double start = get_time_sec();
+
+	for(i = 0; i < sources; ++i) {
+		p_prdb = ssa_pr_compute_half_world(p_fabric->p_smdb,p_context,
+				get_source_guid(p_fabric->p_smdb,i,sources));
+		if(!p_prdb)
+			return -1;
+		p_res->paths += ntohll(p_prdb->p_db_tables[SSA_PR_TABLE_ID].set_count);
+		ssa_db_destroy(p_prdb);
+	}
+
+	p_res->seconds = get_time_sec() - start;
+	return 0;
+}
+
+/*
+ * Range PRDB records are counted as paths, so the ratio to
+ * compute_half_world paths shows the size reduction.
+ */
+static int bench_compute_half_world_range(const struct bench_fabric *p_fabric,
+		void *p_context, const unsigned int sources,
+		struct bench_result *p_res)
+{
+	struct ssa_db *p_prdb = NULL;
+	unsigned int i = 0;
+	double start = get_time_sec();
+
+	for(i = 0; i < sources; ++i) {
+		p_prdb = ssa_pr_compute_half_world_range(p_fabric->p_smdb,p_context,
+				get_source_guid(p_fabric->p_smdb,i,sources));
+		if(!p_prdb)
+			return -1;
+		p_res->paths += ntohll(p_prdb->p_db_tables[SSA_PR_RANGE_TABLE_ID].set_count);
+		ssa_db_destroy(p_prdb);
+	}
+
+	p_res->seconds = get_time_sec() - start;
+	return 0;
+}
+
+struct bench_insert {
+	struct ssa_db *p_prdb;
+	uint64_t capacity;
+	uint64_t paths;
+	double seconds;
+};
+
+static void insert_batch(const ssa_path_parms_t *p_paths, size_t count, void *prm)
+{
+	struct bench_insert *p_insert = (struct bench_insert *)prm;
+	double start = 0;
+
+	if(use_counters)
+		perf_counters_resume(&bench_counters);
+	start = get_time_sec();
+	p_insert->paths += ssa_prdb_insert_batch(p_insert->p_prdb,p_insert->capacity,
+			p_paths,count);
+	p_insert->seconds += get_time_sec() - start;
+	if(use_counters)
+		perf_counters_pause(&bench_counters);
+}
+
+/*
+ * Upper bound of "half world" records: every source LID to every LID
+ */
+static uint64_t get_half_world_capacity(const struct ssa_db *p_smdb)
+{
+	const struct ep_guid_to_lid_tbl_rec *p_tbl =
+		(const struct ep_guid_to_lid_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_GUID_TO_LID];
+	const uint64_t rec_count = ntohll(p_smdb->p_db_tables[SSA_TABLE_ID_GUID_TO_LID].set_count);
+	uint64_t lids = 0, i = 0;
+	uint8_t max_lmc = 0;
+
+	for(i = 0; i < rec_count; ++i) {
+		lids += 1 << p_tbl[i].lmc;
+		if(p_tbl[i].lmc > max_lmc)
+			max_lmc = p_tbl[i].lmc;
+	}
+	return lids << max_lmc;
+}
+
+/*
+ * Only PRDB inserts are timed and counted. Route walks of the same
+ * sources are excluded.
+ */
+static int bench_prdb_insert(const struct bench_fabric *p_fabric,
+		void *p_context, const unsigned int sources,
+		struct bench_result *p_res)
+{
+	struct bench_insert insert;
+	unsigned int i = 0;
+	int res = 0;
+
+	if(use_counters)
+		perf_counters_pause(&bench_counters);
+
+	memset(&insert,'\0',sizeof(insert));
+	insert.capacity = get_half_world_capacity(p_fabric->p_smdb);
+
+	for(i = 0; i < sources && !res; ++i) {
+		insert.p_prdb = ssa_prdb_create(insert.capacity);
+		if(!insert.p_prdb)
+			return -1;
+		if(SSA_PR_SUCCESS != ssa_pr_half_world_batch(p_fabric->p_smdb,p_context,
+					get_source_guid(p_fabric->p_smdb,i,sources),
+					insert_batch,&insert))
+			res = -1;
+		ssa_db_destroy(insert.p_prdb);
+	}
+
+	p_res->paths = insert.paths;
+	p_res->seconds = insert.seconds;
+	return res;
+}
+
+/*
+ * Every destination of a "half world" PRDB is looked up by LID and by
+ * GUID. Only lookups are timed, every successful lookup is counted as
+ * a path.
+ */
+static int bench_prdb_lookup(const struct bench_fabric *p_fabric,
+		void *p_context, const unsigned int sources,
+		struct bench_result *p_res)
+{
+	struct ssa_db *p_prdb = NULL;
+	struct ssa_prdb_index *p_index = NULL;
+	const struct ep_pr_tbl_rec *p_recs = NULL;
+	const struct ep_pr_tbl_rec *p_found = NULL;
+	uint64_t count = 0, j = 0;
+	unsigned int i = 0;
+	double start = 0;
+
+	for(i = 0; i < sources; ++i) {
+		if(use_counters)
+			perf_counters_pause(&bench_counters);
+		p_prdb = ssa_pr_compute_half_world(p_fabric->p_smdb,p_context,
+				get_source_guid(p_fabric->p_smdb,i,sources));
+		if(!p_prdb)
+			return -1;
+		p_index = ssa_prdb_index_create(p_prdb);
+		if(!p_index) {
+			ssa_db_destroy(p_prdb);
+			return -1;
+		}
+		p_recs = (const struct ep_pr_tbl_rec *)p_prdb->pp_tables[SSA_PR_TABLE_ID];
+		count = ntohll(p_prdb->p_db_tables[SSA_PR_TABLE_ID].set_count);
+
+		if(use_counters)
+			perf_counters_resume(&bench_counters);
+		start = get_time_sec();
+		for(j = 0; j < count; ++j) {
+			if(ssa_prdb_lookup_lid(p_index,p_recs[j].lid,&p_found,1))
+				p_res->paths++;
+			if(ssa_prdb_lookup_guid(p_index,p_recs[j].guid,&p_found,1))
+				p_res->paths++;
+		}
+		p_res->seconds += get_time_sec() - start;
+
+		ssa_prdb_index_destroy(p_index);
+		ssa_db_destroy(p_prdb);
+	}
+
+	if(use_counters)
+		perf_counters_pause(&bench_counters);
+	return 0;
+}
+
+/*
+ * A "half world" PRDB is converted to the compact form and expanded
+ * back. Only conversions are timed, every record is counted as a path.
+ */
+static int bench_prdb_compact(const struct bench_fabric *p_fabric,
+		void *p_context, const unsigned int sources,
+		struct bench_result *p_res)
+{
+	struct ssa_db *p_prdb = NULL;
+	struct ssa_db *p_compact = NULL;
+	struct ssa_db *p_expanded = NULL;
+	unsigned int i = 0;
+	double start = 0;
+
+	for(i = 0; i < sources; ++i) {
+		if(use_counters)
+			perf_counters_pause(&bench_counters);
+		p_prdb = ssa_pr_compute_half_world(p_fabric->p_smdb,p_context,
+				get_source_guid(p_fabric->p_smdb,i,sources));
+		if(!p_prdb)
+			return -1;
+
+		if(use_counters)
+			perf_counters_resume(&bench_counters);
+		start = get_time_sec();
+		p_compact = ssa_prdb_compact_create(p_prdb);
+		if(p_compact)
+			p_expanded = ssa_prdb_compact_expand(p_compact,p_fabric->p_smdb);
+		p_res->seconds += get_time_sec() - start;
+
+		if(!p_expanded) {
+			if(p_compact)
+				ssa_db_destroy(p_compact);
+			ssa_db_destroy(p_prdb);
+			return -1;
+		}
+		p_res->paths += ntohll(p_prdb->p_db_tables[SSA_PR_TABLE_ID].set_count);
+
+		ssa_db_destroy(p_expanded);
+		ssa_db_destroy(p_compact);
+		ssa_db_destroy(p_prdb);
+		p_expanded = NULL;
+	}
+
+	if(use_counters)
+		perf_counters_pause(&bench_counters);
+	return 0;
+}
+
+static int bench_whole_world(const struct bench_fabric *p_fabric,
+		void *p_context, const unsigned int threads,
+		struct bench_result *p_res)
+{
+	ssa_pr_status_t res = SSA_PR_SUCCESS;
+	double start = get_time_sec();
+
+	if(threads <= 1)
+		res = ssa_pr_whole_world(p_fabric->p_smdb,p_context,count_path,&p_res->paths);
+	else
+		res = ssa_pr_whole_world_mt(p_fabric->p_smdb,p_context,threads,0,
+				count_path,&p_res->paths);
+
+	p_res->seconds = get_time_sec() - start;
+	return SSA_PR_SUCCESS == res ? 0 : -1;
+}
+
+/*
+ * Every (source, destination) pair with a path is counted
+ */
+static int bench_whole_world_matrix(const struct bench_fabric *p_fabric,
+		void *p_context, const unsigned int threads,
+		struct bench_result *p_res)
+{
+	struct ssa_pr_matrix *p_matrix = NULL;
+	const uint8_t *p_row = NULL;
+	uint32_t count = 0, i = 0, j = 0;
+	double start = get_time_sec();
+
+	p_matrix = ssa_pr_matrix_create(p_fabric->p_smdb,p_context,threads);
+	p_res->seconds = get_time_sec() - start;
+	if(!p_matrix)
+		return -1;
+
+	count = ssa_pr_matrix_size(p_matrix);
+	for(i = 0; i < count; ++i) {
+		p_row = ssa_pr_matrix_row(p_matrix,i);
+		for(j = 0; j < count; ++j)
+			p_res->paths += SSA_PR_MATRIX_NO_PATH != p_row[j];
+	}
+
+	ssa_pr_matrix_destroy(p_matrix);
+	return 0;
+}
+
+/*
+ * Runs a benchmark "repeats" times and reports the best time.
+ */
+static int run_bench(FILE *fd, const struct bench_prm *p_prm,
+		const struct bench_fabric *p_fabric,
+		void *p_context, const char *name,
+		const unsigned int size, const unsigned int arg,
+		int (*bench)(const struct bench_fabric *, void *, const unsigned int,
+			struct bench_result *),
+		struct bench_result *p_best)
+{
+	struct bench_result best, res;
+	unsigned int i = 0;
+	int ret = 0;
+
+	memset(&best,'\0',sizeof(best));
+	for(i = 0; i < p_prm->repeats; ++i) {
+		memset(&res,'\0',sizeof(res));
+		if(use_counters)
+			perf_counters_start(&bench_counters);
+		ret = bench(p_fabric,p_context,arg,&res);
+		if(use_counters) {
+			perf_counters_stop(&bench_counters);
+			memcpy(res.counters,bench_counters.values,sizeof(res.counters));
+		}
+		if(ret) {
+			fprintf(stderr,"Benchmark %s is failed. Size: %u\n",name,size);
+			return -1;
+		}
+		if(!i || res.seconds < best.seconds)
+			best = res;
+	}
+
+	best.name = name;
+	best.size = size;
+	best.threads = !strcmp(name,"whole_world") ? (arg ? arg : 1) : 1;
+	best.index_ms = p_fabric->index_ms ? p_fabric->index_ms : best.seconds * 1e3;
+	print_result(fd,p_prm,p_fabric,&best);
+	if(p_best)
+		*p_best = best;
+	return 0;
+}
+
+static int run_fabric(FILE *fd, const struct bench_prm *p_prm,
+		const unsigned int size)
+{
+	struct topo_gen_prm topo_prm;
+	struct bench_fabric fabric;
+	struct bench_result index_res;
+	void *p_context = NULL;
+	unsigned int i = 0;
+	int res = -1;
+
+	memset(&fabric,'\0',sizeof(fabric));
+	set_fabric_prm(p_prm,size,&topo_prm);
+
+	fabric.p_smdb = topo_gen_create(&topo_prm,&fabric.stats);
+	if(!fabric.p_smdb) {
+		fprintf(stderr,"Fabric generation is failed. Size: %u\n",size);
+		goto Exit;
+	}
+
+	p_context = ssa_pr_create_context(stderr,1);
+	if(!p_context) {
+		fprintf(stderr,"Can't create path record calculation context\n");
+		goto Exit;
+	}
+
+	if(p_prm->use_dp_engine && ssa_pr_set_engine(p_context,SSA_PR_ENGINE_DP)) {
+		fprintf(stderr,"Can't set destination rooted engine\n");
+		goto Exit;
+	}
+
+	if(run_bench(fd,p_prm,&fabric,p_context,"index_build",size,
+				0,bench_index_build,&index_res))
+		goto Exit;
+	fabric.index_ms = index_res.seconds * 1e3;
+
+	if(run_bench(fd,p_prm,&fabric,p_context,"half_world",size,
+				p_prm->sources,bench_half_world,NULL))
+		goto Exit;
+	if(run_bench(fd,p_prm,&fabric,p_context,"compute_half_world",size,
+				p_prm->sources,bench_compute_half_world,NULL))
+		goto Exit;
+	if(run_bench(fd,p_prm,&fabric,p_context,"compute_half_world_range",size,
+				p_prm->sources,bench_compute_half_world_range,NULL))
+		goto Exit;
+	if(run_bench(fd,p_prm,&fabric,p_context,"prdb_insert",size,
+				p_prm->sources,bench_prdb_insert,NULL))
+		goto Exit;
+	if(run_bench(fd,p_prm,&fabric,p_context,"prdb_lookup",size,
+				p_prm->sources,bench_prdb_lookup,NULL))
+		goto Exit;
+	if(run_bench(fd,p_prm,&fabric,p_context,"prdb_compact",size,
+				p_prm->sources,bench_prdb_compact,NULL))
+		goto Exit;
+	for(i = 0; i < p_prm->thread_count; ++i)
+		if(run_bench(fd,p_prm,&fabric,p_context,"whole_world",size,
+					p_prm->threads[i],bench_whole_world,NULL))
+			goto Exit;
+	for(i = 0; i < p_prm->thread_count; ++i)
+		if(run_bench(fd,p_prm,&fabric,p_context,"whole_world_matrix",size,
+					p_prm->threads[i],bench_whole_world_matrix,NULL))
+			goto Exit;
+
+	res = 0;
+Exit:
+	if(p_context) {
+		ssa_pr_destroy_context(p_context);
+		p_context = NULL;
+	}
+	if(fabric.p_smdb) {
+		ssa_db_destroy(fabric.p_smdb);
+		fabric.p_smdb = NULL;
+	}
+	return res;
+}
+
+int main(int argc,char *argv[])
+{
+	int opt = 0;
+	struct bench_prm prm;
+	char output_path[PATH_MAX] = {};
+	FILE *fd = stdout;
+	unsigned int val = 0;
+	unsigned int i = 0;
+	int res = 0;
+
+	memset(&prm,'\0',sizeof(prm));
+	prm.type = TOPO_GEN_FAT_TREE;
+	prm.levels = 3;
+	prm.sources = 64;
+	prm.repeats = 1;
+
+	while ((opt = getopt(argc, argv, "t:s:T:n:p:m:S:r:DPjo:h?")) != -1) {
+		switch (opt) {
+			case 't':
+				prm.type = topo_gen_type_by_name(optarg);
+				if(TOPO_GEN_TYPE_MAX == prm.type) {
+					fprintf(stderr,"Unknown topology: %s\n",optarg);
+					print_usage(stderr,argv[0]);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 's':
+				prm.size_count = parse_list(optarg,prm.sizes);
+				if(!prm.size_count) {
+					fprintf(stderr,"Wrong list of sizes: %s\n",optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'T':
+				prm.thread_count = parse_list(optarg,prm.threads);
+				if(!prm.thread_count) {
+					fprintf(stderr,"Wrong list of threads: %s\n",optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'n':
+				prm.levels = atoi(optarg);
+				break;
+			case 'p':
+				prm.hosts = atoi(optarg);
+				break;
+			case 'm':
+				val = atoi(optarg);
+				prm.lmc = val;
+				break;
+			case 'S':
+				prm.sources = atoi(optarg);
+				break;
+			case 'r':
+				prm.repeats = atoi(optarg);
+				break;
+			case 'D':
+				prm.use_dp_engine = 1;
+				break;
+			case 'P':
+				prm.use_counters = 1;
+				break;
+			case 'j':
+				prm.format = BENCH_FORMAT_JSON;
+				break;
+			case 'o':
+				strncpy(output_path,optarg,PATH_MAX - 1);
+				break;
+			case '?':
+			case 'h':
+				print_usage(stdout,argv[0]);
+				return 0;
+				break;
+			default: /* '?' */
+				if(isprint (optopt))
+					fprintf (stderr, "Unknown option `-%c'.\n", optopt);
+				else
+					fprintf (stderr,
+							"Unknown option character `\\x%x'.\n",
+							optopt);
+				print_usage(stderr,argv[0]);
+				exit(EXIT_FAILURE);
+		}
+	}
+
+	if(!prm.size_count) {
+		prm.sizes[0] = 8;
+		prm.sizes[1] = 16;
+		prm.sizes[2] = 24;
+		prm.size_count = 3;
+	}
+	if(!prm.thread_count) {
+		prm.threads[0] = 1;
+		prm.thread_count = 1;
+	}
+	if(!prm.sources)
+		prm.sources = 1;
+	if(!prm.repeats)
+		prm.repeats = 1;
+
+	if(strlen(output_path)) {
+		fd = fopen(output_path,"w");
+		if(!fd) {
+			fprintf(stderr,"Can't open file for writing: %s\n",output_path);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if(prm.use_counters) {
+		if(!perf_counters_open(&bench_counters))
+			fprintf(stderr,"Hardware counters are not available\n");
+		use_counters = 1;
+	}
+
+	print_header(fd,&prm);
+	for(i = 0; i < prm.size_count && !res; ++i)
+		res = run_fabric(fd,&prm,prm.sizes[i]);
+	print_footer(fd,&prm);
+
+	if(use_counters)
+		perf_counters_close(&bench_counters);
+
+	if(fd != stdout)
+		fclose(fd);
+
+	return res ? EXIT_FAILURE : 0;
+}
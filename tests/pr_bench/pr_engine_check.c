@@ -0,0 +1,227 @@
+/*
+ * Copyright 2004-2013 Mellanox Technologies LTD. All rights reserved.
+ *
+ * This software is available to you under the terms of the
+ * OpenIB.org BSD license included below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/*
+ * Engine consistency check for the degraded fabric mode. Synthetic
+ * fabrics lose links and forwarding table entries, then "whole world" is
+ * computed by the route walk and by the destination rooted engine, single
+ * and multi-threaded. Path counters and failure reports must be the same
+ * for all runs. Exit code is 0 if they are.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <ssa_db.h>
+#include <ssa_smdb.h>
+#include <infiniband/ssa_path_record.h>
+#include <infiniband/ssa_path_record_ext.h>
+
+#include "ssa_path_record_data.h"
+#include "topo_gen.h"
+
+#define CHECK_THREADS 4
+
+/*
+ * Results of one "whole world" run
+ */
+struct check_result {
+	struct ssa_pr_stats stats;
+	struct ssa_pr_fail_stats fail_stats;
+};
+
+/*
+ * degrade_links - removes links of odd ports of a switch in the middle of
+ * the link table, both directions
+ */
+static void degrade_links(struct ssa_db *p_smdb)
+{
+	struct ep_link_tbl_rec *p_link_tbl =
+		(struct ep_link_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_LINK];
+	const uint64_t count = ntohll(p_smdb->p_db_tables[SSA_TABLE_ID_LINK].set_count);
+	const be16_t victim = p_link_tbl[count / 2].from_lid;
+	uint64_t i = 0, j = 0;
+
+	for(i = 0; i < count; ++i) {
+		if((p_link_tbl[i].from_lid == victim && (p_link_tbl[i].from_port_num & 1)) ||
+				(p_link_tbl[i].to_lid == victim && (p_link_tbl[i].to_port_num & 1)))
+			continue;
+		p_link_tbl[j++] = p_link_tbl[i];
+	}
+
+	p_smdb->p_db_tables[SSA_TABLE_ID_LINK].set_count = htonll(j);
+	p_smdb->p_db_tables[SSA_TABLE_ID_LINK].set_size = htonll(j * sizeof(*p_link_tbl));
+}
+
+/*
+ * degrade_lfts - spoils forwarding table entries: some have no port,
+ * others point to a port that doesn't exist
+ */
+static void degrade_lfts(struct ssa_db *p_smdb)
+{
+	struct ep_lft_block_tbl_rec *p_block_tbl =
+		(struct ep_lft_block_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_LFT_BLOCK];
+	const uint64_t count = ntohll(p_smdb->p_db_tables[SSA_TABLE_ID_LFT_BLOCK].set_count);
+	uint64_t i = 0;
+
+	for(i = 3; i < count; i += 17) {
+		p_block_tbl[i].block[5] = LFT_NO_PATH;
+		p_block_tbl[i].block[9] = 250;
+	}
+}
+
+static int check_run(struct ssa_db *p_smdb,
+		ssa_pr_engine_t engine,
+		unsigned int threads,
+		struct check_result *p_result)
+{
+	void *p_context = NULL;
+	ssa_pr_status_t res = SSA_PR_SUCCESS;
+
+	p_context = ssa_pr_create_context(stderr,1);
+	if(!p_context) {
+		fprintf(stderr,"Can't create path record context\n");
+		return -1;
+	}
+
+	if(ssa_pr_set_engine(p_context,engine) ||
+			ssa_pr_set_degraded_mode(p_context,1)) {
+		fprintf(stderr,"Can't configure path record context\n");
+		ssa_pr_destroy_context(p_context);
+		return -1;
+	}
+
+	if(threads > 1)
+		res = ssa_pr_whole_world_mt(p_smdb,p_context,threads,0,NULL,NULL);
+	else
+		res = ssa_pr_whole_world(p_smdb,p_context,NULL,NULL);
+
+	memset(p_result,'\0',sizeof(*p_result));
+	ssa_pr_get_stats(p_context,&p_result->stats);
+	ssa_pr_get_fail_stats(p_context,&p_result->fail_stats);
+	ssa_pr_destroy_context(p_context);
+
+	if(SSA_PR_ERROR == res) {
+		fprintf(stderr,"\"Whole world\" calculation is failed\n");
+		return -1;
+	}
+	return 0;
+}
+
+static int check_compare(const char *name,
+		const struct check_result *p_ref,
+		const struct check_result *p_result)
+{
+	const struct ssa_pr_fail_stats *p_ref_fail = &p_ref->fail_stats;
+	const struct ssa_pr_fail_stats *p_fail = &p_result->fail_stats;
+	int diff = 0;
+
+	diff = p_ref->stats.paths != p_result->stats.paths ||
+		p_ref->stats.no_paths != p_result->stats.no_paths ||
+		p_ref->stats.errors != p_result->stats.errors ||
+		p_ref->stats.hops != p_result->stats.hops ||
+		p_ref_fail->pairs != p_fail->pairs ||
+		p_ref_fail->reverse_pairs != p_fail->reverse_pairs ||
+		p_ref_fail->switches != p_fail->switches ||
+		p_ref_fail->locations != p_fail->locations ||
+		memcmp(p_ref_fail->causes,p_fail->causes,sizeof(p_fail->causes));
+
+	printf("%-8s paths %"PRIu64" no paths %"PRIu64" errors %"PRIu64
+			" failed pairs %"PRIu64" failed reverse %"PRIu64" locations %"PRIu64"%s\n",
+			name,p_result->stats.paths,p_result->stats.no_paths,
+			p_result->stats.errors,p_fail->pairs,p_fail->reverse_pairs,
+			p_fail->locations,diff ? " MISMATCH" : "");
+	return diff;
+}
+
+static int check_fabric(const struct topo_gen_prm *p_prm)
+{
+	struct ssa_db *p_smdb = NULL;
+	struct topo_gen_stats stats;
+	struct check_result ref, result;
+	int failed = 0;
+
+	p_smdb = topo_gen_create(p_prm,&stats);
+	if(!p_smdb) {
+		fprintf(stderr,"Can't generate %s fabric\n",topo_gen_type_name(p_prm->type));
+		return 1;
+	}
+	degrade_links(p_smdb);
+	degrade_lfts(p_smdb);
+
+	printf("%s: switches %zu hosts %zu\n",topo_gen_type_name(p_prm->type),
+			stats.switches,stats.hosts);
+
+	if(check_run(p_smdb,SSA_PR_ENGINE_WALK,1,&ref)) {
+		failed = 1;
+		goto Exit;
+	}
+	check_compare("walk",&ref,&ref);
+
+	if(check_run(p_smdb,SSA_PR_ENGINE_WALK,CHECK_THREADS,&result) ||
+			check_compare("walk mt",&ref,&result))
+		failed = 1;
+	if(check_run(p_smdb,SSA_PR_ENGINE_DP,1,&result) ||
+			check_compare("dp",&ref,&result))
+		failed = 1;
+	if(check_run(p_smdb,SSA_PR_ENGINE_DP,CHECK_THREADS,&result) ||
+			check_compare("dp mt",&ref,&result))
+		failed = 1;
+
+Exit:
+	ssa_db_destroy(p_smdb);
+	return failed;
+}
+
+int main(int argc,char *argv[])
+{
+	struct topo_gen_prm prm;
+	int failed = 0;
+
+	memset(&prm,'\0',sizeof(prm));
+	prm.type = TOPO_GEN_FAT_TREE;
+	prm.radix = 8;
+	prm.levels = 3;
+	failed |= check_fabric(&prm);
+
+	memset(&prm,'\0',sizeof(prm));
+	prm.type = TOPO_GEN_TORUS_2D;
+	prm.dims[0] = prm.dims[1] = 6;
+	prm.lmc = 1;
+	failed |= check_fabric(&prm);
+
+	memset(&prm,'\0',sizeof(prm));
+	prm.type = TOPO_GEN_DRAGONFLY;
+	failed |= check_fabric(&prm);
+
+	return failed;
+}
@@ -0,0 +1,659 @@
+/*
+ * Copyright 2004-2013 Mellanox Technologies LTD. All rights reserved.
+ *
+ * This software is available to you under the terms of the
+ * OpenIB.org BSD license included below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/*
+ * Micro-benchmark of SMDB index lookup primitives: find_port,
+ * find_linked_port, find_destination_port and ib_path_compare_rates_fast.
+ * Arguments of every primitive are prepared in advance for three access
+ * patterns:
+ *   random     - uniformly distributed valid arguments,
+ *   sequential - arguments in the order of smdb tables,
+ *   route      - arguments of ports, links and forwarding table entries
+ *                in the order the route walk visits them between random
+ *                pairs.
+ * Every primitive is timed over its argument array, L1D and LLC misses
+ * are collected if hardware counters are available.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ctype.h>
+#include <inttypes.h>
+#include <time.h>
+#include <linux/limits.h>
+
+#include <ssa_db.h>
+#include <ssa_smdb.h>
+#include <infiniband/ssa_path_record.h>
+
+#include "ssa_path_record_helper.h"
+#include "ssa_path_record_data.h"
+#include "topo_gen.h"
+#include "perf_counters.h"
+
+#define LOOKUP_DEFAULT_OPS (1 << 20)
+#define LOOKUP_MIN_RATE 2
+#define LOOKUP_MAX_RATE 18
+
+enum {
+	LOOKUP_FIND_PORT = 0,
+	LOOKUP_FIND_LINKED_PORT,
+	LOOKUP_FIND_DESTINATION_PORT,
+	LOOKUP_COMPARE_RATES,
+	LOOKUP_PRIMITIVE_NUM
+};
+
+enum {
+	LOOKUP_PATTERN_RANDOM = 0,
+	LOOKUP_PATTERN_SEQUENTIAL,
+	LOOKUP_PATTERN_ROUTE,
+	LOOKUP_PATTERN_NUM
+};
+
+static const char *primitive_names[LOOKUP_PRIMITIVE_NUM] = {
+	"find_port", "find_linked_port", "find_destination_port",
+	"ib_path_compare_rates_fast"
+};
+
+static const char *pattern_names[LOOKUP_PATTERN_NUM] = {
+	"random", "sequential", "route"
+};
+
+/*
+ * Arguments of one call. For ib_path_compare_rates_fast lid and lid2
+ * are rates.
+ */
+struct lookup_op {
+	be16_t lid;
+	be16_t lid2;
+	int port;
+};
+
+struct lookup_trace {
+	struct lookup_op *p_ops;
+	size_t count;
+	size_t size;
+};
+
+struct lookup_env {
+	const struct ssa_db *p_smdb;
+	const struct ssa_pr_smdb_index *p_index;
+	size_t ops;
+	uint64_t rand_state;
+};
+
+static volatile uintptr_t lookup_sink;
+static size_t result_count;
+
+static void print_usage(FILE *file,const char *name)
+{
+	fprintf(file,"Usage: %s [-h] [-t type] [-s size] [-n levels] [-p hosts] [-m lmc] [-N ops] [-j] [-o output file]\n", name);
+	fprintf(file,"\t-h\t\t-Print this help\n");
+	fprintf(file,"\t-t\t\t-Topology: fat-tree, torus-2d, torus-3d or dragonfly. Default: fat-tree\n");
+	fprintf(file,"\t-s\t\t-Fabric size: fat tree radix, torus side or dragonfly\n");
+	fprintf(file,"\t\t\t switches per group. Default: 16\n");
+	fprintf(file,"\t-n\t\t-Fat tree: number of levels. Default: 3\n");
+	fprintf(file,"\t-p\t\t-Channel adapters per leaf switch. Default: topology specific\n");
+	fprintf(file,"\t-m\t\t-LMC of channel adapters. Default: 0\n");
+	fprintf(file,"\t-N\t\t-Number of calls per primitive and pattern. Default: %u\n",
+			LOOKUP_DEFAULT_OPS);
+	fprintf(file,"\t-j\t\t-JSON output. CSV is a default\n");
+	fprintf(file,"\t-o\t\t-Output file location. If ommited, stdout is used\n");
+}
+
+static double get_time_sec()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * xorshift64*: the same sequence on every run
+ */
+static uint64_t next_rand(struct lookup_env *p_env)
+{
+	p_env->rand_state ^= p_env->rand_state >> 12;
+	p_env->rand_state ^= p_env->rand_state << 25;
+	p_env->rand_state ^= p_env->rand_state >> 27;
+	return p_env->rand_state * 2685821657736338717ULL;
+}
+
+static size_t get_count(const struct ssa_db *p_smdb, const int table_id)
+{
+	return ntohll(p_smdb->p_db_tables[table_id].set_count);
+}
+
+static int trace_init(struct lookup_trace *p_trace, const size_t size)
+{
+	p_trace->p_ops = (struct lookup_op *)malloc(size * sizeof(struct lookup_op));
+	p_trace->count = 0;
+	p_trace->size = size;
+	return p_trace->p_ops ? 0 : -1;
+}
+
+static inline void trace_add(struct lookup_trace *p_trace,
+		const be16_t lid, const be16_t lid2, const int port)
+{
+	struct lookup_op *p_op = NULL;
+
+	if(p_trace->count == p_trace->size)
+		return;
+	p_op = p_trace->p_ops + p_trace->count++;
+	p_op->lid = lid;
+	p_op->lid2 = lid2;
+	p_op->port = port;
+}
+
+static inline int trace_is_full(const struct lookup_trace *p_trace)
+{
+	return p_trace->count == p_trace->size;
+}
+
+static void trace_destroy(struct lookup_trace *p_trace)
+{
+	free(p_trace->p_ops);
+	p_trace->p_ops = NULL;
+}
+
+/*
+ * Destination LID number i: base LIDs of GUID_TO_LID records expanded
+ * by LMC.
+ */
+static be16_t get_dest_lid(const struct ssa_db *p_smdb, const uint64_t rand_val)
+{
+	const struct ep_guid_to_lid_tbl_rec *p_tbl =
+		(const struct ep_guid_to_lid_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_GUID_TO_LID];
+	const struct ep_guid_to_lid_tbl_rec *p_rec =
+		p_tbl + rand_val % get_count(p_smdb,SSA_TABLE_ID_GUID_TO_LID);
+
+	return htons(ntohs(p_rec->lid) + (rand_val >> 32) % (1 << p_rec->lmc));
+}
+
+static void fill_random(struct lookup_env *p_env,
+		struct lookup_trace traces[LOOKUP_PRIMITIVE_NUM])
+{
+	const struct ssa_db *p_smdb = p_env->p_smdb;
+	const struct ep_port_tbl_rec *p_ports =
+		(const struct ep_port_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_PORT];
+	const struct ep_link_tbl_rec *p_links =
+		(const struct ep_link_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_LINK];
+	const struct ep_lft_top_tbl_rec *p_tops =
+		(const struct ep_lft_top_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_LFT_TOP];
+	const size_t port_count = get_count(p_smdb,SSA_TABLE_ID_PORT);
+	const size_t link_count = get_count(p_smdb,SSA_TABLE_ID_LINK);
+	const size_t switch_count = get_count(p_smdb,SSA_TABLE_ID_LFT_TOP);
+	size_t i = 0;
+
+	for(i = 0; i < p_env->ops; ++i) {
+		const struct ep_port_tbl_rec *p_port = p_ports + next_rand(p_env) % port_count;
+		const struct ep_link_tbl_rec *p_link = p_links + next_rand(p_env) % link_count;
+
+		trace_add(&traces[LOOKUP_FIND_PORT],p_port->port_lid,0,p_port->port_num);
+		trace_add(&traces[LOOKUP_FIND_LINKED_PORT],p_link->from_lid,0,
+				p_link->from_port_num);
+		trace_add(&traces[LOOKUP_FIND_DESTINATION_PORT],
+				p_tops[next_rand(p_env) % switch_count].lid,
+				get_dest_lid(p_smdb,next_rand(p_env)),0);
+		trace_add(&traces[LOOKUP_COMPARE_RATES],
+				LOOKUP_MIN_RATE + next_rand(p_env) % (LOOKUP_MAX_RATE - LOOKUP_MIN_RATE + 1),
+				LOOKUP_MIN_RATE + next_rand(p_env) % (LOOKUP_MAX_RATE - LOOKUP_MIN_RATE + 1),0);
+	}
+}
+
+static void fill_sequential(struct lookup_env *p_env,
+		struct lookup_trace traces[LOOKUP_PRIMITIVE_NUM])
+{
+	const struct ssa_db *p_smdb = p_env->p_smdb;
+	const struct ep_port_tbl_rec *p_ports =
+		(const struct ep_port_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_PORT];
+	const struct ep_link_tbl_rec *p_links =
+		(const struct ep_link_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_LINK];
+	const struct ep_lft_top_tbl_rec *p_tops =
+		(const struct ep_lft_top_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_LFT_TOP];
+	const struct ep_guid_to_lid_tbl_rec *p_guids =
+		(const struct ep_guid_to_lid_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_GUID_TO_LID];
+	const size_t port_count = get_count(p_smdb,SSA_TABLE_ID_PORT);
+	const size_t link_count = get_count(p_smdb,SSA_TABLE_ID_LINK);
+	const size_t switch_count = get_count(p_smdb,SSA_TABLE_ID_LFT_TOP);
+	const size_t guid_count = get_count(p_smdb,SSA_TABLE_ID_GUID_TO_LID);
+	size_t i = 0, sw = 0, guid = 0;
+	unsigned int lid_offset = 0;
+	int rate1 = LOOKUP_MIN_RATE, rate2 = LOOKUP_MIN_RATE;
+
+	for(i = 0; i < p_env->ops; ++i) {
+		trace_add(&traces[LOOKUP_FIND_PORT],p_ports[i % port_count].port_lid,0,
+				p_ports[i % port_count].port_num);
+		trace_add(&traces[LOOKUP_FIND_LINKED_PORT],p_links[i % link_count].from_lid,0,
+				p_links[i % link_count].from_port_num);
+
+		/* switch major order, destination LIDs in GUID_TO_LID order */
+		trace_add(&traces[LOOKUP_FIND_DESTINATION_PORT],p_tops[sw].lid,
+				htons(ntohs(p_guids[guid].lid) + lid_offset),0);
+		if(++lid_offset == (1U << p_guids[guid].lmc)) {
+			lid_offset = 0;
+			if(++guid == guid_count) {
+				guid = 0;
+				sw = (sw + 1) % switch_count;
+			}
+		}
+
+		trace_add(&traces[LOOKUP_COMPARE_RATES],rate1,rate2,0);
+		if(++rate2 > LOOKUP_MAX_RATE) {
+			rate2 = LOOKUP_MIN_RATE;
+			if(++rate1 > LOOKUP_MAX_RATE)
+				rate1 = LOOKUP_MIN_RATE;
+		}
+	}
+}
+
+/*
+ * Hop by hop route walk in the same way as ssa_pr_path_params does it:
+ * links, forwarding tables and ports are taken from the routing graph of
+ * the index. Every hop records arguments of the lookup primitives that
+ * resolve the same link, forwarding table entry, port and rate.
+ */
+static void walk_route(struct lookup_env *p_env,
+		struct lookup_trace traces[LOOKUP_PRIMITIVE_NUM],
+		const struct ep_guid_to_lid_tbl_rec *p_source_rec,
+		const be16_t dest_lid)
+{
+	const struct ssa_db *p_smdb = p_env->p_smdb;
+	const struct ssa_pr_smdb_index *p_index = p_env->p_index;
+	const struct ep_port_tbl_rec *p_port_tbl =
+		(const struct ep_port_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_PORT];
+	const struct ep_port_tbl_rec *p_port = NULL;
+	uint32_t port_index = 0;
+	uint8_t rate_rank = 0;
+	int rate = 0;
+	int hops = 0;
+
+	p_port = find_port(p_smdb,p_index,p_source_rec->lid,-1);
+	trace_add(&traces[LOOKUP_FIND_PORT],p_source_rec->lid,0,-1);
+	if(!p_port)
+		return;
+	port_index = p_port - p_port_tbl;
+	rate = p_index->port_rate[port_index];
+	rate_rank = p_index->port_rate_rank[port_index];
+
+	while(hops++ < MAX_HOPS) {
+		const uint32_t from_index = port_index;
+		int out_port_num = -1;
+
+		trace_add(&traces[LOOKUP_FIND_LINKED_PORT],p_port_tbl[from_index].port_lid,0,
+				p_port_tbl[from_index].port_num);
+		port_index = p_index->port_link[from_index];
+		if(SSA_PR_NO_INDEX == port_index || !p_index->port_is_switch[port_index] ||
+				p_port_tbl[port_index].port_lid == dest_lid)
+			return;
+
+		trace_add(&traces[LOOKUP_COMPARE_RATES],rate,p_index->port_rate[port_index],0);
+		if(p_index->port_rate_rank[port_index] < rate_rank) {
+			rate_rank = p_index->port_rate_rank[port_index];
+			rate = p_index->port_rate[port_index];
+		}
+
+		trace_add(&traces[LOOKUP_FIND_DESTINATION_PORT],p_port_tbl[port_index].port_lid,dest_lid,0);
+		out_port_num = route_out_port(p_index,port_index,dest_lid);
+		if(out_port_num < 0 || LFT_NO_PATH == out_port_num)
+			return;
+
+		trace_add(&traces[LOOKUP_FIND_PORT],p_port_tbl[port_index].port_lid,0,out_port_num);
+		port_index = route_switch_port(p_smdb,p_index,port_index,out_port_num);
+		if(SSA_PR_NO_INDEX == port_index)
+			return;
+
+		trace_add(&traces[LOOKUP_COMPARE_RATES],rate,p_index->port_rate[port_index],0);
+		if(p_index->port_rate_rank[port_index] < rate_rank) {
+			rate_rank = p_index->port_rate_rank[port_index];
+			rate = p_index->port_rate[port_index];
+		}
+	}
+}
+
+static void fill_route(struct lookup_env *p_env,
+		struct lookup_trace traces[LOOKUP_PRIMITIVE_NUM])
+{
+	const struct ssa_db *p_smdb = p_env->p_smdb;
+	const struct ep_guid_to_lid_tbl_rec *p_guids =
+		(const struct ep_guid_to_lid_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_GUID_TO_LID];
+	const size_t guid_count = get_count(p_smdb,SSA_TABLE_ID_GUID_TO_LID);
+	size_t walks = 0;
+	int i = 0, full = 0;
+
+	/* A walk adds at least one call of every primitive but rate comparison */
+	while(full < LOOKUP_PRIMITIVE_NUM && walks++ < 16 * p_env->ops) {
+		const struct ep_guid_to_lid_tbl_rec *p_source_rec =
+			p_guids + next_rand(p_env) % guid_count;
+
+		if(p_source_rec->is_switch)
+			continue;
+		walk_route(p_env,traces,p_source_rec,get_dest_lid(p_smdb,next_rand(p_env)));
+
+		for(i = 0, full = 0; i < LOOKUP_PRIMITIVE_NUM; ++i)
+			full += trace_is_full(&traces[i]);
+	}
+}
+
+static uintptr_t run_primitive(const struct lookup_env *p_env,
+		const int primitive,
+		const struct lookup_trace *p_trace)
+{
+	const struct ssa_db *p_smdb = p_env->p_smdb;
+	const struct ssa_pr_smdb_index *p_index = p_env->p_index;
+	const struct lookup_op *p_op = p_trace->p_ops;
+	const struct lookup_op *p_end = p_trace->p_ops + p_trace->count;
+	uintptr_t sum = 0;
+
+	switch(primitive) {
+		case LOOKUP_FIND_PORT:
+			for(; p_op < p_end; ++p_op)
+				sum += (uintptr_t)find_port(p_smdb,p_index,p_op->lid,p_op->port);
+			break;
+		case LOOKUP_FIND_LINKED_PORT:
+			for(; p_op < p_end; ++p_op)
+				sum += (uintptr_t)find_linked_port(p_smdb,p_index,p_op->lid,p_op->port);
+			break;
+		case LOOKUP_FIND_DESTINATION_PORT:
+			for(; p_op < p_end; ++p_op)
+				sum += find_destination_port(p_smdb,p_index,p_op->lid,p_op->lid2);
+			break;
+		case LOOKUP_COMPARE_RATES:
+			for(; p_op < p_end; ++p_op)
+				sum += ib_path_compare_rates_fast(p_op->lid,p_op->lid2);
+			break;
+		default:
+			break;
+	}
+	return sum;
+}
+
+static void print_header(FILE *fd, const int json)
+{
+	if(json)
+		fprintf(fd,"[\n");
+	else
+		fprintf(fd,"topology,switches,hosts,primitive,pattern,ops,seconds,ns_per_op,"
+				"l1d_misses_per_op,llc_misses_per_op\n");
+}
+
+static void print_footer(FILE *fd, const int json)
+{
+	if(json)
+		fprintf(fd,"\n]\n");
+}
+
+static void print_counter(FILE *fd, const int json,
+		const struct perf_counters *p_counters,
+		const int id, const size_t ops)
+{
+	if(!perf_counters_is_available(p_counters,id))
+		fputs(json ? "null" : "",fd);
+	else
+		fprintf(fd,"%.4f",ops ? (double)p_counters->values[id] / ops : 0);
+}
+
+static void print_result(FILE *fd, const int json,
+		const char *topology,
+		const struct topo_gen_stats *p_stats,
+		const int primitive, const int pattern,
+		const size_t ops, const double seconds,
+		const struct perf_counters *p_counters)
+{
+	const double ns_per_op = ops ? seconds * 1e9 / ops : 0;
+
+	if(json) {
+		fprintf(fd,"%s  {\"topology\": \"%s\", \"switches\": %zu, \"hosts\": %zu, "
+				"\"primitive\": \"%s\", \"pattern\": \"%s\", \"ops\": %zu, "
+				"\"seconds\": %.6f, \"ns_per_op\": %.3f, \"l1d_misses_per_op\": ",
+				result_count ? ",\n" : "",topology,p_stats->switches,p_stats->hosts,
+				primitive_names[primitive],pattern_names[pattern],ops,seconds,ns_per_op);
+		print_counter(fd,json,p_counters,PERF_CNT_L1D_MISSES,ops);
+		fprintf(fd,", \"llc_misses_per_op\": ");
+		print_counter(fd,json,p_counters,PERF_CNT_LLC_MISSES,ops);
+		fprintf(fd,"}");
+	} else {
+		fprintf(fd,"%s,%zu,%zu,%s,%s,%zu,%.6f,%.3f,",topology,p_stats->switches,
+				p_stats->hosts,primitive_names[primitive],pattern_names[pattern],
+				ops,seconds,ns_per_op);
+		print_counter(fd,json,p_counters,PERF_CNT_L1D_MISSES,ops);
+		fprintf(fd,",");
+		print_counter(fd,json,p_counters,PERF_CNT_LLC_MISSES,ops);
+		fprintf(fd,"\n");
+	}
+	fflush(fd);
+	result_count++;
+}
+
+static int run_lookup_bench(FILE *fd, const int json,
+		const struct topo_gen_prm *p_topo_prm, const size_t ops)
+{
+	struct topo_gen_stats stats;
+	struct ssa_db *p_smdb = NULL;
+	struct ssa_pr_smdb_index *p_index = NULL;
+	struct lookup_trace traces[LOOKUP_PRIMITIVE_NUM];
+	struct perf_counters counters;
+	struct lookup_env env;
+	void *p_context = NULL;
+	int pattern = 0, primitive = 0;
+	int res = -1;
+
+	memset(traces,'\0',sizeof(traces));
+	perf_counters_open(&counters);
+
+	p_smdb = topo_gen_create(p_topo_prm,&stats);
+	if(!p_smdb) {
+		fprintf(stderr,"Fabric generation is failed\n");
+		goto Exit;
+	}
+
+	/* The context initializes Access Layer logging */
+	p_context = ssa_pr_create_context(stderr,1);
+	if(!p_context) {
+		fprintf(stderr,"Can't create path record calculation context\n");
+		goto Exit;
+	}
+
+	p_index = (struct ssa_pr_smdb_index *)malloc(sizeof(*p_index));
+	if(!p_index) {
+		fprintf(stderr,"Can't allocate smdb index\n");
+		goto Exit;
+	}
+	memset(p_index,'\0',sizeof(*p_index));
+	p_index->epoch = -1;
+	if(ssa_pr_rebuild_indexes(p_index,p_smdb)) {
+		fprintf(stderr,"smdb index build is failed\n");
+		goto Exit;
+	}
+
+	memset(&env,'\0',sizeof(env));
+	env.p_smdb = p_smdb;
+	env.p_index = p_index;
+	env.ops = ops;
+
+	print_header(fd,json);
+	for(pattern = 0; pattern < LOOKUP_PATTERN_NUM; ++pattern) {
+		env.rand_state = 0x9E3779B97F4A7C15ULL;
+		for(primitive = 0; primitive < LOOKUP_PRIMITIVE_NUM; ++primitive) {
+			trace_destroy(&traces[primitive]);
+			if(trace_init(&traces[primitive],ops)) {
+				fprintf(stderr,"Can't allocate arguments. Calls: %zu\n",ops);
+				goto Exit;
+			}
+		}
+
+		if(LOOKUP_PATTERN_RANDOM == pattern)
+			fill_random(&env,traces);
+		else if(LOOKUP_PATTERN_SEQUENTIAL == pattern)
+			fill_sequential(&env,traces);
+		else
+			fill_route(&env,traces);
+
+		for(primitive = 0; primitive < LOOKUP_PRIMITIVE_NUM; ++primitive) {
+			double start = 0, seconds = 0;
+
+			/* warm up */
+			lookup_sink += run_primitive(&env,primitive,&traces[primitive]);
+
+			perf_counters_start(&counters);
+			start = get_time_sec();
+			lookup_sink += run_primitive(&env,primitive,&traces[primitive]);
+			seconds = get_time_sec() - start;
+			perf_counters_stop(&counters);
+
+			print_result(fd,json,topo_gen_type_name(p_topo_prm->type),&stats,
+					primitive,pattern,traces[primitive].count,seconds,&counters);
+		}
+	}
+	print_footer(fd,json);
+
+	res = 0;
+Exit:
+	for(primitive = 0; primitive < LOOKUP_PRIMITIVE_NUM; ++primitive)
+		trace_destroy(&traces[primitive]);
+	if(p_index) {
+		ssa_pr_destroy_indexes(p_index);
+		free(p_index);
+		p_index = NULL;
+	}
+	if(p_context) {
+		ssa_pr_destroy_context(p_context);
+		p_context = NULL;
+	}
+	if(p_smdb) {
+		ssa_db_destroy(p_smdb);
+		p_smdb = NULL;
+	}
+	perf_counters_close(&counters);
+	return res;
+}
+
+int main(int argc,char *argv[])
+{
+	int opt = 0;
+	struct topo_gen_prm topo_prm;
+	char output_path[PATH_MAX] = {};
+	FILE *fd = stdout;
+	unsigned int size = 16;
+	size_t ops = LOOKUP_DEFAULT_OPS;
+	int json = 0;
+	int res = 0;
+
+	memset(&topo_prm,'\0',sizeof(topo_prm));
+	topo_prm.type = TOPO_GEN_FAT_TREE;
+	topo_prm.levels = 3;
+
+	while ((opt = getopt(argc, argv, "t:s:n:p:m:N:jo:h?")) != -1) {
+		switch (opt) {
+			case 't':
+				topo_prm.type = topo_gen_type_by_name(optarg);
+				if(TOPO_GEN_TYPE_MAX == topo_prm.type) {
+					fprintf(stderr,"Unknown topology: %s\n",optarg);
+					print_usage(stderr,argv[0]);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 's':
+				size = atoi(optarg);
+				break;
+			case 'n':
+				topo_prm.levels = atoi(optarg);
+				break;
+			case 'p':
+				topo_prm.hosts = atoi(optarg);
+				break;
+			case 'm':
+				topo_prm.lmc = atoi(optarg);
+				break;
+			case 'N':
+				ops = strtoul(optarg,NULL,0);
+				break;
+			case 'j':
+				json = 1;
+				break;
+			case 'o':
+				strncpy(output_path,optarg,PATH_MAX - 1);
+				break;
+			case '?':
+			case 'h':
+				print_usage(stdout,argv[0]);
+				return 0;
+				break;
+			default: /* '?' */
+				if(isprint (optopt))
+					fprintf (stderr, "Unknown option `-%c'.\n", optopt);
+				else
+					fprintf (stderr,
+							"Unknown option character `\\x%x'.\n",
+							optopt);
+				print_usage(stderr,argv[0]);
+				exit(EXIT_FAILURE);
+		}
+	}
+
+	if(!ops || !size) {
+		fprintf(stderr,"Number of calls and fabric size have to be positive\n");
+		exit(EXIT_FAILURE);
+	}
+
+	switch(topo_prm.type) {
+		case TOPO_GEN_FAT_TREE:
+			topo_prm.radix = size;
+			break;
+		case TOPO_GEN_TORUS_2D:
+		case TOPO_GEN_TORUS_3D:
+			topo_prm.dims[0] = topo_prm.dims[1] = topo_prm.dims[2] = size;
+			break;
+		case TOPO_GEN_DRAGONFLY:
+			topo_prm.routers = size;
+			topo_prm.global_links = size / 2 ? size / 2 : 1;
+			break;
+		default:
+			break;
+	}
+
+	if(strlen(output_path)) {
+		fd = fopen(output_path,"w");
+		if(!fd) {
+			fprintf(stderr,"Can't open file for writing: %s\n",output_path);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	res = run_lookup_bench(fd,json,&topo_prm,ops);
+
+	if(fd != stdout)
+		fclose(fd);
+
+	return res ? EXIT_FAILURE : 0;
+}
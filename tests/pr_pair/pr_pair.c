@@ -51,7 +51,9 @@
 #include <ssa_prdb.h>
 #include <ssa_db_helper.h>
 #include <infiniband/ssa_path_record.h>
+#include <infiniband/ssa_path_record_ext.h>
 
+#define PRDB_BINARY_FILE "prdb.bin"
 
 static const char *log_verbosity_level[] = {"No log","Error","Info","Debug"};
 
@@ -59,7 +61,7 @@ static void print_usage(FILE *file,const char *name)
 {
 	int i = 0;
 
-	fprintf(file,"Usage: %s [-h] [-o output file | -O output folder] [-n number | -f file name | -a] [-l | -g] [-L file name] [-v number] input folder\n", name);
+	fprintf(file,"Usage: %s [-h] [-o output file | -O output folder] [-n number | -f file name | -a] [-l | -g] [-L file name] [-v number] [-t number] [-D] [-s] [-A] [-G] [-B] [-M] input folder\n", name);
 	fprintf(file,"\t-h\t\t-Print this help\n");
 	fprintf(file,"\t-o\t\t-Output file location. If ommited, stdout is used\n");
 	fprintf(file,"\t-O\t\t-PRDB location\n");
@@ -69,9 +71,18 @@ static void print_usage(FILE *file,const char *name)
 	fprintf(file,"\t-l\t\t-Input ID is LID\n");
 	fprintf(file,"\t-g\t\t-Input ID is GUID. It's a default parameter\n");
 	fprintf(file,"\t-L\t\t-Access Layer log file path. If ommited, stdout is used.\n");
+	fprintf(file,"\t-t\t\t-Number of threads for \"whole world\" computation. 0 - number of CPUs\n");
+	fprintf(file,"\t-D\t\t-Use destination rooted engine for \"whole world\" computation\n");
+	fprintf(file,"\t-s\t\t-Print statistics and latency histograms of path record computation\n");
+	fprintf(file,"\t-A\t\t-Asynchronous logging\n");
+	fprintf(file,"\t-G\t\t-Degraded fabric mode. Failed paths are skipped and reported\n");
+	fprintf(file,"\t-B\t\t-Save PRDB in the binary format to <PRDB location>/%s\n",PRDB_BINARY_FILE);
+	fprintf(file,"\t-M\t\t-Compute \"whole world\" into a path attribute matrix\n");
 	fprintf(file,"\t-v\t\t-Log verbosity level. Default value is 1\n");
 	for(i = 0; i < sizeof(log_verbosity_level) / sizeof(log_verbosity_level[0]); ++i)
 		fprintf(file,"\t\t\t\t-%d - %s.\n",i,log_verbosity_level[i]);
+	fprintf(file,"\t\t\t\t Debug messages are compiled in only if the access layer\n"
+			"\t\t\t\t is configured with --enable-debug.\n");
 	fprintf(file,"\tinput folder\t-SMDB database\n");
 }
 
@@ -137,6 +148,14 @@ struct input_prm
 	uint8_t whole_world;
 	uint8_t is_guid;
 	uint8_t log_verbosity;
+	uint8_t use_threads;
+	uint8_t use_dp_engine;
+	uint8_t print_stats;
+	uint8_t async_log;
+	uint8_t degraded;
+	uint8_t binary_prdb;
+	uint8_t matrix;
+	unsigned int threads;
 };
 
 
@@ -168,6 +187,10 @@ static void print_input_prm(const struct input_prm *prm)
 
 	if(prm->whole_world) {
 		printf("Compute \"whole world\" path records.\n");
+		if(prm->use_threads)
+			printf("Threads: %u\n",prm->threads);
+		if(prm->use_dp_engine)
+			printf("Destination rooted engine is used.\n");
 		return;
 	}
 }
@@ -253,6 +276,59 @@ static void dump_pr(GPtrArray *path_arr,struct ssa_db *p_smdb,FILE *fd)
 	fprintf(fd,"\n");
 }
 
+/*
+ * The same output as dump_pr. LIDs of a port share a matrix cell.
+ */
+static void dump_matrix(const struct ssa_pr_matrix *p_matrix,struct ssa_db *p_smdb,FILE *fd)
+{
+	uint16_t *p_lids = NULL;
+	size_t lid_count = 0, i = 0, j = 0;
+	uint32_t lid = 0;
+	short first_line = 1;
+
+	p_lids = (uint16_t *)malloc(0xFFFF * sizeof(*p_lids));
+	if(!p_lids) {
+		fprintf(stderr,"Can't allocate LID array\n");
+		return;
+	}
+	for(lid = 1; lid < 0xFFFF; ++lid)
+		if(SSA_PR_MATRIX_NO_ID != ssa_pr_matrix_id_by_lid(p_matrix,htons(lid)))
+			p_lids[lid_count++] = lid;
+
+	for(i = 0; i < lid_count; ++i) {
+		const uint32_t source_id = ssa_pr_matrix_id_by_lid(p_matrix,htons(p_lids[i]));
+		short header = 0;
+
+		for(j = 0; j < lid_count; ++j) {
+			const uint32_t dest_id = ssa_pr_matrix_id_by_lid(p_matrix,htons(p_lids[j]));
+			ssa_path_parms_t path_prm;
+
+			if(SSA_PR_SUCCESS != ssa_pr_matrix_path(p_matrix,source_id,dest_id,&path_prm))
+				continue;
+
+			if(!header) {
+				const struct ep_port_tbl_rec *p_port_rec = find_port(p_smdb,htons(p_lids[i]));
+				const struct ep_guid_to_lid_tbl_rec *p_guid_to_lid_rec = find_guid_to_lid_rec_by_lid(p_smdb,htons(p_lids[i]));
+
+				assert(p_port_rec && p_guid_to_lid_rec );
+
+				header = 1;
+				if(first_line)
+					first_line = 0;
+				else
+					fprintf(fd,"\n");
+
+				fprintf(fd,"%s 0x%016"PRIx64", base LID %"SCNu16", port %u\n",!p_guid_to_lid_rec->is_switch?"Channel Adapter":"Switch",
+						ntohll(p_guid_to_lid_rec->guid),ntohs(p_guid_to_lid_rec->lid),p_port_rec->port_num);
+				fprintf(fd,"# LID  : SL : MTU : RATE\n");
+			}
+			fprintf(fd,"0x%04X"" : %-2d : %-3d : %-4d\n",p_lids[j],0,path_prm.mtu,path_prm.rate);
+		}
+	}
+	fprintf(fd,"\n");
+	free(p_lids);
+}
+
 static void ssa_pr_path_output(const ssa_path_parms_t *p_path_prm, void *prm)
 {
 	ssa_path_parms_t *p_my_path = NULL;
@@ -378,6 +454,50 @@ static size_t get_input_guids(const struct input_prm *p_prm,
 	return 0;
 }
 
+static void print_pr_stats(void *p_context,FILE *fd)
+{
+	struct ssa_pr_stats stats;
+
+	if(ssa_pr_get_stats(p_context,&stats)) {
+		fprintf(stderr,"Can't get path record statistics\n");
+		return;
+	}
+
+	fprintf(fd,"Path records: %"PRIu64" no path: %"PRIu64" errors: %"PRIu64" hops: %"PRIu64"\n",
+			stats.paths,stats.no_paths,stats.errors,stats.hops);
+	fprintf(fd,"Index rebuilds: %"PRIu64" time: %"PRIu64" ns memory: %"PRIu64" bytes\n",
+			stats.index_rebuilds,stats.index_rebuild_ns,stats.index_memory);
+	fprintf(fd,"\"Half world\" calls: %"PRIu64" time: %"PRIu64" ns\n",
+			stats.half_world_calls,stats.half_world_ns);
+	fprintf(fd,"\"Whole world\" calls: %"PRIu64" time: %"PRIu64" ns\n",
+			stats.whole_world_calls,stats.whole_world_ns);
+	fprintf(fd,"Pair queries: %"PRIu64" cache hits: %"PRIu64"\n",
+			stats.query_calls,stats.query_hits);
+	ssa_pr_dump_latency(p_context,fd);
+}
+
+static void print_pr_fail_stats(void *p_context,FILE *fd)
+{
+	struct ssa_pr_fail_stats stats;
+	struct ssa_pr_fail_location locations[8];
+	size_t i = 0, count = 0;
+
+	if(ssa_pr_get_fail_stats(p_context,&stats)) {
+		fprintf(stderr,"Can't get path record failure statistics\n");
+		return;
+	}
+
+	fprintf(fd,"Failed paths: %"PRIu64" failed reverse paths: %"PRIu64
+			" failing switches: %"PRIu64" locations: %"PRIu64"\n",
+			stats.pairs,stats.reverse_pairs,stats.switches,stats.locations);
+
+	count = ssa_pr_get_fail_locations(p_context,locations,
+			sizeof(locations) / sizeof(locations[0]));
+	for(i = 0; i < count; ++i)
+		fprintf(fd,"\tLID: 0x%04"PRIx16" port: %u failures: %"PRIu64"\n",
+				ntohs(locations[i].lid),locations[i].port_num,locations[i].count);
+}
+
 static int run_pr_calculation(struct input_prm* p_prm)
 {
 	short dump_to_stdout = 0;
@@ -395,6 +515,7 @@ static int run_pr_calculation(struct input_prm* p_prm)
 	int res = 0;
 	ssa_pr_status_t pr_res = SSA_PR_SUCCESS;
 	struct ssa_db *p_prdb = NULL;
+	struct ssa_pr_matrix *p_matrix = NULL;
 
 	if(!strlen(p_prm->log_path) || !strcmp(p_prm->log_path,"stderr"))
 		fd_log = stderr;
@@ -452,6 +573,18 @@ static int run_pr_calculation(struct input_prm* p_prm)
 		goto Exit;
 	}
 
+	if(p_prm->async_log && ssa_pr_log_async_start(0))
+		fprintf(stderr,"Can't start asynchronous logging. Synchronous logging is used\n");
+
+	if(p_prm->degraded)
+		ssa_pr_set_degraded_mode(p_context,1);
+
+	if(p_prm->use_dp_engine && ssa_pr_set_engine(p_context,SSA_PR_ENGINE_DP)) {
+		fprintf(stderr,"Can't set destination rooted engine\n");
+		res = -1;
+		goto Exit;
+	}
+
 	if(dump_to_prdb) {
 		get_input_guids(p_prm,p_db_diff,guids_arr);
 		if(guids_arr->len) {
@@ -474,6 +607,14 @@ static int run_pr_calculation(struct input_prm* p_prm)
 
 			pr_res = ssa_pr_half_world(p_db_diff,p_context,guid,ssa_pr_path_output,path_arr);
 		}
+	} else if(p_prm->matrix) {
+		p_matrix = ssa_pr_matrix_create(p_db_diff,p_context,
+				p_prm->use_threads ? p_prm->threads : 1);
+		if(!p_matrix)
+			pr_res = SSA_PR_ERROR;
+	} else if(p_prm->use_threads) {
+		pr_res = ssa_pr_whole_world_mt(p_db_diff,p_context,p_prm->threads,0,
+				ssa_pr_path_output,path_arr);
 	} else {
 		pr_res = ssa_pr_whole_world(p_db_diff,p_context,ssa_pr_path_output,path_arr);
 	}	
@@ -484,9 +625,31 @@ static int run_pr_calculation(struct input_prm* p_prm)
 		goto Exit;
 	}
 
-	if(!dump_to_prdb) {
+	if(p_prm->print_stats)
+		print_pr_stats(p_context,stdout);
+	if(p_prm->print_stats && p_prm->degraded)
+		print_pr_fail_stats(p_context,stdout);
+
+	if(p_matrix) {
+		printf("%"PRIu32" x %"PRIu32" path matrix, %zu bytes\n",
+				ssa_pr_matrix_size(p_matrix),ssa_pr_matrix_size(p_matrix),
+				ssa_pr_matrix_memory(p_matrix));
+		dump_matrix(p_matrix,p_db_diff,fd_dump);
+	} else if(!dump_to_prdb) {
 		printf("%u path records found\n",path_arr->len);
 		dump_pr(path_arr,p_db_diff,fd_dump);
+	} else if(p_prm->binary_prdb) {
+		char file_path[PATH_MAX];
+
+		snprintf(file_path,sizeof(file_path),"%s/%s",p_prm->prdb_path,PRDB_BINARY_FILE);
+		if(ssa_prdb_save_file(p_prdb,file_path)) {
+			fprintf(stderr,"Can't save prdb database: %s\n",file_path);
+			res = -1;
+		} else {
+			fprintf(stdout,"prdb database is created: %s\n",file_path);
+		}
+		ssa_db_destroy(p_prdb);
+		p_prdb = NULL;
 	} else {
 		ssa_db_save(p_prm->prdb_path,p_prdb,SSA_DB_HELPER_DEBUG);
 		fprintf(stdout,"prdb database is created\n");
@@ -495,6 +658,16 @@ static int run_pr_calculation(struct input_prm* p_prm)
 	}
 
 Exit:
+	if(p_prm->async_log) {
+		uint64_t dropped = ssa_pr_log_async_stop();
+
+		if(dropped)
+			fprintf(stderr,"%"PRIu64" log messages are dropped\n",dropped);
+	}
+	if(p_matrix) {
+		ssa_pr_matrix_destroy(p_matrix);
+		p_matrix = NULL;
+	}
 	if(p_context ) {
 		ssa_pr_destroy_context(p_context);
 		p_context = NULL;
@@ -549,14 +722,16 @@ int main(int argc,char *argv[])
 	short use_log_opt = 0;
 	short use_verbosity_opt =0;
 	short use_prdb_dump = 0;
+	short use_threads_opt = 0;
 	short err_opt = 0;
 	uint64_t id = 0; 
 	char id_string_val[PATH_MAX] = {};
 	char verbosity_string_val[PATH_MAX] = {};
+	char threads_string_val[PATH_MAX] = {};
 
 	memset(&prm,'\0',sizeof(prm));
 
-	while ((opt = getopt(argc, argv, "glan:f:o:O:hL:v:?")) != -1) {
+	while ((opt = getopt(argc, argv, "glan:f:o:O:hL:v:t:DsAGBM?")) != -1) {
 		switch (opt) {
 			case 'O':
 				use_prdb_dump  = 1;
@@ -583,6 +758,28 @@ int main(int argc,char *argv[])
 					strncpy(id_string_val,optarg,PATH_MAX);
 				}
 				break;
+			case 't':
+				use_threads_opt = 1;
+				strncpy(threads_string_val,optarg,PATH_MAX);
+				break;
+			case 'D':
+				prm.use_dp_engine = 1;
+				break;
+			case 's':
+				prm.print_stats = 1;
+				break;
+			case 'A':
+				prm.async_log = 1;
+				break;
+			case 'G':
+				prm.degraded = 1;
+				break;
+			case 'B':
+				prm.binary_prdb = 1;
+				break;
+			case 'M':
+				prm.matrix = 1;
+				break;
 			case 'v':
 				use_verbosity_opt  = 1;
 				strncpy(verbosity_string_val,optarg,PATH_MAX);
@@ -640,6 +837,12 @@ int main(int argc,char *argv[])
 
 	prm.whole_world = use_all_opt;
 
+	if(prm.matrix && (!prm.whole_world || use_prdb_dump)) {
+		fprintf (stderr, "Incompatible options.\n");
+		print_usage(stderr,argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
 	if(!use_lid_opt && !use_guid_opt)
 		/*It's a default option*/
 		use_guid_opt = 1;
@@ -686,6 +889,19 @@ int main(int argc,char *argv[])
 		prm.log_verbosity = 1;
 	}
 
+	if(use_threads_opt) {
+		unsigned int threads = 0;
+
+		if(1 != sscanf(threads_string_val,"%u",&threads)) {
+			fprintf(stderr,"String : %s can't be converted to numeric value.\n"
+					,threads_string_val);
+			print_usage(stderr,argv[0]);
+			exit(EXIT_FAILURE);
+		}
+		prm.use_threads = 1;
+		prm.threads = threads;
+	}
+
 	if(strlen(log_path)) {
 		if(is_file_exist(log_path)) {
 			fprintf(stderr,"Log file will be replaced: %s\n",log_path);
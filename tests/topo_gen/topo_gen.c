@@ -0,0 +1,742 @@
+/*
+ * Copyright 2004-2013 Mellanox Technologies LTD. All rights reserved.
+ *
+ * This software is available to you under the terms of the
+ * OpenIB.org BSD license included below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <byteswap.h>
+
+#include <ssa_db.h>
+#include <ssa_smdb.h>
+
+#include "topo_gen.h"
+
+#define TOPO_NO_PEER 0xFFFFFFFF
+#define TOPO_NO_PATH 255
+#define TOPO_MAX_UNICAST_LID 0xBFFF
+#define TOPO_MAX_PORTS 254
+#define TOPO_LFT_BLOCK_SIZE 64
+#define TOPO_SWITCH_GUID_BASE 0x0002c90200000000ULL
+#define TOPO_HOST_GUID_BASE 0x0002c90300000000ULL
+#define TOPO_SUBNET_PREFIX 0xfe80000000000000ULL
+
+#define TOPO_DEFAULT_MTU 5 /* 4096 */
+#define TOPO_DEFAULT_RATE 3 /* 10 Gb/s x 4 */
+#define TOPO_DEFAULT_SUBNET_TIMEOUT 18
+
+/*
+ * Fabric graph. Nodes 0 .. switch_count - 1 are switches, the rest are
+ * channel adapters (hosts). Every host has one port that is linked to a
+ * switch.
+ *
+ *@p_peer - index: switch * (switch_ports + 1) + port number,
+ *          value: linked node or TOPO_NO_PEER.
+ *@p_peer_port - the same index, value: port number of linked node.
+ *@p_host_switch, p_host_port - switch and switch's port of a host.
+ *@p_lid - base LID of a node.
+ */
+struct topo_fabric {
+	size_t switch_count;
+	size_t host_count;
+	unsigned int switch_ports;
+	uint32_t *p_peer;
+	uint8_t *p_peer_port;
+	uint32_t *p_host_switch;
+	uint8_t *p_host_port;
+	uint16_t *p_lid;
+	size_t link_count;
+	uint8_t lmc;
+	uint16_t max_lid;
+};
+
+static const char *topo_type_names[TOPO_GEN_TYPE_MAX] = {
+	"fat-tree", "torus-2d", "torus-3d", "dragonfly"
+};
+
+static inline size_t peer_slot(const struct topo_fabric *p_fabric,
+		const size_t switch_id,
+		const unsigned int port_num)
+{
+	return switch_id * (p_fabric->switch_ports + 1) + port_num;
+}
+
+static int fabric_alloc(struct topo_fabric *p_fabric,
+		const size_t switch_count,
+		const unsigned int switch_ports,
+		const size_t host_count)
+{
+	const size_t slot_count = switch_count * (switch_ports + 1);
+
+	memset(p_fabric,0,sizeof(*p_fabric));
+
+	if(switch_ports > TOPO_MAX_PORTS) {
+		fprintf(stderr,"Too many switch ports: %u. Max: %u\n",
+				switch_ports,TOPO_MAX_PORTS);
+		return -1;
+	}
+
+	p_fabric->switch_count = switch_count;
+	p_fabric->host_count = host_count;
+	p_fabric->switch_ports = switch_ports;
+
+	p_fabric->p_peer = (uint32_t *)malloc(slot_count * sizeof(uint32_t));
+	p_fabric->p_peer_port = (uint8_t *)calloc(slot_count,sizeof(uint8_t));
+	p_fabric->p_host_switch = (uint32_t *)malloc((host_count + 1) * sizeof(uint32_t));
+	p_fabric->p_host_port = (uint8_t *)calloc(host_count + 1,sizeof(uint8_t));
+	p_fabric->p_lid = (uint16_t *)calloc(switch_count + host_count,sizeof(uint16_t));
+	if(!p_fabric->p_peer || !p_fabric->p_peer_port || !p_fabric->p_host_switch ||
+			!p_fabric->p_host_port || !p_fabric->p_lid) {
+		fprintf(stderr,"Can't allocate fabric graph. Switches: %zu hosts: %zu\n",
+				switch_count,host_count);
+		return -1;
+	}
+
+	memset(p_fabric->p_peer,0xFF,slot_count * sizeof(uint32_t));
+	memset(p_fabric->p_host_switch,0xFF,(host_count + 1) * sizeof(uint32_t));
+	return 0;
+}
+
+static void fabric_free(struct topo_fabric *p_fabric)
+{
+	free(p_fabric->p_peer);
+	free(p_fabric->p_peer_port);
+	free(p_fabric->p_host_switch);
+	free(p_fabric->p_host_port);
+	free(p_fabric->p_lid);
+	memset(p_fabric,0,sizeof(*p_fabric));
+}
+
+static void link_switches(struct topo_fabric *p_fabric,
+		const size_t switch_a, const unsigned int port_a,
+		const size_t switch_b, const unsigned int port_b)
+{
+	const size_t slot_a = peer_slot(p_fabric,switch_a,port_a);
+	const size_t slot_b = peer_slot(p_fabric,switch_b,port_b);
+
+	p_fabric->p_peer[slot_a] = switch_b;
+	p_fabric->p_peer_port[slot_a] = port_b;
+	p_fabric->p_peer[slot_b] = switch_a;
+	p_fabric->p_peer_port[slot_b] = port_a;
+	p_fabric->link_count++;
+}
+
+static void link_host(struct topo_fabric *p_fabric,
+		const size_t host, const size_t switch_id,
+		const unsigned int port_num)
+{
+	const size_t slot = peer_slot(p_fabric,switch_id,port_num);
+
+	p_fabric->p_peer[slot] = p_fabric->switch_count + host;
+	p_fabric->p_peer_port[slot] = 1;
+	p_fabric->p_host_switch[host] = switch_id;
+	p_fabric->p_host_port[host] = port_num;
+	p_fabric->link_count++;
+}
+
+/*
+ * Hosts are attached to ports 1 .. hosts of the given leaf switches.
+ */
+static void link_hosts(struct topo_fabric *p_fabric,
+		const size_t first_leaf,
+		const size_t leaf_count,
+		const unsigned int hosts)
+{
+	size_t i = 0, host = 0;
+	unsigned int j = 0;
+
+	for(i = 0; i < leaf_count; ++i)
+		for(j = 1; j <= hosts; ++j)
+			link_host(p_fabric,host++,first_leaf + i,j);
+}
+
+static int build_fat_tree(struct topo_fabric *p_fabric,
+		const struct topo_gen_prm *p_prm)
+{
+	const unsigned int k = p_prm->radix;
+	const unsigned int half = k / 2;
+	const unsigned int hosts = p_prm->hosts;
+	size_t leaf, spine, pod, edge, agg, core;
+	unsigned int j = 0;
+
+	if(k < 2 || k % 2) {
+		fprintf(stderr,"Fat tree radix has to be even: %u\n",k);
+		return -1;
+	}
+
+	if(2 == p_prm->levels) {
+		/* leaves: 0 .. k - 1, spines: k .. k + half - 1 */
+		if(fabric_alloc(p_fabric,k + half,
+					hosts + half > k ? hosts + half : k,k * hosts))
+			return -1;
+
+		for(leaf = 0; leaf < k; ++leaf)
+			for(j = 0; j < half; ++j) {
+				spine = k + j;
+				link_switches(p_fabric,leaf,hosts + 1 + j,spine,leaf + 1);
+			}
+		link_hosts(p_fabric,0,k,hosts);
+		return 0;
+	}
+
+	if(3 != p_prm->levels) {
+		fprintf(stderr,"Fat tree has to have 2 or 3 levels: %u\n",p_prm->levels);
+		return -1;
+	}
+
+	/*
+	 * edge switches: 0 .. k * half - 1
+	 * aggregation switches: k * half .. k * k - 1
+	 * core switches: k * k .. k * k + half * half - 1
+	 */
+	if(fabric_alloc(p_fabric,k * k + half * half,
+				hosts + half > k ? hosts + half : k,k * half * hosts))
+		return -1;
+
+	for(pod = 0; pod < k; ++pod) {
+		for(edge = 0; edge < half; ++edge)
+			for(j = 0; j < half; ++j) {
+				agg = k * half + pod * half + j;
+				link_switches(p_fabric,pod * half + edge,hosts + 1 + j,
+						agg,edge + 1);
+			}
+		for(agg = 0; agg < half; ++agg)
+			for(j = 0; j < half; ++j) {
+				core = k * k + agg * half + j;
+				link_switches(p_fabric,k * half + pod * half + agg,half + 1 + j,
+						core,pod + 1);
+			}
+	}
+	link_hosts(p_fabric,0,k * half,hosts);
+	return 0;
+}
+
+/*
+ * Every switch links its "+" port of a dimension to "-" port of
+ * the next switch in the ring. Ports of dimension d are
+ * hosts + 2 * d + 1 ("+") and hosts + 2 * d + 2 ("-").
+ */
+static int build_torus(struct topo_fabric *p_fabric,
+		const struct topo_gen_prm *p_prm,
+		const unsigned int dim_count)
+{
+	const unsigned int hosts = p_prm->hosts;
+	unsigned int dims[3] = { 1, 1, 1 };
+	size_t switch_count = 1, stride = 1, i = 0;
+	unsigned int d = 0;
+
+	for(d = 0; d < dim_count; ++d) {
+		dims[d] = p_prm->dims[d];
+		if(!dims[d]) {
+			fprintf(stderr,"Torus dimension %u is zero\n",d);
+			return -1;
+		}
+		switch_count *= dims[d];
+	}
+
+	if(fabric_alloc(p_fabric,switch_count,hosts + 2 * dim_count,
+				switch_count * hosts))
+		return -1;
+
+	for(d = 0; d < dim_count; ++d) {
+		if(dims[d] > 1) {
+			for(i = 0; i < switch_count; ++i) {
+				const size_t coord = (i / stride) % dims[d];
+				const size_t next = i - coord * stride +
+					((coord + 1) % dims[d]) * stride;
+
+				link_switches(p_fabric,i,hosts + 2 * d + 1,
+						next,hosts + 2 * d + 2);
+			}
+		}
+		stride *= dims[d];
+	}
+	link_hosts(p_fabric,0,switch_count,hosts);
+	return 0;
+}
+
+/*
+ * Router r of group G: switch G * routers + r.
+ * Ports: 1 .. hosts - hosts, then routers - 1 local ports, then
+ * global_links global ports.
+ * Global link k = r * global_links + j of group G leads to group
+ * (G + k + 1) mod groups. On the other side it has number groups - 2 - k.
+ */
+static int build_dragonfly(struct topo_fabric *p_fabric,
+		const struct topo_gen_prm *p_prm)
+{
+	const unsigned int a = p_prm->routers;
+	const unsigned int h = p_prm->global_links;
+	const unsigned int hosts = p_prm->hosts;
+	const size_t groups = (size_t)a * h + 1;
+	const unsigned int local_port = hosts + 1;
+	const unsigned int global_port = hosts + a;
+	size_t g = 0, k = 0;
+	unsigned int r = 0, q = 0;
+
+	if(!a || !h) {
+		fprintf(stderr,"Dragonfly needs routers and global links\n");
+		return -1;
+	}
+
+	if(fabric_alloc(p_fabric,groups * a,hosts + a - 1 + h,groups * a * hosts))
+		return -1;
+
+	for(g = 0; g < groups; ++g) {
+		for(r = 0; r < a; ++r)
+			for(q = r + 1; q < a; ++q)
+				link_switches(p_fabric,g * a + r,local_port + q - 1,
+						g * a + q,local_port + r);
+
+		for(k = 0; k < a * h; ++k) {
+			const size_t target = (g + k + 1) % groups;
+			const size_t remote_k = groups - 2 - k;
+
+			if(target < g)
+				continue;
+			link_switches(p_fabric,g * a + k / h,global_port + k % h,
+					target * a + remote_k / h,global_port + remote_k % h);
+		}
+	}
+	link_hosts(p_fabric,0,groups * a,hosts);
+	return 0;
+}
+
+/*
+ * Switches get LIDs 1 .. switch_count. Hosts get LMC aligned ranges.
+ */
+static int assign_lids(struct topo_fabric *p_fabric, const uint8_t lmc)
+{
+	const size_t lids_per_host = 1 << lmc;
+	size_t next_lid = 1, i = 0;
+
+	for(i = 0; i < p_fabric->switch_count; ++i)
+		p_fabric->p_lid[i] = next_lid++;
+
+	next_lid = (next_lid + lids_per_host - 1) & ~(lids_per_host - 1);
+	for(i = 0; i < p_fabric->host_count; ++i) {
+		if(next_lid + lids_per_host - 1 > TOPO_MAX_UNICAST_LID) {
+			fprintf(stderr,"The fabric doesn't fit unicast LID range. "
+					"Switches: %zu hosts: %zu LMC: %u\n",
+					p_fabric->switch_count,p_fabric->host_count,lmc);
+			return -1;
+		}
+		p_fabric->p_lid[p_fabric->switch_count + i] = next_lid;
+		next_lid += lids_per_host;
+	}
+
+	p_fabric->lmc = lmc;
+	p_fabric->max_lid = next_lid - 1;
+	return 0;
+}
+
+static void fill_guid_to_lid(const struct topo_fabric *p_fabric,
+		struct ep_guid_to_lid_tbl_rec *p_rec)
+{
+	size_t i = 0;
+
+	for(i = 0; i < p_fabric->switch_count; ++i, ++p_rec) {
+		p_rec->guid = htonll(TOPO_SWITCH_GUID_BASE + i);
+		p_rec->lid = htons(p_fabric->p_lid[i]);
+		p_rec->lmc = 0;
+		p_rec->is_switch = 1;
+	}
+
+	for(i = 0; i < p_fabric->host_count; ++i, ++p_rec) {
+		p_rec->guid = htonll(TOPO_HOST_GUID_BASE + i);
+		p_rec->lid = htons(p_fabric->p_lid[p_fabric->switch_count + i]);
+		p_rec->lmc = p_fabric->lmc;
+		p_rec->is_switch = 0;
+	}
+}
+
+/*
+ * Switch port 0 and all linked switch ports have port records.
+ * Links are stored in both directions.
+ */
+static void fill_ports_and_links(const struct topo_fabric *p_fabric,
+		const struct topo_gen_prm *p_prm,
+		struct ep_port_tbl_rec *p_port,
+		struct ep_link_tbl_rec *p_link)
+{
+	size_t i = 0;
+	unsigned int j = 0;
+
+	for(i = 0; i < p_fabric->switch_count; ++i) {
+		const be16_t lid = htons(p_fabric->p_lid[i]);
+
+		p_port->port_lid = lid;
+		p_port->port_num = 0;
+		p_port->neighbor_mtu = p_prm->mtu;
+		p_port->rate = p_prm->rate | SSA_DB_PORT_IS_SWITCH_MASK;
+		p_port++;
+
+		for(j = 1; j <= p_fabric->switch_ports; ++j) {
+			const size_t slot = peer_slot(p_fabric,i,j);
+			const uint32_t peer = p_fabric->p_peer[slot];
+
+			if(TOPO_NO_PEER == peer)
+				continue;
+
+			p_port->port_lid = lid;
+			p_port->port_num = j;
+			p_port->neighbor_mtu = p_prm->mtu;
+			p_port->rate = p_prm->rate | SSA_DB_PORT_IS_SWITCH_MASK;
+			p_port++;
+
+			p_link->from_lid = lid;
+			p_link->from_port_num = j;
+			p_link->to_lid = htons(p_fabric->p_lid[peer]);
+			p_link->to_port_num = p_fabric->p_peer_port[slot];
+			p_link++;
+		}
+	}
+
+	for(i = 0; i < p_fabric->host_count; ++i) {
+		const be16_t lid = htons(p_fabric->p_lid[p_fabric->switch_count + i]);
+
+		p_port->port_lid = lid;
+		p_port->port_num = 1;
+		p_port->neighbor_mtu = p_prm->mtu;
+		p_port->rate = p_prm->rate;
+		p_port++;
+
+		p_link->from_lid = lid;
+		p_link->from_port_num = 1;
+		p_link->to_lid = htons(p_fabric->p_lid[p_fabric->p_host_switch[i]]);
+		p_link->to_port_num = p_fabric->p_host_port[i];
+		p_link++;
+	}
+}
+
+static inline void set_lft_entry(struct ep_lft_block_tbl_rec *p_blocks,
+		const size_t blocks_per_switch,
+		const size_t switch_id,
+		const uint16_t lid,
+		const uint8_t port_num)
+{
+	p_blocks[switch_id * blocks_per_switch + lid / TOPO_LFT_BLOCK_SIZE].
+		block[lid % TOPO_LFT_BLOCK_SIZE] = port_num;
+}
+
+/*
+ * Minimal hop routes. For every destination switch a BFS over switches
+ * gives distances. A switch forwards a destination LID to one of its
+ * neighbors that are closer to the destination switch, the neighbor is
+ * selected by the LID.
+ */
+static int fill_lfts(const struct topo_fabric *p_fabric,
+		struct ep_lft_top_tbl_rec *p_top,
+		struct ep_lft_block_tbl_rec *p_blocks)
+{
+	const size_t switch_count = p_fabric->switch_count;
+	const unsigned int ports = p_fabric->switch_ports;
+	const size_t blocks_per_switch = p_fabric->max_lid / TOPO_LFT_BLOCK_SIZE + 1;
+	const unsigned int lids_per_host = 1 << p_fabric->lmc;
+	uint32_t *p_dist = NULL, *p_queue = NULL, *p_hosts = NULL;
+	uint8_t *p_candidates = NULL;
+	size_t i = 0, dest = 0, s = 0;
+	unsigned int j = 0, l = 0, host_count = 0;
+
+	p_dist = (uint32_t *)malloc(switch_count * sizeof(uint32_t));
+	p_queue = (uint32_t *)malloc(switch_count * sizeof(uint32_t));
+	p_candidates = (uint8_t *)malloc(ports + 1);
+	p_hosts = (uint32_t *)malloc((ports + 1) * sizeof(uint32_t));
+	if(!p_dist || !p_queue || !p_candidates || !p_hosts) {
+		fprintf(stderr,"Can't allocate routing buffers. Switches: %zu\n",switch_count);
+		free(p_dist);
+		free(p_queue);
+		free(p_candidates);
+		free(p_hosts);
+		return -1;
+	}
+
+	for(i = 0; i < switch_count; ++i) {
+		p_top[i].lid = htons(p_fabric->p_lid[i]);
+		p_top[i].lft_top = htons(p_fabric->max_lid);
+		for(j = 0; j < blocks_per_switch; ++j) {
+			struct ep_lft_block_tbl_rec *p_block = p_blocks + i * blocks_per_switch + j;
+
+			p_block->lid = htons(p_fabric->p_lid[i]);
+			p_block->block_num = htons(j);
+			memset(p_block->block,TOPO_NO_PATH,sizeof(p_block->block));
+		}
+	}
+
+	for(dest = 0; dest < switch_count; ++dest) {
+		size_t head = 0, tail = 0;
+
+		memset(p_dist,0xFF,switch_count * sizeof(uint32_t));
+		p_dist[dest] = 0;
+		p_queue[tail++] = dest;
+		while(head < tail) {
+			const size_t u = p_queue[head++];
+
+			for(j = 1; j <= ports; ++j) {
+				const uint32_t v = p_fabric->p_peer[peer_slot(p_fabric,u,j)];
+
+				if(v < switch_count && TOPO_NO_PEER == p_dist[v]) {
+					p_dist[v] = p_dist[u] + 1;
+					p_queue[tail++] = v;
+				}
+			}
+		}
+
+		/* Destination switch: its own LID and its hosts */
+		set_lft_entry(p_blocks,blocks_per_switch,dest,p_fabric->p_lid[dest],0);
+		host_count = 0;
+		for(j = 1; j <= ports; ++j) {
+			const uint32_t v = p_fabric->p_peer[peer_slot(p_fabric,dest,j)];
+
+			if(TOPO_NO_PEER == v || v < switch_count)
+				continue;
+			p_hosts[host_count++] = v;
+			for(l = 0; l < lids_per_host; ++l)
+				set_lft_entry(p_blocks,blocks_per_switch,dest,
+						p_fabric->p_lid[v] + l,j);
+		}
+
+		for(s = 0; s < switch_count; ++s) {
+			unsigned int count = 0;
+
+			if(s == dest || TOPO_NO_PEER == p_dist[s])
+				continue;
+
+			for(j = 1; j <= ports; ++j) {
+				const uint32_t v = p_fabric->p_peer[peer_slot(p_fabric,s,j)];
+
+				if(v < switch_count && p_dist[v] + 1 == p_dist[s])
+					p_candidates[count++] = j;
+			}
+
+			set_lft_entry(p_blocks,blocks_per_switch,s,p_fabric->p_lid[dest],
+					p_candidates[p_fabric->p_lid[dest] % count]);
+			for(j = 0; j < host_count; ++j) {
+				for(l = 0; l < lids_per_host; ++l) {
+					const uint16_t lid = p_fabric->p_lid[p_hosts[j]] + l;
+
+					set_lft_entry(p_blocks,blocks_per_switch,s,lid,
+							p_candidates[lid % count]);
+				}
+			}
+		}
+	}
+
+	free(p_dist);
+	free(p_queue);
+	free(p_candidates);
+	free(p_hosts);
+	return 0;
+}
+
+static void set_dataset(struct ssa_db *p_smdb, const int table_id,
+		const uint64_t count, const size_t rec_size,
+		const uint64_t epoch)
+{
+	struct db_dataset *p_dataset = &p_smdb->p_db_tables[table_id];
+
+	p_dataset->epoch = htonll(epoch);
+	p_dataset->set_count = htonll(count);
+	p_dataset->set_size = htonll(count * rec_size);
+	if(count)
+		memset(p_smdb->pp_tables[table_id],0,count * rec_size);
+}
+
+static struct ssa_db *fabric_to_smdb(const struct topo_fabric *p_fabric,
+		const struct topo_gen_prm *p_prm)
+{
+	struct ssa_db *p_smdb = NULL;
+	struct ep_subnet_opts_tbl_rec *p_opts = NULL;
+	uint64_t rec_count[SSA_TABLE_ID_MAX] = {};
+	size_t port_count = p_fabric->switch_count + p_fabric->host_count;
+	size_t i = 0;
+	unsigned int j = 0;
+
+	for(i = 0; i < p_fabric->switch_count; ++i)
+		for(j = 1; j <= p_fabric->switch_ports; ++j)
+			if(TOPO_NO_PEER != p_fabric->p_peer[peer_slot(p_fabric,i,j)])
+				port_count++;
+
+	rec_count[SSA_TABLE_ID_SUBNET_OPTS] = 1;
+	rec_count[SSA_TABLE_ID_GUID_TO_LID] = p_fabric->switch_count + p_fabric->host_count;
+	rec_count[SSA_TABLE_ID_PORT] = port_count;
+	rec_count[SSA_TABLE_ID_LINK] = 2 * p_fabric->link_count;
+	rec_count[SSA_TABLE_ID_LFT_TOP] = p_fabric->switch_count;
+	rec_count[SSA_TABLE_ID_LFT_BLOCK] = p_fabric->switch_count *
+		(p_fabric->max_lid / TOPO_LFT_BLOCK_SIZE + 1);
+
+	p_smdb = ssa_db_smdb_init(p_prm->epoch,rec_count);
+	if(!p_smdb) {
+		fprintf(stderr,"Can't create smdb database\n");
+		return NULL;
+	}
+
+	set_dataset(p_smdb,SSA_TABLE_ID_SUBNET_OPTS,rec_count[SSA_TABLE_ID_SUBNET_OPTS],
+			sizeof(struct ep_subnet_opts_tbl_rec),p_prm->epoch);
+	set_dataset(p_smdb,SSA_TABLE_ID_GUID_TO_LID,rec_count[SSA_TABLE_ID_GUID_TO_LID],
+			sizeof(struct ep_guid_to_lid_tbl_rec),p_prm->epoch);
+	set_dataset(p_smdb,SSA_TABLE_ID_PORT,rec_count[SSA_TABLE_ID_PORT],
+			sizeof(struct ep_port_tbl_rec),p_prm->epoch);
+	set_dataset(p_smdb,SSA_TABLE_ID_LINK,rec_count[SSA_TABLE_ID_LINK],
+			sizeof(struct ep_link_tbl_rec),p_prm->epoch);
+	set_dataset(p_smdb,SSA_TABLE_ID_LFT_TOP,rec_count[SSA_TABLE_ID_LFT_TOP],
+			sizeof(struct ep_lft_top_tbl_rec),p_prm->epoch);
+	set_dataset(p_smdb,SSA_TABLE_ID_LFT_BLOCK,rec_count[SSA_TABLE_ID_LFT_BLOCK],
+			sizeof(struct ep_lft_block_tbl_rec),p_prm->epoch);
+
+	p_opts = (struct ep_subnet_opts_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_SUBNET_OPTS];
+	p_opts->subnet_prefix = htonll(TOPO_SUBNET_PREFIX);
+	p_opts->lmc = p_fabric->lmc;
+	p_opts->subnet_timeout = p_prm->subnet_timeout;
+
+	fill_guid_to_lid(p_fabric,
+			(struct ep_guid_to_lid_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_GUID_TO_LID]);
+	fill_ports_and_links(p_fabric,p_prm,
+			(struct ep_port_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_PORT],
+			(struct ep_link_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_LINK]);
+	if(fill_lfts(p_fabric,
+				(struct ep_lft_top_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_LFT_TOP],
+				(struct ep_lft_block_tbl_rec *)p_smdb->pp_tables[SSA_TABLE_ID_LFT_BLOCK])) {
+		ssa_db_destroy(p_smdb);
+		return NULL;
+	}
+
+	return p_smdb;
+}
+
+static void set_defaults(struct topo_gen_prm *p_prm)
+{
+	unsigned int d = 0;
+
+	switch(p_prm->type) {
+		case TOPO_GEN_FAT_TREE:
+			if(!p_prm->radix)
+				p_prm->radix = 8;
+			if(!p_prm->levels)
+				p_prm->levels = 2;
+			if(!p_prm->hosts)
+				p_prm->hosts = p_prm->radix / 2;
+			break;
+		case TOPO_GEN_TORUS_2D:
+		case TOPO_GEN_TORUS_3D:
+			for(d = 0; d < 3; ++d)
+				if(!p_prm->dims[d])
+					p_prm->dims[d] = 4;
+			if(!p_prm->hosts)
+				p_prm->hosts = 1;
+			break;
+		case TOPO_GEN_DRAGONFLY:
+			if(!p_prm->routers)
+				p_prm->routers = 4;
+			if(!p_prm->global_links)
+				p_prm->global_links = 2;
+			if(!p_prm->hosts)
+				p_prm->hosts = 2;
+			break;
+		default:
+			break;
+	}
+
+	if(!p_prm->mtu)
+		p_prm->mtu = TOPO_DEFAULT_MTU;
+	if(!p_prm->rate)
+		p_prm->rate = TOPO_DEFAULT_RATE;
+	if(!p_prm->subnet_timeout)
+		p_prm->subnet_timeout = TOPO_DEFAULT_SUBNET_TIMEOUT;
+	if(!p_prm->epoch)
+		p_prm->epoch = 1;
+}
+
+struct ssa_db *topo_gen_create(const struct topo_gen_prm *p_input_prm,
+		struct topo_gen_stats *p_stats)
+{
+	struct topo_fabric fabric;
+	struct topo_gen_prm prm = *p_input_prm;
+	struct ssa_db *p_smdb = NULL;
+	int res = -1;
+
+	memset(&fabric,0,sizeof(fabric));
+	set_defaults(&prm);
+
+	if(prm.lmc > 7) {
+		fprintf(stderr,"LMC has to be in range 0 .. 7: %u\n",prm.lmc);
+		return NULL;
+	}
+
+	switch(prm.type) {
+		case TOPO_GEN_FAT_TREE:
+			res = build_fat_tree(&fabric,&prm);
+			break;
+		case TOPO_GEN_TORUS_2D:
+			res = build_torus(&fabric,&prm,2);
+			break;
+		case TOPO_GEN_TORUS_3D:
+			res = build_torus(&fabric,&prm,3);
+			break;
+		case TOPO_GEN_DRAGONFLY:
+			res = build_dragonfly(&fabric,&prm);
+			break;
+		default:
+			fprintf(stderr,"Unknown topology type: %d\n",prm.type);
+			break;
+	}
+	if(res)
+		goto Exit;
+
+	if(assign_lids(&fabric,prm.lmc))
+		goto Exit;
+
+	p_smdb = fabric_to_smdb(&fabric,&prm);
+	if(p_smdb && p_stats) {
+		p_stats->switches = fabric.switch_count;
+		p_stats->hosts = fabric.host_count;
+		p_stats->links = fabric.link_count;
+		p_stats->max_lid = fabric.max_lid;
+	}
+
+Exit:
+	fabric_free(&fabric);
+	return p_smdb;
+}
+
+enum topo_gen_type topo_gen_type_by_name(const char *name)
+{
+	int i = 0;
+
+	for(i = 0; i < TOPO_GEN_TYPE_MAX; ++i)
+		if(!strcmp(name,topo_type_names[i]))
+			return (enum topo_gen_type)i;
+	return TOPO_GEN_TYPE_MAX;
+}
+
+const char *topo_gen_type_name(enum topo_gen_type type)
+{
+	return type < TOPO_GEN_TYPE_MAX ? topo_type_names[type] : "unknown";
+}
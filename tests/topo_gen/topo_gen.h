@@ -0,0 +1,132 @@
+/*
+ * Copyright 2004-2013 Mellanox Technologies LTD. All rights reserved.
+ *
+ * This software is available to you under the terms of the
+ * OpenIB.org BSD license included below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+#ifndef TOPO_GEN_H
+#define TOPO_GEN_H
+
+/*
+ * Synthetic fabric generator. It builds a smdb database with
+ * SUBNET_OPTS, GUID_TO_LID, PORT, LINK, LFT_TOP and LFT_BLOCK tables.
+ * Forwarding tables contain minimal hop routes. If a destination is
+ * reachable by several ports, ports are chosen by destination LID, so
+ * LIDs of one LMC range are spread over different routes.
+ */
+
+#include <stdint.h>
+#include <ssa_db.h>
+
+/*
+ *@TOPO_GEN_FAT_TREE - fat tree of switches with "radix" ports. Two
+ *                     levels: "radix" leaves and radix/2 spines.
+ *                     Three levels: "radix" pods of radix/2 edge and
+ *                     radix/2 aggregation switches, (radix/2)^2 cores.
+ *@TOPO_GEN_TORUS_2D - dims[0] x dims[1] torus of switches.
+ *@TOPO_GEN_TORUS_3D - dims[0] x dims[1] x dims[2] torus of switches.
+ *@TOPO_GEN_DRAGONFLY - groups of "routers" fully connected switches. Every
+ *                      switch has "global_links" links to other groups.
+ *                      There are routers * global_links + 1 groups, every
+ *                      pair of groups is connected by one link.
+ */
+enum topo_gen_type {
+	TOPO_GEN_FAT_TREE = 0,
+	TOPO_GEN_TORUS_2D,
+	TOPO_GEN_TORUS_3D,
+	TOPO_GEN_DRAGONFLY,
+	TOPO_GEN_TYPE_MAX
+};
+
+/*
+ * Parameters of a generated fabric. Zero values are replaced by defaults.
+ *
+ *@radix - fat tree: number of switch ports. Default: 8.
+ *@levels - fat tree: 2 or 3. Default: 2.
+ *@dims - torus: switches per dimension. Default: 4.
+ *@routers - dragonfly: switches per group. Default: 4.
+ *@global_links - dragonfly: global links per switch. Default: 2.
+ *@hosts - channel adapters per leaf switch. Default: radix/2 for
+ *         fat tree, 1 for torus, 2 for dragonfly.
+ *@lmc - LMC of channel adapters. Switches always have LMC 0.
+ *@mtu - MTU of all links (IB encoding). Default: 4096.
+ *@rate - rate of all links (IB encoding). Default: 40 Gb/s.
+ *@subnet_timeout - subnet timeout. Default: 18.
+ *@epoch - epoch of smdb tables. Default: 1.
+ */
+struct topo_gen_prm {
+	enum topo_gen_type type;
+	unsigned int radix;
+	unsigned int levels;
+	unsigned int dims[3];
+	unsigned int routers;
+	unsigned int global_links;
+	unsigned int hosts;
+	uint8_t lmc;
+	uint8_t mtu;
+	uint8_t rate;
+	uint8_t subnet_timeout;
+	uint64_t epoch;
+};
+
+/*
+ * Size of a generated fabric.
+ */
+struct topo_gen_stats {
+	size_t switches;
+	size_t hosts;
+	size_t links;
+	uint16_t max_lid;
+};
+
+/**
+ * topo_gen_create - generates a smdb database
+ * @p_prm: Fabric parameters
+ * @p_stats: Output. Size of the fabric. Can be NULL.
+ *
+ * @return value: smdb database. NULL - failure. Fails if the fabric
+ *                doesn't fit unicast LID range.
+ *
+ * The database is destroyed by ssa_db_destroy.
+ **/
+extern struct ssa_db *topo_gen_create(const struct topo_gen_prm *p_prm,
+		struct topo_gen_stats *p_stats);
+
+/**
+ * topo_gen_type_by_name - converts a topology name to type
+ * @name: "fat-tree", "torus-2d", "torus-3d" or "dragonfly"
+ *
+ * @return value: topology type. TOPO_GEN_TYPE_MAX - unknown name.
+ **/
+extern enum topo_gen_type topo_gen_type_by_name(const char *name);
+
+/**
+ * topo_gen_type_name - returns a name of a topology type
+ * @type: Topology type
+ **/
+extern const char *topo_gen_type_name(enum topo_gen_type type);
+
+#endif /* end of include guard: TOPO_GEN_H */
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2004-2013 Mellanox Technologies LTD. All rights reserved.
+ *
+ * This software is available to you under the terms of the
+ * OpenIB.org BSD license included below:
+ *
+ *     Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *      - Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *
+ *      - Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ctype.h>
+#include <errno.h>
+#include <linux/limits.h>
+#include <dirent.h>
+
+#include <ssa_db.h>
+#include <ssa_db_helper.h>
+
+#include "topo_gen.h"
+
+static void print_usage(FILE *file,const char *name)
+{
+	fprintf(file,"Usage: %s [-h] [-t type] [-k radix] [-n levels] [-d XxY[xZ]] [-r routers] [-g global links] [-p hosts] [-m lmc] [-e epoch] output folder\n", name);
+	fprintf(file,"\t-h\t\t-Print this help\n");
+	fprintf(file,"\t-t\t\t-Topology: fat-tree, torus-2d, torus-3d or dragonfly. Default: fat-tree\n");
+	fprintf(file,"\t-k\t\t-Fat tree: switch radix. Default: 8\n");
+	fprintf(file,"\t-n\t\t-Fat tree: number of levels, 2 or 3. Default: 2\n");
+	fprintf(file,"\t-d\t\t-Torus: switches per dimension. Default: 4x4[x4]\n");
+	fprintf(file,"\t-r\t\t-Dragonfly: switches per group. Default: 4\n");
+	fprintf(file,"\t-g\t\t-Dragonfly: global links per switch. Default: 2\n");
+	fprintf(file,"\t-p\t\t-Channel adapters per leaf switch\n");
+	fprintf(file,"\t-m\t\t-LMC of channel adapters. Default: 0\n");
+	fprintf(file,"\t-e\t\t-Epoch of smdb tables. Default: 1\n");
+	fprintf(file,"\toutput folder\t-smdb database location\n");
+}
+
+static int is_dir_exist(const char* path)
+{
+	DIR *dir = opendir(path);
+
+	if(dir) {
+		closedir(dir);
+		dir = NULL;
+		return 1;
+	}
+	return 0;
+}
+
+static int parse_uint(const char *str, unsigned int *p_val)
+{
+	if(1 != sscanf(str,"%u",p_val)) {
+		fprintf(stderr,"String : %s can't be converted to numeric value.\n",str);
+		return -1;
+	}
+	return 0;
+}
+
+static int parse_ulong(const char *str, unsigned long *p_val)
+{
+	char *p_end = NULL;
+
+	errno = 0;
+	*p_val = strtoul(str,&p_end,10);
+	if(errno || p_end == str || *p_end || '-' == *str) {
+		fprintf(stderr,"String : %s can't be converted to numeric value.\n",str);
+		return -1;
+	}
+	return 0;
+}
+
+int main(int argc,char *argv[])
+{
+	int opt = 0;
+	struct topo_gen_prm prm;
+	struct topo_gen_stats stats;
+	struct ssa_db *p_smdb = NULL;
+	char smdb_path[PATH_MAX] = {};
+	unsigned int val = 0;
+	unsigned long lmc = 0;
+	int err_opt = 0;
+
+	memset(&prm,'\0',sizeof(prm));
+	memset(&stats,'\0',sizeof(stats));
+	prm.type = TOPO_GEN_FAT_TREE;
+
+	while ((opt = getopt(argc, argv, "t:k:n:d:r:g:p:m:e:h?")) != -1) {
+		switch (opt) {
+			case 't':
+				prm.type = topo_gen_type_by_name(optarg);
+				if(TOPO_GEN_TYPE_MAX == prm.type) {
+					fprintf(stderr,"Unknown topology: %s\n",optarg);
+					err_opt = 1;
+				}
+				break;
+			case 'k':
+				err_opt = parse_uint(optarg,&prm.radix);
+				break;
+			case 'n':
+				err_opt = parse_uint(optarg,&prm.levels);
+				break;
+			case 'd':
+				if(sscanf(optarg,"%ux%ux%u",&prm.dims[0],&prm.dims[1],&prm.dims[2]) < 2) {
+					fprintf(stderr,"Wrong torus dimensions: %s\n",optarg);
+					err_opt = 1;
+				}
+				break;
+			case 'r':
+				err_opt = parse_uint(optarg,&prm.routers);
+				break;
+			case 'g':
+				err_opt = parse_uint(optarg,&prm.global_links);
+				break;
+			case 'p':
+				err_opt = parse_uint(optarg,&prm.hosts);
+				break;
+			case 'm':
+				err_opt = parse_ulong(optarg,&lmc);
+				if(!err_opt && lmc > 7) {
+					fprintf(stderr,"LMC must be in range [0, 7]: %s\n",optarg);
+					err_opt = 1;
+				}
+				prm.lmc = lmc;
+				break;
+			case 'e':
+				err_opt = parse_uint(optarg,&val);
+				prm.epoch = val;
+				break;
+			case '?':
+			case 'h':
+				print_usage(stdout,argv[0]);
+				return 0;
+				break;
+			default: /* '?' */
+				if(isprint (optopt))
+					fprintf (stderr, "Unknown option `-%c'.\n", optopt);
+				else
+					fprintf (stderr,
+							"Unknown option character `\\x%x'.\n",
+							optopt);
+				print_usage(stderr,argv[0]);
+				exit(EXIT_FAILURE);
+		}
+		if(err_opt) {
+			print_usage(stderr,argv[0]);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if(argc != (optind + 1)) {
+		fprintf(stderr,"Output folder is expected\n");
+		print_usage(stderr,argv[0]);
+		exit(EXIT_FAILURE);
+	}
+	strncpy(smdb_path,argv[optind],PATH_MAX - 1);
+
+	if(!is_dir_exist(smdb_path)) {
+		fprintf(stderr,"Directory does not exist: %s\n",smdb_path);
+		print_usage(stderr,argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	p_smdb = topo_gen_create(&prm,&stats);
+	if(!p_smdb) {
+		fprintf(stderr,"smdb database generation is failed.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	printf("Topology: %s\n",topo_gen_type_name(prm.type));
+	printf("Switches: %zu Channel adapters: %zu Links: %zu Max LID: %u\n",
+			stats.switches,stats.hosts,stats.links,stats.max_lid);
+
+	ssa_db_save(smdb_path,p_smdb,SSA_DB_HELPER_DEBUG);
+	printf("smdb database is saved to: %s\n",smdb_path);
+
+	ssa_db_destroy(p_smdb);
+	return 0;
+}